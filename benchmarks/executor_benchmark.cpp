@@ -0,0 +1,120 @@
+#include <graphloom/graphloom.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+/**
+ * Measures the executor's per node overhead with kernels
+ * that do nothing: a chain, where every node continues on
+ * the thread of its input, and a fan out, where one node
+ * releases every other. Also measures building the
+ * executable graph, kernel resolution included.
+ *
+ * Usage: executor_benchmark [num_nodes] [runs], default 100000 20
+*/
+
+using namespace graphloom;
+
+namespace
+{
+    class NopKernel : public OpKernel
+    {
+    public:
+        NopKernel(const OpKernelContext& context) : OpKernel(context) {}
+
+        Status Compute(ComputeContext& context) override
+        {
+            return Status::kOK;
+        }
+    };
+
+    Status ScalarShape(const ComputeContext& context, LayoutArray& shape)
+    {
+        shape = {1};
+        return Status::kOK;
+    }
+
+    /**
+     * @returns Mean ns per node of updating a session to graph
+    */
+    double TimeUpdates(const GraphDef& graph, size_t runs)
+    {
+        Session session;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t run = 0; run < runs; ++run)
+        {
+            GL_CHECK_OK(session.UpdateGraph(graph));
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return 1e9 * seconds / (runs * graph.num_nodes());
+    }
+
+    /**
+     * @returns Mean ns per node of running targets
+    */
+    double TimeRuns(const GraphDef& graph, const std::vector<NodeDef*>& targets,
+        size_t threads, size_t runs)
+    {
+        SessionOptions options;
+        options.inter_op_threads = threads;
+        Session session(options);
+        GL_CHECK_OK(session.UpdateGraph(graph));
+
+        // first run warms the caches and scratch allocators
+        std::vector<TensorBuffer> outputs;
+        GL_CHECK_OK(session.Run({}, targets, outputs));
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t run = 0; run < runs; ++run)
+        {
+            GL_CHECK_OK(session.Run({}, targets, outputs));
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return 1e9 * seconds / (runs * graph.num_nodes());
+    }
+}
+
+GL_REGISTER_OP("bench_source").Output(ScalarShape).Build();
+GL_REGISTER_OP("bench_unary").Input().Output(ScalarShape).Build();
+GL_REGISTER_KERNEL("bench_source", NopKernel, "CPU").
+    Output(DataType::Float).Build();
+GL_REGISTER_KERNEL("bench_unary", NopKernel, "CPU").
+    Input(DataType::Float).Output(DataType::Float).Build();
+
+int main(int argc, char** argv)
+{
+    size_t num_nodes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+    size_t runs = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 20;
+    if (num_nodes < 2 || runs == 0)
+    {
+        std::fprintf(stderr, "usage: %s [num_nodes] [runs]\n", argv[0]);
+        return 1;
+    }
+
+    GraphDef chain;
+    NodeDef* node = NodeDefBuilder(chain, "bench_source", "CPU:0").Build({DataType::Float});
+    for (size_t i = 1; i < num_nodes; ++i)
+    {
+        node = NodeDefBuilder(chain, "bench_unary", "CPU:0").
+            Input(node, 0).
+            Build({DataType::Float});
+    }
+
+    GraphDef fan_out;
+    NodeDef* source = NodeDefBuilder(fan_out, "bench_source", "CPU:0").Build({DataType::Float});
+    std::vector<NodeDef*> leaves;
+    for (size_t i = 1; i < num_nodes; ++i)
+    {
+        leaves.push_back(NodeDefBuilder(fan_out, "bench_unary", "CPU:0").
+            Input(source, 0).
+            Build({DataType::Float}));
+    }
+
+    std::printf("nodes: %zu, runs: %zu\n", num_nodes, runs);
+    std::printf("chain,   1 thread:  %.1f ns/node\n", TimeRuns(chain, {node}, 1, runs));
+    std::printf("fan out, 1 thread:  %.1f ns/node\n", TimeRuns(fan_out, leaves, 1, runs));
+    std::printf("fan out, 4 threads: %.1f ns/node\n", TimeRuns(fan_out, leaves, 4, runs));
+    std::printf("update graph:       %.1f ns/node\n", TimeUpdates(chain, runs));
+    return 0;
+}
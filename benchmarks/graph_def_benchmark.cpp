@@ -0,0 +1,100 @@
+#include <graphloom/graphloom.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+/**
+ * Builds a chain of nodes that all request the same name,
+ * the worst case of unique name generation, looks every
+ * node up by name, then compacts the adjacency and walks
+ * it.
+ *
+ * Usage: graph_def_benchmark [num_nodes], default 1000000
+*/
+
+using namespace graphloom;
+
+namespace
+{
+    Status ScalarShape(const ComputeContext& context, LayoutArray& shape)
+    {
+        shape = {1};
+        return Status::kOK;
+    }
+
+    double SecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+GL_REGISTER_OP("bench_source").Output(ScalarShape).Build();
+GL_REGISTER_OP("bench_unary").Input().Output(ScalarShape).Build();
+
+int main(int argc, char** argv)
+{
+    size_t num_nodes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    if (num_nodes == 0)
+    {
+        std::fprintf(stderr, "usage: %s [num_nodes]\n", argv[0]);
+        return 1;
+    }
+
+    GraphDef graph;
+    std::vector<NodeDef*> nodes;
+    nodes.reserve(num_nodes);
+
+    auto start = std::chrono::steady_clock::now();
+    nodes.push_back(NodeDefBuilder(graph, "bench_source", "CPU:0").
+        Name("node").
+        Build({DataType::Float}));
+    for (size_t i = 1; i < num_nodes; ++i)
+    {
+        nodes.push_back(NodeDefBuilder(graph, "bench_unary", "CPU:0").
+            Input(nodes.back(), 0).
+            Name("node").
+            Build({DataType::Float}));
+    }
+    double build_seconds = SecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    size_t found = 0;
+    for (const NodeDef* node : nodes)
+    {
+        found += graph.FindNode(node->name()) == node;
+    }
+    double find_seconds = SecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    GraphDefAdjacency adjacency = graph.Adjacency();
+    double adjacency_seconds = SecondsSince(start);
+
+    // longest path from the source, a typical whole graph pass
+    start = std::chrono::steady_clock::now();
+    std::vector<size_t> depth(num_nodes, 0);
+    for (size_t i = 0; i < num_nodes; ++i)
+    {
+        for (size_t e = adjacency.out_offsets[i]; e < adjacency.out_offsets[i + 1]; ++e)
+        {
+            size_t& dest = depth[adjacency.out_nodes[e]];
+            dest = std::max(dest, depth[i] + 1);
+        }
+    }
+    double walk_seconds = SecondsSince(start);
+
+    if (found != num_nodes || graph.num_nodes() != num_nodes || depth.back() != num_nodes - 1)
+    {
+        std::fprintf(stderr, "lookup failed, found %zu of %zu nodes\n", found, num_nodes);
+        return 1;
+    }
+
+    std::printf("nodes:    %zu\n", num_nodes);
+    std::printf("build:    %.3f s, %.1f ns/node\n", build_seconds, 1e9 * build_seconds / num_nodes);
+    std::printf("FindNode: %.3f s, %.1f ns/node\n", find_seconds, 1e9 * find_seconds / num_nodes);
+    std::printf("compact:  %.3f s, %.1f ns/node\n", adjacency_seconds, 1e9 * adjacency_seconds / num_nodes);
+    std::printf("walk:     %.3f s, %.1f ns/node\n", walk_seconds, 1e9 * walk_seconds / num_nodes);
+    return 0;
+}
@@ -2,8 +2,11 @@
 #define GRAPHLOOM_COMMON_DATA_TYPE_H_
 
 #include <unordered_map>
+#include <cstddef>
 #include <cstdint>
 
+#include "graphloom/common/half.h"
+
 /**
  * This module defines the DataType enum 
  * and its helpers.
@@ -22,6 +25,9 @@ namespace graphloom
         Int16,
         Int32,
         Int64,
+
+        Float16,
+        BFloat16,
     };
 
     /**
@@ -34,7 +40,9 @@ namespace graphloom
         sizeof(int8_t),
         sizeof(int16_t),
         sizeof(int32_t),
-        sizeof(int64_t)
+        sizeof(int64_t),
+        sizeof(Fp16),
+        sizeof(Bf16)
     };
 
     /**
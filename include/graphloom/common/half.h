@@ -0,0 +1,176 @@
+#ifndef GRAPHLOOM_COMMON_HALF_H_
+#define GRAPHLOOM_COMMON_HALF_H_
+
+#include <cstdint>
+#include <cstring>
+
+/**
+ * This module defines the 16 bit floating point element 
+ * types of DataType::Float16 and DataType::BFloat16. 
+ * Fp16 is IEEE 754 binary16: 5 exponent and 10 mantissa 
+ * bits. Bf16 is the upper half of a float: 8 exponent 
+ * and 7 mantissa bits, the range of float at lower 
+ * precision. Both are storage types, math converts them 
+ * to float. Conversions from float round to nearest even.
+*/
+
+namespace graphloom
+{
+    /**
+     * @param value Float to convert
+     * @returns IEEE binary16 bits of value
+    */
+    inline uint16_t FloatToFp16Bits(float value)
+    {
+        // float_to_half_fast3_rtne by Fabian Giesen
+        const uint32_t f32_infinity = 255u << 23;
+        const uint32_t f16_max = (127u + 16) << 23;
+        const uint32_t denorm_magic = ((127u - 15) + (23 - 10) + 1) << 23;
+
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        uint32_t sign = bits & 0x80000000u;
+        bits ^= sign;
+
+        uint16_t result;
+        if (bits >= f16_max)
+        {
+            // NaN stays a quiet NaN, the rest overflows to infinity
+            result = bits > f32_infinity ? 0x7e00 : 0x7c00;
+        }
+        else if (bits < (113u << 23))
+        {
+            // subnormal or zero, the float add rounds the mantissa
+            float magic;
+            std::memcpy(&magic, &denorm_magic, sizeof(magic));
+            float sum;
+            std::memcpy(&sum, &bits, sizeof(sum));
+            sum += magic;
+            uint32_t sum_bits;
+            std::memcpy(&sum_bits, &sum, sizeof(sum_bits));
+            result = static_cast<uint16_t>(sum_bits - denorm_magic);
+        }
+        else
+        {
+            uint32_t mantissa_odd = (bits >> 13) & 1;
+            bits += ((15u - 127) << 23) + 0xfff + mantissa_odd;
+            result = static_cast<uint16_t>(bits >> 13);
+        }
+        return static_cast<uint16_t>(result | (sign >> 16));
+    }
+
+    /**
+     * @param bits IEEE binary16 bits
+     * @returns Float of equal value
+    */
+    inline float Fp16BitsToFloat(uint16_t bits)
+    {
+        const uint32_t shifted_exponent = 0x7c00u << 13;
+
+        uint32_t result = (bits & 0x7fffu) << 13;
+        uint32_t exponent = result & shifted_exponent;
+        result += (127u - 15) << 23;
+        if (exponent == shifted_exponent)
+        {
+            // infinity or NaN
+            result += (128u - 16) << 23;
+        }
+        else if (exponent == 0)
+        {
+            // subnormal, renormalized by a float subtract
+            const uint32_t magic_bits = 113u << 23;
+            float magic;
+            std::memcpy(&magic, &magic_bits, sizeof(magic));
+            result += 1u << 23;
+            float value;
+            std::memcpy(&value, &result, sizeof(value));
+            value -= magic;
+            std::memcpy(&result, &value, sizeof(result));
+        }
+        result |= static_cast<uint32_t>(bits & 0x8000u) << 16;
+
+        float value;
+        std::memcpy(&value, &result, sizeof(value));
+        return value;
+    }
+
+    /**
+     * @param value Float to convert
+     * @returns bfloat16 bits of value
+    */
+    inline uint16_t FloatToBf16Bits(float value)
+    {
+        // branch free so loops over it vectorize
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        uint32_t rounded = (bits + 0x7fffu + ((bits >> 16) & 1)) >> 16;
+        uint32_t nan = (bits >> 16) | 0x40;
+        return static_cast<uint16_t>((bits & 0x7fffffffu) > 0x7f800000u ? nan : rounded);
+    }
+
+    /**
+     * @param bits bfloat16 bits
+     * @returns Float of equal value
+    */
+    inline float Bf16BitsToFloat(uint16_t bits)
+    {
+        uint32_t result = static_cast<uint32_t>(bits) << 16;
+        float value;
+        std::memcpy(&value, &result, sizeof(value));
+        return value;
+    }
+
+    // Element of DataType::Float16
+    struct Fp16
+    {
+        uint16_t bits;
+
+        Fp16() = default;
+
+        explicit Fp16(float value) : 
+            bits(FloatToFp16Bits(value))
+        {
+
+        }
+
+        explicit operator float() const
+        {
+            return Fp16BitsToFloat(bits);
+        }
+
+        static Fp16 FromBits(uint16_t bits)
+        {
+            Fp16 value;
+            value.bits = bits;
+            return value;
+        }
+    };
+
+    // Element of DataType::BFloat16
+    struct Bf16
+    {
+        uint16_t bits;
+
+        Bf16() = default;
+
+        explicit Bf16(float value) : 
+            bits(FloatToBf16Bits(value))
+        {
+
+        }
+
+        explicit operator float() const
+        {
+            return Bf16BitsToFloat(bits);
+        }
+
+        static Bf16 FromBits(uint16_t bits)
+        {
+            Bf16 value;
+            value.bits = bits;
+            return value;
+        }
+    };
+}
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <omp.h>
 #include <string>
+#include <vector>
 
 #include "graphloom/device/device.h"
 #include "graphloom/device/registration.h"
@@ -14,17 +15,117 @@
 
 namespace graphloom
 {
+    class CachingAllocator;
 
-    // Represents an instance of CPU device
+    /**
+     * Page size backing large CPU buffers
+    */
+    enum class HugePages
+    {
+        Off,            // base pages
+        Transparent,    // huge page aligned and advised, the kernel promotes them
+        Explicit,       // reserved huge pages (hugetlbfs), Transparent if none left
+    };
+
+    /**
+     * How a Cpu obtains memory from the system. Every buffer
+     * is 64 byte aligned, a cache line and an AVX-512 vector.
+     * Buffers of at least mapped_threshold bytes are mapped 
+     * from the system on their own with the options below, 
+     * smaller ones are carved from shared slabs.
+    */
+    struct CpuAllocOptions
+    {
+        // Min bytes of a buffer mapped with the options below
+        size_t mapped_threshold = size_t(1) << 21;
+
+        // Page size of mapped buffers
+        HugePages huge_pages = HugePages::Transparent;
+
+        // Fault in mapped buffers when they are allocated, 
+        // so the first kernel to use them does not
+        bool prefault = false;
+
+        // Lock mapped buffers in RAM, implies prefault. Best
+        // effort, limited by RLIMIT_MEMLOCK
+        bool lock = false;
+    };
+
+    /**
+     * Represents an instance of CPU device.
+     * 
+     * Buffers are served by a size-class caching allocator,
+     * freed buffers are kept for reuse rather than returned
+     * to the system.
+     * 
+     * Buffers are cached once allocated, so CpuAllocOptions
+     * are best set before the memory they are meant for is
+     * allocated, ex. before Session::UpdateGraph() plans its
+     * persistent arenas.
+     * 
+     * A Cpu bound to a NUMA node prefers the node's memory 
+     * for its buffers and runs its nodes on workers pinned 
+     * to the node's cpus.
+    */
     class Cpu : public Device
     {
     public:
+        Cpu();
+
+        /**
+         * @param numa_node NUMA node of the device
+         * @param cpus Logical cpus of the node, one worker each
+        */
+        Cpu(int numa_node, const std::vector<int>& cpus);
+        ~Cpu() override;
+
         Status status() const override;
         Status malloc(DataType dtype, size_t size, void*& ptr) override;
         Status free(DataType dtype, void* ptr) override;
+        Status memcpy(void* dest, const void* src, size_t bytes) override;
+
+        /**
+         * Started on first use, nullptr unless bound to a NUMA node
+        */
+        ThreadPool* workers() override;
+
+        /**
+         * Applies to memory obtained from the system from now on,
+         * cached buffers keep how they were allocated.
+         * 
+         * NOTE: Thread safe
+         * 
+         * @param options Allocation options
+        */
+        void set_alloc_options(const CpuAllocOptions& options);
+
+        /**
+         * @returns Current allocation options
+        */
+        CpuAllocOptions alloc_options() const;
+
+        /**
+         * @returns NUMA node of the device, -1 if not bound
+        */
+        int numa_node() const;
+
+        /**
+         * @returns Logical cpus of the NUMA node, empty if not bound
+        */
+        const std::vector<int>& cpus() const;
+
+    private:
+        CachingAllocator* const allocator_;
+        const int numa_node_;
+        const std::vector<int> cpus_;
+        ThreadPool* workers_; // guarded by lock_
     };
 
-    // Responsible for CPU device discovery
+    /**
+     * Responsible for CPU device discovery. Hosts with
+     * several NUMA nodes get one device per node, named 
+     * in node order, otherwise a single unbound device.
+    */
     class CpuFactory : public DeviceFactory
     {
     public:
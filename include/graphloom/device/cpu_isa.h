@@ -0,0 +1,60 @@
+#ifndef GRAPHLOOM_DEVICE_CPU_ISA_H_
+#define GRAPHLOOM_DEVICE_CPU_ISA_H_
+
+/**
+ * This module defines the CPU instruction set levels
+ * kernels may require. The host CPU is probed once, 
+ * kernel resolution then picks the best kernel the 
+ * host supports, so one binary uses the widest vector
+ * units of every machine it runs on.
+*/
+
+namespace graphloom
+{
+    /**
+     * x86 instruction set levels. Every level requires 
+     * all levels before it, the host level is the highest 
+     * level the CPU and OS fully support.
+    */
+    enum CpuIsa
+    {
+        Generic,        // any CPU
+        Sse42,          // SSE4.2
+        Avx2,           // AVX2, FMA and F16C
+        Avx512,         // AVX-512 F, BW, DQ and VL
+        Avx512Vnni,     // Avx512 and AVX-512 VNNI
+        Avx512Bf16,     // Avx512Vnni and AVX-512 BF16
+    };
+
+    /**
+     * @returns Highest level supported by the host, 
+     * capped by LimitCpuIsa()
+    */
+    CpuIsa HostCpuIsa();
+
+    /**
+     * @param isa Level to check
+     * @returns True if kernels requiring isa may run on the host
+    */
+    bool CpuIsaSupported(CpuIsa isa);
+
+    /**
+     * Caps the level reported by HostCpuIsa(). Graphs 
+     * updated afterwards resolve kernels of at most isa.
+     * Used to pin a fleet to one code path or to test 
+     * lower levels on a newer CPU.
+     * 
+     * NOTE: Thread safe
+     * 
+     * @param isa Highest level allowed
+    */
+    void LimitCpuIsa(CpuIsa isa);
+
+    /**
+     * @param isa Level
+     * @returns Printable name of isa
+    */
+    const char* CpuIsaName(CpuIsa isa);
+}
+
+#endif
@@ -2,6 +2,7 @@
 #define GRAPHLOOM_DEVICE_DEVICE_H_
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <omp.h>
 
@@ -24,6 +25,75 @@
 namespace graphloom
 {
     class OpKernel;
+    class MemoryProfiler;
+    class ThreadPool;
+
+    // Buckets of the allocation size histogram. Bucket i
+    // counts allocations of (2^(i-1), 2^i] bytes, bucket 0
+    // those of at most 1 byte and the last every larger one
+    constexpr size_t kMemoryHistogramBuckets = 48;
+
+    /**
+     * Snapshot of the allocations made on a device, 
+     * or by one node on a device
+    */
+    struct MemoryStats
+    {
+        size_t live_bytes = 0;  // allocated and not yet freed
+        size_t peak_bytes = 0;  // max of live_bytes, a device's may miss up to 1 MiB of it
+        size_t num_allocs = 0;  // number of allocations
+        size_t num_frees = 0;   // number of frees
+        size_t histogram[kMemoryHistogramBuckets] = {}; // allocations per size bucket
+    };
+
+    /**
+     * What a device records on top of its MemoryStats
+    */
+    enum class MemoryProfiling
+    {
+        Off,        // device totals only
+        Nodes,      // MemoryStats of every node allocating
+        CallSites,  // and the call stack of every live allocation
+    };
+
+    /**
+     * A live allocation of a profiled device
+    */
+    struct AllocationRecord
+    {
+        const void* ptr = nullptr;
+        size_t bytes = 0;
+        std::string node;                   // node allocating, empty outside of a MemoryScope
+        std::vector<std::string> call_site; // innermost frame first, if MemoryProfiling::CallSites
+    };
+
+    /**
+     * Attributes the device allocations of the calling
+     * thread to a graph node while in scope. The executor
+     * opens one around each node it computes. Scopes nest, 
+     * the innermost wins.
+    */
+    class MemoryScope
+    {
+    public:
+        /**
+         * @param node Name of the node, must outlive the scope
+        */
+        explicit MemoryScope(const std::string& node);
+        ~MemoryScope();
+
+        MemoryScope(const MemoryScope&)             = delete;
+        MemoryScope& operator=(const MemoryScope&)  = delete;
+
+        /**
+         * @returns Node of the calling thread's innermost 
+         * scope, nullptr if none
+        */
+        static const std::string* current();
+
+    private:
+        const std::string* const previous_;
+    };
 
     /**
      * The Device class is intended to be inherited to represent 
@@ -82,6 +152,82 @@ namespace graphloom
         */
         virtual Status free(DataType dtype, void* ptr) = 0;
 
+        /**
+         * Copies bytes between two buffers allocated on this device.
+         * 
+         * NOTE: Must be thread safe
+         * 
+         * @param dest Destination buffer
+         * @param src Source buffer
+         * @param bytes Number of bytes to copy
+         * @returns Copy status
+        */
+        virtual Status memcpy(void* dest, const void* src, size_t bytes) = 0;
+
+        /**
+         * NOTE: Thread safe
+         * 
+         * @returns Allocation statistics of this device
+        */
+        MemoryStats memory_stats() const;
+
+        /**
+         * Statistics of the allocations made in each 
+         * MemoryScope while profiling was on. Allocations 
+         * outside of a scope are under the empty name.
+         * 
+         * NOTE: Thread safe
+         * 
+         * @returns Map of node name to its statistics
+        */
+        std::unordered_map<std::string, MemoryStats> node_memory_stats() const;
+
+        /**
+         * Allocations made while profiling was on and 
+         * not yet freed, largest first
+         * 
+         * NOTE: Thread safe
+         * 
+         * @returns Live allocation records
+        */
+        std::vector<AllocationRecord> live_allocations() const;
+
+        /**
+         * Sets what is recorded per allocation. Turning 
+         * profiling off drops the live allocation records, 
+         * the device and node statistics are kept but the 
+         * dropped allocations no longer count as live.
+         * 
+         * NOTE: Thread safe
+         * 
+         * @param mode Profiling mode
+        */
+        void set_memory_profiling(MemoryProfiling mode);
+
+        /**
+         * @returns Current profiling mode
+        */
+        MemoryProfiling memory_profiling() const;
+
+        /**
+         * Sets the peak bytes of the device and its 
+         * nodes to their live bytes
+         * 
+         * NOTE: Thread safe
+        */
+        void ResetPeakMemory();
+
+        /**
+         * Threads owned by the device, ex. pinned to the cores
+         * next to its memory. Nodes placed on the device run 
+         * on them instead of the session's threads.
+         * 
+         * NOTE: Thread safe
+         * 
+         * @returns Worker pool, nullptr to run on the session's
+        */
+        virtual ThreadPool* workers();
+
         // delete copy and move to ensure single 
         // instance per physical device
         Device(const Device&)             = delete;
@@ -104,6 +250,28 @@ namespace graphloom
         */
         virtual Status Compute(OpKernel* kernel, ComputeContext& context);
 
+        /**
+         * Records an allocation into the memory statistics, 
+         * implementations call it for every successful malloc()
+         * 
+         * NOTE: Thread safe
+         * 
+         * @param ptr Allocated buffer
+         * @param bytes Number of bytes requested
+        */
+        void RecordAllocation(const void* ptr, size_t bytes);
+
+        /**
+         * Records a free into the memory statistics, 
+         * implementations call it for every free()
+         * 
+         * NOTE: Thread safe
+         * 
+         * @param ptr Freed buffer
+         * @param bytes Number of bytes of its allocation
+        */
+        void RecordFree(const void* ptr, size_t bytes);
+
         omp_lock_t lock_; // mutex/lock for thread safety
 
     private:
@@ -114,6 +282,7 @@ namespace graphloom
 
         std::string name_; // device name
         std::string type_; // device type
+        MemoryProfiler* const profiler_; // memory statistics
     };
 
     /**
@@ -76,6 +76,33 @@ namespace graphloom
         */
        size_t num_factories() const;
 
+        /**
+         * Gets the allocation statistics of the device with 
+         * name, throws exception if device does not exist.
+         * Case sensitive
+         * 
+         * @param name Device instance name
+         * @returns Allocation statistics of the device
+        */
+        MemoryStats GetMemoryStats(const std::string& name) const;
+
+        /**
+         * Sets the memory profiling mode of every device
+         * 
+         * @param mode Profiling mode
+        */
+        void SetMemoryProfiling(MemoryProfiling mode);
+
+        /**
+         * Generates a report of the live and peak bytes of 
+         * every device, followed by its nodes of largest peak 
+         * if profiled
+         * 
+         * @param max_nodes Max nodes listed per device
+         * @returns Human readable report
+        */
+        std::string GenMemoryReport(size_t max_nodes = 10) const;
+
     private:
         friend class GraphFactory;
 
@@ -2,6 +2,9 @@
 #define GRAPHLOOM_GRAPH_GRAPH_CONTEXT_H_
 
 #include <string>
+#include <cstdint>
+#include <functional>
+#include <vector>
 
 /**
  * This module defines the contexts used by 
@@ -11,7 +14,12 @@
 namespace graphloom
 {
     class NodeDef;
-    
+    class GraphDef;
+    class TensorBuffer;
+    class LayoutArray;
+    class ThreadPool;
+    class ScratchAllocator;
+
     /**
      * OpKernel's construction context.
      * Passed to OpKernel's constructor.
@@ -20,64 +28,276 @@ namespace graphloom
     {
     public:
         /**
-         * Returns the attribute at path
+         * Returns the attribute with name
+         * 
+         * @param name name of the op's attribute
+         * @returns attribute
+        */
+        int32_t GetInt32Attr(const std::string& name) const;
+
+        /**
+         * Returns the attribute in slot index, the 
+         * index-th attribute the op declared
+         * 
+         * @param index slot of the attribute
+         * @returns attribute
+        */
+        int32_t GetInt32Attr(size_t index) const;
+
+        /**
+         * Returns the attribute with name
+         * 
+         * @param name name of the op's attribute
+         * @returns attribute
+        */
+        int64_t GetInt64Attr(const std::string& name) const;
+
+        /**
+         * Returns the attribute in slot index, the 
+         * index-th attribute the op declared
+         * 
+         * @param index slot of the attribute
+         * @returns attribute
+        */
+        int64_t GetInt64Attr(size_t index) const;
+
+        /**
+         * Returns the attribute with name
+         * 
+         * @param name name of the op's attribute
+         * @returns attribute
+        */
+        float GetFloatAttr(const std::string& name) const;
+
+        /**
+         * Returns the attribute in slot index, the 
+         * index-th attribute the op declared
          * 
-         * @param path relative path
+         * @param index slot of the attribute
          * @returns attribute
         */
-        int32_t GetInt32Attr(const std::string& path) const;
+        float GetFloatAttr(size_t index) const;
 
         /**
-         * Returns the attribute at path
+         * Returns the attribute with name
          * 
-         * @param path relative path
+         * @param name name of the op's attribute
          * @returns attribute
         */
-        int64_t GetInt64Attr(const std::string& path) const;
+        double GetDoubleAttr(const std::string& name) const;
 
         /**
-         * Returns the attribute at path
+         * Returns the attribute in slot index, the 
+         * index-th attribute the op declared
          * 
-         * @param path relative path
+         * @param index slot of the attribute
          * @returns attribute
         */
-        float GetFloatAttr(const std::string& path) const;
+        double GetDoubleAttr(size_t index) const;
 
         /**
-         * Returns the attribute at path
+         * Returns the attribute with name
          * 
-         * @param path relative path
+         * @param name name of the op's attribute
          * @returns attribute
         */
-        double GetDoubleAttr(const std::string& path) const;
+        bool GetBoolAttr(const std::string& name) const;
 
         /**
-         * Returns the attribute at path
+         * Returns the attribute in slot index, the 
+         * index-th attribute the op declared
          * 
-         * @param path relative path
+         * @param index slot of the attribute
          * @returns attribute
         */
-        bool GetBoolAttr(const std::string& path) const;
+        bool GetBoolAttr(size_t index) const;
+
+        /**
+         * Returns the attribute with name
+         * 
+         * @param name name of the op's attribute
+         * @returns attribute
+        */
+        const TensorBuffer& GetTensorAttr(const std::string& name) const;
+
+        /**
+         * Returns the attribute in slot index, the 
+         * index-th attribute the op declared
+         * 
+         * @param index slot of the attribute
+         * @returns attribute
+        */
+        const TensorBuffer& GetTensorAttr(size_t index) const;
+
+        /**
+         * Returns the attribute with name
+         * 
+         * @param name name of the op's attribute
+         * @returns attribute
+        */
+        const std::vector<int64_t>& GetInt64ListAttr(const std::string& name) const;
+
+        /**
+         * Returns the attribute in slot index, the 
+         * index-th attribute the op declared
+         * 
+         * @param index slot of the attribute
+         * @returns attribute
+        */
+        const std::vector<int64_t>& GetInt64ListAttr(size_t index) const;
+
+        /**
+         * Returns the attribute with name
+         * 
+         * @param name name of the op's attribute
+         * @returns attribute
+        */
+        const std::vector<float>& GetFloatListAttr(const std::string& name) const;
+
+        /**
+         * Returns the attribute in slot index, the 
+         * index-th attribute the op declared
+         * 
+         * @param index slot of the attribute
+         * @returns attribute
+        */
+        const std::vector<float>& GetFloatListAttr(size_t index) const;
 
     private:
         friend class GraphFactory;
 
         /**
+         * @param graph_def the GraphDef that stores the attributes
          * @param node_def the NodeDef that carries the attributes
         */
-        OpKernelContext(const NodeDef* node_def);
+        OpKernelContext(const GraphDef* graph_def, const NodeDef* node_def);
 
+        /**
+         * Throws if the op has no attribute with name
+         * 
+         * @param name name of the op's attribute
+         * @returns slot of the attribute
+        */
+        size_t AttrIndex(const std::string& name) const;
+
+        const GraphDef* graph_def_; // GraphDef that stores the attributes
         const NodeDef* node_def_; // NodeDef that carries the attributes
     };
 
     /**
      * OpKernel's compute context. Passed to 
-     * OpKernel's Compute() during exectuion
+     * OpKernel's Compute() during exectuion.
+     * 
+     * Inputs and outputs are non-owning and indexed, 
+     * outputs are allocated before Compute() is called. 
+     * Together with scratch() a kernel runs without heap 
+     * allocations or attribute lookups, attributes are 
+     * read once in the kernel's constructor instead.
     */
     class ComputeContext
     {
     public:
-        // TODO: fill
+        /**
+         * Empty context, used to infer output shapes 
+         * before any input exists
+        */
+        ComputeContext() = default;
+
+        /**
+         * @returns Number of input tensors available
+        */
+        size_t num_inputs() const;
+
+        /**
+         * @returns Number of output tensors available
+        */
+        size_t num_outputs() const;
+
+        /**
+         * NOTE: Throws while shapes are inferred during 
+         * planning, only input_shape() is available then
+         * 
+         * @param index Index of the input
+         * @returns Input tensor at index
+        */
+        const TensorBuffer& input(size_t index) const;
+
+        /**
+         * @param index Index of the input
+         * @returns Shape of the input tensor at index
+        */
+        const LayoutArray& input_shape(size_t index) const;
+
+        /**
+         * @param index Index of the output
+         * @returns Output tensor at index
+        */
+        TensorBuffer& output(size_t index) const;
+
+        /**
+         * Number of threads the kernel may use, shrinks as
+         * more nodes of the graph compute concurrently.
+         * 
+         * @returns Thread budget of the kernel, at least 1
+        */
+        size_t thread_budget() const;
+
+        /**
+         * Calls fn over chunks of [0, n) on at most thread_budget() 
+         * threads of the session's pool, the calling thread included.
+         * Returns once every chunk is done. Kernels must use this 
+         * instead of spawning their own threads.
+         * 
+         * @param n Number of iterations
+         * @param grain Min iterations per chunk
+         * @param fn Called with the [begin, end) range of a chunk
+        */
+        void parallel_for(size_t n, size_t grain, 
+            const std::function<void(size_t, size_t)>& fn) const;
+
+        /**
+         * Allocates workspace memory on the kernel's device. 
+         * The memory is released when Compute() returns.
+         * 
+         * NOTE: Only the thread running Compute() may call 
+         * this, not the threads of parallel_for()
+         * 
+         * @param bytes Number of bytes requested
+         * @returns 64 byte aligned buffer
+        */
+        void* scratch(size_t bytes) const;
+
+    private:
+        friend class Executor;
+        friend class GraphFactory;
+
+        /**
+         * Shape only context, used to infer output 
+         * shapes before the graph runs
+         * 
+         * @param input_shapes Shapes of the input tensors
+         * @param num_inputs Number of input tensors
+        */
+        ComputeContext(const LayoutArray* const* input_shapes, size_t num_inputs);
+
+        /**
+         * @param inputs Input tensors
+         * @param num_inputs Number of input tensors
+         * @param outputs Output tensors
+         * @param num_outputs Number of output tensors
+        */
+        ComputeContext(TensorBuffer* const* inputs, size_t num_inputs, 
+            TensorBuffer* const* outputs, size_t num_outputs);
+
+        TensorBuffer* const* inputs_ = nullptr;
+        TensorBuffer* const* outputs_ = nullptr;
+        const LayoutArray* const* input_shapes_ = nullptr; // set if inputs_ is not
+        size_t num_inputs_ = 0;
+        size_t num_outputs_ = 0;
+
+        ThreadPool* pool_ = nullptr; // nullptr runs parallel_for inline
+        size_t thread_budget_ = 1;
+        ScratchAllocator* scratch_ = nullptr;
     };
 }
 
@@ -2,10 +2,11 @@
 #define GRAPHLOOM_GRAPH_GRAPH_DEF_H_
 
 #include <unordered_set>
+#include <set>
 #include <unordered_map>
-#include <any>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <cstdint>
 
 #include "graphloom/common/status.h"
@@ -28,18 +29,75 @@ namespace graphloom
     class NodeDef;
     class GraphDef;
     class GraphFactory;
+    class Arena;
+
+    /**
+     * Type of an attribute value
+    */
+    enum class AttrType : uint8_t
+    {
+        None, // slot not set
+        Int32,
+        Int64,
+        Float,
+        Double,
+        Bool,
+        Tensor,
+        Int64List,
+        FloatList,
+    };
+
+    /**
+     * Typed attribute slot of a node. The slots of a node 
+     * are indexed in the order OpBuilder::Attribute declared 
+     * them. Scalars are stored inline, tensors and lists 
+     * in the GraphDef at index.
+    */
+    struct AttrSlot
+    {
+        AttrType type = AttrType::None;
+        union
+        {
+            int32_t i32;
+            int64_t i64;
+            float f32;
+            double f64;
+            bool b;
+            size_t index = 0; // into the tensors or lists of its type
+        };
+    };
+
+    /**
+     * Compacted adjacency of a GraphDef in CSR form, nodes
+     * are referred to by id. The inputs of node i are at
+     * [in_offsets[i], in_offsets[i + 1]) in input order, 
+     * its consumers at [out_offsets[i], out_offsets[i + 1])
+     * in the order the edges were built.
+    */
+    struct GraphDefAdjacency
+    {
+        std::vector<size_t> in_offsets;     // num_nodes + 1 offsets
+        std::vector<int> in_nodes;          // source node of each input
+        std::vector<size_t> in_ports;       // output index of the source node
+
+        std::vector<size_t> out_offsets;    // num_nodes + 1 offsets
+        std::vector<int> out_nodes;         // destination node of each consumer
+        std::vector<size_t> out_ports;      // input index of the destination node
+    };
 
     /**
      * Computational graph intermediate 
      * representation.
      * 
      * Contains the nodes, edges and 
-     * attributes that define a graph
+     * attributes that define a graph.
+     * Nodes and edges are packed in an 
+     * arena owned by the graph.
     */
     class GraphDef
     {
     public:
-        GraphDef() = default;
+        GraphDef();
         ~GraphDef();
 
         GraphDef(const GraphDef&)               = delete;
@@ -61,7 +119,21 @@ namespace graphloom
         size_t num_nodes() const;
 
         /**
-         * Search for a node. O(n) complexity
+         * @returns Number of edges in this graph
+        */
+        size_t num_edges() const;
+
+        /**
+         * Builds a snapshot of the adjacency, for passes 
+         * that walk the whole graph without chasing the 
+         * edge pointers of every node. O(nodes + edges)
+         * 
+         * @returns Compacted adjacency of this graph
+        */
+        GraphDefAdjacency Adjacency() const;
+
+        /**
+         * Search for a node. O(1) average complexity
          * 
          * @param name Node's name, case-sensitive
          * @returns The node if found, nullptr otherwise 
@@ -120,18 +192,86 @@ namespace graphloom
         */
         bool GetBoolAttr(const std::string& path) const;
 
+        /**
+         * Returns the Attribute at path
+         * 
+         * @param path Absolute path
+         * @returns Attribute
+        */
+        const TensorBuffer& GetTensorAttr(const std::string& path) const;
+
+        /**
+         * Returns the Attribute at path
+         * 
+         * @param path Absolute path
+         * @returns Attribute
+        */
+        const std::vector<int64_t>& GetInt64ListAttr(const std::string& path) const;
+
+        /**
+         * Returns the Attribute at path
+         * 
+         * @param path Absolute path
+         * @returns Attribute
+        */
+        const std::vector<float>& GetFloatListAttr(const std::string& path) const;
+
     private:
         friend class NodeDefBuilder;
         friend class GraphFactory;
+        friend class OpKernelContext;
+
+        /**
+         * Throws if the node has no such slot or 
+         * the slot holds another type
+         * 
+         * @param node Node of the attribute
+         * @param index Slot of the attribute in node's op
+         * @param type Requested type
+         * @returns Attribute slot
+        */
+        const AttrSlot& Attr(const NodeDef* node, size_t index, AttrType type) const;
+
+        /**
+         * Throws if there is no attribute at path or 
+         * it holds another type
+         * 
+         * @param path Absolute path
+         * @param type Requested type
+         * @returns Attribute slot
+        */
+        const AttrSlot& Attr(const std::string& path, AttrType type) const;
+
+        /**
+         * @param path Absolute path
+         * @returns Attribute slot, nullptr if there is none
+        */
+        const AttrSlot* FindAttr(const std::string& path) const;
         
+        Arena* const arena_; // storage of the nodes, edges and their lists
+
         std::vector<NodeDef*> nodes_;
-        std::unordered_set<EdgeDef*> edges_;
+        std::vector<EdgeDef*> edges_;
+
+        // Map of node name to node, keys view the names in the arena
+        std::unordered_map<std::string_view, NodeDef*> node_index_;
+
+        // Device names requested by the nodes, each stored once
+        std::unordered_set<std::string> devices_;
+
+        // Map of base name to the last suffix given to a
+        // node of that name, see NodeDefBuilder::GenUniqueNodeName
+        std::unordered_map<std::string, size_t> name_suffixes_;
 
         // Set of nodes without inputs
         std::set<NodeDef*> source_nodes_;
         
-        // Map of absolute path to attributes
-        std::unordered_map<std::string, std::any> attributes_; 
+        // Attribute slots of every node, the slots of a node 
+        // are at [attr_offset_, attr_offset_ + its op's attributes)
+        std::vector<AttrSlot> attr_slots_;
+        std::vector<TensorBuffer> attr_tensors_;
+        std::vector<std::vector<int64_t>> attr_int64_lists_;
+        std::vector<std::vector<float>> attr_float_lists_;
     };
 
     /**
@@ -165,7 +305,18 @@ namespace graphloom
         /**
          * @returns The op's output types requested by user
         */
-        const std::vector<DataType>& out_dtypes() const;
+        std::vector<DataType> out_dtypes() const;
+
+        /**
+         * @param id Index/id of the output
+         * @returns Output type requested by user
+        */
+        DataType output_dtype(size_t id) const;
+
+        /**
+         * @returns Number of outputs
+        */
+        size_t num_outputs() const;
 
     private:
         friend class NodeDefBuilder;
@@ -174,19 +325,24 @@ namespace graphloom
         
         /**
          * @param op The operation this node represents
-         * @param name Name of this node
+         * @param name Name of this node, stored in the graph's arena
          * @param device Name of device to execute op on request by user 
+         * @param in_edges Array of op.num_inputs() edges, stored in the graph's arena
+         * @param out_dtypes Array of op.num_outputs() types, stored in the graph's arena
         */
-        NodeDef(const Op& op, const std::string& name, const std::string& device);
+        NodeDef(const Op& op, std::string_view name, const std::string* device, 
+            EdgeDef** in_edges, const DataType* out_dtypes);
         ~NodeDef() = default;
         
         int id_;
+        size_t attr_offset_ = 0; // first attribute slot in the GraphDef
         const Op& op_;
-        std::string name_;
-        std::string device_;
-        std::vector<EdgeDef*> in_edges_;
-        std::vector<EdgeDef*> out_edges_;
-        std::vector<DataType> out_dtypes_;
+        std::string_view name_;
+        const std::string* device_;     // interned in GraphDef::devices_
+        EdgeDef** in_edges_;            // indexed by input id
+        EdgeDef* first_out_ = nullptr;  // out edges, linked by EdgeDef::next_out_
+        EdgeDef* last_out_ = nullptr;
+        const DataType* out_dtypes_;
     };
 
     class EdgeDef
@@ -214,6 +370,7 @@ namespace graphloom
 
     private:
         friend class NodeDefBuilder;
+        friend class GraphDef;
         
         /**
          * @param src Source node
@@ -228,6 +385,7 @@ namespace graphloom
         NodeDef* dest_;
         size_t src_id_;
         size_t dest_id_;
+        EdgeDef* next_out_ = nullptr; // next out edge of src_
     };
 }
 
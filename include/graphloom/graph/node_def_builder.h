@@ -2,8 +2,6 @@
 #define GRAPHLOOM_GRAPH_NODE_DEF_BUILDER_H_
 
 #include <vector>
-#include <unordered_map>
-#include <any>
 #include <utility>
 #include <string>
 #include <cstdint>
@@ -91,6 +89,34 @@ namespace graphloom
         */
         NodeDefBuilder& SetAttr(const std::string& name, bool value);
 
+        /**
+         * Sets the attribute at path. The tensor shares 
+         * the storage of value
+         * 
+         * @param path Relative path
+         * @param value Attribute
+         * @returns This builder
+        */
+        NodeDefBuilder& SetAttr(const std::string& name, const TensorBuffer& value);
+
+        /**
+         * Sets the attribute at path
+         * 
+         * @param path Relative path
+         * @param value Attribute
+         * @returns This builder
+        */
+        NodeDefBuilder& SetAttr(const std::string& name, const std::vector<int64_t>& value);
+
+        /**
+         * Sets the attribute at path
+         * 
+         * @param path Relative path
+         * @param value Attribute
+         * @returns This builder
+        */
+        NodeDefBuilder& SetAttr(const std::string& name, const std::vector<float>& value);
+
         /**
          * Finalize and build the node into the graph.
          * 
@@ -148,8 +174,35 @@ namespace graphloom
         */
         std::string GenUniqueNodeName(const std::string& base_name);
 
+        /**
+         * Throws if the op has no attribute with name. A slot 
+         * that changes type frees its staged value
+         * 
+         * @param name Name of the attribute
+         * @param type Type of the value about to be set
+         * @returns Slot of the attribute
+        */
+        AttrSlot& Slot(const std::string& name, AttrType type);
+
+        /**
+         * Stages a tensor or list value of slot
+         * 
+         * @param values Staged values of the value's type
+         * @param slot Slot to store into
+         * @param value The value
+        */
+        template <typename T>
+        void Store(std::vector<T>& values, const AttrSlot& slot, const T& value);
+
         std::vector<std::pair<NodeDef*, size_t>> node_inputs_;
-        std::unordered_map<std::string, std::any> attributes_;
+
+        // slots of the node in the op's attribute order, tensor 
+        // and list values are staged below at the position of 
+        // their slot until Build()
+        std::vector<AttrSlot> attributes_;
+        std::vector<TensorBuffer> tensors_;
+        std::vector<std::vector<int64_t>> int64_lists_;
+        std::vector<std::vector<float>> float_lists_;
         std::string name_;
         std::string device_;
         const Op& op_;
@@ -1,22 +1,56 @@
 #ifndef GRAPHLOOM_GRAPH_SESSION_H_
 #define GRAPHLOOM_GRAPH_SESSION_H_
 
+#include <omp.h>
 #include <initializer_list>
 #include <vector>
 #include <utility>
 
+#include "graphloom/common/status.h"
 #include "graphloom/graph/graph_def.h"
 #include "graphloom/graph/node_def_builder.h"
 #include "graphloom/tensor/tensor.h"
 
+/**
+ * This module defines the Session, the interface
+ * to execute a GraphDef.
+*/
+
 namespace graphloom 
 {
     class Graph;
+    class Executor;
+    class ThreadPool;
+
+    /**
+     * Threading configuration of a Session
+    */
+    struct SessionOptions
+    {
+        // Threads of the session's pool, shared by node
+        // dispatch and kernels. 0 for the hardware concurrency
+        size_t inter_op_threads = 0;
+
+        // Max threads one kernel may use, 0 for inter_op_threads
+        size_t intra_op_threads = 0;
 
+        // Idle polls before a pool thread sleeps, 0 to sleep at once
+        size_t spin_iterations = 4096;
+    };
+
+    /**
+     * Owns an executable copy of a GraphDef and runs it.
+     * Nodes are dispatched as soon as their inputs are 
+     * computed, independent branches run in parallel on
+     * the session's thread pool.
+    */
     class Session
     {
     public:
-        Session();
+        /**
+         * @param options Threading configuration
+        */
+        explicit Session(const SessionOptions& options = SessionOptions());
         ~Session();
 
         Session(const Session&)               = delete;
@@ -24,13 +58,51 @@ namespace graphloom
         Session(Session&&)                    = delete;
         Session& operator=(Session&&)         = delete;
 
-        void UpdateGraph(const GraphDef& graph);
+        /**
+         * Builds the executable graph from graph. Resolves 
+         * kernels and plans intermediate tensor memory. 
+         * Kernels are constructed on the session's threads, 
+         * their constructors must be thread safe.
+         * 
+         * NOTE: graph may be destroyed afterwards, but its 
+         * NodeDef pointers are still used to name nodes in Run()
+         * 
+         * @param graph Graph to execute
+         * @returns Update status
+        */
+        Status UpdateGraph(const GraphDef& graph);
+
+        /**
+         * Computes the target nodes. Runs are serialized.
+         * 
+         * @param feeds Tensors to use as output 0 of a node instead 
+         * of computing it. The tensors must outlive the call
+         * @param target_nodes Nodes whose outputs are returned
+         * @param outputs Returned outputs of every target node in order
+         * @returns Run status
+        */
+        Status Run(const std::vector<std::pair<NodeDef*, TensorBuffer*>>& feeds, 
+            const std::vector<NodeDef*>& target_nodes, 
+            std::vector<TensorBuffer>& outputs);
+
+        /**
+         * @returns Bytes preallocated for intermediate tensors
+        */
+        size_t planned_peak_bytes() const;
 
-        void Run(const std::vector<std::pair<NodeDef*, TensorBuffer*>>&, const std::vector<NodeDef>& target_nodes, std::vector<TensorBuffer>& outputs);
+        /**
+         * @returns Fraction of the planned arena not 
+         * occupied by live tensors at the peak
+        */
+        double planned_fragmentation() const;
 
     private:
+        const SessionOptions options_;
+        ThreadPool* const pool_;
         Graph* const graph_;
+        Executor* executor_;
+        omp_lock_t lock_; // serializes updates and runs
     };
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -2,11 +2,13 @@
 
 
 #include "graphloom/common/data_type.h"
+#include "graphloom/common/half.h"
 #include "graphloom/common/initializer.h"
 #include "graphloom/common/macros.h"
 #include "graphloom/common/status.h"
 
 #include "graphloom/device/cpu.h"
+#include "graphloom/device/cpu_isa.h"
 #include "graphloom/device/device.h"
 #include "graphloom/device/registration.h"
 
@@ -15,7 +17,16 @@
 #include "graphloom/graph/node_def_builder.h"
 #include "graphloom/graph/session.h"
 
+#include "graphloom/kernels/cast.h"
+#include "graphloom/kernels/elementwise.h"
+#include "graphloom/kernels/matmul.h"
+#include "graphloom/kernels/quantize.h"
+#include "graphloom/kernels/sparse_matmul.h"
+
 #include "graphloom/op/op.h"
 #include "graphloom/op/registration.h"
 
+#include "graphloom/tensor/checkpoint.h"
+#include "graphloom/tensor/quantization.h"
+#include "graphloom/tensor/sparse.h"
 #include "graphloom/tensor/tensor.h"
\ No newline at end of file
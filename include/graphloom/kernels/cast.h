@@ -0,0 +1,23 @@
+#ifndef GRAPHLOOM_KERNELS_CAST_H_
+#define GRAPHLOOM_KERNELS_CAST_H_
+
+#include "graphloom/op/registration.h"
+
+/**
+ * This module declares the Cast op.
+ * 
+ * Cast(X) converts every element of X to the node's 
+ * output DataType, the output has the shape of X. CPU 
+ * kernels are registered between every pair of 
+ * DataType::Float, DataType::Double, DataType::Float16 
+ * and DataType::BFloat16. Conversions to 16 bit types 
+ * round to nearest even, 16 bit types convert to and 
+ * from Double through Float.
+*/
+
+namespace graphloom
+{
+    GL_DECLARE_KERNEL_LIBRARY(cast);
+}
+
+#endif
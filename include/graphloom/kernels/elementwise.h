@@ -0,0 +1,23 @@
+#ifndef GRAPHLOOM_KERNELS_ELEMENTWISE_H_
+#define GRAPHLOOM_KERNELS_ELEMENTWISE_H_
+
+#include "graphloom/op/registration.h"
+
+/**
+ * This module declares the elementwise ops.
+ * 
+ * Add, Sub, Mul, Div, Max and Min take two inputs that 
+ * broadcast like NumPy: shapes are aligned on their last 
+ * dimension and a dimension of size 1 repeats to match 
+ * the other input. Relu, Sigmoid, Tanh, Exp and Log take 
+ * one input, the output has its shape. CPU kernels are 
+ * registered for DataType::Float, DataType::Double and 
+ * DataType::BFloat16, which is computed in float.
+*/
+
+namespace graphloom
+{
+    GL_DECLARE_KERNEL_LIBRARY(elementwise);
+}
+
+#endif
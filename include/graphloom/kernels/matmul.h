@@ -0,0 +1,31 @@
+#ifndef GRAPHLOOM_KERNELS_MATMUL_H_
+#define GRAPHLOOM_KERNELS_MATMUL_H_
+
+#include "graphloom/op/registration.h"
+
+/**
+ * This module declares the MatMul op.
+ * 
+ * MatMul(A, B) computes the matrix product of A with
+ * shape [M, K] and B with shape [K, N], the output has
+ * shape [M, N]. CPU kernels are registered for 
+ * DataType::Float and DataType::Double. DataType::BFloat16
+ * inputs accumulate in float and output DataType::Float.
+ * 
+ * Quantized DataType::Int8 inputs, see 
+ * graphloom/tensor/quantization.h, accumulate in int32. 
+ * A is quantized per tensor, B per tensor or per column 
+ * (axis 1). MatMul outputs the DataType::Int32 
+ * accumulators with the zero points removed, in units of 
+ * A's scale times B's scale, or the DataType::Float real 
+ * values. QuantizedMatMul(A, B) outputs DataType::Int8 
+ * requantized with its "out_scale" (float) and 
+ * "out_zero_point" (int32) attributes.
+*/
+
+namespace graphloom
+{
+    GL_DECLARE_KERNEL_LIBRARY(matmul);
+}
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef GRAPHLOOM_KERNELS_QUANTIZE_H_
+#define GRAPHLOOM_KERNELS_QUANTIZE_H_
+
+#include "graphloom/op/registration.h"
+
+/**
+ * This module declares the quantization ops, see
+ * graphloom/tensor/quantization.h for the parameters.
+ *
+ * Quantize(X) converts Float X to DataType::Int8 with
+ * the per tensor "scale" (float) and "zero_point"
+ * (int32) attributes. QuantizeDynamic(X) does the same
+ * with parameters covering the range of each X.
+ * Dequantize(Q) converts an Int8 tensor to Float with
+ * its per tensor or per channel parameters. Outputs
+ * have the shape of the input and carry their
+ * parameters, which downstream kernels read.
+*/
+
+namespace graphloom
+{
+    GL_DECLARE_KERNEL_LIBRARY(quantize);
+}
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef GRAPHLOOM_KERNELS_SPARSE_MATMUL_H_
+#define GRAPHLOOM_KERNELS_SPARSE_MATMUL_H_
+
+#include "graphloom/op/registration.h"
+
+/**
+ * This module declares the sparse MatMul ops, the sparse
+ * operand is fed as the component tensors of a
+ * SparseTensor, see graphloom/tensor/sparse.h.
+ *
+ * CsrMatMul(row_offsets, col_indices, values, B) computes
+ * the product of the Csr matrix A with shape [M, K] and
+ * the dense B with shape [K, N], M is the number of row
+ * offsets - 1. BsrMatMul(row_offsets, col_indices,
+ * values, B) does the same for a Bsr A, values has shape
+ * [blocks, block_rows, block_cols] and M is the number of
+ * row offsets - 1 times block_rows. The output has shape
+ * [M, N], N = 1 is a matrix vector product. Indices are
+ * DataType::Int32, CPU kernels are registered for
+ * DataType::Float and DataType::Double values and B.
+ * Coo matrices are converted with SparseTensor::ToCsr().
+*/
+
+namespace graphloom
+{
+    GL_DECLARE_KERNEL_LIBRARY(sparse_matmul);
+}
+
+#endif
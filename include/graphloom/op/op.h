@@ -4,7 +4,6 @@
 #include <string>
 #include <functional>
 #include <unordered_map>
-#include <set>
 #include <vector>
 #include <utility>
 
@@ -13,6 +12,7 @@
 #include "graphloom/tensor/tensor.h"
 #include "graphloom/common/status.h"
 #include "graphloom/device/device.h"
+#include "graphloom/device/cpu_isa.h"
 #include "graphloom/graph/graph_context.h"
 
 /**
@@ -40,7 +40,8 @@ namespace graphloom
         /**
          * @param context the construction context of an op kernel
         */
-        OpKernel(OpKernelContext& context);
+        OpKernel(const OpKernelContext& context);
+        virtual ~OpKernel() = default;
 
         /**
          * Actually compute with the kernel
@@ -84,23 +85,32 @@ namespace graphloom
         */
         size_t num_outputs() const;
 
+        /**
+         * @returns Instruction set level the kernel requires
+        */
+        CpuIsa isa() const;
+
 
     private:
         template<typename T>
         friend class OpKernelDefBuilder;
         friend class GraphFactory;
+        friend class Op;
 
         /**
          * @param device Device type the OpKernel runs on
          * @param create_fn Function to create the OpKernel instance
          * @param in_dtypes Data types of the input tensors
          * @param out_dtypes Data types of the output tensors
+         * @param isa Instruction set level the kernel requires
         */
         OpKernelDef(const std::string& device, const std::function<OpKernel*(const OpKernelContext&)>& create_fn, 
             const std::vector<DataType>& in_dtypes, 
-            const std::vector<DataType>& out_dtypes);
+            const std::vector<DataType>& out_dtypes,
+            CpuIsa isa);
 
         const std::string device_;
+        const CpuIsa isa_;
         const std::function<OpKernel*(const OpKernelContext&)> create_fn_;
         const std::vector<DataType> in_dtypes_;
         const std::vector<DataType> out_dtypes_;
@@ -129,22 +139,63 @@ namespace graphloom
         std::string name() const;
         
         /**
-         * @returns Set of required attributes for this op
+         * @returns Required attributes of this op, a node 
+         * stores attribute i in its slot i
+        */
+        const std::vector<std::string>& attributes() const;
+
+        /**
+         * @param name Name of the attribute
+         * @returns Slot of the attribute, -1 if this op has none
         */
-        const std::set<std::string>& attributes() const;
+        int AttrIndex(const std::string& name) const;
 
     private:
         friend class OpBuilder;
         friend class GraphFactory;
         friend class OpRegistry;
+        friend class Executor;
 
         Op() = default;
 
-        std::set<std::string> attributes_;
+        /**
+         * Adds a kernel and updates the dispatch table
+         * 
+         * @param kernel Kernel definition
+        */
+        void AddKernel(OpKernelDef&& kernel);
+
+        /**
+         * Looks up the dispatch table. O(1) average
+         * 
+         * @param device Device type
+         * @param in_dtypes Data types of the input tensors
+         * @param out_dtypes Data types of the output tensors
+         * @returns Kernel of the highest instruction set level the 
+         * host supports, the first registered wins ties. nullptr if none
+        */
+        const OpKernelDef* FindKernel(const std::string& device, 
+            const std::vector<DataType>& in_dtypes, 
+            const std::vector<DataType>& out_dtypes) const;
+
+        /**
+         * @param device Device type
+         * @param in_dtypes Data types of the input tensors
+         * @param out_dtypes Data types of the output tensors
+         * @returns Hash of a kernel signature
+        */
+        static size_t HashSignature(const std::string& device, 
+            const std::vector<DataType>& in_dtypes, 
+            const std::vector<DataType>& out_dtypes);
+
+        std::vector<std::string> attributes_; // in declaration order
         // list of functions that computes the shape of output 
         // tensor at their respective index
         std::vector<std::function<Status(const ComputeContext&, LayoutArray&)>> out_shape_fns_;
         std::vector<OpKernelDef> kernels_;
+        // Map of signature hash to the indices in kernels_ of the 
+        // kernels of a signature, highest instruction set level first
+        std::unordered_multimap<size_t, std::vector<size_t>> dispatch_;
         size_t num_inputs_ = 0;
         size_t num_outputs_ = 0;
         std::string name_;
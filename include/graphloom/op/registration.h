@@ -19,9 +19,10 @@
  * build and register ops and op kernels.
 */
 
-// GL_REGISTER_OP implementation
+// GL_REGISTER_OP implementation. Registrations have internal
+// linkage, counters of different source files collide
 #define GL_REGISTER_OP_IMPL(op_name, counter) \
-    inline graphloom::Initializer GL_CONCATENATE(register_op_, counter) = \
+    static graphloom::Initializer GL_CONCATENATE(register_op_, counter) = \
     graphloom::OpBuilder(op_name)
 
 // Register Op builder
@@ -30,13 +31,29 @@
 
 // GL_REGISTER_KERNEL implementation
 #define GL_REGISTER_KERNEL_IMPL(op_name, kernel, device, counter) \
-    inline graphloom::Initializer GL_CONCATENATE(register_kernel_, counter) = \
+    static graphloom::Initializer GL_CONCATENATE(register_kernel_, counter) = \
     graphloom::OpKernelDefBuilder<kernel>(op_name, device)
 
 // Register Kernel builder
 #define GL_REGISTER_KERNEL(op_name, kernel, device) \
     GL_REGISTER_KERNEL_IMPL(op_name, kernel, device, __COUNTER__)
 
+// Declares a library of ops and kernels registered in a
+// source file of graphloom. Declared in the library's public
+// header, the reference keeps its registrations in static builds
+#define GL_DECLARE_KERNEL_LIBRARY(name)                                 \
+    graphloom::Initializer GL_CONCATENATE(gl_link_, name)();            \
+    inline graphloom::Initializer GL_CONCATENATE(gl_init_link_, name) = \
+    GL_CONCATENATE(gl_link_, name)()
+
+// Defines a library declared with GL_DECLARE_KERNEL_LIBRARY,
+// in the source file holding its registrations
+#define GL_DEFINE_KERNEL_LIBRARY(name)                                  \
+    graphloom::Initializer GL_CONCATENATE(gl_link_, name)()             \
+    {                                                                   \
+        return graphloom::Initializer();                                \
+    }
+
 namespace graphloom
 {
     /**
@@ -56,12 +73,20 @@ namespace graphloom
         /**
          * Adds an output tensor to this op
          * 
+         * NOTE: shape_fn is first called while the graph is 
+         * planned with a context that only has input shapes, 
+         * and no inputs if any of them is unknown. It must 
+         * return a non-ok status or throw if the shape cannot 
+         * be computed, it is then called again during execution.
+         * 
+         * @param shape_fn Function that computes the output's shape
          * @returns This builder
         */
         OpBuilder& Output(const std::function<Status(const ComputeContext&, LayoutArray&)>& shape_fn);
 
         /**
-         * Adds an attribute with name
+         * Adds an attribute with name. Attributes are 
+         * assigned slots in the order they are added
          * 
          * @param name The new attribute's name
          * @returns This builder
@@ -85,7 +110,7 @@ namespace graphloom
         size_t num_inputs_ = 0;
         size_t num_outputs_ = 0;
         std::string op_name_;
-        std::set<std::string> attributes_;
+        std::vector<std::string> attributes_;
 
         // list of functions that computes the shape of output 
         // tensor at their respective index
@@ -112,7 +137,8 @@ namespace graphloom
         size_t size() const;
 
     private:
-        friend class OpKernelBuilder;
+        template <typename T>
+        friend class OpKernelDefBuilder;
         friend class OpBuilder;
 
         /**
@@ -160,6 +186,7 @@ namespace graphloom
         OpKernelDefBuilder& Input(DataType dtype)
         {
             input_dtypes_.push_back(dtype);
+            return *this;
         }
 
         /**
@@ -170,9 +197,25 @@ namespace graphloom
         */
         OpKernelDefBuilder& Output(DataType dtype)
         {
-            input_dtypes_.push_back(dtype);
+            output_dtypes_.push_back(dtype);
+            return *this;
         }
         
+        /**
+         * Sets the instruction set level the kernel requires. 
+         * Among kernels matching a node, the one with the 
+         * highest level the host supports is used.
+         * Defaults to CpuIsa::Generic
+         * 
+         * @param isa Required instruction set level
+         * @returns This builder
+        */
+        OpKernelDefBuilder& Isa(CpuIsa isa)
+        {
+            isa_ = isa;
+            return *this;
+        }
+
         /**
          * Finalize and build OpKernelDef into Op
          * 
@@ -180,7 +223,7 @@ namespace graphloom
         */
         Initializer Build() const
         {
-            OpKernelDef kernel(device_, create_fn_, input_dtypes_, output_dtypes_);
+            OpKernelDef kernel(device_, create_fn_, input_dtypes_, output_dtypes_, isa_);
             Status status = OpRegistry::instance().RegisterOpKernel(target_op_name_, std::move(kernel));
             GL_CHECK_OK(status);
             return Initializer();
@@ -192,9 +235,9 @@ namespace graphloom
         */
         OpKernelDefBuilder(const std::string& target_op_name, 
             const std::string& device) : 
+            create_fn_([](const OpKernelContext& context) {return new T(context);}),
             target_op_name_(target_op_name),
-            device_(device),
-            create_fn_([](const OpKernelContext& context) {return new T(context);})
+            device_(device)
         {
             if (!std::is_base_of<OpKernel, T>::value)
             {
@@ -208,6 +251,7 @@ namespace graphloom
         std::function<OpKernel*(const OpKernelContext&)> create_fn_; // lambda function that creates the OpKernel instance
         const std::string target_op_name_;
         const std::string device_;
+        CpuIsa isa_ = CpuIsa::Generic;
     };
 }
 
@@ -0,0 +1,101 @@
+#ifndef GRAPHLOOM_TENSOR_CHECKPOINT_H_
+#define GRAPHLOOM_TENSOR_CHECKPOINT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "graphloom/common/status.h"
+#include "graphloom/device/device.h"
+#include "graphloom/tensor/tensor.h"
+
+/**
+ * This module defines the checkpoint file, a versioned 
+ * binary container of named tensors. All integers are 
+ * little endian.
+ * 
+ *   magic    8 bytes "GLCKPT\0\0"
+ *   version  u32
+ *   count    u32 number of tensors
+ *   entries  count times:
+ *              name_size u32, name bytes,
+ *              dtype u32, rank u32, rank times dim u64,
+ *              offset u64, bytes u64
+ *   payloads tensor data, row major, each at its entry's
+ *            offset which is a multiple of kCheckpointAlignment
+ * 
+ * Aligned payloads can be mapped in place or read by 
+ * several threads at once.
+*/
+
+namespace graphloom
+{
+    // Version written by Checkpoint::Save
+    constexpr uint32_t kCheckpointVersion = 1;
+
+    // Alignment of each tensor's payload in the file
+    constexpr size_t kCheckpointAlignment = 64;
+
+    struct CheckpointSaveOptions
+    {
+        // Bytes staged before a write to the file, the 
+        // checkpoint is never staged whole
+        size_t buffer_bytes = size_t(1) << 20;
+    };
+
+    // How Checkpoint::Load brings payloads into memory
+    enum class CheckpointLoadMode
+    {
+        // Map each payload in place, pages are read on first access
+        Map,
+
+        // Allocate each tensor on the device and read the payloads
+        Read,
+    };
+
+    struct CheckpointLoadOptions
+    {
+        CheckpointLoadMode mode = CheckpointLoadMode::Map;
+
+        // Mapping mode and access hint of CheckpointLoadMode::Map
+        MapFileOptions map_options;
+
+        // Threads reading payloads in CheckpointLoadMode::Read,
+        // 0 for the hardware concurrency
+        size_t read_threads = 0;
+    };
+
+    class Checkpoint
+    {
+    public:
+        /**
+         * Writes tensors to a checkpoint file
+         * 
+         * @param path Path of the file, overwritten if it exists
+         * @param tensors Unique names and tensors to save
+         * @param options Staging buffer size
+         * @returns Non-ok status if a name repeats or the file cannot be written
+        */
+        static Status Save(const std::string& path, 
+            const std::vector<std::pair<std::string, const TensorBuffer*>>& tensors, 
+            const CheckpointSaveOptions& options = CheckpointSaveOptions());
+
+        /**
+         * Reads every tensor of a checkpoint file
+         * 
+         * @param path Path of the file
+         * @param device CPU device the tensors live on
+         * @param tensors Returned tensors by name
+         * @param options Map or read the payloads
+         * @returns Non-ok status if the file is not a valid checkpoint
+        */
+        static Status Load(const std::string& path, Device* device, 
+            std::unordered_map<std::string, TensorBuffer>& tensors, 
+            const CheckpointLoadOptions& options = CheckpointLoadOptions());
+    };
+}
+
+#endif
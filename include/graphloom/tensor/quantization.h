@@ -0,0 +1,159 @@
+#ifndef GRAPHLOOM_TENSOR_QUANTIZATION_H_
+#define GRAPHLOOM_TENSOR_QUANTIZATION_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "graphloom/tensor/tensor.h"
+
+/**
+ * This module defines affine quantization of Int8 tensors.
+ * A quantized value q represents the real value
+ *
+ *   scale * (q - zero_point)
+ *
+ * Per tensor quantization uses one scale and zero point
+ * for all elements. Per channel quantization uses one of
+ * each per index of a channel axis, ex. per output column
+ * of a MatMul weight.
+*/
+
+namespace graphloom
+{
+    /**
+     * Scales and zero points of a quantized tensor.
+     * Immutable, tensors share it between their copies.
+    */
+    class QuantParams
+    {
+    public:
+        /**
+         * @param scale Step between quantized values, > 0
+         * @param zero_point Quantized value of real 0, in [-128, 127]
+         * @returns Per tensor quantization
+        */
+        static QuantParams PerTensor(float scale, int32_t zero_point);
+
+        /**
+         * @param axis Channel axis of the tensor
+         * @param scales Scale of each channel, > 0
+         * @param zero_points Zero point of each channel, in [-128, 127]
+         * @returns Per channel quantization
+        */
+        static QuantParams PerChannel(size_t axis, const std::vector<float>& scales,
+            const std::vector<int32_t>& zero_points);
+
+        /**
+         * @returns True if each index of axis() has its own parameters
+        */
+        bool per_channel() const;
+
+        /**
+         * @returns Channel axis if per_channel()
+        */
+        size_t axis() const;
+
+        /**
+         * @returns Number of channels, 1 if per tensor
+        */
+        size_t num_channels() const;
+
+        /**
+         * @param channel Index along axis(), 0 if per tensor
+         * @returns Scale of channel
+        */
+        float scale(size_t channel = 0) const;
+
+        /**
+         * @param channel Index along axis(), 0 if per tensor
+         * @returns Zero point of channel
+        */
+        int32_t zero_point(size_t channel = 0) const;
+
+        /**
+         * @returns num_channels() scales
+        */
+        const float* scales() const;
+
+        /**
+         * @returns num_channels() zero points
+        */
+        const int32_t* zero_points() const;
+
+    private:
+        QuantParams() = default;
+
+        std::vector<float> scales_;
+        std::vector<int32_t> zero_points_;
+        size_t axis_ = 0;
+        bool per_channel_ = false;
+    };
+
+    /**
+     * @param x Real value
+     * @param inv_scale 1 / scale
+     * @param zero_point Zero point
+     * @returns x quantized, rounded to nearest even and saturated
+    */
+    inline int8_t QuantizeValue(float x, float inv_scale, int32_t zero_point)
+    {
+        float q = std::nearbyint(x * inv_scale) + static_cast<float>(zero_point);
+        return static_cast<int8_t>(std::min(std::max(q, -128.0f), 127.0f));
+    }
+
+    /**
+     * @param q Quantized value
+     * @param scale Scale
+     * @param zero_point Zero point
+     * @returns Real value of q
+    */
+    inline float DequantizeValue(int8_t q, float scale, int32_t zero_point)
+    {
+        return scale * static_cast<float>(static_cast<int32_t>(q) - zero_point);
+    }
+
+    /**
+     * Asymmetric quantization of [min, max], widened to
+     * include 0 so that 0 is exactly representable
+     *
+     * @param min Smallest real value
+     * @param max Largest real value
+     * @returns Per tensor quantization
+    */
+    QuantParams ChooseQuantParams(float min, float max);
+
+    /**
+     * @param x Float tensor
+     * @returns Per tensor asymmetric quantization of x's range
+    */
+    QuantParams ChooseQuantParams(const TensorBuffer& x);
+
+    /**
+     * Symmetric quantization of each channel, zero points
+     * are 0. Used for weights, the kernels then skip the
+     * zero point corrections of the weight.
+     *
+     * @param x Float tensor
+     * @param axis Channel axis of x
+     * @returns Per channel quantization
+    */
+    QuantParams ChooseChannelQuantParams(const TensorBuffer& x, size_t axis);
+
+    /**
+     * @param x Float tensor
+     * @param params Quantization of the result
+     * @returns Contiguous Int8 tensor carrying params
+    */
+    TensorBuffer QuantizeTensor(const TensorBuffer& x, const QuantParams& params);
+
+    /**
+     * @param q Quantized Int8 tensor
+     * @returns Contiguous Float tensor of q's real values
+    */
+    TensorBuffer DequantizeTensor(const TensorBuffer& q);
+}
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef GRAPHLOOM_TENSOR_SPARSE_H_
+#define GRAPHLOOM_TENSOR_SPARSE_H_
+
+#include <cstddef>
+
+#include "graphloom/common/data_type.h"
+#include "graphloom/tensor/tensor.h"
+
+/**
+ * This module defines SparseTensor, a matrix that only
+ * stores its nonzero values. The values and indices are
+ * plain TensorBuffers, index tensors are DataType::Int32.
+ * They are fed to the sparse kernels as separate inputs,
+ * see graphloom/kernels/sparse_matmul.h.
+ *
+ * Coo stores the row and column of each value, sorted by
+ * row then column. Csr stores the column of each value
+ * and row offsets, the values of row i are at
+ * [row_offsets[i], row_offsets[i + 1]). Bsr is Csr over
+ * dense block_rows x block_cols blocks, values has shape
+ * [blocks, block_rows, block_cols].
+*/
+
+namespace graphloom
+{
+    enum class SparseFormat
+    {
+        Coo,
+        Csr,
+        Bsr,
+    };
+
+    /**
+     * Sparse matrix of DataType::Float or DataType::Double.
+     * Immutable, copies share the component tensors.
+    */
+    class SparseTensor
+    {
+    public:
+        /**
+         * NOTE: Bsr requires the dimensions of dense to be
+         * multiples of the block size. A matrix of zeros
+         * stores one zero, tensors have no 0 dims.
+         *
+         * @param dense Rank 2 Float or Double tensor
+         * @param format Format of the result
+         * @param block_rows Rows of a block if format is Bsr
+         * @param block_cols Columns of a block if format is Bsr
+         * @returns Nonzero values of dense, or the blocks
+         * with a nonzero value if format is Bsr
+        */
+        static SparseTensor FromDense(const TensorBuffer& dense, SparseFormat format,
+            size_t block_rows = 1, size_t block_cols = 1);
+
+        /**
+         * Throws if the components do not describe a
+         * valid matrix of shape
+         *
+         * @param shape Rank 2 shape of the matrix
+         * @param row_indices Row of each value
+         * @param col_indices Column of each value
+         * @param values Values, sorted by row then column
+         * @returns Coo matrix sharing the components
+        */
+        static SparseTensor Coo(const LayoutArray& shape, const TensorBuffer& row_indices,
+            const TensorBuffer& col_indices, const TensorBuffer& values);
+
+        /**
+         * Throws if the components do not describe a
+         * valid matrix of shape
+         *
+         * @param shape Rank 2 shape of the matrix
+         * @param row_offsets shape[0] + 1 offsets into values
+         * @param col_indices Column of each value
+         * @param values Values
+         * @returns Csr matrix sharing the components
+        */
+        static SparseTensor Csr(const LayoutArray& shape, const TensorBuffer& row_offsets,
+            const TensorBuffer& col_indices, const TensorBuffer& values);
+
+        /**
+         * Throws if the components do not describe a
+         * valid matrix of shape
+         *
+         * @param shape Rank 2 shape of the matrix, multiples
+         * of the block size
+         * @param row_offsets Block rows + 1 offsets into values
+         * @param col_indices Block column of each block
+         * @param values Blocks, [blocks, block_rows, block_cols]
+         * @returns Bsr matrix sharing the components
+        */
+        static SparseTensor Bsr(const LayoutArray& shape, const TensorBuffer& row_offsets,
+            const TensorBuffer& col_indices, const TensorBuffer& values);
+
+        /**
+         * Converts to Csr, every stored value is kept,
+         * including the zeros inside Bsr blocks
+         *
+         * @returns Csr matrix, this matrix if already Csr
+        */
+        SparseTensor ToCsr() const;
+
+        /**
+         * @returns Contiguous dense tensor of shape()
+        */
+        TensorBuffer ToDense() const;
+
+        /**
+         * @returns Storage format
+        */
+        SparseFormat format() const;
+
+        /**
+         * @returns Data type of the values
+        */
+        DataType dtype() const;
+
+        /**
+         * @returns Logical dense shape
+        */
+        const LayoutArray& shape() const;
+
+        /**
+         * @returns Number of stored values
+        */
+        size_t nnz() const;
+
+        /**
+         * @returns Rows of a block, 1 unless Bsr
+        */
+        size_t block_rows() const;
+
+        /**
+         * @returns Columns of a block, 1 unless Bsr
+        */
+        size_t block_cols() const;
+
+        /**
+         * @returns Number of bytes of the components
+        */
+        size_t bytes() const;
+
+        /**
+         * @returns Row of each value, throws unless Coo
+        */
+        const TensorBuffer& row_indices() const;
+
+        /**
+         * @returns Row offsets, throws if Coo
+        */
+        const TensorBuffer& row_offsets() const;
+
+        /**
+         * @returns Column of each value, or block column if Bsr
+        */
+        const TensorBuffer& col_indices() const;
+
+        /**
+         * @returns Stored values
+        */
+        const TensorBuffer& values() const;
+
+    private:
+        SparseTensor() = default;
+
+        SparseFormat format_ = SparseFormat::Csr;
+        LayoutArray shape_;
+        TensorBuffer rows_; // row indices if Coo, else row offsets
+        TensorBuffer cols_;
+        TensorBuffer values_;
+    };
+}
+
+#endif
@@ -1,7 +1,12 @@
 #ifndef GRAPHLOOM_TENSOR_TENSOR_H_
 #define GRAPHLOOM_TENSOR_TENSOR_H_
 
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <initializer_list>
+#include <memory>
+#include <string>
 
 #include "graphloom/common/status.h"
 #include "graphloom/common/data_type.h"
@@ -16,12 +21,17 @@
 
 namespace graphloom
 {
+    class QuantParams;
+
     /**
      * A fixed sized array that defines tensor layouts 
     */
     class LayoutArray
     {
     public:
+        // Rank 0 layout
+        LayoutArray();
+
         /**
          * @param list Layout size initalization list
         */
@@ -36,9 +46,9 @@ namespace graphloom
         LayoutArray& operator=(const LayoutArray&)  = default;
         LayoutArray& operator=(const std::initializer_list<size_t>& list);
 
-        // move deleted because there is nothing to move
-        LayoutArray(LayoutArray&&)                  = delete;
-        LayoutArray& operator=(LayoutArray&&)       = delete;
+        // move is a copy because there is nothing to steal
+        LayoutArray(LayoutArray&&)                  = default;
+        LayoutArray& operator=(LayoutArray&&)       = default;
 
         /**
          * @returns Number of valid sizes
@@ -46,6 +56,7 @@ namespace graphloom
         size_t rank() const;
         
         const size_t& operator[](size_t index) const;
+        size_t& operator[](size_t index);
 
         /**
          * Set the layout size
@@ -54,6 +65,13 @@ namespace graphloom
         */
         void Set(const std::initializer_list<size_t>& list);
 
+        /**
+         * Set the rank, sizes past the previous rank are 1
+         * 
+         * @param rank New rank
+        */
+        void Resize(size_t rank);
+
         size_t* begin() 
         {
             return array_;
@@ -63,19 +81,46 @@ namespace graphloom
             return array_ + rank();
         }
 
+        const size_t* begin() const
+        {
+            return array_;
+        }
+
+        const size_t* end() const
+        {
+            return array_ + rank();
+        }
+
+        /**
+         * @returns Product of all sizes, 1 if rank 0
+        */
+        size_t NumElements() const;
+
 
     private:
         size_t rank_;
         size_t array_[GRAPHLOOM_MAX_LAYOUT];
     };
 
+    // Rank of a TensorMap whose rank is only known at runtime
+    constexpr size_t kDynamicRank = SIZE_MAX;
+
+    /**
+     * Maps tensor to memory buffer. TensorMap<T> handles 
+     * any rank, TensorMap<T, Rank> a rank fixed at compile 
+     * time with cheaper indexing.
+    */
+    template<typename T, size_t Rank = kDynamicRank>
+    class TensorMap;
+
     /**
-     * Maps tensor to memory buffer
+     * Maps tensor of any rank to memory buffer
     */
     template<typename T>
-    class TensorMap
+    class TensorMap<T, kDynamicRank>
     {
     public:
+        using iterator = T*;
 
         /**
          * @param buf Underlying memory buffer
@@ -113,21 +158,69 @@ namespace graphloom
         }
 
         template<typename... Args>
-        T& operator()(size_t i, Args... args)
+        T& operator()(size_t i, Args... args) const
         {
-            return *AccessHelper(strides_, i, args...); 
+            return *AccessHelper(strides_.begin(), i, args...); 
         }
 
-    private:
-        T* AccessHelper(size_t* strides, size_t i)
+        /**
+         * @returns Shape of the tensor
+        */
+        const LayoutArray& shape() const
         {
-            return buf_ + i*strides[0];
+            return shape_;
         }
 
-        template<typename... Args>
-        T* AccessHelper(size_t* strides, size_t i, Args... args)
+        /**
+         * @returns Underlying memory buffer
+        */
+        T* data() const
         {
-            return AccessHelper(strides + 1, args...) + i*strides[0];
+            return buf_;
+        }
+
+        /**
+         * @returns Number of elements
+        */
+        size_t size() const
+        {
+            return shape_.NumElements();
+        }
+
+        /**
+         * @returns True if the elements are packed in row major order
+        */
+        bool IsContiguous() const
+        {
+            size_t expected = 1;
+            for (size_t i = shape_.rank(); i-- > 0;)
+            {
+                if (shape_[i] != 1 && strides_[i] != expected) return false;
+                expected *= shape_[i];
+            }
+            return true;
+        }
+
+        /**
+         * NOTE: Only contiguous tensors can be iterated
+         * 
+         * @returns Iterator to the first element in row major order
+        */
+        iterator begin() const
+        {
+            if (!IsContiguous())
+            {
+                throw GlException("Cannot iterate a non contiguous tensor");
+            }
+            return buf_;
+        }
+
+        /**
+         * @returns Iterator past the last element
+        */
+        iterator end() const
+        {
+            return begin() + size();
         }
 
         /**
@@ -138,7 +231,7 @@ namespace graphloom
         */
         static LayoutArray NaiveStrides(const LayoutArray& shape)
         {
-            LayoutArray strides;
+            LayoutArray strides(shape);
             size_t stride = 1;
             for (int i = shape.rank() - 1; i >= 0; --i)
             {
@@ -148,92 +241,736 @@ namespace graphloom
             return strides;
         }
 
+    private:
+        T* AccessHelper(const size_t* strides, size_t i) const
+        {
+            return buf_ + i*strides[0];
+        }
+
+        template<typename... Args>
+        T* AccessHelper(const size_t* strides, size_t i, Args... args) const
+        {
+            return AccessHelper(strides + 1, args...) + i*strides[0];
+        }
+
+        T* buf_;
         LayoutArray shape_;
         LayoutArray strides_;
+    };
+
+    /**
+     * Maps tensor of rank Rank to memory buffer. Shape and 
+     * strides are Rank sized arrays and an access is a loop 
+     * of Rank terms, which the compiler unrolls.
+    */
+    template<typename T, size_t Rank>
+    class TensorMap
+    {
+    public:
+        using iterator = T*;
+
+        /**
+         * @param buf Underlying memory buffer
+         * @param shape Shape of the tensor, of rank Rank
+         * @param strides Stride of each tensor's dimension
+        */
+        TensorMap(T* buf, const LayoutArray& shape, const LayoutArray& strides) : 
+            buf_(buf)
+        {
+            if (shape.rank() != Rank || strides.rank() != Rank)
+            {
+                throw GlException("TensorMap of rank ", Rank, 
+                    " cannot map a rank ", shape.rank(), " tensor");
+            }
+
+            for (size_t i = 0; i < Rank; ++i)
+            {
+                if (shape[i] == 0)
+                {
+                    throw GlException("Shape cannot have 0 dim");
+                }
+                shape_[i] = shape[i];
+                strides_[i] = strides[i];
+            }
+        }
+
+        /**
+         * @param buf Underlying memory buffer
+         * @param shape Shape of the tensor, of rank Rank
+        */
+        TensorMap(T* buf, const LayoutArray& shape) : 
+            TensorMap(buf, shape, TensorMap<T>::NaiveStrides(shape))
+        {
+
+        }
+
+        template<typename... Args>
+        T& operator()(Args... args) const
+        {
+            static_assert(sizeof...(Args) == Rank, "Number of indices must equal Rank");
+            if constexpr (Rank == 0)
+            {
+                return *buf_;
+            }
+            else
+            {
+                const size_t index[] = {static_cast<size_t>(args)...};
+                size_t offset = 0;
+                for (size_t i = 0; i < Rank; ++i)
+                {
+                    offset += index[i] * strides_[i];
+                }
+                return buf_[offset];
+            }
+        }
+
+        /**
+         * @param i Dimension
+         * @returns Size of dimension i
+        */
+        size_t dim(size_t i) const
+        {
+            return shape_[i];
+        }
+
+        /**
+         * @param i Dimension
+         * @returns Element stride of dimension i
+        */
+        size_t stride(size_t i) const
+        {
+            return strides_[i];
+        }
+
+        /**
+         * @returns Underlying memory buffer
+        */
+        T* data() const
+        {
+            return buf_;
+        }
+
+        /**
+         * @returns Number of elements
+        */
+        size_t size() const
+        {
+            size_t count = 1;
+            for (size_t i = 0; i < Rank; ++i)
+            {
+                count *= shape_[i];
+            }
+            return count;
+        }
+
+        /**
+         * @returns True if the elements are packed in row major order
+        */
+        bool IsContiguous() const
+        {
+            size_t expected = 1;
+            for (size_t i = Rank; i-- > 0;)
+            {
+                if (shape_[i] != 1 && strides_[i] != expected) return false;
+                expected *= shape_[i];
+            }
+            return true;
+        }
+
+        /**
+         * NOTE: Only contiguous tensors can be iterated
+         * 
+         * @returns Iterator to the first element in row major order
+        */
+        iterator begin() const
+        {
+            if (!IsContiguous())
+            {
+                throw GlException("Cannot iterate a non contiguous tensor");
+            }
+            return buf_;
+        }
+
+        /**
+         * @returns Iterator past the last element
+        */
+        iterator end() const
+        {
+            return begin() + size();
+        }
+
+    private:
         T* buf_;
+        std::array<size_t, Rank> shape_;
+        std::array<size_t, Rank> strides_;
+    };
+
+    /**
+     * @param shape Shape of a contiguous tensor
+     * @returns Row major strides of shape
+    */
+    template<size_t Rank>
+    constexpr std::array<size_t, Rank> ContiguousStrides(const std::array<size_t, Rank>& shape)
+    {
+        std::array<size_t, Rank> strides{};
+        size_t stride = 1;
+        for (size_t i = Rank; i-- > 0;)
+        {
+            strides[i] = stride;
+            stride *= shape[i];
+        }
+        return strides;
+    }
+
+    /**
+     * Maps contiguous tensor of shape Dims... to memory 
+     * buffer. Strides are compile time constants, an 
+     * access folds into one multiply-add per index.
+    */
+    template<typename T, size_t... Dims>
+    class StaticTensorMap
+    {
+    public:
+        using iterator = T*;
+
+        static constexpr size_t kRank = sizeof...(Dims);
+        static constexpr size_t kSize = (Dims * ... * size_t(1));
+        static_assert(kRank > 0, "StaticTensorMap needs at least one dimension");
+
+        /**
+         * @param buf Underlying memory buffer of kSize elements
+        */
+        explicit StaticTensorMap(T* buf) : 
+            buf_(buf)
+        {
+
+        }
+
+        template<typename... Args>
+        T& operator()(Args... args) const
+        {
+            static_assert(sizeof...(Args) == kRank, "Number of indices must equal the rank");
+            const size_t index[] = {static_cast<size_t>(args)...};
+            size_t offset = 0;
+            for (size_t i = 0; i < kRank; ++i)
+            {
+                offset += index[i] * kStrides[i];
+            }
+            return buf_[offset];
+        }
+
+        /**
+         * @returns Underlying memory buffer
+        */
+        T* data() const
+        {
+            return buf_;
+        }
+
+        /**
+         * @returns Number of elements
+        */
+        static constexpr size_t size()
+        {
+            return kSize;
+        }
+
+        /**
+         * @returns Iterator to the first element in row major order
+        */
+        iterator begin() const
+        {
+            return buf_;
+        }
+
+        /**
+         * @returns Iterator past the last element
+        */
+        iterator end() const
+        {
+            return buf_ + kSize;
+        }
+
+    private:
+        static constexpr std::array<size_t, kRank> kStrides = 
+            ContiguousStrides<kRank>({{Dims...}});
+
+        T* buf_;
+    };
+    
+    // How a file mapped tensor sees the file
+    enum class MapMode
+    {
+        // Read only and shared with every process mapping
+        // the file, a mutable Map() copies the tensor
+        ReadOnly,
+
+        // Writable, written pages are private copies and
+        // never reach the file
+        CopyOnWrite,
+    };
+
+    // Access pattern hint of a file mapped tensor
+    enum class MapAdvice
+    {
+        Normal,
+
+        // Read ahead aggressively, pages are touched in order
+        Sequential,
+
+        // Do not read ahead
+        Random,
+
+        // Start reading the whole region in the background
+        WillNeed,
+    };
+
+    struct MapFileOptions
+    {
+        MapMode mode = MapMode::ReadOnly;
+        MapAdvice advice = MapAdvice::Normal;
+    };
+
+    /**
+     * Reference counted device memory shared by a tensor, 
+     * all views of it and its copies
+    */
+    class TensorStorage
+    {
+    public:
+        /**
+         * Allocates bytes on device
+         * 
+         * @param device The device the memory lives on
+         * @param bytes Number of bytes
+        */
+        TensorStorage(Device* device, size_t bytes);
+
+        /**
+         * Wraps memory owned by someone else, ex. a 
+         * memory arena. The memory is not freed.
+         * 
+         * @param device The device the memory lives on
+         * @param data Memory of at least bytes
+         * @param bytes Number of bytes
+        */
+        TensorStorage(Device* device, void* data, size_t bytes);
+        virtual ~TensorStorage();
+
+        TensorStorage(const TensorStorage&)             = delete;
+        TensorStorage& operator=(const TensorStorage&)  = delete;
+
+        /**
+         * @returns Underlying memory
+        */
+        void* data() const;
+
+        /**
+         * @returns Number of bytes of the memory
+        */
+        size_t bytes() const;
+
+        /**
+         * @returns Device the memory lives on
+        */
+        Device* device() const;
+
+        /**
+         * @returns False if the memory is borrowed
+        */
+        virtual bool owns_data() const;
+
+        /**
+         * @returns False if the memory cannot be written to
+        */
+        virtual bool writable() const;
+
+        /**
+         * @returns True if a tensor copy shares the memory, 
+         * writers must then copy it first
+        */
+        bool shared() const;
+
+        /**
+         * Counts a tensor copy sharing the memory, views 
+         * are not counted unless they view a copy
+        */
+        void AddCopy();
+
+        /**
+         * Uncounts a tensor copy that stopped sharing the memory
+        */
+        void RemoveCopy();
+
+    private:
+        Device* device_;
+        void* data_;
+        size_t bytes_;
+        bool owns_data_;
+        std::atomic<size_t> copies_;
     };
     
     /**
-     * A memory buffer interpreted as a tensor
+     * A memory buffer interpreted as a tensor. 
+     * 
+     * The memory is a TensorStorage that views share: a 
+     * view has its own shape, element strides and element 
+     * offset into the storage, so slicing, transposing, 
+     * broadcasting and reshaping only build metadata. 
+     * Tensors are row major and contiguous unless they 
+     * are a view.
+     * 
+     * Copies are copy on write: a copy shares the storage 
+     * and the first mutable Map() of any tensor on a 
+     * storage with live copies or a read only storage 
+     * copies it into a private one. Views are not copies, 
+     * so writes through a tensor reach its views once its 
+     * copies are gone. Use Clone() for an eager copy.
     */
     class TensorBuffer
     {
     public:
+        // Empty tensor without storage
+        TensorBuffer();
+
         /**
          * @param dtype Data type of each element in the tensor
          * @param shape Shape of the tensor
          * @param device The device the memory buffer lives on
         */
         TensorBuffer(DataType dtype, const LayoutArray& shape, Device* device);
+
+        /**
+         * Wraps memory owned by someone else, ex. a
+         * memory arena. The memory is not freed.
+         * 
+         * @param dtype Data type of each element in the tensor
+         * @param shape Shape of the tensor
+         * @param device The device the memory buffer lives on
+         * @param data Memory buffer of at least the tensor's size
+        */
+        TensorBuffer(DataType dtype, const LayoutArray& shape, Device* device, void* data);
         ~TensorBuffer();
 
+        /**
+         * Creates a tensor whose memory is a mapping of a file 
+         * region, pages are read from the file on first access
+         * 
+         * @param path Path of the file
+         * @param offset Byte offset of the tensor data in the file
+         * @param dtype Data type of each element in the tensor
+         * @param shape Shape of the tensor
+         * @param device CPU device the memory is accessed from
+         * @param options Mapping mode and access hint
+         * @param tensor Returned tensor
+         * @returns Non-ok status if the file region cannot be mapped
+        */
+        static Status MapFile(const std::string& path, size_t offset, DataType dtype, 
+            const LayoutArray& shape, Device* device, const MapFileOptions& options, 
+            TensorBuffer& tensor);
+
         TensorBuffer(const TensorBuffer& other);
         TensorBuffer& operator=(const TensorBuffer& other);
-        TensorBuffer(TensorBuffer&& other);
-        TensorBuffer& operator=(TensorBuffer&& other);
+        TensorBuffer(TensorBuffer&& other) noexcept;
+        TensorBuffer& operator=(TensorBuffer&& other) noexcept;
         
         /**
          * @returns Shape of the tensor
         */
         const LayoutArray& shape() const;
 
+        /**
+         * @returns Element stride of each dimension, 
+         * 0 for broadcast dimensions
+        */
+        const LayoutArray& strides() const;
+
+        /**
+         * @returns Offset of the first element into 
+         * the storage, in elements
+        */
+        size_t offset() const;
+
         /**
          * @returns Number of elements
         */
         size_t size() const;
 
+        /**
+         * @returns Number of bytes of the tensor data
+        */
+        size_t bytes() const;
+
         /**
          * @returns Data type of the element
         */
         DataType dtype() const;
 
+        /**
+         * @returns True if the elements are packed in 
+         * row major order, kernels may then index the 
+         * data as a flat array
+        */
+        bool IsContiguous() const;
+
         /**
          * Reshapes the shape of the tensor. 
          * 
          * NOTE: The size of 
          * the new shape must equal current size
+         * and the tensor must be contiguous
          * 
          * @param list New shape
          * @returns Reshape status
         */
         Status Reshape(const std::initializer_list<size_t>& list);
 
+        /**
+         * Views of the tensor. They share the storage, writes
+         * through a view are seen by the tensor and all other 
+         * views. Invalid arguments throw GlException.
+        */
+
+        /**
+         * @param dim Dimension to slice
+         * @param begin First index of the slice
+         * @param end Index past the last of the slice, > begin
+         * @returns View of [begin, end) along dim
+        */
+        TensorBuffer Slice(size_t dim, size_t begin, size_t end) const;
+
+        /**
+         * @param perm Permutation, dimension i of the view 
+         * is dimension perm[i] of the tensor
+         * @returns View with permuted dimensions
+        */
+        TensorBuffer Transpose(const LayoutArray& perm) const;
+
+        /**
+         * @returns View with reversed dimensions
+        */
+        TensorBuffer Transpose() const;
+
+        /**
+         * NOTE: Broadcast elements alias each other, 
+         * the view should only be read
+         * 
+         * @param shape Shape the tensor broadcasts to, 
+         * NumPy style
+         * @returns View of shape
+        */
+        TensorBuffer Broadcast(const LayoutArray& shape) const;
+
+        /**
+         * NOTE: Non contiguous tensors can only be viewed 
+         * in shapes that split or merge dimensions whose 
+         * strides allow it, use Contiguous() first otherwise
+         * 
+         * @param shape New shape of equal size
+         * @returns View of shape
+        */
+        TensorBuffer View(const LayoutArray& shape) const;
+
+        /**
+         * @returns This tensor's storage if contiguous, 
+         * otherwise a contiguous copy on the same device
+        */
+        TensorBuffer Contiguous() const;
+
+        /**
+         * @returns Contiguous copy in a new storage on the same device
+        */
+        TensorBuffer Clone() const;
+
         /**
          * Creates a TensorMap to access the tensor data
          * 
+         * NOTE: Copies the storage first if a tensor copy 
+         * shares it or it is read only
+         * 
          * @param T Type to interpret the buffer as
+         * @param Rank Rank of the tensor if known at compile time
          * @returns TensorMap 
         */
-        template<typename T>
-        TensorMap<T> Map()
+        template<typename T, size_t Rank = kDynamicRank>
+        TensorMap<T, Rank> Map()
         {
             if (sizeof(T) != DataTypeSize(dtype()))
             {
                 throw GlException("Bad cast, type size does not match");
             }
-            return TensorMap(base<T>(), shape());
+            return TensorMap<T, Rank>(base<T>(), shape(), strides());
+        }
+
+        /**
+         * Creates a read only TensorMap to access the tensor data
+         * 
+         * @param T Type to interpret the buffer as
+         * @param Rank Rank of the tensor if known at compile time
+         * @returns TensorMap 
+        */
+        template<typename T, size_t Rank = kDynamicRank>
+        TensorMap<const T, Rank> Map() const
+        {
+            if (sizeof(T) != DataTypeSize(dtype()))
+            {
+                throw GlException("Bad cast, type size does not match");
+            }
+            return TensorMap<const T, Rank>(reinterpret_cast<const T*>(data()), shape(), strides());
+        }
+
+        /**
+         * Creates a StaticTensorMap to access the tensor data
+         * 
+         * NOTE: The tensor must be contiguous with shape Dims...
+         * and the storage is copied first if a tensor copy 
+         * shares it or it is read only
+         * 
+         * @param T Type to interpret the buffer as
+         * @param Dims Shape of the tensor
+         * @returns StaticTensorMap 
+        */
+        template<typename T, size_t... Dims>
+        StaticTensorMap<T, Dims...> StaticMap()
+        {
+            CheckStaticMap<T, Dims...>();
+            return StaticTensorMap<T, Dims...>(base<T>());
+        }
+
+        /**
+         * Creates a read only StaticTensorMap to access the tensor data
+         * 
+         * NOTE: The tensor must be contiguous with shape Dims...
+         * 
+         * @param T Type to interpret the buffer as
+         * @param Dims Shape of the tensor
+         * @returns StaticTensorMap 
+        */
+        template<typename T, size_t... Dims>
+        StaticTensorMap<const T, Dims...> StaticMap() const
+        {
+            CheckStaticMap<T, Dims...>();
+            return StaticTensorMap<const T, Dims...>(reinterpret_cast<const T*>(data()));
         }
+
+        /**
+         * @returns Device the memory buffer lives on
+        */
+        Device* device() const;
+
+        /**
+         * @returns Quantization of an Int8 tensor, 
+         * nullptr if it is not quantized
+        */
+        const QuantParams* quant_params() const;
+
+        /**
+         * Attaches quantization to an Int8 tensor. Views
+         * and copies of the tensor carry it too.
+         * 
+         * NOTE: Throws GlException if the tensor is not Int8 
+         * or the channels do not match the channel axis
+         * 
+         * @param params Quantization, nullptr clears it
+        */
+        void set_quant_params(const std::shared_ptr<const QuantParams>& params);
+        void set_quant_params(const QuantParams& params);
         
 
     private:
+        friend class Checkpoint;
+        friend class Executor;
+
+        /**
+         * View of storage
+         * 
+         * @param storage Storage shared with the viewed tensor
+         * @param dtype Data type of each element in the tensor
+         * @param shape Shape of the view
+         * @param strides Element strides of the view
+         * @param offset Element offset of the view into storage
+        */
+        TensorBuffer(const std::shared_ptr<TensorStorage>& storage, DataType dtype, 
+            const LayoutArray& shape, const LayoutArray& strides, size_t offset);
+
         /**
          * @returns Underlying memory buffer
         */
         void* data();
+        const void* data() const;
+
+        /**
+         * @returns False if the memory is borrowed or 
+         * there is no storage
+        */
+        bool owns_data() const;
         
         /**
-         * @returns Pointer casted underlying memory buffer
+         * Replaces a storage shared with a tensor copy or 
+         * read only by a private copy of it
+        */
+        void MakeUnique();
+
+        /**
+         * @param shape Shape of the view
+         * @param strides Element strides of the view
+         * @param offset Element offset of the view into storage
+         * @returns View of the storage, counted as a copy 
+         * if this tensor is one
+        */
+        TensorBuffer MakeView(const LayoutArray& shape, const LayoutArray& strides, size_t offset) const;
+
+        /**
+         * Uncounts this tensor if it is a copy of its storage
+        */
+        void ReleaseCopy();
+
+        /**
+         * @returns Pointer casted underlying memory buffer, 
+         * private to this tensor and its views
         */
         template <typename T>
         T* base() {
+            MakeUnique();
             return reinterpret_cast<T*>(data());
         }
+
+        /**
+         * Throws if the tensor cannot be mapped as a 
+         * StaticTensorMap<T, Dims...>
+        */
+        template<typename T, size_t... Dims>
+        void CheckStaticMap() const
+        {
+            if (sizeof(T) != DataTypeSize(dtype()))
+            {
+                throw GlException("Bad cast, type size does not match");
+            }
+
+            const size_t dims[] = {Dims...};
+            bool match = shape_.rank() == sizeof...(Dims);
+            for (size_t i = 0; match && i < sizeof...(Dims); ++i)
+            {
+                match = shape_[i] == dims[i];
+            }
+            if (!match)
+            {
+                throw GlException("Static shape does not match the tensor's shape");
+            }
+            if (!IsContiguous())
+            {
+                throw GlException("Cannot statically map a non contiguous tensor");
+            }
+        }
         
-        Device* device_;
+        std::shared_ptr<TensorStorage> storage_;
         LayoutArray shape_;
+        LayoutArray strides_;
+        size_t offset_;
         size_t size_;
-        void* data_;
         DataType dtype_;
+        std::shared_ptr<const QuantParams> quant_;
+        bool copy_;
     };
 }
 
@@ -0,0 +1,51 @@
+#include <cstdint>
+
+#include "common/arena.h"
+
+namespace graphloom
+{
+    /**
+     * Arena Impl
+    */
+
+    Arena::~Arena()
+    {
+        for (char* block : blocks_)
+        {
+            delete[] block;
+        }
+    }
+
+    void* Arena::Allocate(size_t bytes, size_t alignment)
+    {
+        uintptr_t head = reinterpret_cast<uintptr_t>(head_);
+        uintptr_t aligned = (head + alignment - 1) & ~(uintptr_t(alignment) - 1);
+        if (head_ != nullptr && aligned + bytes <= reinterpret_cast<uintptr_t>(end_))
+        {
+            head_ = reinterpret_cast<char*>(aligned + bytes);
+            return reinterpret_cast<void*>(aligned);
+        }
+
+        // new[] is aligned to max_align_t, enough for any object
+        if (bytes > kBlockBytes / 4)
+        {
+            // oversized, the current block keeps its free space
+            char* block = new char[bytes];
+            blocks_.push_back(block);
+            capacity_ += bytes;
+            return block;
+        }
+
+        char* block = new char[kBlockBytes];
+        blocks_.push_back(block);
+        capacity_ += kBlockBytes;
+        head_ = block + bytes;
+        end_ = block + kBlockBytes;
+        return block;
+    }
+
+    size_t Arena::capacity() const
+    {
+        return capacity_;
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef GRAPHLOOM_COMMON_ARENA_H_
+#define GRAPHLOOM_COMMON_ARENA_H_
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * This module defines the Arena, a bump allocator for
+ * objects that live as long as their owner, ex. the
+ * nodes and edges of a GraphDef. Objects are packed
+ * into large blocks in allocation order and released
+ * all at once, so building a large structure costs a
+ * few system allocations instead of one per object.
+ * The arena never runs destructors, its owner does.
+*/
+
+namespace graphloom
+{
+    class Arena
+    {
+    public:
+        // Bytes of a block, larger requests get their own block
+        static constexpr size_t kBlockBytes = size_t(1) << 16;
+
+        Arena() = default;
+        ~Arena();
+
+        Arena(const Arena&)               = delete;
+        Arena& operator=(const Arena&)    = delete;
+
+        /**
+         * NOTE: Not thread safe
+         *
+         * @param bytes Number of bytes requested
+         * @param alignment Power of 2 alignment, at most alignof(std::max_align_t)
+         * @returns Memory valid until the arena is destroyed, throws on failure
+        */
+        void* Allocate(size_t bytes, size_t alignment);
+
+        /**
+         * @returns Number of bytes obtained from the system
+        */
+        size_t capacity() const;
+
+    private:
+        std::vector<char*> blocks_;
+        char* head_ = nullptr;  // next free byte of the current block
+        char* end_ = nullptr;   // end of the current block
+        size_t capacity_ = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <exception>
+
+#include "common/thread_pool.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#define GL_HAS_AFFINITY 1
+#endif
+
+namespace graphloom
+{
+    namespace
+    {
+        // Pool and index of the worker running on this thread
+        thread_local const ThreadPool* current_pool = nullptr;
+        thread_local size_t current_index = 0;
+
+        // Chunks of a ParallelFor per thread, balances uneven chunks
+        constexpr size_t kChunksPerThread = 4;
+
+        // Shared state of one ParallelFor. Helpers that start
+        // after the loop finished find no chunk and return.
+        struct Loop
+        {
+            std::atomic<size_t> next{0};
+            std::atomic<size_t> done{0};
+            size_t n = 0;
+            size_t chunk = 0;
+            size_t num_chunks = 0;
+            const std::function<void(size_t, size_t)>* fn = nullptr;
+
+            std::mutex error_mutex;
+            std::exception_ptr error;
+        };
+
+        void RunChunks(Loop& loop)
+        {
+            size_t index;
+            while ((index = loop.next.fetch_add(1, std::memory_order_relaxed)) < loop.num_chunks)
+            {
+                size_t begin = index * loop.chunk;
+                size_t end = std::min(loop.n, begin + loop.chunk);
+                try
+                {
+                    (*loop.fn)(begin, end);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(loop.error_mutex);
+                    if (!loop.error) loop.error = std::current_exception();
+                }
+                loop.done.fetch_add(1, std::memory_order_release);
+            }
+        }
+
+        /**
+         * Restricts the calling thread to cpus, best effort
+         *
+         * @param cpus Logical cpus, empty to do nothing
+        */
+        void PinCurrentThread(const std::vector<int>& cpus)
+        {
+#ifdef GL_HAS_AFFINITY
+            if (cpus.empty()) return;
+
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (int cpu : cpus)
+            {
+                if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+            }
+            if (CPU_COUNT(&set) > 0)
+            {
+                pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+            }
+#else
+            (void)cpus;
+#endif
+        }
+    }
+
+    /**
+     * ThreadPool Impl
+    */
+
+    ThreadPool::ThreadPool(size_t num_threads, size_t spin_iterations, const std::vector<int>& cpus) :
+        spin_iterations_(spin_iterations),
+        cpus_(cpus),
+        pending_(0),
+        sleepers_(0),
+        next_queue_(0),
+        stop_(false)
+    {
+        if (num_threads == 0)
+        {
+            num_threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        for (size_t i = 0; i < num_threads; ++i)
+        {
+            queues_.emplace_back(new Queue());
+        }
+        for (size_t i = 0; i < num_threads; ++i)
+        {
+            threads_.emplace_back(&ThreadPool::WorkerLoop, this, i);
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            stop_.store(true);
+        }
+        wake_.notify_all();
+
+        for (std::thread& thread : threads_)
+        {
+            thread.join();
+        }
+    }
+
+    void ThreadPool::Schedule(Task task)
+    {
+        size_t index = current_pool == this ?
+            current_index :
+            next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+
+        // counted before it is visible, so a worker never
+        // sleeps while the task is queued
+        pending_.fetch_add(1);
+        {
+            Queue& queue = *queues_[index];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+
+        if (sleepers_.load() > 0)
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            wake_.notify_one();
+        }
+    }
+
+    void ThreadPool::ParallelFor(size_t n, size_t max_threads, size_t grain,
+        const std::function<void(size_t, size_t)>& fn)
+    {
+        if (n == 0) return;
+
+        grain = std::max<size_t>(grain, 1);
+        size_t max_chunks = (n + grain - 1) / grain;
+        size_t threads = std::min(std::max<size_t>(max_threads, 1), max_chunks);
+        if (threads == 1)
+        {
+            fn(0, n);
+            return;
+        }
+
+        std::shared_ptr<Loop> loop = std::make_shared<Loop>();
+        size_t num_chunks = std::min(max_chunks, threads * kChunksPerThread);
+        loop->n = n;
+        loop->chunk = (n + num_chunks - 1) / num_chunks;
+        loop->num_chunks = (n + loop->chunk - 1) / loop->chunk;
+        loop->fn = &fn;
+
+        for (size_t i = 1; i < threads; ++i)
+        {
+            Schedule([loop]() { RunChunks(*loop); });
+        }
+        RunChunks(*loop);
+
+        // remaining chunks are already running on helpers
+        while (loop->done.load(std::memory_order_acquire) < loop->num_chunks)
+        {
+            std::this_thread::yield();
+        }
+
+        if (loop->error) std::rethrow_exception(loop->error);
+    }
+
+    size_t ThreadPool::num_threads() const
+    {
+        return threads_.size();
+    }
+
+    int ThreadPool::CurrentThreadId() const
+    {
+        return current_pool == this ? static_cast<int>(current_index) : -1;
+    }
+
+    void ThreadPool::WorkerLoop(size_t index)
+    {
+        current_pool = this;
+        current_index = index;
+        PinCurrentThread(cpus_);
+
+        Task task;
+        size_t idle = 0;
+        while (true)
+        {
+            if (TakeTask(index, task))
+            {
+                task();
+                task = nullptr;
+                idle = 0;
+                continue;
+            }
+
+            if (stop_.load() && pending_.load() == 0) break;
+
+            if (idle < spin_iterations_)
+            {
+                ++idle;
+                std::this_thread::yield();
+                continue;
+            }
+
+            // sleepers_ is raised before pending_ is checked and
+            // Schedule() raises pending_ before checking sleepers_,
+            // so either the task is seen here or the worker is woken
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            sleepers_.fetch_add(1);
+            wake_.wait(lock, [this]() { return pending_.load() > 0 || stop_.load(); });
+            sleepers_.fetch_sub(1);
+            idle = 0;
+        }
+
+        current_pool = nullptr;
+    }
+
+    bool ThreadPool::TakeTask(size_t index, Task& task)
+    {
+        if (pending_.load(std::memory_order_relaxed) == 0) return false;
+
+        // own tasks newest first, they are the hottest in cache
+        {
+            Queue& queue = *queues_[index];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty())
+            {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+                pending_.fetch_sub(1);
+                return true;
+            }
+        }
+
+        // steal the oldest task of another worker
+        for (size_t i = 1; i < queues_.size(); ++i)
+        {
+            Queue& queue = *queues_[(index + i) % queues_.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty())
+            {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                pending_.fetch_sub(1);
+                return true;
+            }
+        }
+        return false;
+    }
+}
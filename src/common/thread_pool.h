@@ -0,0 +1,133 @@
+#ifndef GRAPHLOOM_COMMON_THREAD_POOL_H_
+#define GRAPHLOOM_COMMON_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * This module defines the ThreadPool shared by inter-op
+ * (node dispatch) and intra-op (parallel_for) parallelism.
+ * Every worker owns a deque: it pushes and pops its own
+ * tasks at the back and steals the oldest task at the front
+ * of another worker's deque when its own is empty. Idle
+ * workers spin for a while before sleeping, so short gaps
+ * between tasks do not pay for a wake up. Workers may be
+ * restricted to a set of cpus, ex. the cores of one NUMA
+ * node.
+*/
+
+namespace graphloom
+{
+    class ThreadPool
+    {
+    public:
+        using Task = std::function<void()>;
+
+        // Idle polls of the deques before a worker sleeps
+        static constexpr size_t kDefaultSpinIterations = 4096;
+
+        /**
+         * Starts the workers
+         *
+         * @param num_threads Number of workers, 0 for the hardware concurrency
+         * @param spin_iterations Idle polls before a worker sleeps, 0 to sleep at once
+         * @param cpus Logical cpus the workers may run on, empty for any
+        */
+        explicit ThreadPool(size_t num_threads, size_t spin_iterations = kDefaultSpinIterations,
+            const std::vector<int>& cpus = {});
+
+        /**
+         * Runs the tasks still queued then joins the workers
+        */
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&)               = delete;
+        ThreadPool& operator=(const ThreadPool&)    = delete;
+
+        /**
+         * Queues task. Called from a worker, the task goes to
+         * the worker's own deque, otherwise deques are picked
+         * round robin.
+         *
+         * NOTE: Thread safe. task must not throw
+         *
+         * @param task Task to run
+        */
+        void Schedule(Task task);
+
+        /**
+         * Calls fn over chunks of [0, n) on at most max_threads
+         * threads, the calling thread included, and returns once
+         * every chunk is done. The caller computes chunks itself
+         * instead of waiting on helpers, so this never deadlocks
+         * when every worker is busy.
+         *
+         * NOTE: Thread safe. The first exception thrown by fn is
+         * rethrown on the caller
+         *
+         * @param n Number of iterations
+         * @param max_threads Max threads working on the loop
+         * @param grain Min iterations per chunk
+         * @param fn Called with the [begin, end) range of a chunk
+        */
+        void ParallelFor(size_t n, size_t max_threads, size_t grain,
+            const std::function<void(size_t, size_t)>& fn);
+
+        /**
+         * @returns Number of workers
+        */
+        size_t num_threads() const;
+
+        /**
+         * @returns Index of the calling worker of this pool, -1 if
+         * the caller is not one of its workers
+        */
+        int CurrentThreadId() const;
+
+    private:
+        struct Queue
+        {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        /**
+         * Runs tasks until the pool stops
+         *
+         * @param index Index of the worker
+        */
+        void WorkerLoop(size_t index);
+
+        /**
+         * Takes the newest task of the worker's deque,
+         * else the oldest task of another deque
+         *
+         * @param index Index of the worker
+         * @param task Returned task
+         * @returns true if a task was taken
+        */
+        bool TakeTask(size_t index, Task& task);
+
+        std::vector<std::unique_ptr<Queue>> queues_;
+        std::vector<std::thread> threads_;
+        const size_t spin_iterations_;
+        const std::vector<int> cpus_;
+
+        std::atomic<size_t> pending_;    // tasks queued, not yet taken
+        std::atomic<size_t> sleepers_;   // workers asleep or about to sleep
+        std::atomic<size_t> next_queue_; // round robin for external tasks
+        std::atomic<bool> stop_;
+
+        std::mutex sleep_mutex_;
+        std::condition_variable wake_;
+    };
+}
+
+#endif
@@ -0,0 +1,461 @@
+#include <omp.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "device/caching_allocator.h"
+#include "device/system_memory.h"
+
+namespace graphloom
+{
+    namespace
+    {
+        // Bytes reserved in front of every block. Keeps the
+        // payload kAlignment aligned.
+        constexpr size_t kHeaderSize = CachingAllocator::kAlignment;
+
+        // Target size of a slab carved into blocks
+        constexpr size_t kSlabBytes = size_t(1) << 20;
+
+        // Maximum number of blocks carved out of one slab
+        constexpr size_t kMaxBlocksPerSlab = 64;
+
+        // Blocks larger than this bypass the thread caches
+        constexpr size_t kThreadCacheMaxBlock = size_t(1) << 18;
+
+        // Soft limit of cached bytes per bin in a thread cache
+        constexpr size_t kThreadCacheBytes = size_t(1) << 20;
+
+        struct BlockHeader
+        {
+            BlockHeader* next; // free list link, only valid while cached
+            size_t bin;        // size class of this block
+            size_t bytes;      // bytes requested, only valid while allocated
+            size_t mapped;     // mapping length of a large block, 0 if not mapped
+        };
+        static_assert(sizeof(BlockHeader) <= kHeaderSize, "Block header exceeds reserved space");
+
+        inline BlockHeader* HeaderOf(void* ptr)
+        {
+            return reinterpret_cast<BlockHeader*>(static_cast<char*>(ptr) - kHeaderSize);
+        }
+
+        inline const BlockHeader* HeaderOf(const void* ptr)
+        {
+            return reinterpret_cast<const BlockHeader*>(static_cast<const char*>(ptr) - kHeaderSize);
+        }
+
+        inline void* PayloadOf(BlockHeader* header, size_t bytes)
+        {
+            header->bytes = bytes;
+            return reinterpret_cast<char*>(header) + kHeaderSize;
+        }
+
+        /**
+         * @param bin Size class index
+         * @returns Max number of blocks a thread may cache, 0 if uncached
+        */
+        inline size_t ThreadCapacity(size_t bin)
+        {
+            size_t bin_size = CachingAllocator::BinSize(bin);
+            if (bin_size > kThreadCacheMaxBlock) return 0;
+
+            size_t capacity = kThreadCacheBytes / bin_size;
+            if (capacity < 4) capacity = 4;
+            if (capacity > 64) capacity = 64;
+            return capacity;
+        }
+
+        std::atomic<uint64_t> allocator_count{0};
+    }
+
+    /**
+     * Shared store of free blocks. Each bin is guarded
+     * by its own lock so bins never contend with each other.
+    */
+    struct CachingAllocator::Reservoir
+    {
+        struct Slab
+        {
+            void* ptr;
+            size_t mapped; // mapping length, 0 if not mapped
+        };
+
+        struct Bin
+        {
+            omp_lock_t lock;
+            BlockHeader* head = nullptr;
+            std::vector<Slab> slabs; // system allocations owned by this bin
+        };
+
+        Bin bins[kNumBins];
+        const int numa_node; // preferred node of new slabs
+
+        mutable omp_lock_t options_lock;
+        CpuAllocOptions options;
+
+        explicit Reservoir(int numa_node) :
+            numa_node(numa_node)
+        {
+            for (Bin& bin : bins)
+            {
+                omp_init_lock(&bin.lock);
+            }
+            omp_init_lock(&options_lock);
+        }
+
+        ~Reservoir()
+        {
+            for (Bin& bin : bins)
+            {
+                for (const Slab& slab : bin.slabs)
+                {
+                    SystemFree(slab.ptr, kAlignment, slab.mapped);
+                }
+                omp_destroy_lock(&bin.lock);
+            }
+            omp_destroy_lock(&options_lock);
+        }
+
+        /**
+         * @returns Copy of the current options
+        */
+        CpuAllocOptions Options() const
+        {
+            omp_set_lock(&options_lock);
+            CpuAllocOptions result = options;
+            omp_unset_lock(&options_lock);
+            return result;
+        }
+
+        /**
+         * Takes up to count blocks out of the bin, carving
+         * a new slab if the bin is empty.
+         *
+         * @param index Bin index
+         * @param count Max number of blocks to take
+         * @param taken Returned number of blocks taken
+         * @returns Linked list of taken blocks, nullptr on failure
+        */
+        BlockHeader* Take(size_t index, size_t count, size_t& taken)
+        {
+            Bin& bin = bins[index];
+            omp_set_lock(&bin.lock);
+
+            if (bin.head == nullptr && !Carve(index))
+            {
+                omp_unset_lock(&bin.lock);
+                taken = 0;
+                return nullptr;
+            }
+
+            BlockHeader* head = bin.head;
+            BlockHeader* tail = head;
+            taken = 1;
+            while (taken < count && tail->next != nullptr)
+            {
+                tail = tail->next;
+                ++taken;
+            }
+            bin.head = tail->next;
+            tail->next = nullptr;
+
+            omp_unset_lock(&bin.lock);
+            return head;
+        }
+
+        /**
+         * Returns a linked list of blocks to the bin
+         *
+         * @param index Bin index
+         * @param head First block of the list
+         * @param tail Last block of the list
+        */
+        void Give(size_t index, BlockHeader* head, BlockHeader* tail)
+        {
+            Bin& bin = bins[index];
+            omp_set_lock(&bin.lock);
+            tail->next = bin.head;
+            bin.head = head;
+            omp_unset_lock(&bin.lock);
+        }
+
+    private:
+        /**
+         * Allocates a new slab and threads its blocks onto
+         * the bin's free list. Caller must hold the bin's lock.
+         *
+         * @param index Bin index
+         * @returns True if successful
+        */
+        bool Carve(size_t index)
+        {
+            Bin& bin = bins[index];
+            // strides stay kAlignment multiples, bin sizes need not be
+            size_t block_size = kHeaderSize + (BinSize(index) + kAlignment - 1) / kAlignment * kAlignment;
+            size_t num_blocks = kSlabBytes / block_size;
+            if (num_blocks < 1) num_blocks = 1;
+            if (num_blocks > kMaxBlocksPerSlab) num_blocks = kMaxBlocksPerSlab;
+
+            size_t mapped;
+            char* slab = static_cast<char*>(SystemAllocate(num_blocks * block_size,
+                kAlignment, Options(), numa_node, mapped));
+            if (slab == nullptr) return false;
+            bin.slabs.push_back({slab, mapped});
+
+            for (size_t i = 0; i < num_blocks; ++i)
+            {
+                BlockHeader* header = reinterpret_cast<BlockHeader*>(slab + i*block_size);
+                header->bin = index;
+                header->next = bin.head;
+                bin.head = header;
+            }
+            return true;
+        }
+    };
+
+    /**
+     * Per-thread free lists of one allocator. Accessed
+     * only by its owning thread, so no locking is needed.
+     * The cache does not keep the reservoir alive, blocks
+     * cached for a destroyed allocator are dropped with it.
+    */
+    struct CachingAllocator::ThreadCache
+    {
+        struct FreeList
+        {
+            BlockHeader* head = nullptr;
+            size_t count = 0;
+        };
+
+        uint64_t owner; // id of the allocator this cache belongs to
+        std::weak_ptr<Reservoir> reservoir;
+        FreeList lists[kNumBins];
+
+        ThreadCache(uint64_t owner, const std::shared_ptr<Reservoir>& reservoir) :
+            owner(owner), reservoir(reservoir)
+        {
+
+        }
+
+        // return every cached block when the thread exits,
+        // unless the allocator and its slabs are already gone
+        ~ThreadCache()
+        {
+            std::shared_ptr<Reservoir> alive = reservoir.lock();
+            if (alive == nullptr) return;
+
+            for (size_t i = 0; i < kNumBins; ++i)
+            {
+                if (lists[i].count > 0)
+                {
+                    Flush(*alive, i, lists[i].count);
+                }
+            }
+        }
+
+        /**
+         * Returns the first count cached blocks of bin to the reservoir
+         *
+         * @param target Reservoir the blocks were taken from
+         * @param index Bin index
+         * @param count Number of blocks to return
+        */
+        void Flush(Reservoir& target, size_t index, size_t count)
+        {
+            FreeList& list = lists[index];
+            BlockHeader* head = list.head;
+            BlockHeader* tail = head;
+            for (size_t i = 1; i < count; ++i)
+            {
+                tail = tail->next;
+            }
+            list.head = tail->next;
+            list.count -= count;
+            target.Give(index, head, tail);
+        }
+    };
+
+    /**
+     * CachingAllocator Impl
+    */
+
+    CachingAllocator::CachingAllocator(int numa_node) :
+        id_(allocator_count.fetch_add(1)),
+        numa_node_(numa_node),
+        reservoir_(std::make_shared<Reservoir>(numa_node))
+    {
+
+    }
+
+    CachingAllocator::~CachingAllocator()
+    {
+        // Frees the slabs, blocks still cached by other
+        // threads are dropped and their caches pruned later.
+        reservoir_.reset();
+    }
+
+    void* CachingAllocator::Allocate(size_t bytes)
+    {
+        size_t bin = BinIndex(bytes);
+
+        if (bin == kLargeBin)
+        {
+            if (bytes > SIZE_MAX - kHeaderSize - kHugePageBytes) return nullptr;
+
+            size_t mapped;
+            void* raw = SystemAllocate(kHeaderSize + bytes, kAlignment,
+                reservoir_->Options(), numa_node_, mapped);
+            if (raw == nullptr) return nullptr;
+            BlockHeader* header = static_cast<BlockHeader*>(raw);
+            header->bin = kLargeBin;
+            header->mapped = mapped;
+            return PayloadOf(header, bytes);
+        }
+
+        size_t capacity = ThreadCapacity(bin);
+        ThreadCache* cache = capacity == 0 ? nullptr : LocalCache();
+        if (cache == nullptr)
+        {
+            size_t taken;
+            BlockHeader* header = reservoir_->Take(bin, 1, taken);
+            return header == nullptr ? nullptr : PayloadOf(header, bytes);
+        }
+
+        ThreadCache::FreeList& list = cache->lists[bin];
+        if (list.head == nullptr)
+        {
+            list.head = reservoir_->Take(bin, capacity / 2, list.count);
+            if (list.head == nullptr) return nullptr;
+        }
+
+        BlockHeader* header = list.head;
+        list.head = header->next;
+        --list.count;
+        return PayloadOf(header, bytes);
+    }
+
+    void CachingAllocator::Deallocate(void* ptr)
+    {
+        if (ptr == nullptr) return;
+
+        BlockHeader* header = HeaderOf(ptr);
+        size_t bin = header->bin;
+
+        if (bin == kLargeBin)
+        {
+            SystemFree(header, kAlignment, header->mapped);
+            return;
+        }
+
+        size_t capacity = ThreadCapacity(bin);
+        ThreadCache* cache = capacity == 0 ? nullptr : LocalCache();
+        if (cache == nullptr)
+        {
+            reservoir_->Give(bin, header, header);
+            return;
+        }
+
+        ThreadCache::FreeList& list = cache->lists[bin];
+        header->next = list.head;
+        list.head = header;
+        ++list.count;
+
+        // keep the thread cache bounded, hand half
+        // back so other threads can reuse them
+        if (list.count > capacity)
+        {
+            cache->Flush(*reservoir_, bin, list.count / 2);
+        }
+    }
+
+    size_t CachingAllocator::AllocatedBytes(const void* ptr)
+    {
+        return HeaderOf(ptr)->bytes;
+    }
+
+    size_t CachingAllocator::BinIndex(size_t bytes)
+    {
+        if (bytes <= (size_t(1) << kMinBinShift)) return 0;
+        if (bytes > (size_t(1) << kMaxBinShift)) return kLargeBin;
+
+        // bytes is in (2^shift, 2^(shift+1)], split into kBinsPerDoubling steps
+        size_t shift = 0;
+        for (size_t v = bytes - 1; v > 1; v >>= 1) ++shift;
+        size_t step_shift = shift - 2;
+        size_t offset = (bytes - 1 - (size_t(1) << shift)) >> step_shift;
+        return 1 + (shift - kMinBinShift) * kBinsPerDoubling + offset;
+    }
+
+    size_t CachingAllocator::BinSize(size_t bin)
+    {
+        if (bin == 0) return size_t(1) << kMinBinShift;
+
+        size_t shift = kMinBinShift + (bin - 1) / kBinsPerDoubling;
+        size_t offset = (bin - 1) % kBinsPerDoubling;
+        return (size_t(1) << shift) + (offset + 1) * (size_t(1) << (shift - 2));
+    }
+
+    int CachingAllocator::numa_node() const
+    {
+        return numa_node_;
+    }
+
+    void CachingAllocator::set_options(const CpuAllocOptions& options)
+    {
+        omp_set_lock(&reservoir_->options_lock);
+        reservoir_->options = options;
+        omp_unset_lock(&reservoir_->options_lock);
+    }
+
+    CpuAllocOptions CachingAllocator::options() const
+    {
+        return reservoir_->Options();
+    }
+
+    CachingAllocator::ThreadCache* CachingAllocator::LocalCache()
+    {
+        // Set once the thread's caches are torn down, late
+        // deallocations (ex. from static destructors) then
+        // go straight to the reservoir.
+        thread_local bool torn_down = false;
+        thread_local ThreadCache* last = nullptr;
+
+        struct Caches
+        {
+            std::vector<std::unique_ptr<ThreadCache>> entries;
+            ~Caches()
+            {
+                torn_down = true;
+                last = nullptr;
+            }
+        };
+        thread_local Caches caches;
+
+        if (torn_down) return nullptr;
+
+        if (last != nullptr && last->owner == id_)
+        {
+            return last;
+        }
+
+        for (const std::unique_ptr<ThreadCache>& cache : caches.entries)
+        {
+            if (cache->owner == id_)
+            {
+                last = cache.get();
+                return last;
+            }
+        }
+
+        // prune the caches of destroyed allocators before adding one
+        caches.entries.erase(std::remove_if(caches.entries.begin(), caches.entries.end(),
+            [](const std::unique_ptr<ThreadCache>& cache) { return cache->reservoir.expired(); }),
+            caches.entries.end());
+
+        caches.entries.push_back(std::make_unique<ThreadCache>(id_, reservoir_));
+        last = caches.entries.back().get();
+        return last;
+    }
+}
@@ -0,0 +1,126 @@
+#ifndef GRAPHLOOM_DEVICE_CACHING_ALLOCATOR_H_
+#define GRAPHLOOM_DEVICE_CACHING_ALLOCATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "graphloom/device/cpu.h"
+
+/**
+ * This module defines the CachingAllocator used by
+ * host devices. Requests are rounded up to a size class
+ * (bin) and served from a per-thread free list first,
+ * then from a shared reservoir of slabs. Freed blocks
+ * are cached instead of returned to the system, so
+ * repeated allocations of the same shapes never reach
+ * the system allocator nor a global lock. Slabs and
+ * large blocks may be placed on a preferred NUMA node,
+ * large ones are obtained per CpuAllocOptions.
+*/
+
+namespace graphloom
+{
+    class CachingAllocator
+    {
+    public:
+        // Alignment of every block returned
+        static constexpr size_t kAlignment = 64;
+
+        // Smallest and largest binned block size as powers of 2
+        static constexpr size_t kMinBinShift = 6;
+        static constexpr size_t kMaxBinShift = 26;
+
+        // Number of size classes between two powers of 2
+        static constexpr size_t kBinsPerDoubling = 4;
+
+        // Total number of size classes
+        static constexpr size_t kNumBins = 1 + (kMaxBinShift - kMinBinShift) * kBinsPerDoubling;
+
+        // Bin index of blocks too large to be binned
+        static constexpr size_t kLargeBin = kNumBins;
+
+        /**
+         * @param numa_node NUMA node preferred for new memory,
+         * negative to leave placement to first touch
+        */
+        explicit CachingAllocator(int numa_node = -1);
+        ~CachingAllocator();
+
+        CachingAllocator(const CachingAllocator&)               = delete;
+        CachingAllocator& operator=(const CachingAllocator&)    = delete;
+
+        /**
+         * Allocates a kAlignment aligned buffer.
+         *
+         * NOTE: Thread safe
+         *
+         * @param bytes Number of bytes requested
+         * @returns Buffer pointer, nullptr on failure
+        */
+        void* Allocate(size_t bytes);
+
+        /**
+         * Returns a buffer from Allocate() to the cache.
+         * The buffer may be freed on any thread.
+         *
+         * NOTE: Thread safe
+         *
+         * @param ptr Buffer to free, nullptr is ignored
+        */
+        void Deallocate(void* ptr);
+
+        /**
+         * @param ptr Buffer from Allocate(), not yet freed
+         * @returns Number of bytes requested for ptr
+        */
+        static size_t AllocatedBytes(const void* ptr);
+
+        /**
+         * @param bytes Number of bytes requested
+         * @returns Size class of bytes, kLargeBin if not binned
+        */
+        static size_t BinIndex(size_t bytes);
+
+        /**
+         * @param bin Size class index
+         * @returns Usable bytes of blocks in the size class
+        */
+        static size_t BinSize(size_t bin);
+
+        /**
+         * @returns NUMA node preferred for new memory, negative if none
+        */
+        int numa_node() const;
+
+        /**
+         * NOTE: Thread safe
+         * 
+         * @param options Options of memory obtained from now on
+        */
+        void set_options(const CpuAllocOptions& options);
+
+        /**
+         * NOTE: Thread safe
+         * 
+         * @returns Options of memory obtained from the system
+        */
+        CpuAllocOptions options() const;
+
+    private:
+        struct Reservoir;
+        struct ThreadCache;
+
+        /**
+         * @returns The calling thread's cache of this allocator,
+         * nullptr if the thread is exiting
+        */
+        ThreadCache* LocalCache();
+
+        const uint64_t id_; // unique id, keys the thread local caches
+        const int numa_node_;
+        std::shared_ptr<Reservoir> reservoir_; // shared by all thread caches
+    };
+}
+
+#endif
@@ -1,9 +1,38 @@
 #include <cstdlib>
+#include <cstdint>
+#include <cstring>
 
 #include "graphloom/device/cpu.h"
+#include "common/thread_pool.h"
+#include "device/caching_allocator.h"
+#include "device/numa.h"
 
 namespace graphloom
 {
+    Cpu::Cpu() :
+        allocator_(new CachingAllocator()),
+        numa_node_(-1),
+        workers_(nullptr)
+    {
+
+    }
+
+    Cpu::Cpu(int numa_node, const std::vector<int>& cpus) :
+        allocator_(new CachingAllocator(numa_node)),
+        numa_node_(numa_node),
+        cpus_(cpus),
+        workers_(nullptr)
+    {
+
+    }
+
+    Cpu::~Cpu()
+    {
+        // stop the workers before the allocator they allocate from
+        delete workers_;
+        delete allocator_;
+    }
+
     Status Cpu::status() const
     {
         return Status::kOK;
@@ -11,25 +40,70 @@ namespace graphloom
 
     Status Cpu::malloc(DataType dtype, size_t size, void*& ptr)
     {
-        omp_set_lock(&lock_);
         size_t dsize = DataTypeSize(dtype);
-        ptr = static_cast<void*>(::operator new(size*dsize, std::align_val_t(dsize), std::nothrow));
+        if (size > SIZE_MAX / dsize)
+        {
+            ptr = nullptr;
+            return Status(1, name(), " memory allocation failure, size overflow");
+        }
+
+        // no device lock, the allocator is thread safe
+        ptr = allocator_->Allocate(size*dsize);
         if (ptr == nullptr)
         {
-            omp_unset_lock(&lock_); // to ensure the null check is atomic
             return Status(1, name(), " memory allocation failure");
         }
-        
-        omp_unset_lock(&lock_);
+        RecordAllocation(ptr, size*dsize);
+        return Status::kOK;
+    }
+
+    Status Cpu::free(DataType, void* ptr)
+    {
+        if (ptr == nullptr) return Status::kOK;
+
+        RecordFree(ptr, CachingAllocator::AllocatedBytes(ptr));
+        allocator_->Deallocate(ptr);
         return Status::kOK;
     }
 
-    Status Cpu::free(DataType dtype, void* ptr)
+    Status Cpu::memcpy(void* dest, const void* src, size_t bytes)
     {
+        std::memcpy(dest, src, bytes);
+        return Status::kOK;
+    }
+
+    ThreadPool* Cpu::workers()
+    {
+        if (numa_node_ < 0 || cpus_.empty()) return nullptr;
+
         omp_set_lock(&lock_);
-        ::operator delete(ptr, std::align_val_t(DataTypeSize(dtype)));
+        if (workers_ == nullptr)
+        {
+            workers_ = new ThreadPool(cpus_.size(), ThreadPool::kDefaultSpinIterations, cpus_);
+        }
+        ThreadPool* workers = workers_;
         omp_unset_lock(&lock_);
-        return Status::kOK;
+        return workers;
+    }
+
+    void Cpu::set_alloc_options(const CpuAllocOptions& options)
+    {
+        allocator_->set_options(options);
+    }
+
+    CpuAllocOptions Cpu::alloc_options() const
+    {
+        return allocator_->options();
+    }
+
+    int Cpu::numa_node() const
+    {
+        return numa_node_;
+    }
+
+    const std::vector<int>& Cpu::cpus() const
+    {
+        return cpus_;
     }
 
     CpuFactory::CpuFactory(const std::string& device_type):
@@ -40,7 +114,18 @@ namespace graphloom
 
     Status CpuFactory::DiscoverDevices(std::vector<Device*>& devices_found)
     {
-        devices_found.push_back(new Cpu());
+        // one node needs no placement, memory and threads are local anyway
+        std::vector<NumaNode> nodes = DiscoverNumaNodes();
+        if (nodes.size() < 2)
+        {
+            devices_found.push_back(new Cpu());
+            return Status::kOK;
+        }
+
+        for (const NumaNode& node : nodes)
+        {
+            devices_found.push_back(new Cpu(node.id, node.cpus));
+        }
         return Status::kOK;
     }
 }
\ No newline at end of file
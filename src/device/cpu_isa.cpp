@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <atomic>
+
+#include "graphloom/device/cpu_isa.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GL_CPU_ISA_X86 1
+#endif
+
+namespace graphloom
+{
+    namespace
+    {
+        /**
+         * Probes the CPU. __builtin_cpu_supports also checks 
+         * the OS saves the vector registers.
+         * 
+         * @returns Highest fully supported level
+        */
+        CpuIsa ProbeCpuIsa()
+        {
+#ifdef GL_CPU_ISA_X86
+            __builtin_cpu_init();
+            if (!__builtin_cpu_supports("sse4.2")) return CpuIsa::Generic;
+            if (!__builtin_cpu_supports("avx2") || !__builtin_cpu_supports("fma") ||
+                !__builtin_cpu_supports("f16c"))
+            {
+                return CpuIsa::Sse42;
+            }
+            if (!__builtin_cpu_supports("avx512f") || !__builtin_cpu_supports("avx512bw") ||
+                !__builtin_cpu_supports("avx512dq") || !__builtin_cpu_supports("avx512vl"))
+            {
+                return CpuIsa::Avx2;
+            }
+            if (!__builtin_cpu_supports("avx512vnni")) return CpuIsa::Avx512;
+            if (!__builtin_cpu_supports("avx512bf16")) return CpuIsa::Avx512Vnni;
+            return CpuIsa::Avx512Bf16;
+#else
+            return CpuIsa::Generic;
+#endif
+        }
+
+        std::atomic<int> isa_limit{CpuIsa::Avx512Bf16};
+    }
+
+    CpuIsa HostCpuIsa()
+    {
+        static const CpuIsa host_isa = ProbeCpuIsa();
+        return static_cast<CpuIsa>(std::min<int>(host_isa, isa_limit.load()));
+    }
+
+    bool CpuIsaSupported(CpuIsa isa)
+    {
+        return isa <= HostCpuIsa();
+    }
+
+    void LimitCpuIsa(CpuIsa isa)
+    {
+        isa_limit.store(isa);
+    }
+
+    const char* CpuIsaName(CpuIsa isa)
+    {
+        switch (isa)
+        {
+        case CpuIsa::Generic:       return "Generic";
+        case CpuIsa::Sse42:         return "SSE4.2";
+        case CpuIsa::Avx2:          return "AVX2";
+        case CpuIsa::Avx512:        return "AVX-512";
+        case CpuIsa::Avx512Vnni:    return "AVX-512 VNNI";
+        case CpuIsa::Avx512Bf16:    return "AVX-512 BF16";
+        }
+        return "Unknown";
+    }
+}
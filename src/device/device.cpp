@@ -1,6 +1,8 @@
 #include "graphloom/device/device.h"
 #include "graphloom/op/op.h"
 
+#include "device/memory_profiler.h"
+
 namespace graphloom
 {
 
@@ -18,7 +20,8 @@ namespace graphloom
         return type_;
     }
 
-    Device::Device()
+    Device::Device() :
+        profiler_(new MemoryProfiler())
     {
         omp_init_lock(&lock_);
     }
@@ -26,6 +29,52 @@ namespace graphloom
     Device::~Device()
     {
         omp_destroy_lock(&lock_);
+        delete profiler_;
+    }
+
+    MemoryStats Device::memory_stats() const
+    {
+        return profiler_->stats();
+    }
+
+    std::unordered_map<std::string, MemoryStats> Device::node_memory_stats() const
+    {
+        return profiler_->node_stats();
+    }
+
+    std::vector<AllocationRecord> Device::live_allocations() const
+    {
+        return profiler_->live_allocations();
+    }
+
+    void Device::set_memory_profiling(MemoryProfiling mode)
+    {
+        profiler_->set_mode(mode);
+    }
+
+    MemoryProfiling Device::memory_profiling() const
+    {
+        return profiler_->mode();
+    }
+
+    void Device::ResetPeakMemory()
+    {
+        profiler_->ResetPeak();
+    }
+
+    void Device::RecordAllocation(const void* ptr, size_t bytes)
+    {
+        profiler_->RecordAllocation(ptr, bytes);
+    }
+
+    void Device::RecordFree(const void* ptr, size_t bytes)
+    {
+        profiler_->RecordFree(ptr, bytes);
+    }
+
+    ThreadPool* Device::workers()
+    {
+        return nullptr;
     }
 
     Status Device::Compute(OpKernel* kernel, ComputeContext& context)
@@ -0,0 +1,274 @@
+#include <algorithm>
+
+#include "device/memory_profiler.h"
+
+#if defined(__GLIBC__)
+#include <execinfo.h>
+#include <cstdlib>
+#define GL_HAS_BACKTRACE 1
+#endif
+
+namespace graphloom
+{
+    namespace
+    {
+        thread_local const std::string* current_scope = nullptr;
+
+        // name of allocations made outside of any MemoryScope
+        const std::string kNoScope;
+
+        // frames of a call stack inside the profiler and Device
+        constexpr size_t kProfilerFrames = 2;
+
+        /**
+         * @returns Shard of the calling thread, threads
+         * are spread over the shards in turn
+        */
+        size_t ShardIndex()
+        {
+            static std::atomic<size_t> next_thread(0);
+            thread_local size_t shard = next_thread.fetch_add(1, std::memory_order_relaxed) % MemoryProfiler::kShards;
+            return shard;
+        }
+
+        /**
+         * Adds an allocation to stats
+        */
+        void AddAllocation(MemoryStats& stats, size_t bytes)
+        {
+            stats.live_bytes += bytes;
+            stats.peak_bytes = std::max(stats.peak_bytes, stats.live_bytes);
+            ++stats.num_allocs;
+            ++stats.histogram[MemoryProfiler::HistogramBucket(bytes)];
+        }
+    }
+
+    /**
+     * MemoryScope Impl
+    */
+
+    MemoryScope::MemoryScope(const std::string& node) :
+        previous_(current_scope)
+    {
+        current_scope = &node;
+    }
+
+    MemoryScope::~MemoryScope()
+    {
+        current_scope = previous_;
+    }
+
+    const std::string* MemoryScope::current()
+    {
+        return current_scope;
+    }
+
+    /**
+     * MemoryProfiler Impl
+    */
+
+    MemoryProfiler::MemoryProfiler() :
+        peak_bytes_(0),
+        mode_(MemoryProfiling::Off)
+    {
+        for (Shard& shard : shards_)
+        {
+            shard.live_bytes.store(0, std::memory_order_relaxed);
+            shard.num_allocs.store(0, std::memory_order_relaxed);
+            shard.num_frees.store(0, std::memory_order_relaxed);
+            shard.unchecked_bytes.store(0, std::memory_order_relaxed);
+            for (std::atomic<size_t>& bucket : shard.histogram)
+            {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+        omp_init_lock(&lock_);
+    }
+
+    MemoryProfiler::~MemoryProfiler()
+    {
+        omp_destroy_lock(&lock_);
+    }
+
+    void MemoryProfiler::RecordAllocation(const void* ptr, size_t bytes)
+    {
+        Shard& shard = shards_[ShardIndex()];
+        shard.live_bytes.fetch_add(bytes, std::memory_order_relaxed);
+        shard.num_allocs.fetch_add(1, std::memory_order_relaxed);
+        shard.histogram[HistogramBucket(bytes)].fetch_add(1, std::memory_order_relaxed);
+
+        // summing the shards reads the other threads' lines, 
+        // only done once the shard allocated enough to matter
+        if (shard.unchecked_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes >= kPeakSlack)
+        {
+            shard.unchecked_bytes.store(0, std::memory_order_relaxed);
+            UpdatePeak();
+        }
+
+        MemoryProfiling mode = mode_.load(std::memory_order_relaxed);
+        if (mode == MemoryProfiling::Off) return;
+
+        // the stack is walked outside of the lock
+        Record record;
+        record.bytes = bytes;
+        record.num_frames = 0;
+#ifdef GL_HAS_BACKTRACE
+        if (mode == MemoryProfiling::CallSites)
+        {
+            record.num_frames = static_cast<size_t>(backtrace(record.frames, kMaxFrames));
+        }
+#endif
+
+        const std::string* scope = MemoryScope::current();
+        omp_set_lock(&lock_);
+        record.node = &*nodes_.try_emplace(scope != nullptr ? *scope : kNoScope).first;
+        AddAllocation(record.node->second, bytes);
+        live_[ptr] = record;
+        omp_unset_lock(&lock_);
+    }
+
+    void MemoryProfiler::RecordFree(const void* ptr, size_t bytes)
+    {
+        Shard& shard = shards_[ShardIndex()];
+        shard.live_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+        shard.num_frees.fetch_add(1, std::memory_order_relaxed);
+
+        // allocations made while profiling was off are not recorded
+        if (mode_.load(std::memory_order_relaxed) == MemoryProfiling::Off) return;
+
+        omp_set_lock(&lock_);
+        auto it = live_.find(ptr);
+        if (it != live_.end())
+        {
+            MemoryStats& node = it->second.node->second;
+            node.live_bytes -= it->second.bytes;
+            ++node.num_frees;
+            live_.erase(it);
+        }
+        omp_unset_lock(&lock_);
+    }
+
+    MemoryStats MemoryProfiler::stats() const
+    {
+        MemoryStats result;
+        result.live_bytes = UpdatePeak();
+        result.peak_bytes = peak_bytes_.load(std::memory_order_relaxed);
+        for (const Shard& shard : shards_)
+        {
+            result.num_allocs += shard.num_allocs.load(std::memory_order_relaxed);
+            result.num_frees += shard.num_frees.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < kMemoryHistogramBuckets; ++i)
+            {
+                result.histogram[i] += shard.histogram[i].load(std::memory_order_relaxed);
+            }
+        }
+        return result;
+    }
+
+    std::unordered_map<std::string, MemoryStats> MemoryProfiler::node_stats() const
+    {
+        omp_set_lock(&lock_);
+        std::unordered_map<std::string, MemoryStats> result = nodes_;
+        omp_unset_lock(&lock_);
+        return result;
+    }
+
+    std::vector<AllocationRecord> MemoryProfiler::live_allocations() const
+    {
+        std::vector<AllocationRecord> result;
+        std::vector<std::vector<void*>> frames;
+
+        omp_set_lock(&lock_);
+        result.reserve(live_.size());
+        frames.reserve(live_.size());
+        for (const auto& pair : live_)
+        {
+            AllocationRecord record;
+            record.ptr = pair.first;
+            record.bytes = pair.second.bytes;
+            record.node = pair.second.node->first;
+            result.push_back(std::move(record));
+            frames.emplace_back(pair.second.frames, pair.second.frames + pair.second.num_frames);
+        }
+        omp_unset_lock(&lock_);
+
+#ifdef GL_HAS_BACKTRACE
+        // symbolized outside of the lock
+        for (size_t i = 0; i < result.size(); ++i)
+        {
+            if (frames[i].empty()) continue;
+            char** symbols = backtrace_symbols(frames[i].data(), static_cast<int>(frames[i].size()));
+            if (symbols == nullptr) continue;
+            for (size_t f = kProfilerFrames; f < frames[i].size(); ++f)
+            {
+                result[i].call_site.push_back(symbols[f]);
+            }
+            std::free(symbols);
+        }
+#endif
+
+        std::sort(result.begin(), result.end(), [](const AllocationRecord& a, const AllocationRecord& b) {
+            return a.bytes > b.bytes;
+        });
+        return result;
+    }
+
+    void MemoryProfiler::set_mode(MemoryProfiling mode)
+    {
+        omp_set_lock(&lock_);
+        mode_.store(mode, std::memory_order_relaxed);
+        if (mode == MemoryProfiling::Off)
+        {
+            // the frees of dropped records will not be attributed, 
+            // their bytes stop counting as live for their node now
+            for (const auto& pair : live_)
+            {
+                pair.second.node->second.live_bytes -= pair.second.bytes;
+            }
+            live_.clear();
+        }
+        omp_unset_lock(&lock_);
+    }
+
+    MemoryProfiling MemoryProfiler::mode() const
+    {
+        return mode_.load(std::memory_order_relaxed);
+    }
+
+    void MemoryProfiler::ResetPeak()
+    {
+        peak_bytes_.store(0, std::memory_order_relaxed);
+        UpdatePeak();
+
+        omp_set_lock(&lock_);
+        for (auto& pair : nodes_)
+        {
+            pair.second.peak_bytes = pair.second.live_bytes;
+        }
+        omp_unset_lock(&lock_);
+    }
+
+    size_t MemoryProfiler::UpdatePeak() const
+    {
+        // shards' live bytes wrap, their sum does not
+        size_t live = 0;
+        for (const Shard& shard : shards_)
+        {
+            live += shard.live_bytes.load(std::memory_order_relaxed);
+        }
+
+        size_t peak = peak_bytes_.load(std::memory_order_relaxed);
+        while (live > peak && !peak_bytes_.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        {
+
+        }
+        return live;
+    }
+
+    size_t MemoryProfiler::HistogramBucket(size_t bytes)
+    {
+        size_t bucket = 0;
+        for (size_t v = bytes > 0 ? bytes - 1 : 0; v > 0; v >>= 1) ++bucket;
+        return std::min(bucket, kMemoryHistogramBuckets - 1);
+    }
+}
@@ -0,0 +1,124 @@
+#ifndef GRAPHLOOM_DEVICE_MEMORY_PROFILER_H_
+#define GRAPHLOOM_DEVICE_MEMORY_PROFILER_H_
+
+#include <omp.h>
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "graphloom/device/device.h"
+
+/**
+ * This module defines the MemoryProfiler every Device
+ * keeps. The device totals are always on: each thread
+ * counts into one of a few cache line aligned shards,
+ * summed when read, so allocating threads do not write
+ * a shared line. Once profiling is on, allocations are
+ * also recorded by address under a lock so frees are
+ * attributed to the node that allocated, optionally
+ * with the call stack of the allocation.
+*/
+
+namespace graphloom
+{
+    class MemoryProfiler
+    {
+    public:
+        // Max frames of a recorded call stack
+        static constexpr size_t kMaxFrames = 24;
+
+        // Shards of the device totals
+        static constexpr size_t kShards = 16;
+
+        // Bytes a shard allocates before the peak is refreshed,
+        // the peak may miss up to kShards * kPeakSlack bytes
+        static constexpr size_t kPeakSlack = size_t(64) << 10;
+
+        MemoryProfiler();
+        ~MemoryProfiler();
+
+        MemoryProfiler(const MemoryProfiler&)               = delete;
+        MemoryProfiler& operator=(const MemoryProfiler&)    = delete;
+
+        /**
+         * @param ptr Allocated buffer
+         * @param bytes Number of bytes requested
+        */
+        void RecordAllocation(const void* ptr, size_t bytes);
+
+        /**
+         * @param ptr Freed buffer
+         * @param bytes Number of bytes of its allocation
+        */
+        void RecordFree(const void* ptr, size_t bytes);
+
+        /**
+         * @returns Device totals
+        */
+        MemoryStats stats() const;
+
+        /**
+         * @returns Statistics of each node
+        */
+        std::unordered_map<std::string, MemoryStats> node_stats() const;
+
+        /**
+         * @returns Live allocations recorded, largest first
+        */
+        std::vector<AllocationRecord> live_allocations() const;
+
+        void set_mode(MemoryProfiling mode);
+        MemoryProfiling mode() const;
+
+        // sets every peak to its live bytes
+        void ResetPeak();
+
+        /**
+         * @param bytes Number of bytes of an allocation
+         * @returns Histogram bucket of bytes
+        */
+        static size_t HistogramBucket(size_t bytes);
+
+    private:
+        struct Record
+        {
+            size_t bytes;
+            std::pair<const std::string, MemoryStats>* node; // allocating node and its statistics
+            size_t num_frames;
+            void* frames[kMaxFrames];
+        };
+
+        // device totals counted by some of the threads, live 
+        // bytes wrap when freed by another shard's thread
+        struct alignas(64) Shard
+        {
+            std::atomic<size_t> live_bytes;
+            std::atomic<size_t> num_allocs;
+            std::atomic<size_t> num_frees;
+            std::atomic<size_t> unchecked_bytes; // allocated since the peak was refreshed
+            std::atomic<size_t> histogram[kMemoryHistogramBuckets];
+        };
+
+        /**
+         * Raises the peak to the live bytes of the device
+         * 
+         * @returns Live bytes of the device
+        */
+        size_t UpdatePeak() const;
+
+        Shard shards_[kShards];
+        mutable std::atomic<size_t> peak_bytes_;
+
+        std::atomic<MemoryProfiling> mode_;
+
+        // guards the profiling state below
+        mutable omp_lock_t lock_;
+        std::unordered_map<std::string, MemoryStats> nodes_;
+        std::unordered_map<const void*, Record> live_;
+    };
+}
+
+#endif
@@ -0,0 +1,146 @@
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+
+#include "device/numa.h"
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#define GL_HAS_NUMA 1
+#endif
+
+namespace graphloom
+{
+    namespace
+    {
+#ifdef GL_HAS_NUMA
+        // policy of mbind(2), from <linux/mempolicy.h>
+        constexpr int kMpolPreferred = 1;
+#endif
+
+        // Largest cpu or node id accepted from sysfs
+        constexpr int kMaxId = 1 << 16;
+
+        /**
+         * @param path File to read
+         * @param contents Returned contents
+         * @returns true if the file was read
+        */
+        bool ReadFile(const std::string& path, std::string& contents)
+        {
+            std::ifstream file(path);
+            if (!file) return false;
+            std::stringstream stream;
+            stream << file.rdbuf();
+            contents = stream.str();
+            return true;
+        }
+
+        /**
+         * Parses a decimal id at list[pos], advances pos
+         *
+         * @returns true if an id in [0, kMaxId] was read
+        */
+        bool ParseId(const std::string& list, size_t& pos, int& id)
+        {
+            size_t begin = pos;
+            long value = 0;
+            while (pos < list.size() && list[pos] >= '0' && list[pos] <= '9')
+            {
+                value = value*10 + (list[pos] - '0');
+                if (value > kMaxId) return false;
+                ++pos;
+            }
+            id = static_cast<int>(value);
+            return pos > begin;
+        }
+    }
+
+    const char* const kNumaSysfsRoot = "/sys/devices/system/node";
+
+    bool ParseCpuList(const std::string& list, std::vector<int>& ids)
+    {
+        ids.clear();
+
+        size_t end = list.find_last_not_of(" \n");
+        if (end == std::string::npos) return true;
+
+        std::string trimmed = list.substr(0, end + 1);
+        size_t pos = 0;
+        while (true)
+        {
+            int first, last;
+            if (!ParseId(trimmed, pos, first)) return false;
+            last = first;
+            if (pos < trimmed.size() && trimmed[pos] == '-')
+            {
+                ++pos;
+                if (!ParseId(trimmed, pos, last) || last < first) return false;
+            }
+            if (!ids.empty() && first <= ids.back()) return false;
+            for (int id = first; id <= last; ++id)
+            {
+                ids.push_back(id);
+            }
+
+            if (pos == trimmed.size()) return true;
+            if (trimmed[pos] != ',') return false;
+            ++pos;
+        }
+    }
+
+    std::vector<NumaNode> DiscoverNumaNodes(const std::string& root)
+    {
+        std::vector<NumaNode> nodes;
+
+        std::string contents;
+        std::vector<int> online;
+        if (!ReadFile(root + "/online", contents) || !ParseCpuList(contents, online))
+        {
+            return nodes;
+        }
+
+        for (int id : online)
+        {
+            NumaNode node;
+            node.id = id;
+            if (!ReadFile(root + "/node" + std::to_string(id) + "/cpulist", contents) ||
+                !ParseCpuList(contents, node.cpus))
+            {
+                // an unreadable node makes the whole topology suspect
+                nodes.clear();
+                return nodes;
+            }
+            if (!node.cpus.empty())
+            {
+                nodes.push_back(std::move(node));
+            }
+        }
+        return nodes;
+    }
+
+    void BindToNumaNode(void* ptr, size_t bytes, int node)
+    {
+#ifdef GL_HAS_NUMA
+        constexpr int kMaskBits = 8 * sizeof(unsigned long);
+        if (node < 0 || node >= kMaskBits) return;
+
+        long page = sysconf(_SC_PAGESIZE);
+        if (page <= 0) return;
+
+        // mbind requires page aligned memory, partial pages are left alone
+        uintptr_t begin = reinterpret_cast<uintptr_t>(ptr);
+        uintptr_t first = (begin + page - 1) / page * page;
+        uintptr_t last = (begin + bytes) / page * page;
+        if (last <= first) return;
+
+        unsigned long mask = 1ul << node;
+        syscall(SYS_mbind, first, last - first, kMpolPreferred, &mask, kMaskBits + 1, 0);
+#else
+        (void)ptr;
+        (void)bytes;
+        (void)node;
+#endif
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef GRAPHLOOM_DEVICE_NUMA_H_
+#define GRAPHLOOM_DEVICE_NUMA_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * This module reads the NUMA topology of the host from
+ * sysfs and places memory on a node. Where NUMA is not
+ * supported no node is found and memory is placed by
+ * first touch. Threads are pinned by ThreadPool.
+*/
+
+namespace graphloom
+{
+    // Default sysfs directory of the NUMA nodes
+    extern const char* const kNumaSysfsRoot;
+
+    struct NumaNode
+    {
+        int id;
+        std::vector<int> cpus; // logical cpus of the node, ascending
+    };
+
+    /**
+     * Parses a sysfs cpu or node list, ex. "0-3,8,10-11"
+     *
+     * @param list List to parse, a trailing newline is allowed
+     * @param ids Returned ids, ascending
+     * @returns true if list is well formed
+    */
+    bool ParseCpuList(const std::string& list, std::vector<int>& ids);
+
+    /**
+     * Nodes without cpus (memory only) are skipped.
+     *
+     * @param root sysfs directory of the NUMA nodes
+     * @returns Online nodes with cpus, ascending by id,
+     * empty if the topology cannot be read
+    */
+    std::vector<NumaNode> DiscoverNumaNodes(const std::string& root = kNumaSysfsRoot);
+
+    /**
+     * Prefers node for the pages fully inside [ptr, ptr + bytes)
+     * that are not yet touched. Failure is ignored, the pages
+     * are then placed by first touch.
+     *
+     * @param ptr Start of the memory
+     * @param bytes Number of bytes
+     * @param node NUMA node id, negative to do nothing
+    */
+    void BindToNumaNode(void* ptr, size_t bytes, int node);
+}
+
+#endif
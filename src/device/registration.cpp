@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <sstream>
+
 #include "graphloom/device/registration.h"
 
 namespace graphloom
@@ -48,19 +51,57 @@ namespace graphloom
         return factories_.size();
     }
 
-    std::string DeviceRegistry::GenUniqueName(const std::string& base_name)
+    MemoryStats DeviceRegistry::GetMemoryStats(const std::string& name) const
+    {
+        return GetDevice(name)->memory_stats();
+    }
+
+    void DeviceRegistry::SetMemoryProfiling(MemoryProfiling mode)
+    {
+        for (auto pair : devices_)
+        {
+            pair.second->set_memory_profiling(mode);
+        }
+    }
+
+    std::string DeviceRegistry::GenMemoryReport(size_t max_nodes) const
     {
-        std::string name(base_name);
+        std::vector<std::string> names = GenDeviceList();
+        std::sort(names.begin(), names.end());
 
-        // handle edge case index 0
-        name += ":0";
-        if (!HasDevice(name))
+        std::ostringstream report;
+        for (const std::string& name : names)
         {
-            return name;
+            const Device* device = GetDevice(name);
+            MemoryStats stats = device->memory_stats();
+            report << name << ": live " << stats.live_bytes << " B, peak " << stats.peak_bytes 
+                << " B, " << stats.num_allocs << " allocs, " << stats.num_frees << " frees\n";
+
+            std::vector<std::pair<std::string, MemoryStats>> nodes;
+            for (auto& pair : device->node_memory_stats())
+            {
+                nodes.emplace_back(pair.first, pair.second);
+            }
+            std::sort(nodes.begin(), nodes.end(), [](const auto& a, const auto& b) {
+                return a.second.peak_bytes > b.second.peak_bytes;
+            });
+            if (nodes.size() > max_nodes) nodes.resize(max_nodes);
+
+            for (const auto& node : nodes)
+            {
+                report << "  " << (node.first.empty() ? "<unscoped>" : node.first) 
+                    << ": live " << node.second.live_bytes << " B, peak " << node.second.peak_bytes 
+                    << " B, " << node.second.num_allocs << " allocs\n";
+            }
         }
-        name = base_name;
+        return report.str();
+    }
 
-        for (int i = 0; HasDevice(name); ++i)
+    std::string DeviceRegistry::GenUniqueName(const std::string& base_name)
+    {
+        // devices of a type are numbered in discovery order
+        std::string name;
+        for (int i = 0; name.empty() || HasDevice(name); ++i)
         {
             name = base_name;
             name += ":";
@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <cstdint>
+
+#include "device/scratch_allocator.h"
+
+namespace graphloom
+{
+    namespace
+    {
+        // Smallest block taken from the device
+        constexpr size_t kMinBlockBytes = size_t(1) << 16;
+
+        inline size_t AlignUp(size_t bytes)
+        {
+            return (bytes + ScratchAllocator::kAlignment - 1) /
+                ScratchAllocator::kAlignment * ScratchAllocator::kAlignment;
+        }
+    }
+
+    /**
+     * ScratchAllocator Impl
+    */
+
+    ScratchAllocator::ScratchAllocator(Device* device) :
+        device_(device),
+        offset_(0),
+        used_(0)
+    {
+
+    }
+
+    ScratchAllocator::~ScratchAllocator()
+    {
+        FreeBlocks();
+    }
+
+    void* ScratchAllocator::Allocate(size_t bytes)
+    {
+        if (bytes > SIZE_MAX - kAlignment) return nullptr;
+        bytes = AlignUp(std::max<size_t>(bytes, 1));
+
+        if (blocks_.empty() || blocks_.back().bytes - offset_ < bytes)
+        {
+            if (!Grow(bytes)) return nullptr;
+        }
+
+        void* ptr = static_cast<char*>(blocks_.back().data) + offset_;
+        offset_ += bytes;
+        used_ += bytes;
+        return ptr;
+    }
+
+    void ScratchAllocator::Reset()
+    {
+        // one block that fits the whole peak replaces a chain
+        if (blocks_.size() > 1)
+        {
+            size_t peak = used_;
+            FreeBlocks();
+            Grow(peak);
+        }
+        offset_ = 0;
+        used_ = 0;
+    }
+
+    Device* ScratchAllocator::device() const
+    {
+        return device_;
+    }
+
+    size_t ScratchAllocator::capacity() const
+    {
+        size_t total = 0;
+        for (const Block& block : blocks_)
+        {
+            total += block.bytes;
+        }
+        return total;
+    }
+
+    bool ScratchAllocator::Grow(size_t bytes)
+    {
+        size_t size = std::max(bytes, kMinBlockBytes);
+        if (!blocks_.empty())
+        {
+            size = std::max(size, blocks_.back().bytes * 2);
+        }
+
+        void* data = nullptr;
+        if (!device_->malloc(DataType::Int8, size, data).ok() || data == nullptr)
+        {
+            return false;
+        }
+        blocks_.push_back(Block{data, size});
+        offset_ = 0;
+        return true;
+    }
+
+    void ScratchAllocator::FreeBlocks()
+    {
+        for (const Block& block : blocks_)
+        {
+            device_->free(DataType::Int8, block.data);
+        }
+        blocks_.clear();
+        offset_ = 0;
+    }
+}
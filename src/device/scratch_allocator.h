@@ -0,0 +1,85 @@
+#ifndef GRAPHLOOM_DEVICE_SCRATCH_ALLOCATOR_H_
+#define GRAPHLOOM_DEVICE_SCRATCH_ALLOCATOR_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "graphloom/device/device.h"
+
+/**
+ * This module defines the ScratchAllocator, a bump
+ * allocator for kernel workspaces. Scratch memory lives
+ * until Reset(), which is called after every kernel.
+ * When a kernel needs more than the current block a new
+ * block is chained, and Reset() merges the blocks into
+ * one large enough for the peak. After the first few
+ * runs no kernel's scratch reaches the device allocator.
+*/
+
+namespace graphloom
+{
+    class ScratchAllocator
+    {
+    public:
+        // Alignment of every allocation
+        static constexpr size_t kAlignment = 64;
+
+        /**
+         * @param device Device the scratch memory lives on
+        */
+        explicit ScratchAllocator(Device* device);
+        ~ScratchAllocator();
+
+        ScratchAllocator(const ScratchAllocator&)               = delete;
+        ScratchAllocator& operator=(const ScratchAllocator&)    = delete;
+
+        /**
+         * NOTE: Not thread safe
+         *
+         * @param bytes Number of bytes requested
+         * @returns kAlignment aligned buffer valid until Reset(), nullptr on failure
+        */
+        void* Allocate(size_t bytes);
+
+        /**
+         * Releases every allocation at once
+        */
+        void Reset();
+
+        /**
+         * @returns Device the scratch memory lives on
+        */
+        Device* device() const;
+
+        /**
+         * @returns Total bytes held from the device
+        */
+        size_t capacity() const;
+
+    private:
+        struct Block
+        {
+            void* data;
+            size_t bytes;
+        };
+
+        /**
+         * Chains a new block of at least bytes
+         *
+         * @returns true on success
+        */
+        bool Grow(size_t bytes);
+
+        /**
+         * Returns every block to the device
+        */
+        void FreeBlocks();
+
+        Device* const device_;
+        std::vector<Block> blocks_; // last block is bumped
+        size_t offset_;             // used bytes of the last block
+        size_t used_;               // used bytes since Reset()
+    };
+}
+
+#endif
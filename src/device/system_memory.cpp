@@ -0,0 +1,138 @@
+#include <cstdint>
+#include <new>
+
+#include "device/numa.h"
+#include "device/system_memory.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define GL_HAS_MMAP 1
+#endif
+
+namespace graphloom
+{
+    namespace
+    {
+        /**
+         * @returns Size of a base page
+        */
+        size_t PageSize()
+        {
+#ifdef GL_HAS_MMAP
+            long page = sysconf(_SC_PAGESIZE);
+            if (page > 0) return static_cast<size_t>(page);
+#endif
+            return 4096;
+        }
+
+        /**
+         * Faults in every page of [ptr, ptr + bytes)
+        */
+        void Prefault(void* ptr, size_t bytes)
+        {
+            size_t page = PageSize();
+            volatile char* memory = static_cast<volatile char*>(ptr);
+            for (size_t offset = 0; offset < bytes; offset += page)
+            {
+                memory[offset] = memory[offset];
+            }
+        }
+
+#ifdef GL_HAS_MMAP
+        /**
+         * @param bytes Length to map, a multiple of the page size
+         * @param huge_pages Huge page mode
+         * @param mapped Returned mapping length
+         * @returns Mapping, nullptr on failure
+        */
+        void* Map(size_t bytes, HugePages huge_pages, size_t& mapped)
+        {
+#ifdef MAP_HUGETLB
+            if (huge_pages == HugePages::Explicit)
+            {
+                // reserved huge pages, lengths are whole huge pages
+                mapped = (bytes + kHugePageBytes - 1) / kHugePageBytes * kHugePageBytes;
+                void* ptr = mmap(nullptr, mapped, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+                if (ptr != MAP_FAILED) return ptr;
+            }
+#endif
+            if (huge_pages == HugePages::Off)
+            {
+                mapped = bytes;
+                void* ptr = mmap(nullptr, mapped, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                return ptr == MAP_FAILED ? nullptr : ptr;
+            }
+
+            // transparent huge pages only back huge page aligned
+            // ranges, over map then trim to an aligned range
+            size_t length = bytes + kHugePageBytes;
+            void* raw = mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (raw == MAP_FAILED) return nullptr;
+
+            uintptr_t begin = reinterpret_cast<uintptr_t>(raw);
+            uintptr_t aligned = (begin + kHugePageBytes - 1) / kHugePageBytes * kHugePageBytes;
+            size_t head = aligned - begin;
+            size_t tail = length - head - bytes;
+            if (head > 0) munmap(raw, head);
+            if (tail > 0) munmap(reinterpret_cast<void*>(aligned + bytes), tail);
+
+            mapped = bytes;
+            void* ptr = reinterpret_cast<void*>(aligned);
+#ifdef MADV_HUGEPAGE
+            madvise(ptr, mapped, MADV_HUGEPAGE);
+#endif
+            return ptr;
+        }
+#endif
+    }
+
+    void* SystemAllocate(size_t bytes, size_t alignment, const CpuAllocOptions& options,
+        int numa_node, size_t& mapped)
+    {
+        mapped = 0;
+        bool large = bytes >= options.mapped_threshold;
+
+#ifdef GL_HAS_MMAP
+        if (large)
+        {
+            size_t page = PageSize();
+            size_t length = (bytes + page - 1) / page * page;
+            void* ptr = Map(length, options.huge_pages, mapped);
+            if (ptr != nullptr)
+            {
+                // placement is decided by the first touch below
+                BindToNumaNode(ptr, mapped, numa_node);
+                if (options.prefault || options.lock) Prefault(ptr, mapped);
+
+                // best effort, RLIMIT_MEMLOCK may be too low
+                if (options.lock) mlock(ptr, mapped);
+                return ptr;
+            }
+            mapped = 0;
+        }
+#endif
+
+        void* ptr = ::operator new(bytes, std::align_val_t(alignment), std::nothrow);
+        if (ptr == nullptr) return nullptr;
+        BindToNumaNode(ptr, bytes, numa_node);
+        if (large && (options.prefault || options.lock)) Prefault(ptr, bytes);
+        return ptr;
+    }
+
+    void SystemFree(void* ptr, size_t alignment, size_t mapped)
+    {
+        if (ptr == nullptr) return;
+#ifdef GL_HAS_MMAP
+        if (mapped > 0)
+        {
+            munmap(ptr, mapped);
+            return;
+        }
+#endif
+        ::operator delete(ptr, std::align_val_t(alignment));
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef GRAPHLOOM_DEVICE_SYSTEM_MEMORY_H_
+#define GRAPHLOOM_DEVICE_SYSTEM_MEMORY_H_
+
+#include <cstddef>
+
+#include "graphloom/device/cpu.h"
+
+/**
+ * This module obtains memory from the system for the
+ * CachingAllocator. Small requests go to the aligned
+ * operator new. Requests of at least
+ * CpuAllocOptions::mapped_threshold bytes are mapped
+ * straight from the kernel so they can be backed by huge
+ * pages, faulted in up front and locked in RAM. Where
+ * mapping is unsupported or fails, operator new is used
+ * and the pages are only pre-faulted.
+*/
+
+namespace graphloom
+{
+    // Size of a huge page
+    constexpr size_t kHugePageBytes = size_t(1) << 21;
+
+    /**
+     * @param bytes Number of bytes, at most SIZE_MAX - kHugePageBytes
+     * @param alignment Alignment of the memory, at most the page size
+     * @param options Placement and paging options
+     * @param numa_node Preferred NUMA node, negative if none
+     * @param mapped Returned mapping length, 0 if not mapped
+     * @returns Memory, nullptr on failure
+    */
+    void* SystemAllocate(size_t bytes, size_t alignment, const CpuAllocOptions& options,
+        int numa_node, size_t& mapped);
+
+    /**
+     * @param ptr Memory from SystemAllocate()
+     * @param alignment Alignment it was allocated with
+     * @param mapped Mapping length returned by SystemAllocate()
+    */
+    void SystemFree(void* ptr, size_t alignment, size_t mapped);
+}
+
+#endif
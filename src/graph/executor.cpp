@@ -0,0 +1,474 @@
+#include <algorithm>
+#include <unordered_map>
+
+#include "graph/executor.h"
+
+namespace graphloom
+{
+    Executor::Executor(const Graph& graph, ThreadPool& pool, size_t intra_op_threads) :
+        graph_(graph),
+        flat_(graph.flat_),
+        pools_(1, &pool),
+        node_pools_(graph.nodes_.size(), 0),
+        intra_op_threads_(intra_op_threads),
+        pending_(graph.nodes_.size()),
+        outstanding_(0),
+        failed_(false),
+        status_(Status::kOK)
+    {
+        omp_init_lock(&status_lock_);
+
+        const std::vector<Node*>& nodes = graph.nodes_;
+        const MemoryPlan& plan = graph.memory_plan_;
+
+        // the extra value is the missing input slot, always null
+        values_.resize(flat_.num_values() + 1, nullptr);
+        held_.resize(flat_.num_values());
+        slots_.resize(flat_.num_values());
+        inputs_.resize(flat_.input_slots.size(), nullptr);
+        for (const Node* node : nodes)
+        {
+            ThreadPool* workers = flat_.devices[node->id_]->workers();
+            if (workers != nullptr)
+            {
+                auto it = std::find(pools_.begin(), pools_.end(), workers);
+                node_pools_[node->id_] = static_cast<uint32_t>(it - pools_.begin());
+                if (it == pools_.end()) pools_.push_back(workers);
+            }
+
+            // planned outputs always view the same arena range
+            uint32_t first = flat_.output_offsets[node->id_];
+            for (size_t i = 0; i < node->out_dtypes_.size(); ++i)
+            {
+                void* address = plan.address(node->id_, i);
+                if (address == nullptr) continue;
+                slots_[first + i].reset(new TensorBuffer(node->out_dtypes_[i], 
+                    node->out_shapes_[i], node->device_, address));
+            }
+        }
+
+        // the extra slot serves callers outside the pools
+        size_t num_slots = 0;
+        for (const ThreadPool* worker_pool : pools_)
+        {
+            scratch_offsets_.push_back(num_slots);
+            num_slots += worker_pool->num_threads();
+        }
+        scratch_.resize(num_slots + 1);
+        running_ = std::vector<std::atomic<size_t>>(pools_.size());
+    }
+
+    Executor::~Executor()
+    {
+        omp_destroy_lock(&status_lock_);
+    }
+
+    Status Executor::Run(const std::vector<std::pair<NodeDef*, TensorBuffer*>>& feeds,
+        const std::vector<NodeDef*>& targets,
+        std::vector<TensorBuffer>& outputs)
+    {
+        size_t num_nodes = flat_.num_nodes();
+
+        needed_.assign(num_nodes, 0);
+        fed_.assign(num_nodes, 0);
+        below_feed_.assign(num_nodes, 0);
+        targets_.assign(num_nodes, 0);
+        std::fill(values_.begin(), values_.end(), nullptr);
+
+        // fed tensors replace the node's computation
+        packed_feeds_.clear();
+        packed_feeds_.reserve(feeds.size());
+        for (const std::pair<NodeDef*, TensorBuffer*>& feed : feeds)
+        {
+            const Node* node = FindNode(feed.first);
+            if (node == nullptr || feed.second == nullptr)
+            {
+                return Status(1, "Invalid feed, node is not in the graph or tensor is null");
+            }
+            if (node->out_dtypes_.size() != 1)
+            {
+                return Status(2, "Cannot feed node \"", node->name_,
+                    "\", only nodes with exactly 1 output can be fed");
+            }
+            if (node->out_dtypes_[0] != feed.second->dtype())
+            {
+                return Status(3, "Cannot feed node \"", node->name_, "\", mismatched DataType");
+            }
+
+            // the outputs below a static shape are sized for it
+            const LayoutArray& shape = feed.second->shape();
+            const LayoutArray& expected = node->out_shapes_[0];
+            if (node->static_shapes_[0] && (shape.rank() != expected.rank() ||
+                !std::equal(shape.begin(), shape.end(), expected.begin())))
+            {
+                return Status(5, "Cannot feed node \"", node->name_, "\", mismatched shape");
+            }
+            uint32_t slot = flat_.output_offsets[node->id_];
+            fed_[node->id_] = 1;
+            values_[slot] = feed.second;
+
+            // kernels index their inputs as flat arrays
+            if (!feed.second->IsContiguous())
+            {
+                packed_feeds_.push_back(feed.second->Contiguous());
+                values_[slot] = &packed_feeds_.back();
+            }
+        }
+
+        // only compute what the targets depend on
+        std::vector<uint32_t> stack;
+        for (const NodeDef* target : targets)
+        {
+            const Node* node = FindNode(target);
+            if (node == nullptr)
+            {
+                return Status(4, "Invalid target, node is not in the graph");
+            }
+            stack.push_back(node->id_);
+            targets_[node->id_] = 1;
+        }
+        while (!stack.empty())
+        {
+            uint32_t id = stack.back();
+            stack.pop_back();
+            if (needed_[id]) continue;
+            needed_[id] = 1;
+            if (fed_[id]) continue;
+
+            for (uint32_t i = flat_.input_offsets[id]; i < flat_.input_offsets[id + 1]; ++i)
+            {
+                if (!needed_[flat_.input_nodes[i]]) stack.push_back(flat_.input_nodes[i]);
+            }
+        }
+
+        // arena ranges are only reused once the nodes reading 
+        // them are done, which a node below a feed may start 
+        // before. Its outputs are allocated instead.
+        for (uint32_t id = 0; id < num_nodes; ++id)
+        {
+            if (fed_[id] && needed_[id]) stack.push_back(id);
+        }
+        while (!stack.empty())
+        {
+            uint32_t id = stack.back();
+            stack.pop_back();
+            for (uint32_t i = flat_.consumer_offsets[id]; i < flat_.consumer_offsets[id + 1]; ++i)
+            {
+                uint32_t dest = flat_.consumers[i];
+                if (!needed_[dest] || fed_[dest] || below_feed_[dest]) continue;
+                below_feed_[dest] = 1;
+                stack.push_back(dest);
+            }
+        }
+
+        std::vector<uint32_t> ready;
+        for (uint32_t id = 0; id < num_nodes; ++id)
+        {
+            if (!needed_[id]) continue;
+
+            int pending = fed_[id] ? 0 : flat_.pending[id];
+            pending_[id].store(pending, std::memory_order_relaxed);
+            if (pending == 0) ready.push_back(id);
+        }
+
+        failed_.store(false);
+        status_ = Status::kOK;
+
+        for (uint32_t id : ready)
+        {
+            Dispatch(id);
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(done_mutex_);
+            done_.wait(lock, [this]() { return outstanding_.load() == 0; });
+        }
+
+        if (failed_.load())
+        {
+            ReleaseOutputs();
+            return status_;
+        }
+
+        // hand over the targets' outputs. Tensors owned by the run
+        // (unplanned outputs, held copies of arena outputs) are moved, 
+        // owned ones it keeps (feeds, repeated targets) share their 
+        // storage copy on write and borrowed feeds are copied.
+        size_t num_outputs = 0;
+        for (const NodeDef* target : targets)
+        {
+            num_outputs += FindNode(target)->out_dtypes_.size();
+        }
+        outputs.clear();
+        outputs.reserve(num_outputs);
+
+        std::unordered_map<const TensorBuffer*, size_t> moved;
+        for (const NodeDef* target : targets)
+        {
+            const Node* node = FindNode(target);
+            uint32_t first = flat_.output_offsets[node->id_];
+            for (size_t i = 0; i < node->out_dtypes_.size(); ++i)
+            {
+                TensorBuffer* value = values_[first + i];
+                TensorBuffer* slot = slots_[first + i].get();
+                if (held_[first + i].data() != nullptr)
+                {
+                    value = slot = &held_[first + i];
+                }
+
+                auto it = moved.find(value);
+                if (it == moved.end() && value == slot && slot->owns_data())
+                {
+                    moved[value] = outputs.size();
+                    outputs.push_back(std::move(*slot));
+                    continue;
+                }
+
+                const TensorBuffer& src = it == moved.end() ? *value : outputs[it->second];
+                if (src.owns_data())
+                {
+                    outputs.push_back(src);
+                    continue;
+                }
+
+                outputs.emplace_back();
+                Status status = CopyOut(src, outputs.back());
+                if (!status.ok())
+                {
+                    ReleaseOutputs();
+                    return status;
+                }
+            }
+        }
+
+        ReleaseOutputs();
+        return Status::kOK;
+    }
+
+    void Executor::ReleaseOutputs()
+    {
+        for (std::unique_ptr<TensorBuffer>& slot : slots_)
+        {
+            if (slot == nullptr || !slot->owns_data()) continue;
+            TensorBuffer released(std::move(*slot));
+        }
+        for (TensorBuffer& held : held_)
+        {
+            if (held.data() == nullptr) continue;
+            TensorBuffer released(std::move(held));
+        }
+    }
+
+    Status Executor::CopyOut(const TensorBuffer& src, TensorBuffer& dst)
+    {
+        dst = TensorBuffer(src.dtype(), src.shape(), src.device());
+        dst.quant_ = src.quant_;
+        return src.device()->memcpy(dst.data(), src.data(), src.bytes());
+    }
+
+    const Node* Executor::FindNode(const NodeDef* node_def) const
+    {
+        if (node_def == nullptr) return nullptr;
+
+        int id = node_def->id();
+        if (id < 0 || static_cast<size_t>(id) >= graph_.nodes_.size()) return nullptr;
+
+        if (flat_.names[id] != node_def->name()) return nullptr;
+        return graph_.nodes_[id];
+    }
+
+    void Executor::Dispatch(uint32_t id)
+    {
+        outstanding_.fetch_add(1);
+        pools_[node_pools_[id]]->Schedule([this, id]() {
+            Process(id);
+
+            // notified under the lock, Run() cannot return
+            // and destroy the condition before this is done
+            if (outstanding_.fetch_sub(1) == 1)
+            {
+                std::lock_guard<std::mutex> lock(done_mutex_);
+                done_.notify_all();
+            }
+        });
+    }
+
+    void Executor::Process(uint32_t id)
+    {
+        constexpr uint32_t kNone = UINT32_MAX;
+        while (id != kNone)
+        {
+            if (failed_.load(std::memory_order_relaxed)) return;
+
+            if (!fed_[id])
+            {
+                Status status = Compute(id);
+                if (!status.ok())
+                {
+                    Fail(status);
+                    return;
+                }
+            }
+
+            // keep one ready consumer of this pool on this thread,
+            // dispatch the rest
+            uint32_t next = kNone;
+            uint32_t pool = node_pools_[id];
+            for (uint32_t i = flat_.consumer_offsets[id]; i < flat_.consumer_offsets[id + 1]; ++i)
+            {
+                uint32_t dest = flat_.consumers[i];
+                if (!needed_[dest]) continue;
+                if (pending_[dest].fetch_sub(1, std::memory_order_acq_rel) != 1) continue;
+
+                if (next == kNone && node_pools_[dest] == pool)
+                {
+                    next = dest;
+                }
+                else
+                {
+                    Dispatch(dest);
+                }
+            }
+            id = next;
+        }
+    }
+
+    Status Executor::Compute(uint32_t id)
+    {
+        const std::string& name = flat_.names[id];
+
+        // outputs and scratch memory count towards the node
+        MemoryScope memory_scope(name);
+        try
+        {
+            uint32_t first_input = flat_.input_offsets[id];
+            size_t num_inputs = flat_.input_offsets[id + 1] - first_input;
+            uint32_t first_output = flat_.output_offsets[id];
+            size_t num_outputs = flat_.output_offsets[id + 1] - first_output;
+
+            TensorBuffer** inputs = inputs_.data() + first_input;
+            for (size_t i = 0; i < num_inputs; ++i)
+            {
+                inputs[i] = values_[flat_.input_slots[first_input + i]];
+            }
+
+            // unplanned outputs are allocated from the device
+            ComputeContext shape_context(inputs, num_inputs, nullptr, 0);
+            for (size_t i = 0; i < num_outputs; ++i)
+            {
+                std::unique_ptr<TensorBuffer>& slot = slots_[first_output + i];
+                bool planned = slot != nullptr && !slot->owns_data() && slot->data() != nullptr;
+                if (!planned || below_feed_[id])
+                {
+                    const Node* node = graph_.nodes_[id];
+                    LayoutArray shape;
+                    if (node->static_shapes_[i])
+                    {
+                        shape = node->out_shapes_[i];
+                    }
+                    else
+                    {
+                        Status status = node->op_->out_shape_fns_[i](shape_context, shape);
+                        if (!status.ok()) return status;
+                    }
+
+                    TensorBuffer output(node->out_dtypes_[i], shape, flat_.devices[id]);
+                    if (planned)
+                    {
+                        // the slot keeps its arena range for later runs
+                        held_[first_output + i] = std::move(output);
+                        values_[first_output + i] = &held_[first_output + i];
+                        continue;
+                    }
+                    if (slot == nullptr)
+                    {
+                        slot.reset(new TensorBuffer(std::move(output)));
+                    }
+                    else
+                    {
+                        *slot = std::move(output);
+                    }
+                }
+                values_[first_output + i] = slot.get();
+            }
+
+            // concurrent nodes share the pool's threads
+            size_t pool_index = node_pools_[id];
+            ThreadPool* pool = pools_[pool_index];
+            std::atomic<size_t>& running_nodes = running_[pool_index];
+            size_t running = running_nodes.fetch_add(1) + 1;
+            size_t intra_op_threads = intra_op_threads_ == 0 ? pool->num_threads() : intra_op_threads_;
+            ScratchAllocator& scratch = Scratch(flat_.devices[id], pool_index);
+            ComputeContext context(inputs, num_inputs,
+                values_.data() + first_output, num_outputs);
+            context.pool_ = pool;
+            context.thread_budget_ = std::max<size_t>(1, 
+                std::min(intra_op_threads, pool->num_threads() / running));
+            context.scratch_ = &scratch;
+
+            Status status = Status::kOK;
+            try
+            {
+                status = flat_.kernels[id]->Compute(context);
+            }
+            catch (...)
+            {
+                scratch.Reset();
+                running_nodes.fetch_sub(1);
+                throw;
+            }
+            scratch.Reset();
+            running_nodes.fetch_sub(1);
+
+            if (!status.ok())
+            {
+                return Status(status.code(), "Node \"", name, "\" failed: ", status.msg());
+            }
+
+            // arena outputs are reused once the consumers ran, a
+            // target's are copied out before any consumer is released
+            if (targets_[id])
+            {
+                for (size_t i = 0; i < num_outputs; ++i)
+                {
+                    const TensorBuffer& output = *values_[first_output + i];
+                    if (output.owns_data()) continue;
+
+                    status = CopyOut(output, held_[first_output + i]);
+                    if (!status.ok()) return status;
+                }
+            }
+            return Status::kOK;
+        }
+        catch (const std::exception& e)
+        {
+            return Status(1, "Node \"", name, "\" failed: ", e.what());
+        }
+    }
+
+    ScratchAllocator& Executor::Scratch(Device* device, size_t pool)
+    {
+        int worker = pools_[pool]->CurrentThreadId();
+        size_t index = worker < 0 ? scratch_.size() - 1 : scratch_offsets_[pool] + worker;
+
+        // only this worker touches its allocators
+        std::vector<std::unique_ptr<ScratchAllocator>>& allocators = scratch_[index];
+        for (std::unique_ptr<ScratchAllocator>& allocator : allocators)
+        {
+            if (allocator->device() == device) return *allocator;
+        }
+        allocators.emplace_back(new ScratchAllocator(device));
+        return *allocators.back();
+    }
+
+    void Executor::Fail(const Status& status)
+    {
+        omp_set_lock(&status_lock_);
+        if (!failed_.load())
+        {
+            status_ = status;
+            failed_.store(true);
+        }
+        omp_unset_lock(&status_lock_);
+    }
+}
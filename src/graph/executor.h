@@ -0,0 +1,175 @@
+#ifndef GRAPHLOOM_GRAPH_EXECUTOR_H_
+#define GRAPHLOOM_GRAPH_EXECUTOR_H_
+
+#include <omp.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "graphloom/common/status.h"
+#include "graphloom/graph/graph_def.h"
+#include "graphloom/tensor/tensor.h"
+
+#include "common/thread_pool.h"
+#include "device/scratch_allocator.h"
+#include "graph/graph.h"
+
+/**
+ * This module defines the Executor which runs a Graph.
+ * Every node keeps an atomic count of its pending inputs,
+ * a node is dispatched to the ThreadPool as soon as its 
+ * count reaches zero so independent branches compute 
+ * concurrently. The pool's threads are split between the 
+ * nodes computing at the same time, each kernel gets its 
+ * share as the thread budget of its parallel_for. Nodes
+ * placed on a device with its own workers (ex. pinned to
+ * a NUMA node) run on those instead of the session pool.
+ *
+ * Output tensors of arena planned nodes, the input pointer
+ * arrays and the scratch allocators are built once and
+ * reused by every run, so computing a node does not touch
+ * the heap unless its output is not planned. A feed cuts
+ * the dependencies the arena plan relies on, the nodes 
+ * below it allocate their outputs instead. Dispatch
+ * walks the graph's FlatGraph by node id, the Node objects
+ * are only read once per run to resolve the feeds and 
+ * targets, and to allocate unplanned outputs.
+*/
+
+namespace graphloom
+{
+    class Executor
+    {
+    public:
+        /**
+         * @param graph Graph to execute. Must outlive the executor
+         * @param pool Pool that runs the nodes of devices without
+         * workers. Must outlive the executor
+         * @param intra_op_threads Max thread budget of a kernel, 0 for the pool size
+        */
+        Executor(const Graph& graph, ThreadPool& pool, size_t intra_op_threads);
+        ~Executor();
+
+        Executor(const Executor&)               = delete;
+        Executor& operator=(const Executor&)    = delete;
+
+        /**
+         * Computes the target nodes. Only the nodes the targets
+         * depend on are computed.
+         *
+         * NOTE: Not thread safe, runs must be serialized
+         *
+         * @param feeds Tensors that replace output 0 of nodes
+         * @param targets Nodes whose outputs are returned
+         * @param outputs Returned outputs of every target, in order
+         * @returns Run status
+        */
+        Status Run(const std::vector<std::pair<NodeDef*, TensorBuffer*>>& feeds,
+            const std::vector<NodeDef*>& targets,
+            std::vector<TensorBuffer>& outputs);
+
+    private:
+        /**
+         * @param node_def Node of the GraphDef the graph was built from
+         * @returns Matching node of the graph, nullptr if none
+        */
+        const Node* FindNode(const NodeDef* node_def) const;
+
+        /**
+         * Queues Process(id) on the pool of its device
+         *
+         * @param id Id of a node whose inputs are all computed
+        */
+        void Dispatch(uint32_t id);
+
+        /**
+         * Computes the node then dispatches its ready consumers.
+         * One ready consumer of the same pool continues on
+         * this thread.
+         *
+         * @param id Id of a node whose inputs are all computed
+        */
+        void Process(uint32_t id);
+
+        /**
+         * Allocates the node's outputs and runs its kernel
+         *
+         * @param id Id of the node to compute
+         * @returns Compute status
+        */
+        Status Compute(uint32_t id);
+
+        /**
+         * Frees the device memory of unplanned outputs 
+         * and held target outputs left from the run
+        */
+        void ReleaseOutputs();
+
+        /**
+         * Copies src into new device memory
+         *
+         * @param src Tensor to copy
+         * @param dst Returned copy
+         * @returns Copy status
+        */
+        static Status CopyOut(const TensorBuffer& src, TensorBuffer& dst);
+
+        /**
+         * @param device Device of the node computed on this thread
+         * @param pool Index of the pool computing the node
+         * @returns Scratch allocator of the calling worker for device
+        */
+        ScratchAllocator& Scratch(Device* device, size_t pool);
+
+        /**
+         * Records the first failure of the run
+         *
+         * @param status Failure status
+        */
+        void Fail(const Status& status);
+
+        const Graph& graph_;
+        const FlatGraph& flat_;
+        std::vector<ThreadPool*> pools_;    // session pool, then device workers
+        std::vector<uint32_t> node_pools_;  // pool of each node, indexed by node id
+        const size_t intra_op_threads_;     // 0 for the size of the node's pool
+
+        // per run state, indexed by node id
+        std::vector<std::atomic<int>> pending_;  // number of inputs not yet computed
+        std::vector<char> needed_;               // node is required by a target
+        std::vector<char> fed_;                  // node's output is fed
+        std::vector<char> below_feed_;           // node depends on a fed node
+        std::vector<char> targets_;              // node's outputs are returned
+
+        // per run state, indexed by value slot
+        std::vector<TensorBuffer*> values_;      // output tensors, slots or feeds
+        std::vector<TensorBuffer> packed_feeds_; // contiguous copies of strided feeds
+        std::vector<TensorBuffer> held_;         // copies of arena planned target outputs, 
+                                                 // outputs of planned nodes below a feed
+
+        // persistent state, indexed by value slot
+        std::vector<std::unique_ptr<TensorBuffer>> slots_; // output tensors
+
+        // input pointers of all nodes, laid out as FlatGraph::input_slots
+        std::vector<TensorBuffer*> inputs_;
+
+        // scratch allocators of each worker, one per device
+        std::vector<std::vector<std::unique_ptr<ScratchAllocator>>> scratch_;
+        std::vector<size_t> scratch_offsets_; // first slot of each pool's workers
+
+        std::vector<std::atomic<size_t>> running_; // nodes computing on each pool
+        std::atomic<size_t> outstanding_;  // dispatched tasks not yet finished
+        std::mutex done_mutex_;
+        std::condition_variable done_;
+
+        std::atomic<bool> failed_;
+        Status status_;
+        omp_lock_t status_lock_;
+    };
+}
+
+#endif
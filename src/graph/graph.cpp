@@ -2,6 +2,34 @@
 
 namespace graphloom
 {
+    /**
+     * FlatGraph Impl
+    */
+    size_t FlatGraph::num_nodes() const
+    {
+        return kernels.size();
+    }
+
+    size_t FlatGraph::num_values() const
+    {
+        return output_offsets.empty() ? 0 : output_offsets.back();
+    }
+
+    void FlatGraph::Clear()
+    {
+        kernels.clear();
+        devices.clear();
+        pending.clear();
+        names.clear();
+        input_offsets.clear();
+        input_slots.clear();
+        input_nodes.clear();
+        output_offsets.clear();
+        consumer_offsets.clear();
+        consumers.clear();
+    }
+
+
     /**
      * Graph Impl
     */
@@ -17,7 +45,8 @@ namespace graphloom
 
         nodes_.clear();
         edges_.clear();
-        attributes_.clear();
+        memory_plan_.Clear();
+        flat_.Clear();
     }
 
     Graph::~Graph()
@@ -31,7 +60,8 @@ namespace graphloom
         {
             nodes_ = std::move(other.nodes_);
             edges_ = std::move(other.edges_);
-            attributes_ = std::move(other.attributes_);
+            memory_plan_ = std::move(other.memory_plan_);
+            flat_ = std::move(other.flat_);
         }
     }
 
@@ -39,9 +69,11 @@ namespace graphloom
     {
         if (this != &other)
         {
+            Clear();
             nodes_ = std::move(other.nodes_);
             edges_ = std::move(other.edges_);
-            attributes_ = std::move(other.attributes_);
+            memory_plan_ = std::move(other.memory_plan_);
+            flat_ = std::move(other.flat_);
         }
         return *this;
     }
@@ -53,34 +85,14 @@ namespace graphloom
         return node == nodes_[node->id()];
     }
     
-    bool Graph::HasAttr(const std::string& path) const
-    {
-        return attributes_.find(path) != attributes_.end();
-    }
-
-    int32_t Graph::GetInt32Attr(const std::string& path) const
-    {
-        return std::any_cast<int32_t>(attributes_.at(path));
-    }
-
-    int64_t Graph::GetInt64Attr(const std::string& path) const
-    {
-        return std::any_cast<int64_t>(attributes_.at(path));
-    }
-
-    float Graph::GetFloatAttr(const std::string& path) const
+    const MemoryPlan& Graph::memory_plan() const
     {
-        return std::any_cast<float>(attributes_.at(path));
+        return memory_plan_;
     }
 
-    double Graph::GetDoubleAttr(const std::string& path) const
+    const FlatGraph& Graph::flat() const
     {
-        return std::any_cast<double>(attributes_.at(path));
-    }
-
-    bool Graph::GetBoolAttr(const std::string& path) const
-    {
-        return std::any_cast<bool>(attributes_.at(path));
+        return flat_;
     }
 
 
@@ -108,8 +120,28 @@ namespace graphloom
         return id_;
     }
 
+    Device* Node::device() const
+    {
+        return device_;
+    }
+
+    const std::vector<Edge*>& Node::in_edges() const
+    {
+        return in_edges_;
+    }
+
+    const std::vector<Edge*>& Node::out_edges() const
+    {
+        return out_edges_;
+    }
+
+    bool Node::has_static_shape(size_t index) const
+    {
+        return static_shapes_[index];
+    }
+
     Node::Node(const std::string& name, int id) : 
-        name_(name), id_(id)
+        id_(id), op_(nullptr), kernel_(nullptr), device_(nullptr), name_(name)
     {
 
     }
@@ -139,4 +171,10 @@ namespace graphloom
         return dest_id_;
     }
 
+    Edge::Edge(Node* src, size_t src_id, Node* dest, size_t dest_id) :
+        src_(src), dest_(dest), src_id_(src_id), dest_id_(dest_id)
+    {
+
+    }
+
 }
\ No newline at end of file
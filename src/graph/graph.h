@@ -5,16 +5,55 @@
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
-#include <any>
 
 #include "graphloom/op/op.h"
 #include "graphloom/common/status.h"
 #include "graphloom/graph/graph_context.h"
+#include "graphloom/tensor/tensor.h"
+
+#include "graph/memory_planner.h"
 
 namespace graphloom
 {
     class Edge;
 
+    /**
+     * Struct of arrays form of a Graph, built by GraphFactory
+     * once the graph is complete. It holds only what the 
+     * executor touches to dispatch a node, indexed by node 
+     * id. Outputs are referred to by value slot, a flat index 
+     * over the outputs of every node in id order, slot
+     * num_values is never filled and stands for a missing input.
+    */
+    struct FlatGraph
+    {
+        std::vector<OpKernel*> kernels;
+        std::vector<Device*> devices;
+        std::vector<int> pending;               // initial pending count, number of inputs
+        std::vector<std::string> names;         // memory scope of each node, see MemoryScope
+
+        std::vector<uint32_t> input_offsets;    // num_nodes + 1 offsets into input_slots
+        std::vector<uint32_t> input_slots;      // value slot read by each input
+        std::vector<uint32_t> input_nodes;      // node producing each input
+
+        std::vector<uint32_t> output_offsets;   // num_nodes + 1, first value slot of each node
+
+        std::vector<uint32_t> consumer_offsets; // num_nodes + 1 offsets into consumers
+        std::vector<uint32_t> consumers;        // destination of every out edge
+
+        /**
+         * @returns Number of nodes
+        */
+        size_t num_nodes() const;
+
+        /**
+         * @returns Number of value slots, excluding the missing input slot
+        */
+        size_t num_values() const;
+
+        void Clear();
+    };
+
     class Node
     {
     public:
@@ -23,17 +62,33 @@ namespace graphloom
         std::string name() const;
         Status Compute(ComputeContext& context);
         int id() const;
+        Device* device() const;
+        const std::vector<Edge*>& in_edges() const;
+        const std::vector<Edge*>& out_edges() const;
+
+        /**
+         * @param index Output index
+         * @returns True if the output's shape is known before execution
+        */
+        bool has_static_shape(size_t index) const;
 
     private:
         friend class GraphFactory;
+        friend class MemoryPlanner;
+        friend class Executor;
         
         explicit Node(const std::string& name, int id);
         
         int id_;
+        const Op* op_;
         OpKernel* kernel_;
+        Device* device_;
         std::string name_;
-        std::vector<Edge*> in_edges_;
+        std::vector<Edge*> in_edges_; // indexed by input id
         std::vector<Edge*> out_edges_;
+        std::vector<DataType> out_dtypes_;
+        std::vector<LayoutArray> out_shapes_; // valid where static_shapes_ is set
+        std::vector<bool> static_shapes_;
     };
 
     class Edge
@@ -46,6 +101,7 @@ namespace graphloom
 
     private:
         friend class GraphFactory;
+        friend class Executor;
 
         Edge(Node* src, size_t src_id, Node* dest, size_t dest_id);
 
@@ -69,21 +125,26 @@ namespace graphloom
         Graph& operator=(Graph&& other);
         
         bool IsValidNode(const Node* node) const;
-        
-        bool HasAttr(const std::string& path) const;
 
-        int32_t GetInt32Attr(const std::string& path) const;
-        int64_t GetInt64Attr(const std::string& path) const;
-        float GetFloatAttr(const std::string& path) const;
-        double GetDoubleAttr(const std::string& path) const;
-        bool GetBoolAttr(const std::string& path) const;
+        /**
+         * @returns Arena assignment of the intermediate tensors
+        */
+        const MemoryPlan& memory_plan() const;
+
+        /**
+         * @returns Struct of arrays form of the graph
+        */
+        const FlatGraph& flat() const;
 
     private:
         friend class GraphFactory;
+        friend class MemoryPlanner;
+        friend class Executor;
 
         std::vector<Node*> nodes_;
         std::unordered_set<Edge*> edges_;
-        std::unordered_map<std::string, std::any> attributes_;
+        MemoryPlan memory_plan_;
+        FlatGraph flat_;
     };
 }
 
@@ -0,0 +1,210 @@
+#include "graphloom/graph/graph_context.h"
+#include "graphloom/graph/graph_def.h"
+#include "graphloom/common/status.h"
+
+#include "graphloom/tensor/tensor.h"
+
+#include "common/thread_pool.h"
+#include "device/scratch_allocator.h"
+
+namespace graphloom
+{
+    /**
+     * OpKernelContext Impl
+    */
+
+    int32_t OpKernelContext::GetInt32Attr(const std::string& name) const
+    {
+        return GetInt32Attr(AttrIndex(name));
+    }
+
+    int32_t OpKernelContext::GetInt32Attr(size_t index) const
+    {
+        return graph_def_->Attr(node_def_, index, AttrType::Int32).i32;
+    }
+
+    int64_t OpKernelContext::GetInt64Attr(const std::string& name) const
+    {
+        return GetInt64Attr(AttrIndex(name));
+    }
+
+    int64_t OpKernelContext::GetInt64Attr(size_t index) const
+    {
+        return graph_def_->Attr(node_def_, index, AttrType::Int64).i64;
+    }
+
+    float OpKernelContext::GetFloatAttr(const std::string& name) const
+    {
+        return GetFloatAttr(AttrIndex(name));
+    }
+
+    float OpKernelContext::GetFloatAttr(size_t index) const
+    {
+        return graph_def_->Attr(node_def_, index, AttrType::Float).f32;
+    }
+
+    double OpKernelContext::GetDoubleAttr(const std::string& name) const
+    {
+        return GetDoubleAttr(AttrIndex(name));
+    }
+
+    double OpKernelContext::GetDoubleAttr(size_t index) const
+    {
+        return graph_def_->Attr(node_def_, index, AttrType::Double).f64;
+    }
+
+    bool OpKernelContext::GetBoolAttr(const std::string& name) const
+    {
+        return GetBoolAttr(AttrIndex(name));
+    }
+
+    bool OpKernelContext::GetBoolAttr(size_t index) const
+    {
+        return graph_def_->Attr(node_def_, index, AttrType::Bool).b;
+    }
+
+    const TensorBuffer& OpKernelContext::GetTensorAttr(const std::string& name) const
+    {
+        return GetTensorAttr(AttrIndex(name));
+    }
+
+    const TensorBuffer& OpKernelContext::GetTensorAttr(size_t index) const
+    {
+        return graph_def_->attr_tensors_[graph_def_->Attr(node_def_, index, AttrType::Tensor).index];
+    }
+
+    const std::vector<int64_t>& OpKernelContext::GetInt64ListAttr(const std::string& name) const
+    {
+        return GetInt64ListAttr(AttrIndex(name));
+    }
+
+    const std::vector<int64_t>& OpKernelContext::GetInt64ListAttr(size_t index) const
+    {
+        return graph_def_->attr_int64_lists_[graph_def_->Attr(node_def_, index, AttrType::Int64List).index];
+    }
+
+    const std::vector<float>& OpKernelContext::GetFloatListAttr(const std::string& name) const
+    {
+        return GetFloatListAttr(AttrIndex(name));
+    }
+
+    const std::vector<float>& OpKernelContext::GetFloatListAttr(size_t index) const
+    {
+        return graph_def_->attr_float_lists_[graph_def_->Attr(node_def_, index, AttrType::FloatList).index];
+    }
+
+    OpKernelContext::OpKernelContext(const GraphDef* graph_def, const NodeDef* node_def) :
+        graph_def_(graph_def),
+        node_def_(node_def)
+    {
+
+    }
+
+    size_t OpKernelContext::AttrIndex(const std::string& name) const
+    {
+        int index = node_def_->op().AttrIndex(name);
+        if (index < 0)
+        {
+            throw GlException("Op \"", node_def_->op().name(), "\" has no attribute \"", name, "\"");
+        }
+        return index;
+    }
+
+
+    /**
+     * ComputeContext Impl
+    */
+
+    size_t ComputeContext::num_inputs() const
+    {
+        return num_inputs_;
+    }
+
+    size_t ComputeContext::num_outputs() const
+    {
+        return num_outputs_;
+    }
+
+    const TensorBuffer& ComputeContext::input(size_t index) const
+    {
+        if (index >= num_inputs_)
+        {
+            throw GlException("Input index ", index, " out of range, context has ", 
+                num_inputs_, " inputs");
+        }
+        if (inputs_ == nullptr)
+        {
+            throw GlException("Input values are not available while shapes are inferred");
+        }
+        return *inputs_[index];
+    }
+
+    const LayoutArray& ComputeContext::input_shape(size_t index) const
+    {
+        if (index >= num_inputs_)
+        {
+            throw GlException("Input index ", index, " out of range, context has ", 
+                num_inputs_, " inputs");
+        }
+        if (inputs_ != nullptr) return inputs_[index]->shape();
+        return *input_shapes_[index];
+    }
+
+    TensorBuffer& ComputeContext::output(size_t index) const
+    {
+        if (index >= num_outputs_)
+        {
+            throw GlException("Output index ", index, " out of range, context has ", 
+                num_outputs_, " outputs");
+        }
+        return *outputs_[index];
+    }
+
+    size_t ComputeContext::thread_budget() const
+    {
+        return thread_budget_;
+    }
+
+    void ComputeContext::parallel_for(size_t n, size_t grain, 
+        const std::function<void(size_t, size_t)>& fn) const
+    {
+        if (pool_ == nullptr || thread_budget_ <= 1)
+        {
+            if (n > 0) fn(0, n);
+            return;
+        }
+        pool_->ParallelFor(n, thread_budget_, grain, fn);
+    }
+
+    void* ComputeContext::scratch(size_t bytes) const
+    {
+        if (scratch_ == nullptr)
+        {
+            throw GlException("Scratch memory is not available in this context");
+        }
+
+        void* ptr = scratch_->Allocate(bytes);
+        if (ptr == nullptr)
+        {
+            throw GlException("Failed to allocate ", bytes, " bytes of scratch memory");
+        }
+        return ptr;
+    }
+
+    ComputeContext::ComputeContext(const LayoutArray* const* input_shapes, size_t num_inputs) :
+        input_shapes_(input_shapes),
+        num_inputs_(num_inputs)
+    {
+
+    }
+
+    ComputeContext::ComputeContext(TensorBuffer* const* inputs, size_t num_inputs, 
+        TensorBuffer* const* outputs, size_t num_outputs) :
+        inputs_(inputs),
+        outputs_(outputs),
+        num_inputs_(num_inputs),
+        num_outputs_(num_outputs)
+    {
+
+    }
+}
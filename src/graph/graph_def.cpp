@@ -1,6 +1,7 @@
 #include <stdexcept>
 
 #include "graphloom/graph/graph_def.h"
+#include "common/arena.h"
 
 
 namespace graphloom
@@ -9,24 +10,31 @@ namespace graphloom
      * GraphDef impl
     */
 
+    GraphDef::GraphDef() :
+        arena_(new Arena())
+    {
+
+    }
+
     GraphDef::~GraphDef()
     {
-        for (const NodeDef* node : nodes_) {
-            delete node;
-        }
+        // the arena frees the memory, nodes and edges are trivially destructible
+        delete arena_;
 
-        for (const EdgeDef* edge : edges_) {
-            delete edge;
-        }
         nodes_.clear();
         edges_.clear();
-        attributes_.clear();
+        attr_slots_.clear();
+        attr_tensors_.clear();
+        attr_int64_lists_.clear();
+        attr_float_lists_.clear();
         source_nodes_.clear();
+        node_index_.clear();
+        name_suffixes_.clear();
     }
 
     bool GraphDef::HasAttr(const std::string& path) const
     {
-        return attributes_.find(path) != attributes_.end();
+        return FindAttr(path) != nullptr;
     }
 
     size_t GraphDef::num_nodes() const
@@ -34,40 +42,131 @@ namespace graphloom
         return nodes_.size();
     }
 
+    size_t GraphDef::num_edges() const
+    {
+        return edges_.size();
+    }
+
+    GraphDefAdjacency GraphDef::Adjacency() const
+    {
+        GraphDefAdjacency adjacency;
+        adjacency.in_offsets.reserve(nodes_.size() + 1);
+        adjacency.out_offsets.reserve(nodes_.size() + 1);
+        adjacency.in_nodes.reserve(edges_.size());
+        adjacency.in_ports.reserve(edges_.size());
+        adjacency.out_nodes.reserve(edges_.size());
+        adjacency.out_ports.reserve(edges_.size());
+
+        adjacency.in_offsets.push_back(0);
+        adjacency.out_offsets.push_back(0);
+        for (const NodeDef* node : nodes_)
+        {
+            for (size_t i = 0; i < node->op_.num_inputs(); ++i)
+            {
+                const EdgeDef* edge = node->in_edges_[i];
+                adjacency.in_nodes.push_back(edge->src_->id_);
+                adjacency.in_ports.push_back(edge->src_id_);
+            }
+            for (const EdgeDef* edge = node->first_out_; edge != nullptr; edge = edge->next_out_)
+            {
+                adjacency.out_nodes.push_back(edge->dest_->id_);
+                adjacency.out_ports.push_back(edge->dest_id_);
+            }
+            adjacency.in_offsets.push_back(adjacency.in_nodes.size());
+            adjacency.out_offsets.push_back(adjacency.out_nodes.size());
+        }
+        return adjacency;
+    }
+
     int32_t GraphDef::GetInt32Attr(const std::string& path) const
     {
-        return std::any_cast<int32_t>(attributes_.at(path));
+        return Attr(path, AttrType::Int32).i32;
     }
 
     int64_t GraphDef::GetInt64Attr(const std::string& path) const
     {
-        return std::any_cast<int64_t>(attributes_.at(path));
+        return Attr(path, AttrType::Int64).i64;
     }
 
     float GraphDef::GetFloatAttr(const std::string& path) const
     {
-        return std::any_cast<float>(attributes_.at(path));
+        return Attr(path, AttrType::Float).f32;
     }
 
     double GraphDef::GetDoubleAttr(const std::string& path) const
     {
-        return std::any_cast<double>(attributes_.at(path));
+        return Attr(path, AttrType::Double).f64;
     }
 
     bool GraphDef::GetBoolAttr(const std::string& path) const
     {
-        return std::any_cast<bool>(attributes_.at(path));
+        return Attr(path, AttrType::Bool).b;
     }
 
-    NodeDef* GraphDef::FindNode(const std::string& name) const
+    const TensorBuffer& GraphDef::GetTensorAttr(const std::string& path) const
     {
-        for (NodeDef* node : nodes_) {
-            if (node->name() == name)
-            {
-                return node;
-            }
+        return attr_tensors_[Attr(path, AttrType::Tensor).index];
+    }
+
+    const std::vector<int64_t>& GraphDef::GetInt64ListAttr(const std::string& path) const
+    {
+        return attr_int64_lists_[Attr(path, AttrType::Int64List).index];
+    }
+
+    const std::vector<float>& GraphDef::GetFloatListAttr(const std::string& path) const
+    {
+        return attr_float_lists_[Attr(path, AttrType::FloatList).index];
+    }
+
+    const AttrSlot& GraphDef::Attr(const NodeDef* node, size_t index, AttrType type) const
+    {
+        const std::vector<std::string>& names = node->op_.attributes();
+        if (index >= names.size())
+        {
+            throw GlException("Op \"", node->op_.name(), "\" only has ", 
+                names.size(), " attributes, index=", index);
+        }
+
+        const AttrSlot& slot = attr_slots_[node->attr_offset_ + index];
+        if (slot.type != type)
+        {
+            throw GlException("Attribute \"", names[index], "\" of node \"", 
+                node->name_, "\" is not of the requested type");
+        }
+        return slot;
+    }
+
+    const AttrSlot& GraphDef::Attr(const std::string& path, AttrType type) const
+    {
+        const AttrSlot* slot = FindAttr(path);
+        if (slot == nullptr)
+        {
+            throw GlException("Attribute \"", path, "\" does not exist");
+        }
+        if (slot->type != type)
+        {
+            throw GlException("Attribute \"", path, "\" is not of the requested type");
         }
-        return nullptr;
+        return *slot;
+    }
+
+    const AttrSlot* GraphDef::FindAttr(const std::string& path) const
+    {
+        size_t split = path.rfind('/');
+        if (split == std::string::npos) return nullptr;
+
+        NodeDef* node = FindNode(path.substr(0, split));
+        if (node == nullptr) return nullptr;
+
+        int index = node->op_.AttrIndex(path.substr(split + 1));
+        if (index < 0) return nullptr;
+        return &attr_slots_[node->attr_offset_ + index];
+    }
+
+    NodeDef* GraphDef::FindNode(const std::string& name) const
+    {
+        auto it = node_index_.find(name);
+        return it == node_index_.end() ? nullptr : it->second;
     }
 
     bool GraphDef::IsValidNode(const NodeDef* node) const
@@ -84,7 +183,7 @@ namespace graphloom
    
     std::string NodeDef::name() const
     {
-        return name_;
+        return std::string(name_);
     }
 
     const Op& NodeDef::op() const
@@ -94,7 +193,7 @@ namespace graphloom
 
     const std::string& NodeDef::device() const
     {
-        return device_;
+        return *device_;
     }
 
     int NodeDef::id() const
@@ -102,16 +201,33 @@ namespace graphloom
         return id_;
     }
 
-    const std::vector<DataType>& NodeDef::out_dtypes() const
+    std::vector<DataType> NodeDef::out_dtypes() const
     {
-        return out_dtypes_;
+        return std::vector<DataType>(out_dtypes_, out_dtypes_ + num_outputs());
     }
 
-    NodeDef::NodeDef(const Op& op, const std::string& name, 
-        const std::string& device) :
+    DataType NodeDef::output_dtype(size_t id) const
+    {
+        if (id >= num_outputs())
+        {
+            throw GlException("Node \"", name_, "\" only has ", 
+                num_outputs(), " outputs, id=", id);
+        }
+        return out_dtypes_[id];
+    }
+
+    size_t NodeDef::num_outputs() const
+    {
+        return op_.num_outputs();
+    }
+
+    NodeDef::NodeDef(const Op& op, std::string_view name, const std::string* device, 
+        EdgeDef** in_edges, const DataType* out_dtypes) :
         op_(op),
         name_(name),
-        device_(device)
+        device_(device),
+        in_edges_(in_edges),
+        out_dtypes_(out_dtypes)
     {
 
     }
@@ -145,8 +261,8 @@ namespace graphloom
         NodeDef* dest, size_t dest_id) :
 
         src_(src),
-        src_id_(src_id),
         dest_(dest),
+        src_id_(src_id),
         dest_id_(dest_id)
     {
         
@@ -1,18 +1,50 @@
+#include <exception>
+#include <string>
+
 #include "graph/graph_factory.h"
+#include "graphloom/device/registration.h"
+#include "common/thread_pool.h"
 
 namespace graphloom
 {
-    Status GraphFactory::UpdateGraph(const GraphDef& graph_def, Graph& graph)
+    Status GraphFactory::UpdateGraph(const GraphDef& graph_def, Graph& graph, ThreadPool* pool)
     {
         graph.Clear();
 
-        // copy attributes
-        graph.attributes_ = graph_def.attributes_;
+        // Fill nodes, kernels are constructed in parallel and 
+        // each lands in the slot of its node id
+        size_t num_nodes = graph_def.nodes_.size();
+        graph.nodes_.resize(num_nodes, nullptr);
+        std::vector<std::string> errors(num_nodes);
+        auto create = [&](size_t begin, size_t end) {
+            std::vector<DataType> input_dtypes;
+            for (size_t i = begin; i < end; ++i)
+            {
+                try
+                {
+                    graph.nodes_[i] = CreateNode(graph_def, graph_def.nodes_[i], input_dtypes);
+                }
+                catch (const std::exception& e)
+                {
+                    errors[i] = e.what();
+                }
+            }
+        };
+        if (pool != nullptr)
+        {
+            pool->ParallelFor(num_nodes, pool->num_threads() + 1, 1, create);
+        }
+        else
+        {
+            create(0, num_nodes);
+        }
 
-        // Fill nodes
-        for (NodeDef* node_def : graph_def.nodes_)
+        // errors are reported in node order, however the work was split
+        Status status = CollectErrors(graph_def, errors);
+        if (!status.ok())
         {
-            graph.nodes_.push_back(CreateNode(node_def));
+            graph.Clear();
+            return status;
         }
 
         // Fill edges
@@ -23,63 +55,170 @@ namespace graphloom
             Edge* edge = new Edge(src, edge_def->src_id(), 
                                 dest, edge_def->dest_id());
             graph.edges_.insert(edge);
+
+            src->out_edges_.push_back(edge);
+            dest->in_edges_[edge->dest_id()] = edge;
         }
 
-        return Status::kOK;
+        // Infer shapes in topological order
+        std::vector<const LayoutArray*> input_shapes;
+        for (Node* node : graph.nodes_)
+        {
+            InferShapes(node, input_shapes);
+        }
+
+        Flatten(graph);
+
+        // Pack intermediate tensors into arenas
+        return MemoryPlanner::Plan(graph, graph.memory_plan_);
     }
 
-    Node* GraphFactory::CreateNode(const NodeDef* node_def)
+    Node* GraphFactory::CreateNode(const GraphDef& graph_def, const NodeDef* node_def, 
+        std::vector<DataType>& input_dtypes)
     {
-        std::function<OpKernel*(const OpKernelContext&)> create_fn;
-        GL_CHECK_OK(ResolveKernel(node_def, create_fn));
+        const OpKernelDef* kernel_def = nullptr;
+        GL_CHECK_OK(ResolveKernel(node_def, input_dtypes, kernel_def));
 
+        // the kernel is constructed first, a throwing constructor leaks nothing
+        OpKernel* kernel = kernel_def->create_fn_(OpKernelContext(&graph_def, node_def));
+
+        const Op& op = node_def->op();
         Node* node = new Node(node_def->name(), node_def->id());
-        node->kernel_ = create_fn(OpKernelContext(node_def));
+        node->op_ = &op;
+        node->kernel_ = kernel;
+        node->device_ = DeviceRegistry::instance().GetDevice(node_def->device());
+        node->in_edges_.resize(op.num_inputs(), nullptr);
+        node->out_dtypes_.assign(node_def->out_dtypes_, node_def->out_dtypes_ + node_def->num_outputs());
+        node->out_shapes_.resize(op.num_outputs());
+        node->static_shapes_.resize(op.num_outputs(), false);
 
         return node;
     }
 
-    Status GraphFactory::ResolveKernel(const NodeDef* node_def, 
-        std::function<OpKernel*(const OpKernelContext&)>& result)
+    void GraphFactory::InferShapes(Node* node, std::vector<const LayoutArray*>& input_shapes)
     {
-        const Op& op = node_def->op();
-
-        for (const OpKernelDef& kernel_def : op.kernels_)
+        // inputs are only visible if all their shapes are static
+        input_shapes.clear();
+        for (const Edge* edge : node->in_edges_)
         {
-            if (op.num_inputs() == 0)
+            if (edge == nullptr || !edge->src_->static_shapes_[edge->src_id_])
             {
-                // Special case. Node with no inputs, infer 
-                // the kernel to use with output dtypes.
+                input_shapes.clear();
+                break;
+            }
+            input_shapes.push_back(&edge->src_->out_shapes_[edge->src_id_]);
+        }
 
-                // find matching kernel
-                if (kernel_def.out_dtypes_ == node_def->out_dtypes())
-                {
-                    result = kernel_def.create_fn_;
-                    return Status::kOK;
-                }
+        // Shapes a shape function can compute without
+        // running the graph are static
+        ComputeContext context(input_shapes.data(), input_shapes.size());
+        for (size_t i = 0; i < node->out_shapes_.size(); ++i)
+        {
+            try
+            {
+                node->static_shapes_[i] = node->op_->out_shape_fns_[i](context, node->out_shapes_[i]).ok();
             }
-            else 
+            catch (const GlException&)
             {
-                // Usual case. Infer kernel to use with input dtypes.
+                node->static_shapes_[i] = false;
+            }
+        }
+    }
 
-                // collect input data types because 
-                // only output data types are kept 
-                std::vector<DataType> input_dtypes;
-                input_dtypes.reserve(op.num_inputs());
-                for (EdgeDef* edge : node_def->in_edges_)
-                {
-                    input_dtypes.push_back(edge->src()->out_dtypes()[edge->src_id()]);
-                }
+    void GraphFactory::Flatten(Graph& graph)
+    {
+        const std::vector<Node*>& nodes = graph.nodes_;
+        FlatGraph& flat = graph.flat_;
+        flat.Clear();
+
+        size_t num_nodes = nodes.size();
+        flat.kernels.reserve(num_nodes);
+        flat.devices.reserve(num_nodes);
+        flat.pending.reserve(num_nodes);
+        flat.names.reserve(num_nodes);
+        flat.input_offsets.reserve(num_nodes + 1);
+        flat.output_offsets.reserve(num_nodes + 1);
+        flat.consumer_offsets.reserve(num_nodes + 1);
+        flat.input_slots.reserve(graph.edges_.size());
+        flat.input_nodes.reserve(graph.edges_.size());
+        flat.consumers.reserve(graph.edges_.size());
+
+        flat.output_offsets.push_back(0);
+        for (const Node* node : nodes)
+        {
+            flat.output_offsets.push_back(flat.output_offsets.back() + node->out_dtypes_.size());
+        }
+        uint32_t missing = flat.output_offsets.back();
 
-                // find matching kernel
-                if (kernel_def.in_dtypes_ == input_dtypes)
+        flat.input_offsets.push_back(0);
+        flat.consumer_offsets.push_back(0);
+        for (const Node* node : nodes)
+        {
+            flat.kernels.push_back(node->kernel_);
+            flat.devices.push_back(node->device_);
+            flat.pending.push_back(static_cast<int>(node->in_edges_.size()));
+            flat.names.push_back(node->name_);
+
+            for (const Edge* edge : node->in_edges_)
+            {
+                if (edge == nullptr)
                 {
-                    result = kernel_def.create_fn_;
-                    return Status::kOK;
+                    flat.input_slots.push_back(missing);
+                    flat.input_nodes.push_back(node->id_);
+                    continue;
                 }
+                flat.input_slots.push_back(flat.output_offsets[edge->src_->id_] + edge->src_id_);
+                flat.input_nodes.push_back(edge->src_->id_);
             }
+            for (const Edge* edge : node->out_edges_)
+            {
+                flat.consumers.push_back(edge->dest_->id_);
+            }
+            flat.input_offsets.push_back(flat.input_slots.size());
+            flat.consumer_offsets.push_back(flat.consumers.size());
+        }
+    }
+
+    Status GraphFactory::CollectErrors(const GraphDef& graph_def, const std::vector<std::string>& errors)
+    {
+        size_t num_failed = 0;
+        std::string message;
+        for (size_t i = 0; i < errors.size(); ++i)
+        {
+            if (errors[i].empty()) continue;
+
+            ++num_failed;
+            message += "\n  node \"";
+            message += graph_def.nodes_[i]->name();
+            message += "\": ";
+            message += errors[i];
         }
 
-        return Status(1, "Failed to resolve OpKernel.");
+        if (num_failed == 0) return Status::kOK;
+        return Status(1, "Failed to create ", num_failed, " of ", errors.size(), " nodes:", message);
+    }
+
+    Status GraphFactory::ResolveKernel(const NodeDef* node_def, 
+        std::vector<DataType>& input_dtypes, const OpKernelDef*& result)
+    {
+        const std::string device_type = DeviceRegistry::instance().GetDevice(node_def->device())->type();
+
+        // collect input data types because 
+        // only output data types are kept 
+        input_dtypes.clear();
+        for (size_t i = 0; i < node_def->op().num_inputs(); ++i)
+        {
+            const EdgeDef* edge = node_def->in_edges_[i];
+            input_dtypes.push_back(edge->src()->output_dtype(edge->src_id()));
+        }
+
+        // the kernel must produce the node's output dtypes from its
+        // input dtypes, ex. Cast has one kernel per dtype pair
+        result = node_def->op().FindKernel(device_type, input_dtypes, node_def->out_dtypes());
+        if (result == nullptr)
+        {
+            return Status(1, "Failed to resolve OpKernel.");
+        }
+        return Status::kOK;
     }
-}
\ No newline at end of file
+}
@@ -8,16 +8,67 @@
 
 namespace graphloom
 {
+    class ThreadPool;
+
     class GraphFactory
     {
     public:
-        static Status UpdateGraph(const GraphDef& graph_def, Graph& graph);
+        /**
+         * Builds the executable graph of graph_def. Kernels are 
+         * constructed on pool, the graph is the same either way
+         * 
+         * @param graph_def Graph to build
+         * @param graph Result, cleared first
+         * @param pool Pool to construct the kernels on, nullptr 
+         * to construct them on the calling thread
+         * @returns Status of the build, lists every node that 
+         * failed in node order
+        */
+        static Status UpdateGraph(const GraphDef& graph_def, Graph& graph, ThreadPool* pool = nullptr);
     private:
-        static Node* CreateNode(const NodeDef* node_def);
+        /**
+         * @param graph_def Graph of the node
+         * @param node_def Node to instantiate the kernel of
+         * @param input_dtypes Reused buffer of input data types
+         * @returns Node with its kernel
+        */
+        static Node* CreateNode(const GraphDef& graph_def, const NodeDef* node_def, 
+            std::vector<DataType>& input_dtypes);
         static Edge* CreateEdge(const EdgeDef* edge_def);
 
+        /**
+         * @param graph_def Graph whose nodes were created
+         * @param errors Error of each node, empty if it was created
+         * @returns Status listing the failed nodes in node order
+        */
+        static Status CollectErrors(const GraphDef& graph_def, const std::vector<std::string>& errors);
+
+        /**
+         * Computes the node's static output shapes from 
+         * the static shapes of its inputs
+         * 
+         * @param node Node whose inputs are already inferred
+         * @param input_shapes Reused buffer of input shapes
+        */
+        static void InferShapes(Node* node, std::vector<const LayoutArray*>& input_shapes);
+
+        /**
+         * Lowers the complete graph into its struct of arrays form
+         * 
+         * @param graph Graph whose nodes and edges are built
+        */
+        static void Flatten(Graph& graph);
+
+        /**
+         * Looks the node's kernel up in its op's dispatch table
+         * 
+         * @param node_def Node to resolve the kernel of
+         * @param input_dtypes Reused buffer of input data types
+         * @param result Kernel of the node
+         * @returns Status of the resolution
+        */
         static Status ResolveKernel(const NodeDef* node_def, 
-            std::function<OpKernel*(const OpKernelContext&)>& result);
+            std::vector<DataType>& input_dtypes, const OpKernelDef*& result);
     };
 }
 
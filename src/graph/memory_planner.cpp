@@ -0,0 +1,392 @@
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <utility>
+
+#include "graph/memory_planner.h"
+#include "graph/graph.h"
+
+namespace graphloom
+{
+    namespace
+    {
+        // Max number of ancestors visited when checking if a
+        // freed block may be reused. Ancestors beyond the budget
+        // are treated as unrelated, which only loses reuse.
+        constexpr size_t kMaxAncestorVisits = 4096;
+
+        inline size_t AlignUp(size_t bytes)
+        {
+            return (bytes + MemoryPlan::kAlignment - 1) / MemoryPlan::kAlignment * MemoryPlan::kAlignment;
+        }
+
+        // A contiguous range of an arena
+        struct Block
+        {
+            size_t size;
+            bool free;
+            std::vector<int> releasers; // nodes that must finish before reuse
+        };
+
+        // Planner state of one arena
+        struct ArenaState
+        {
+            std::map<size_t, Block> blocks; // keyed by offset
+            size_t bytes = 0;
+            size_t live_bytes = 0;
+            size_t live_peak_bytes = 0;
+        };
+
+        /**
+         * Marks the ancestors of node with id >= lower_id
+         * by setting mark[id] = stamp
+        */
+        void MarkAncestors(const Node* node, int lower_id, int stamp,
+            std::vector<int>& mark, std::vector<const Node*>& queue)
+        {
+            queue.clear();
+            queue.push_back(node);
+            for (size_t head = 0; head < queue.size() && queue.size() <= kMaxAncestorVisits; ++head)
+            {
+                for (const Edge* edge : queue[head]->in_edges())
+                {
+                    const Node* src = edge->src();
+                    if (src->id() < lower_id || mark[src->id()] == stamp) continue;
+                    mark[src->id()] = stamp;
+                    queue.push_back(src);
+                }
+            }
+        }
+
+        inline bool Released(const Block& block, const std::vector<int>& mark, int stamp)
+        {
+            for (int releaser : block.releasers)
+            {
+                if (mark[releaser] != stamp) return false;
+            }
+            return true;
+        }
+
+        /**
+         * Finds room for bytes in the arena, reusing a released
+         * free block if possible.
+         *
+         * @returns Offset of the reserved range
+        */
+        size_t Reserve(ArenaState& arena, size_t bytes, const std::vector<int>& mark, int stamp)
+        {
+            auto best = arena.blocks.end();
+            for (auto it = arena.blocks.begin(); it != arena.blocks.end(); ++it)
+            {
+                const Block& block = it->second;
+                if (!block.free || block.size < bytes) continue;
+                if (best != arena.blocks.end() && best->second.size <= block.size) continue;
+                if (!Released(block, mark, stamp)) continue;
+                best = it;
+            }
+
+            if (best != arena.blocks.end())
+            {
+                Block& block = best->second;
+                if (block.size > bytes)
+                {
+                    arena.blocks[best->first + bytes] = Block{block.size - bytes, true, block.releasers};
+                    block.size = bytes;
+                }
+                block.free = false;
+                block.releasers.clear();
+                return best->first;
+            }
+
+            // grow a released block at the end of the arena
+            if (!arena.blocks.empty())
+            {
+                auto last = std::prev(arena.blocks.end());
+                Block& block = last->second;
+                if (block.free && Released(block, mark, stamp))
+                {
+                    arena.bytes += bytes - block.size;
+                    block.size = bytes;
+                    block.free = false;
+                    block.releasers.clear();
+                    return last->first;
+                }
+            }
+
+            size_t offset = arena.bytes;
+            arena.blocks[offset] = Block{bytes, false, {}};
+            arena.bytes += bytes;
+            return offset;
+        }
+
+        /**
+         * Frees the block at offset once releasers finish and
+         * merges it with its free neighbours.
+        */
+        void Release(ArenaState& arena, size_t offset, const std::vector<int>& releasers)
+        {
+            auto it = arena.blocks.find(offset);
+            it->second.free = true;
+            it->second.releasers = releasers;
+
+            auto merge = [](Block& into, Block& from) {
+                into.size += from.size;
+                into.releasers.insert(into.releasers.end(), from.releasers.begin(), from.releasers.end());
+                std::sort(into.releasers.begin(), into.releasers.end());
+                into.releasers.erase(std::unique(into.releasers.begin(), into.releasers.end()), into.releasers.end());
+            };
+
+            auto next = std::next(it);
+            if (next != arena.blocks.end() && next->second.free)
+            {
+                merge(it->second, next->second);
+                arena.blocks.erase(next);
+            }
+
+            if (it != arena.blocks.begin())
+            {
+                auto prev = std::prev(it);
+                if (prev->second.free)
+                {
+                    merge(prev->second, it->second);
+                    arena.blocks.erase(it);
+                }
+            }
+        }
+    }
+
+    /**
+     * MemoryPlan Impl
+    */
+
+    MemoryPlan::~MemoryPlan()
+    {
+        Clear();
+    }
+
+    MemoryPlan::MemoryPlan(MemoryPlan&& other) :
+        arenas_(std::move(other.arenas_)),
+        node_arena_(std::move(other.node_arena_)),
+        offsets_(std::move(other.offsets_)),
+        naive_bytes_(other.naive_bytes_)
+    {
+        // the arenas now belong to this plan
+        other.arenas_.clear();
+        other.Clear();
+    }
+
+    MemoryPlan& MemoryPlan::operator=(MemoryPlan&& other)
+    {
+        if (this != &other)
+        {
+            Clear();
+            arenas_ = std::move(other.arenas_);
+            node_arena_ = std::move(other.node_arena_);
+            offsets_ = std::move(other.offsets_);
+            naive_bytes_ = other.naive_bytes_;
+
+            other.arenas_.clear();
+            other.Clear();
+        }
+        return *this;
+    }
+
+    size_t MemoryPlan::offset(int node_id, size_t output) const
+    {
+        if (node_id < 0 || static_cast<size_t>(node_id) >= offsets_.size()) return kUnplanned;
+        if (output >= offsets_[node_id].size()) return kUnplanned;
+        return offsets_[node_id][output];
+    }
+
+    void* MemoryPlan::address(int node_id, size_t output) const
+    {
+        size_t off = offset(node_id, output);
+        if (off == kUnplanned) return nullptr;
+        return static_cast<char*>(arenas_[node_arena_[node_id]].data) + off;
+    }
+
+    size_t MemoryPlan::peak_bytes() const
+    {
+        size_t total = 0;
+        for (const Arena& arena : arenas_)
+        {
+            total += arena.bytes;
+        }
+        return total;
+    }
+
+    size_t MemoryPlan::live_peak_bytes() const
+    {
+        size_t total = 0;
+        for (const Arena& arena : arenas_)
+        {
+            total += arena.live_peak_bytes;
+        }
+        return total;
+    }
+
+    size_t MemoryPlan::naive_bytes() const
+    {
+        return naive_bytes_;
+    }
+
+    double MemoryPlan::fragmentation() const
+    {
+        size_t peak = peak_bytes();
+        if (peak == 0) return 0.0;
+        return 1.0 - static_cast<double>(live_peak_bytes()) / peak;
+    }
+
+    size_t MemoryPlan::num_arenas() const
+    {
+        return arenas_.size();
+    }
+
+    void MemoryPlan::Clear()
+    {
+        for (Arena& arena : arenas_)
+        {
+            if (arena.data != nullptr)
+            {
+                arena.device->free(DataType::Int8, arena.data);
+            }
+        }
+        arenas_.clear();
+        node_arena_.clear();
+        offsets_.clear();
+        naive_bytes_ = 0;
+    }
+
+
+    /**
+     * MemoryPlanner Impl
+    */
+
+    Status MemoryPlanner::Plan(const Graph& graph, MemoryPlan& plan)
+    {
+        plan.Clear();
+
+        const std::vector<Node*>& nodes = graph.nodes_;
+        std::vector<ArenaState> states;
+
+        // one arena per device, in order of first use
+        plan.node_arena_.resize(nodes.size());
+        for (const Node* node : nodes)
+        {
+            size_t index = 0;
+            while (index < plan.arenas_.size() && plan.arenas_[index].device != node->device_) ++index;
+            if (index == plan.arenas_.size())
+            {
+                MemoryPlan::Arena arena;
+                arena.device = node->device_;
+                plan.arenas_.push_back(arena);
+                states.emplace_back();
+            }
+            plan.node_arena_[node->id_] = index;
+        }
+
+        // remaining consumers and byte size of every node output
+        std::vector<std::vector<size_t>> remaining(nodes.size());
+        std::vector<std::vector<size_t>> bytes(nodes.size());
+        plan.offsets_.resize(nodes.size());
+        for (const Node* node : nodes)
+        {
+            size_t num_outputs = node->out_dtypes_.size();
+            remaining[node->id_].assign(num_outputs, 0);
+            bytes[node->id_].assign(num_outputs, 0);
+            plan.offsets_[node->id_].assign(num_outputs, MemoryPlan::kUnplanned);
+
+            for (const Edge* edge : node->out_edges_)
+            {
+                ++remaining[node->id_][edge->src_id()];
+            }
+
+            for (size_t i = 0; i < num_outputs; ++i)
+            {
+                // outputs without consumers leave the graph
+                if (!node->static_shapes_[i] || remaining[node->id_][i] == 0) continue;
+
+                size_t size = DataTypeSize(node->out_dtypes_[i]);
+                const LayoutArray& shape = node->out_shapes_[i];
+                for (size_t d = 0; d < shape.rank(); ++d)
+                {
+                    size *= shape[d];
+                }
+                bytes[node->id_][i] = AlignUp(size);
+            }
+        }
+
+        std::vector<int> mark(nodes.size(), -1);
+        std::vector<const Node*> queue;
+        std::vector<int> releasers;
+
+        for (const Node* node : nodes)
+        {
+            ArenaState& state = states[plan.node_arena_[node->id_]];
+
+            // lowest node a free block waits on bounds the ancestor search
+            int lower_id = node->id_;
+            for (const auto& pair : state.blocks)
+            {
+                if (!pair.second.free || pair.second.releasers.empty()) continue;
+                lower_id = std::min(lower_id, pair.second.releasers.front());
+            }
+            MarkAncestors(node, lower_id, node->id_, mark, queue);
+
+            // outputs are reserved before inputs are released
+            // so a node never writes over its own inputs
+            for (size_t i = 0; i < bytes[node->id_].size(); ++i)
+            {
+                size_t size = bytes[node->id_][i];
+                if (size == 0) continue;
+
+                plan.offsets_[node->id_][i] = Reserve(state, size, mark, node->id_);
+                plan.naive_bytes_ += size;
+                state.live_bytes += size;
+                state.live_peak_bytes = std::max(state.live_peak_bytes, state.live_bytes);
+            }
+
+            for (const Edge* edge : node->in_edges_)
+            {
+                const Node* src = edge->src();
+                size_t src_id = edge->src_id();
+                if (--remaining[src->id_][src_id] > 0) continue;
+
+                size_t offset = plan.offsets_[src->id_][src_id];
+                if (offset == MemoryPlan::kUnplanned) continue;
+
+                releasers.clear();
+                for (const Edge* out : src->out_edges_)
+                {
+                    if (out->src_id() == src_id) releasers.push_back(out->dest()->id_);
+                }
+                std::sort(releasers.begin(), releasers.end());
+                releasers.erase(std::unique(releasers.begin(), releasers.end()), releasers.end());
+
+                ArenaState& src_state = states[plan.node_arena_[src->id_]];
+                Release(src_state, offset, releasers);
+                src_state.live_bytes -= bytes[src->id_][src_id];
+            }
+        }
+
+        // preallocate the arenas, shared by the planned nodes
+        static const std::string kArenaScope = "MemoryPlan";
+        MemoryScope memory_scope(kArenaScope);
+        for (size_t i = 0; i < plan.arenas_.size(); ++i)
+        {
+            MemoryPlan::Arena& arena = plan.arenas_[i];
+            arena.bytes = states[i].bytes;
+            arena.live_peak_bytes = states[i].live_peak_bytes;
+            if (arena.bytes == 0) continue;
+
+            Status status = arena.device->malloc(DataType::Int8, arena.bytes, arena.data);
+            if (!status.ok())
+            {
+                plan.Clear();
+                return status;
+            }
+        }
+
+        return Status::kOK;
+    }
+}
@@ -0,0 +1,133 @@
+#ifndef GRAPHLOOM_GRAPH_MEMORY_PLANNER_H_
+#define GRAPHLOOM_GRAPH_MEMORY_PLANNER_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "graphloom/common/status.h"
+#include "graphloom/device/device.h"
+
+/**
+ * This module defines the static memory planner. Given
+ * the lifetimes of the intermediate tensors of a Graph,
+ * the planner packs every tensor with a static shape into
+ * one preallocated arena per device, so execution does not
+ * call the device allocator for them.
+*/
+
+namespace graphloom
+{
+    class Graph;
+
+    /**
+     * Result of MemoryPlanner. Owns the arenas and
+     * maps each planned node output to its arena offset.
+    */
+    class MemoryPlan
+    {
+    public:
+        // Offset of a tensor that is not in an arena
+        static constexpr size_t kUnplanned = SIZE_MAX;
+
+        // Alignment of every tensor in the arena
+        static constexpr size_t kAlignment = 64;
+
+        MemoryPlan() = default;
+        ~MemoryPlan();
+
+        MemoryPlan(const MemoryPlan&)               = delete;
+        MemoryPlan& operator=(const MemoryPlan&)    = delete;
+        MemoryPlan(MemoryPlan&& other);
+        MemoryPlan& operator=(MemoryPlan&& other); // frees this plan's arenas first
+
+        /**
+         * @param node_id Id of the producing node
+         * @param output Index of the node's output
+         * @returns Offset into the node's device arena, kUnplanned if not planned
+        */
+        size_t offset(int node_id, size_t output) const;
+
+        /**
+         * @param node_id Id of the producing node
+         * @param output Index of the node's output
+         * @returns Address of the tensor in the arena, nullptr if not planned
+        */
+        void* address(int node_id, size_t output) const;
+
+        /**
+         * @returns Planned peak size, the sum of all arena sizes in bytes
+        */
+        size_t peak_bytes() const;
+
+        /**
+         * @returns Sum over arenas of the max bytes simultaneously live
+         * when nodes are executed in id order. Lower bound of peak_bytes()
+        */
+        size_t live_peak_bytes() const;
+
+        /**
+         * @returns Sum of the sizes of all planned tensors, the bytes
+         * needed if no memory was reused
+        */
+        size_t naive_bytes() const;
+
+        /**
+         * @returns Fraction of the arenas not occupied by live tensors
+         * at the peak, 1 - live_peak_bytes()/peak_bytes(). 0 if empty
+        */
+        double fragmentation() const;
+
+        /**
+         * @returns Number of arenas, one per device used
+        */
+        size_t num_arenas() const;
+
+        /**
+         * Frees the arenas and forgets the plan
+        */
+        void Clear();
+
+    private:
+        friend class MemoryPlanner;
+
+        struct Arena
+        {
+            Device* device = nullptr;
+            size_t bytes = 0;
+            size_t live_peak_bytes = 0;
+            void* data = nullptr;
+        };
+
+        std::vector<Arena> arenas_;
+        std::vector<size_t> node_arena_; // arena index of each node
+        std::vector<std::vector<size_t>> offsets_; // offset of each node output
+        size_t naive_bytes_ = 0;
+    };
+
+    /**
+     * Assigns arena offsets to the static shaped intermediate
+     * tensors of a Graph.
+     *
+     * Two tensors may share memory only if every consumer of
+     * the first is an ancestor of the producer of the second,
+     * so the plan stays valid under any parallel schedule that
+     * respects the graph's edges. Outputs without consumers are
+     * returned to the caller and are never planned.
+    */
+    class MemoryPlanner
+    {
+    public:
+        /**
+         * Plans the graph and allocates the arenas.
+         *
+         * NOTE: node ids must be a topological order
+         *
+         * @param graph Graph with resolved nodes and output shapes
+         * @param plan Returned plan
+         * @returns Planning status
+        */
+        static Status Plan(const Graph& graph, MemoryPlan& plan);
+    };
+}
+
+#endif
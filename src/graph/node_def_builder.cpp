@@ -1,6 +1,10 @@
+#include <new>
+#include <algorithm>
+
 #include "graphloom/graph/node_def_builder.h"
 #include "graphloom/op/registration.h"
 #include "graphloom/device/registration.h"
+#include "common/arena.h"
 
 namespace graphloom
 {
@@ -37,31 +41,49 @@ namespace graphloom
 
     NodeDefBuilder& NodeDefBuilder::SetAttr(const std::string& name, int32_t value)
     {
-        attributes_[name] = value;
+        Slot(name, AttrType::Int32).i32 = value;
         return *this;
     }
 
     NodeDefBuilder& NodeDefBuilder::SetAttr(const std::string& name, int64_t value)
     {
-        attributes_[name] = value;
+        Slot(name, AttrType::Int64).i64 = value;
         return *this;
     }
 
     NodeDefBuilder& NodeDefBuilder::SetAttr(const std::string& name, float value)
     {
-        attributes_[name] = value;
+        Slot(name, AttrType::Float).f32 = value;
         return *this;
     }
 
     NodeDefBuilder& NodeDefBuilder::SetAttr(const std::string& name, double value)
     {
-        attributes_[name] = value;
+        Slot(name, AttrType::Double).f64 = value;
         return *this;
     }
 
     NodeDefBuilder& NodeDefBuilder::SetAttr(const std::string& name, bool value)
     {
-        attributes_[name] = value;
+        Slot(name, AttrType::Bool).b = value;
+        return *this;
+    }
+
+    NodeDefBuilder& NodeDefBuilder::SetAttr(const std::string& name, const TensorBuffer& value)
+    {
+        Store(tensors_, Slot(name, AttrType::Tensor), value);
+        return *this;
+    }
+
+    NodeDefBuilder& NodeDefBuilder::SetAttr(const std::string& name, const std::vector<int64_t>& value)
+    {
+        Store(int64_lists_, Slot(name, AttrType::Int64List), value);
+        return *this;
+    }
+
+    NodeDefBuilder& NodeDefBuilder::SetAttr(const std::string& name, const std::vector<float>& value)
+    {
+        Store(float_lists_, Slot(name, AttrType::FloatList), value);
         return *this;
     }
 
@@ -79,23 +101,32 @@ namespace graphloom
                 "\" requires ", op_.num_inputs(), " inputs");
         }
 
-        if (op_.attributes().size() != attributes_.size())
+        for (size_t i = 0; i < attributes_.size(); ++i)
         {
-            throw GlException("Mismatched number of attributes required by the op and attributes given.");
-        }
-
-        for (const std::string& attr : op_.attributes())
-        {
-            if (attributes_.find(attr) == attributes_.end())
+            if (attributes_[i].type == AttrType::None)
             {
-                throw GlException("Required attribute \"", attr, "\" missing");
+                throw GlException("Required attribute \"", op_.attributes()[i], "\" missing");
             }
         }
 
+        // the name and the edge and type arrays are placed 
+        // in the arena next to the node, the device is interned
+        Arena* arena = graph_.arena_;
         std::string name = GenUniqueNodeName(name_);
-        NodeDef* node = new NodeDef(op_, name, device_);
+        char* name_data = static_cast<char*>(arena->Allocate(name.size(), alignof(char)));
+        std::copy(name.begin(), name.end(), name_data);
+
+        EdgeDef** in_edges = static_cast<EdgeDef**>(
+            arena->Allocate(sizeof(EdgeDef*) * op_.num_inputs(), alignof(EdgeDef*)));
+        DataType* out_dtypes = static_cast<DataType*>(
+            arena->Allocate(sizeof(DataType) * dtypes.size(), alignof(DataType)));
+        std::copy(dtypes.begin(), dtypes.end(), out_dtypes);
+
+        const std::string* device = &*graph_.devices_.insert(device_).first;
+        void* memory = arena->Allocate(sizeof(NodeDef), alignof(NodeDef));
+        NodeDef* node = new (memory) NodeDef(op_, std::string_view(name_data, name.size()), 
+            device, in_edges, out_dtypes);
         AddNode(node);
-        node->out_dtypes_ = dtypes;
 
         // build input edges
         for (int i = 0; i < op_.num_inputs(); ++i)
@@ -106,16 +137,31 @@ namespace graphloom
             AddEdge(src, src_id, node, i);
         }
         
-        // build attributes
-        for (auto pair : attributes_)
+        // build attributes, tensors and lists are appended 
+        // to the graph's and the slots point at them there
+        node->attr_offset_ = graph_.attr_slots_.size();
+        for (AttrSlot slot : attributes_)
         {
-            std::string path(name);
-            path += "/";
-            path += pair.first;
-
-            graph_.attributes_[path] = pair.second;
+            switch (slot.type)
+            {
+            case AttrType::Tensor:
+                graph_.attr_tensors_.push_back(tensors_[slot.index]);
+                slot.index = graph_.attr_tensors_.size() - 1;
+                break;
+            case AttrType::Int64List:
+                graph_.attr_int64_lists_.push_back(int64_lists_[slot.index]);
+                slot.index = graph_.attr_int64_lists_.size() - 1;
+                break;
+            case AttrType::FloatList:
+                graph_.attr_float_lists_.push_back(float_lists_[slot.index]);
+                slot.index = graph_.attr_float_lists_.size() - 1;
+                break;
+            default:
+                break;
+            }
+            graph_.attr_slots_.push_back(slot);
         }
-        
+
 
         return node;
     }
@@ -123,31 +169,38 @@ namespace graphloom
     void NodeDefBuilder::Reset()
     {
         node_inputs_.clear();
-        attributes_.clear();
+        attributes_.assign(op_.attributes().size(), AttrSlot());
+        tensors_.clear();
+        int64_lists_.clear();
+        float_lists_.clear();
         name_.clear();
     }
 
     NodeDefBuilder::NodeDefBuilder(GraphDef& graph, 
         const std::string& op_name, 
         const std::string& device) : 
+        device_(device),
         op_(OpRegistry::instance().GetOp(op_name)),
-        graph_(graph),
-        device_(device)
+        graph_(graph)
     {
         if (!DeviceRegistry::instance().HasDevice(device_))
         {
             throw GlException("Requested device \"", device_, "\" does not exist");
         }
+        attributes_.resize(op_.attributes().size());
     }
 
     void NodeDefBuilder::AddEdge(NodeDef* src, size_t src_id, 
         NodeDef* dest, size_t dest_id)
     {
-        EdgeDef* edge = new EdgeDef(src, src_id, dest, dest_id);
-        graph_.edges_.insert(edge);
+        void* memory = graph_.arena_->Allocate(sizeof(EdgeDef), alignof(EdgeDef));
+        EdgeDef* edge = new (memory) EdgeDef(src, src_id, dest, dest_id);
+        graph_.edges_.push_back(edge);
 
-        src->out_edges_.push_back(edge);
-        dest->in_edges_.push_back(edge);
+        if (src->last_out_ == nullptr) src->first_out_ = edge;
+        else src->last_out_->next_out_ = edge;
+        src->last_out_ = edge;
+        dest->in_edges_[dest_id] = edge;
     }
 
     void NodeDefBuilder::AddNode(NodeDef* node)
@@ -158,17 +211,61 @@ namespace graphloom
         }
         node->id_ = graph_.nodes_.size();
         graph_.nodes_.push_back(node);
+        graph_.node_index_[node->name_] = node;
+    }
+
+    AttrSlot& NodeDefBuilder::Slot(const std::string& name, AttrType type)
+    {
+        int index = op_.AttrIndex(name);
+        if (index < 0)
+        {
+            throw GlException("Op \"", op_.name(), "\" has no attribute \"", name, "\"");
+        }
+
+        AttrSlot& slot = attributes_[index];
+        if (slot.type == type) return slot;
+
+        // the slot changes type, free the value staged for the old one
+        switch (slot.type)
+        {
+        case AttrType::Tensor:
+            tensors_[slot.index] = TensorBuffer();
+            break;
+        case AttrType::Int64List:
+            int64_lists_[slot.index] = std::vector<int64_t>();
+            break;
+        case AttrType::FloatList:
+            float_lists_[slot.index] = std::vector<float>();
+            break;
+        default:
+            break;
+        }
+        slot.type = type;
+        slot.index = index;
+        return slot;
+    }
+
+    template <typename T>
+    void NodeDefBuilder::Store(std::vector<T>& values, const AttrSlot& slot, const T& value)
+    {
+        if (values.size() <= slot.index) values.resize(attributes_.size());
+        values[slot.index] = value;
     }
 
     std::string NodeDefBuilder::GenUniqueNodeName(const std::string& base_name)
     {
-        std::string name(base_name);
-        for (int i = 1; graph_.FindNode(name); ++i)
+        if (!graph_.FindNode(base_name)) return base_name;
+
+        // nodes are never removed, so suffixes up to the last
+        // one given are taken and the search resumes after it
+        size_t& suffix = graph_.name_suffixes_[base_name];
+        std::string name;
+        do
         {
             name = base_name;
             name += "_";
-            name += std::to_string(i);
-        }
+            name += std::to_string(++suffix);
+        } while (graph_.FindNode(name));
         return name;
     }
 }
\ No newline at end of file
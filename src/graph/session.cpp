@@ -0,0 +1,91 @@
+#include <exception>
+
+#include "graphloom/graph/session.h"
+
+#include "common/thread_pool.h"
+#include "graph/executor.h"
+#include "graph/graph.h"
+#include "graph/graph_factory.h"
+
+namespace graphloom
+{
+    Session::Session(const SessionOptions& options) :
+        options_(options),
+        pool_(new ThreadPool(options.inter_op_threads, options.spin_iterations)),
+        graph_(new Graph()),
+        executor_(nullptr)
+    {
+        omp_init_lock(&lock_);
+    }
+
+    Session::~Session()
+    {
+        delete executor_;
+        delete graph_;
+        delete pool_;
+        omp_destroy_lock(&lock_);
+    }
+
+    Status Session::UpdateGraph(const GraphDef& graph)
+    {
+        omp_set_lock(&lock_);
+        delete executor_;
+        executor_ = nullptr;
+
+        // nothing may escape while the lock is held
+        Status status = Status::kOK;
+        try
+        {
+            status = GraphFactory::UpdateGraph(graph, *graph_, pool_);
+            if (status.ok())
+            {
+                executor_ = new Executor(*graph_, *pool_, options_.intra_op_threads);
+            }
+        }
+        catch (const std::exception& e)
+        {
+            status = Status(1, e.what());
+        }
+
+        if (!status.ok())
+        {
+            graph_->Clear();
+        }
+        omp_unset_lock(&lock_);
+        return status;
+    }
+
+    Status Session::Run(const std::vector<std::pair<NodeDef*, TensorBuffer*>>& feeds, 
+        const std::vector<NodeDef*>& target_nodes, 
+        std::vector<TensorBuffer>& outputs)
+    {
+        omp_set_lock(&lock_);
+        if (executor_ == nullptr)
+        {
+            omp_unset_lock(&lock_);
+            return Status(1, "Session has no graph, call UpdateGraph() first");
+        }
+
+        Status status = Status::kOK;
+        try
+        {
+            status = executor_->Run(feeds, target_nodes, outputs);
+        }
+        catch (const std::exception& e)
+        {
+            status = Status(1, e.what());
+        }
+        omp_unset_lock(&lock_);
+        return status;
+    }
+
+    size_t Session::planned_peak_bytes() const
+    {
+        return graph_->memory_plan().peak_bytes();
+    }
+
+    double Session::planned_fragmentation() const
+    {
+        return graph_->memory_plan().fragmentation();
+    }
+}
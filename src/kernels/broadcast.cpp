@@ -0,0 +1,164 @@
+#include <algorithm>
+
+#include "kernels/broadcast.h"
+
+namespace graphloom
+{
+    namespace
+    {
+        /**
+         * @param shape Shape aligned on its last dimension
+         * @param rank Rank of the broadcast shape
+         * @param dim Dimension of the broadcast shape
+         * @returns Size of shape at dim, 1 if shape has no such dimension
+        */
+        inline size_t AlignedSize(const LayoutArray& shape, size_t rank, size_t dim)
+        {
+            size_t offset = rank - shape.rank();
+            return dim < offset ? 1 : shape[dim - offset];
+        }
+    }
+
+    /**
+     * BroadcastPlan Impl
+    */
+
+    Status BroadcastPlan::OutputShape(const LayoutArray& a, const LayoutArray& b, LayoutArray& shape)
+    {
+        size_t rank = std::max(a.rank(), b.rank());
+
+        // LayoutArray rank is only set from lists, start from the
+        // higher rank operand and fill in the sizes
+        LayoutArray result = a.rank() >= b.rank() ? a : b;
+        for (size_t d = 0; d < rank; ++d)
+        {
+            size_t da = AlignedSize(a, rank, d);
+            size_t db = AlignedSize(b, rank, d);
+            if (da != db && da != 1 && db != 1)
+            {
+                return Status(1, "Shapes cannot broadcast, dimension ", d,
+                    " has sizes ", da, " and ", db);
+            }
+            result[d] = std::max(da, db);
+        }
+
+        shape = result;
+        return Status::kOK;
+    }
+
+    Status BroadcastPlan::Init(const LayoutArray& a, const LayoutArray& b)
+    {
+        size_t rank = std::max(a.rank(), b.rank());
+
+        // contiguous strides of each operand, 0 where broadcast
+        size_t sizes[GRAPHLOOM_MAX_LAYOUT];
+        size_t a_strides[GRAPHLOOM_MAX_LAYOUT];
+        size_t b_strides[GRAPHLOOM_MAX_LAYOUT];
+        size_t a_stride = 1;
+        size_t b_stride = 1;
+        for (size_t i = rank; i-- > 0;)
+        {
+            size_t da = AlignedSize(a, rank, i);
+            size_t db = AlignedSize(b, rank, i);
+            if (da != db && da != 1 && db != 1)
+            {
+                return Status(1, "Shapes cannot broadcast, dimension ", i,
+                    " has sizes ", da, " and ", db);
+            }
+
+            sizes[i] = std::max(da, db);
+            a_strides[i] = da == 1 ? 0 : a_stride;
+            b_strides[i] = db == 1 ? 0 : b_stride;
+            a_stride *= da;
+            b_stride *= db;
+        }
+
+        // drop size 1 dimensions and merge a dimension into the
+        // inner one when both operands step through them as one
+        rank_ = 0;
+        size_t collapsed[GRAPHLOOM_MAX_LAYOUT];
+        size_t a_collapsed[GRAPHLOOM_MAX_LAYOUT];
+        size_t b_collapsed[GRAPHLOOM_MAX_LAYOUT];
+        for (size_t i = rank; i-- > 0;)
+        {
+            if (sizes[i] == 1) continue;
+
+            if (rank_ > 0)
+            {
+                size_t inner = rank_ - 1;
+                if (a_strides[i] == a_collapsed[inner] * collapsed[inner] &&
+                    b_strides[i] == b_collapsed[inner] * collapsed[inner])
+                {
+                    collapsed[inner] *= sizes[i];
+                    continue;
+                }
+            }
+
+            collapsed[rank_] = sizes[i];
+            a_collapsed[rank_] = a_strides[i];
+            b_collapsed[rank_] = b_strides[i];
+            ++rank_;
+        }
+
+        // scalars iterate one element
+        if (rank_ == 0)
+        {
+            collapsed[0] = 1;
+            a_collapsed[0] = 0;
+            b_collapsed[0] = 0;
+            rank_ = 1;
+        }
+
+        // collapsed dimensions were gathered inner to outer
+        for (size_t i = 0; i < rank_; ++i)
+        {
+            sizes_[i] = collapsed[rank_ - 1 - i];
+            a_strides_[i] = a_collapsed[rank_ - 1 - i];
+            b_strides_[i] = b_collapsed[rank_ - 1 - i];
+        }
+        return Status::kOK;
+    }
+
+    size_t BroadcastPlan::rank() const
+    {
+        return rank_;
+    }
+
+    size_t BroadcastPlan::inner_size() const
+    {
+        return sizes_[rank_ - 1];
+    }
+
+    size_t BroadcastPlan::outer_rows() const
+    {
+        size_t rows = 1;
+        for (size_t i = 0; i + 1 < rank_; ++i)
+        {
+            rows *= sizes_[i];
+        }
+        return rows;
+    }
+
+    size_t BroadcastPlan::a_inner_step() const
+    {
+        return a_strides_[rank_ - 1];
+    }
+
+    size_t BroadcastPlan::b_inner_step() const
+    {
+        return b_strides_[rank_ - 1];
+    }
+
+    void BroadcastPlan::RowOffsets(size_t row, size_t& a_offset, size_t& b_offset) const
+    {
+        a_offset = 0;
+        b_offset = 0;
+        for (size_t i = rank_ - 1; i-- > 0;)
+        {
+            size_t index = row % sizes_[i];
+            row /= sizes_[i];
+            a_offset += index * a_strides_[i];
+            b_offset += index * b_strides_[i];
+        }
+    }
+}
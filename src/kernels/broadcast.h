@@ -0,0 +1,85 @@
+#ifndef GRAPHLOOM_KERNELS_BROADCAST_H_
+#define GRAPHLOOM_KERNELS_BROADCAST_H_
+
+#include <cstddef>
+
+#include "graphloom/common/status.h"
+#include "graphloom/tensor/tensor.h"
+
+/**
+ * This module defines the iteration plan of binary
+ * elementwise kernels. Shapes broadcast like NumPy: they
+ * are aligned on their last dimension and a dimension of
+ * size 1 repeats to match the other operand. Adjacent
+ * dimensions that are contiguous in every operand are
+ * collapsed into one, so most plans are 1 or 2 loops deep
+ * no matter the rank of the tensors.
+*/
+
+namespace graphloom
+{
+    class BroadcastPlan
+    {
+    public:
+        /**
+         * @param a Shape of the first operand
+         * @param b Shape of the second operand
+         * @param shape Returned broadcast shape
+         * @returns Non-ok status if the shapes are incompatible
+        */
+        static Status OutputShape(const LayoutArray& a, const LayoutArray& b, LayoutArray& shape);
+
+        /**
+         * Plans the iteration of a contiguous output over
+         * contiguous operands a and b. Does not allocate.
+         *
+         * @param a Shape of the first operand
+         * @param b Shape of the second operand
+         * @returns Non-ok status if the shapes are incompatible
+        */
+        Status Init(const LayoutArray& a, const LayoutArray& b);
+
+        /**
+         * @returns Number of collapsed dimensions, at least 1
+        */
+        size_t rank() const;
+
+        /**
+         * @returns Size of the innermost collapsed dimension
+        */
+        size_t inner_size() const;
+
+        /**
+         * @returns Number of rows of inner_size() output elements
+        */
+        size_t outer_rows() const;
+
+        /**
+         * @returns Step of the first operand along the inner dimension, 0 or 1
+        */
+        size_t a_inner_step() const;
+
+        /**
+         * @returns Step of the second operand along the inner dimension, 0 or 1
+        */
+        size_t b_inner_step() const;
+
+        /**
+         * Offsets of the first element of an output row.
+         * The row's output offset is row * inner_size()
+         *
+         * @param row Row index, less than outer_rows()
+         * @param a_offset Returned element offset into the first operand
+         * @param b_offset Returned element offset into the second operand
+        */
+        void RowOffsets(size_t row, size_t& a_offset, size_t& b_offset) const;
+
+    private:
+        size_t rank_ = 0;
+        size_t sizes_[GRAPHLOOM_MAX_LAYOUT];     // collapsed sizes, outer to inner
+        size_t a_strides_[GRAPHLOOM_MAX_LAYOUT]; // 0 where a is broadcast
+        size_t b_strides_[GRAPHLOOM_MAX_LAYOUT]; // 0 where b is broadcast
+    };
+}
+
+#endif
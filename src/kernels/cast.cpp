@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <type_traits>
+
+#include "graphloom/common/half.h"
+#include "graphloom/kernels/cast.h"
+#include "graphloom/op/op.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GL_CAST_X86 1
+#include <immintrin.h>
+#define GL_TARGET_AVX2 __attribute__((target("avx2,fma,f16c")))
+#define GL_TARGET_AVX512 __attribute__((target("avx512f,avx512dq")))
+#define GL_TARGET_AVX512_BF16 __attribute__((target("avx512f,avx512bf16")))
+#endif
+
+namespace graphloom
+{
+    namespace
+    {
+        // Elements of a loop call, a task of parallel_for
+        constexpr size_t kChunkElements = size_t(1) << 14;
+
+        // Min elements a thread of parallel_for is given
+        constexpr size_t kMinParallelElements = size_t(1) << 15;
+
+        /**
+         * @param x Element to convert
+         * @returns x converted to To, 16 bit types go through float
+        */
+        template<typename To, typename From>
+        inline To CastValue(From x)
+        {
+            if constexpr (std::is_same<To, Fp16>::value || std::is_same<To, Bf16>::value ||
+                std::is_same<From, Fp16>::value || std::is_same<From, Bf16>::value)
+            {
+                return static_cast<To>(static_cast<float>(x));
+            }
+            else
+            {
+                return static_cast<To>(x);
+            }
+        }
+
+        template<typename From, typename To>
+        using CastLoopFn = void (*)(const From* x, To* out, size_t n);
+
+        template<typename From, typename To>
+        inline void CastLoop(const From* x, To* out, size_t n)
+        {
+            #pragma omp simd
+            for (size_t i = 0; i < n; ++i)
+            {
+                out[i] = CastValue<To>(x[i]);
+            }
+        }
+
+        template<typename From, typename To>
+        void CastLoopGeneric(const From* x, To* out, size_t n)
+        {
+            CastLoop(x, out, n);
+        }
+
+#ifdef GL_CAST_X86
+        template<typename From, typename To>
+        GL_TARGET_AVX2 void CastLoopAvx2(const From* x, To* out, size_t n)
+        {
+            CastLoop(x, out, n);
+        }
+
+        template<typename From, typename To>
+        GL_TARGET_AVX512 void CastLoopAvx512(const From* x, To* out, size_t n)
+        {
+            CastLoop(x, out, n);
+        }
+
+        /**
+         * Float16 conversions of F16C and AVX-512F, the
+         * software conversions are branchy and stay scalar
+        */
+
+        GL_TARGET_AVX2 void FloatToFp16Avx2(const float* x, Fp16* out, size_t n)
+        {
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(x + i), _MM_FROUND_TO_NEAREST_INT);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), h);
+            }
+            CastLoop(x + i, out + i, n - i);
+        }
+
+        GL_TARGET_AVX2 void Fp16ToFloatAvx2(const Fp16* x, float* out, size_t n)
+        {
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i));
+                _mm256_storeu_ps(out + i, _mm256_cvtph_ps(h));
+            }
+            CastLoop(x + i, out + i, n - i);
+        }
+
+        GL_TARGET_AVX512 void FloatToFp16Avx512(const float* x, Fp16* out, size_t n)
+        {
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16)
+            {
+                __m256i h = _mm512_cvtps_ph(_mm512_loadu_ps(x + i), _MM_FROUND_TO_NEAREST_INT);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), h);
+            }
+            CastLoop(x + i, out + i, n - i);
+        }
+
+        GL_TARGET_AVX512 void Fp16ToFloatAvx512(const Fp16* x, float* out, size_t n)
+        {
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16)
+            {
+                __m256i h = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(x + i));
+                _mm512_storeu_ps(out + i, _mm512_cvtph_ps(h));
+            }
+            CastLoop(x + i, out + i, n - i);
+        }
+
+        /**
+         * One instruction per 16 elements instead of the
+         * integer rounding sequence. The instruction treats
+         * denormal floats as zero.
+        */
+        GL_TARGET_AVX512_BF16 void FloatToBf16Avx512Bf16(const float* x, Bf16* out, size_t n)
+        {
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16)
+            {
+                __m256bh h = _mm512_cvtneps_pbh(_mm512_loadu_ps(x + i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), reinterpret_cast<__m256i>(h));
+            }
+            if (i < n)
+            {
+                __mmask16 mask = static_cast<__mmask16>((1u << (n - i)) - 1);
+                __m256bh h = _mm512_cvtneps_pbh(_mm512_maskz_loadu_ps(mask, x + i));
+                _mm512_mask_cvtepi32_storeu_epi16(out + i, mask,
+                    _mm512_cvtepu16_epi32(reinterpret_cast<__m256i>(h)));
+            }
+        }
+#endif
+
+        /**
+         * @param isa Highest instruction set level allowed
+         * @returns Fastest loop from From to To requiring at most isa
+        */
+        template<typename From, typename To>
+        CastLoopFn<From, To> CastLoopFor(CpuIsa isa)
+        {
+#ifdef GL_CAST_X86
+            if constexpr (std::is_same<From, float>::value && std::is_same<To, Fp16>::value)
+            {
+                if (isa >= CpuIsa::Avx512) return FloatToFp16Avx512;
+                if (isa >= CpuIsa::Avx2) return FloatToFp16Avx2;
+            }
+            if constexpr (std::is_same<From, Fp16>::value && std::is_same<To, float>::value)
+            {
+                if (isa >= CpuIsa::Avx512) return Fp16ToFloatAvx512;
+                if (isa >= CpuIsa::Avx2) return Fp16ToFloatAvx2;
+            }
+            if constexpr (std::is_same<From, float>::value && std::is_same<To, Bf16>::value)
+            {
+                if (isa >= CpuIsa::Avx512Bf16) return FloatToBf16Avx512Bf16;
+            }
+            if (isa >= CpuIsa::Avx512) return CastLoopAvx512<From, To>;
+            if (isa >= CpuIsa::Avx2) return CastLoopAvx2<From, To>;
+#endif
+            return CastLoopGeneric<From, To>;
+        }
+
+        // State of a cast kernel shared with its parallel_for ranges
+        template<typename From, typename To>
+        struct CastJob
+        {
+            CastLoopFn<From, To> loop;
+            const From* x;
+            To* out;
+            size_t n;
+        };
+
+        Status SameShape(const ComputeContext& context, LayoutArray& shape)
+        {
+            shape = context.input_shape(0);
+            return Status::kOK;
+        }
+    }
+
+    /**
+     * Cast kernel on contiguous tensors, using loops of
+     * at most instruction set isa
+    */
+    template<typename From, typename To, CpuIsa isa>
+    class CastKernel : public OpKernel
+    {
+    public:
+        CastKernel(const OpKernelContext& context) :
+            OpKernel(context),
+            loop_(CastLoopFor<From, To>(isa))
+        {
+
+        }
+
+        Status Compute(ComputeContext& context) override
+        {
+            const TensorBuffer& x = context.input(0);
+            TensorBuffer& out = context.output(0);
+
+            CastJob<From, To> job{loop_, x.Map<From>().data(), out.Map<To>().data(), x.size()};
+            size_t chunks = (job.n + kChunkElements - 1) / kChunkElements;
+            size_t grain = std::max<size_t>(1, kMinParallelElements / kChunkElements);
+            context.parallel_for(chunks, grain,
+                [&job](size_t begin, size_t end) {
+                    size_t first = begin * kChunkElements;
+                    size_t last = std::min(end * kChunkElements, job.n);
+                    job.loop(job.x + first, job.out + first, last - first);
+                });
+            return Status::kOK;
+        }
+
+    private:
+        const CastLoopFn<From, To> loop_;
+    };
+
+    namespace
+    {
+        /**
+         * Registers the kernels of a cast at every
+         * instruction set level up to max_isa
+         *
+         * @param from Input data type
+         * @param to Output data type
+         * @param max_isa Highest level with a faster loop
+        */
+        template<typename From, typename To>
+        Initializer RegisterCastKernels(DataType from, DataType to, CpuIsa max_isa = CpuIsa::Avx512)
+        {
+            OpKernelDefBuilder<CastKernel<From, To, CpuIsa::Generic>>("Cast", "CPU").
+                Input(from).Output(to).Isa(CpuIsa::Generic).Build();
+            OpKernelDefBuilder<CastKernel<From, To, CpuIsa::Avx2>>("Cast", "CPU").
+                Input(from).Output(to).Isa(CpuIsa::Avx2).Build();
+            OpKernelDefBuilder<CastKernel<From, To, CpuIsa::Avx512>>("Cast", "CPU").
+                Input(from).Output(to).Isa(CpuIsa::Avx512).Build();
+            if (max_isa >= CpuIsa::Avx512Bf16)
+            {
+                OpKernelDefBuilder<CastKernel<From, To, CpuIsa::Avx512Bf16>>("Cast", "CPU").
+                    Input(from).Output(to).Isa(CpuIsa::Avx512Bf16).Build();
+            }
+            return Initializer();
+        }
+    }
+
+    GL_REGISTER_OP("Cast").Input().Output(SameShape).Build();
+
+    // registered after the op above, ordered within this file
+    static Initializer register_cast_kernels[] = {
+        RegisterCastKernels<float, double>(DataType::Float, DataType::Double),
+        RegisterCastKernels<float, Fp16>(DataType::Float, DataType::Float16),
+        RegisterCastKernels<float, Bf16>(DataType::Float, DataType::BFloat16, CpuIsa::Avx512Bf16),
+
+        RegisterCastKernels<double, float>(DataType::Double, DataType::Float),
+        RegisterCastKernels<double, Fp16>(DataType::Double, DataType::Float16),
+        RegisterCastKernels<double, Bf16>(DataType::Double, DataType::BFloat16),
+
+        RegisterCastKernels<Fp16, float>(DataType::Float16, DataType::Float),
+        RegisterCastKernels<Fp16, double>(DataType::Float16, DataType::Double),
+        RegisterCastKernels<Fp16, Bf16>(DataType::Float16, DataType::BFloat16),
+
+        RegisterCastKernels<Bf16, float>(DataType::BFloat16, DataType::Float),
+        RegisterCastKernels<Bf16, double>(DataType::BFloat16, DataType::Double),
+        RegisterCastKernels<Bf16, Fp16>(DataType::BFloat16, DataType::Float16),
+    };
+
+    GL_DEFINE_KERNEL_LIBRARY(cast);
+}
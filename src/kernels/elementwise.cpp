@@ -0,0 +1,599 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include "graphloom/kernels/elementwise.h"
+#include "graphloom/op/op.h"
+
+#include "kernels/broadcast.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GL_ELEMENTWISE_X86 1
+
+// Kernels never read floating point exception flags. With
+// trapping math the selects of the float math below stay
+// branches and loops over them stay scalar without AVX-512
+#pragma GCC optimize("no-trapping-math")
+
+#define GL_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define GL_TARGET_AVX512 __attribute__((target("avx512f,avx512dq")))
+#endif
+
+namespace graphloom
+{
+    namespace
+    {
+        // Elements of an inner loop call, a task of parallel_for
+        constexpr size_t kChunkElements = size_t(1) << 14;
+
+        // Min elements a thread of parallel_for is given
+        constexpr size_t kMinParallelElements = size_t(1) << 15;
+
+        /**
+         * Vectorizable float math. Every function is branch free
+         * so loops over it compile to SIMD code, std::exp and
+         * friends are opaque calls the compiler cannot vectorize.
+        */
+
+        inline float BitsToFloat(int32_t bits)
+        {
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        inline int32_t FloatToBits(float value)
+        {
+            int32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return bits;
+        }
+
+        /**
+         * exp(x) = 2^n * exp(r) with r = x - n * ln(2) in
+         * [-ln(2)/2, ln(2)/2], exp(r) is a degree 7 polynomial.
+         * Relative error is below 1e-6.
+        */
+        inline float FastExp(float x)
+        {
+            // n stays within the normal exponent range
+            float clamped = x < -87.3f ? -87.3f : x;
+            clamped = clamped > 88.3f ? 88.3f : clamped;
+            clamped = x != x ? 0.0f : clamped;
+
+            // adding 1.5 * 2^23 rounds to an integer in the low mantissa bits
+            float k = clamped * 1.44269504f + 12582912.0f;
+            int32_t n = FloatToBits(k) - 0x4b400000;
+            float fn = k - 12582912.0f;
+
+            // ln(2) split in two so n * ln2_hi is exact
+            float r = clamped - fn * 0.693359375f + fn * 2.12194440e-4f;
+
+            float p = 1.9875691500e-4f;
+            p = p * r + 1.3981999507e-3f;
+            p = p * r + 8.3334519073e-3f;
+            p = p * r + 4.1665795894e-2f;
+            p = p * r + 1.6666665459e-1f;
+            p = p * r + 5.0000001201e-1f;
+            p = p * r * r + r + 1.0f;
+
+            float y = p * BitsToFloat((n + 127) << 23);
+            y = x > 88.7228391f ? std::numeric_limits<float>::infinity() : y;
+            y = x < -87.3365448f ? 0.0f : y;
+            return x != x ? x : y;
+        }
+
+        /**
+         * log(x) = e * ln(2) + log(m) with x = m * 2^e and m in
+         * [sqrt(1/2), sqrt(2)), log(m) = 2 * atanh(z) with
+         * z = (m - 1) / (m + 1) as an odd series in z.
+         * Relative error is below 1e-6.
+        */
+        inline float FastLog(float x)
+        {
+            // scale denormals into the normal range
+            bool denormal = x < 1.17549435e-38f;
+            float scaled = denormal ? x * 8388608.0f : x;
+
+            int32_t bits = FloatToBits(scaled);
+            int32_t e = ((bits >> 23) & 0xff) - 127 - (denormal ? 23 : 0);
+            float m = BitsToFloat((bits & 0x007fffff) | 0x3f800000);
+            bool upper = m > 1.41421356f;
+            m = upper ? m * 0.5f : m;
+            e = upper ? e + 1 : e;
+
+            float z = (m - 1.0f) / (m + 1.0f);
+            float z2 = z * z;
+            float p = 2.0f / 9.0f;
+            p = p * z2 + 2.0f / 7.0f;
+            p = p * z2 + 2.0f / 5.0f;
+            p = p * z2 + 2.0f / 3.0f;
+            p = p * z2 + 2.0f;
+
+            float fe = static_cast<float>(e);
+            float y = fe * 0.693359375f + (p * z - fe * 2.12194440e-4f);
+
+            y = x == std::numeric_limits<float>::infinity() ? x : y;
+            y = x == 0.0f ? -std::numeric_limits<float>::infinity() : y;
+            y = x < 0.0f ? std::numeric_limits<float>::quiet_NaN() : y;
+            return x != x ? x : y;
+        }
+
+        /**
+         * tanh(x) = 1 - 2 / (exp(2x) + 1), small inputs use
+         * the Taylor series to avoid the cancellation.
+        */
+        inline float FastTanh(float x)
+        {
+            float a = x < 0.0f ? -x : x;
+            float t = 1.0f - 2.0f / (FastExp(2.0f * a) + 1.0f);
+            t = x < 0.0f ? -t : t;
+
+            float x2 = x * x;
+            float p = -17.0f / 315.0f;
+            p = p * x2 + 2.0f / 15.0f;
+            p = p * x2 - 1.0f / 3.0f;
+            p = p * x2 * x + x;
+
+            return a < 0.0625f ? p : t;
+        }
+
+        /**
+         * Bf16 elements are computed in float. The conversions
+         * are redone on raw bits here: the ones of half.h are
+         * compiled without this file's options and would stay
+         * calls in the vector loops.
+        */
+
+        template<typename T>
+        struct MathType
+        {
+            using type = T;
+        };
+
+        template<>
+        struct MathType<Bf16>
+        {
+            using type = float;
+        };
+
+        template<typename T>
+        inline T Widen(T x)
+        {
+            return x;
+        }
+
+        inline float Widen(Bf16 x)
+        {
+            uint16_t bits;
+            std::memcpy(&bits, &x, sizeof(bits));
+            return BitsToFloat(static_cast<int32_t>(static_cast<uint32_t>(bits) << 16));
+        }
+
+        template<typename T>
+        inline T Narrow(typename MathType<T>::type x)
+        {
+            return x;
+        }
+
+        // rounds to nearest even, NaN stays a quiet NaN
+        template<>
+        inline Bf16 Narrow<Bf16>(float x)
+        {
+            uint32_t bits = static_cast<uint32_t>(FloatToBits(x));
+            uint32_t rounded = (bits + 0x7fffu + ((bits >> 16) & 1)) >> 16;
+            uint32_t nan = (bits >> 16) | 0x40;
+            uint16_t result = static_cast<uint16_t>((bits & 0x7fffffffu) > 0x7f800000u ? nan : rounded);
+
+            Bf16 value;
+            std::memcpy(&value, &result, sizeof(value));
+            return value;
+        }
+
+        /**
+         * Elementwise ops. Double precision transcendentals
+         * use the standard library.
+        */
+
+        struct AddOp
+        {
+            template<typename T>
+            static T Apply(T a, T b) { return a + b; }
+        };
+
+        struct SubOp
+        {
+            template<typename T>
+            static T Apply(T a, T b) { return a - b; }
+        };
+
+        struct MulOp
+        {
+            template<typename T>
+            static T Apply(T a, T b) { return a * b; }
+        };
+
+        struct DivOp
+        {
+            template<typename T>
+            static T Apply(T a, T b) { return a / b; }
+        };
+
+        struct MaxOp
+        {
+            template<typename T>
+            static T Apply(T a, T b) { return a > b ? a : b; }
+        };
+
+        struct MinOp
+        {
+            template<typename T>
+            static T Apply(T a, T b) { return a < b ? a : b; }
+        };
+
+        struct ReluOp
+        {
+            template<typename T>
+            static T Apply(T x) { return x > T(0) ? x : T(0); }
+        };
+
+        struct SigmoidOp
+        {
+            static float Apply(float x) { return 1.0f / (1.0f + FastExp(-x)); }
+            static double Apply(double x) { return 1.0 / (1.0 + std::exp(-x)); }
+        };
+
+        struct TanhOp
+        {
+            static float Apply(float x) { return FastTanh(x); }
+            static double Apply(double x) { return std::tanh(x); }
+        };
+
+        struct ExpOp
+        {
+            static float Apply(float x) { return FastExp(x); }
+            static double Apply(double x) { return std::exp(x); }
+        };
+
+        struct LogOp
+        {
+            static float Apply(float x) { return FastLog(x); }
+            static double Apply(double x) { return std::log(x); }
+        };
+
+        /**
+         * Inner loops. Steps of a and b are 0 for a broadcast
+         * operand or 1, the loops are compiled once per
+         * instruction set level below.
+        */
+
+        template<typename T>
+        using BinaryLoopFn = void (*)(const T* a, size_t a_step,
+            const T* b, size_t b_step, T* out, size_t n);
+
+        template<typename T>
+        using UnaryLoopFn = void (*)(const T* x, T* out, size_t n);
+
+        template<typename Op, typename T>
+        inline void BinaryLoop(const T* a, size_t a_step, const T* b, size_t b_step, T* out, size_t n)
+        {
+            using M = typename MathType<T>::type;
+            if (a_step != 0 && b_step != 0)
+            {
+                #pragma omp simd
+                for (size_t i = 0; i < n; ++i)
+                {
+                    out[i] = Narrow<T>(Op::Apply(Widen(a[i]), Widen(b[i])));
+                }
+            }
+            else if (b_step != 0)
+            {
+                const M x = Widen(a[0]);
+                #pragma omp simd
+                for (size_t i = 0; i < n; ++i)
+                {
+                    out[i] = Narrow<T>(Op::Apply(x, Widen(b[i])));
+                }
+            }
+            else if (a_step != 0)
+            {
+                const M y = Widen(b[0]);
+                #pragma omp simd
+                for (size_t i = 0; i < n; ++i)
+                {
+                    out[i] = Narrow<T>(Op::Apply(Widen(a[i]), y));
+                }
+            }
+            else
+            {
+                std::fill(out, out + n, Narrow<T>(Op::Apply(Widen(a[0]), Widen(b[0]))));
+            }
+        }
+
+        template<typename Op, typename T>
+        inline void UnaryLoop(const T* x, T* out, size_t n)
+        {
+            #pragma omp simd
+            for (size_t i = 0; i < n; ++i)
+            {
+                out[i] = Narrow<T>(Op::Apply(Widen(x[i])));
+            }
+        }
+
+        template<typename Op, typename T>
+        void BinaryLoopGeneric(const T* a, size_t a_step, const T* b, size_t b_step, T* out, size_t n)
+        {
+            BinaryLoop<Op>(a, a_step, b, b_step, out, n);
+        }
+
+        template<typename Op, typename T>
+        void UnaryLoopGeneric(const T* x, T* out, size_t n)
+        {
+            UnaryLoop<Op>(x, out, n);
+        }
+
+#ifdef GL_ELEMENTWISE_X86
+        template<typename Op, typename T>
+        GL_TARGET_AVX2 void BinaryLoopAvx2(const T* a, size_t a_step, const T* b, size_t b_step, T* out, size_t n)
+        {
+            BinaryLoop<Op>(a, a_step, b, b_step, out, n);
+        }
+
+        template<typename Op, typename T>
+        GL_TARGET_AVX2 void UnaryLoopAvx2(const T* x, T* out, size_t n)
+        {
+            UnaryLoop<Op>(x, out, n);
+        }
+
+        template<typename Op, typename T>
+        GL_TARGET_AVX512 void BinaryLoopAvx512(const T* a, size_t a_step, const T* b, size_t b_step, T* out, size_t n)
+        {
+            BinaryLoop<Op>(a, a_step, b, b_step, out, n);
+        }
+
+        template<typename Op, typename T>
+        GL_TARGET_AVX512 void UnaryLoopAvx512(const T* x, T* out, size_t n)
+        {
+            UnaryLoop<Op>(x, out, n);
+        }
+#endif
+
+        /**
+         * @param isa Highest instruction set level allowed
+         * @returns Fastest loop of Op requiring at most isa
+        */
+        template<typename Op, typename T>
+        BinaryLoopFn<T> BinaryLoopFor(CpuIsa isa)
+        {
+#ifdef GL_ELEMENTWISE_X86
+            if (isa >= CpuIsa::Avx512) return BinaryLoopAvx512<Op, T>;
+            if (isa >= CpuIsa::Avx2) return BinaryLoopAvx2<Op, T>;
+#endif
+            return BinaryLoopGeneric<Op, T>;
+        }
+
+        template<typename Op, typename T>
+        UnaryLoopFn<T> UnaryLoopFor(CpuIsa isa)
+        {
+#ifdef GL_ELEMENTWISE_X86
+            if (isa >= CpuIsa::Avx512) return UnaryLoopAvx512<Op, T>;
+            if (isa >= CpuIsa::Avx2) return UnaryLoopAvx2<Op, T>;
+#endif
+            return UnaryLoopGeneric<Op, T>;
+        }
+
+        /**
+         * @param n Elements of a row
+         * @returns Number of chunks a row is split into
+        */
+        inline size_t ChunksPerRow(size_t n)
+        {
+            return (n + kChunkElements - 1) / kChunkElements;
+        }
+
+        /**
+         * @param n Elements of a row
+         * @returns Min chunks per parallel_for range
+        */
+        inline size_t ChunkGrain(size_t n)
+        {
+            return std::max<size_t>(1, kMinParallelElements / std::min(n, kChunkElements));
+        }
+
+        // State of a binary kernel shared with its parallel_for
+        // ranges, captured by a single reference so the range
+        // function fits std::function without allocating
+        template<typename T>
+        struct BinaryJob
+        {
+            const BroadcastPlan& plan;
+            BinaryLoopFn<T> loop;
+            const T* a;
+            const T* b;
+            T* out;
+            size_t chunks_per_row;
+        };
+
+        template<typename T>
+        struct UnaryJob
+        {
+            UnaryLoopFn<T> loop;
+            const T* x;
+            T* out;
+            size_t n;
+        };
+
+        Status BroadcastShape(const ComputeContext& context, LayoutArray& shape)
+        {
+            return BroadcastPlan::OutputShape(context.input_shape(0), context.input_shape(1), shape);
+        }
+
+        Status SameShape(const ComputeContext& context, LayoutArray& shape)
+        {
+            shape = context.input_shape(0);
+            return Status::kOK;
+        }
+    }
+
+    /**
+     * Binary kernel on contiguous tensors with NumPy style
+     * broadcasting, using loops of at most instruction set isa
+    */
+    template<typename Op, typename T, CpuIsa isa>
+    class BinaryKernel : public OpKernel
+    {
+    public:
+        BinaryKernel(const OpKernelContext& context) :
+            OpKernel(context),
+            loop_(BinaryLoopFor<Op, T>(isa))
+        {
+
+        }
+
+        Status Compute(ComputeContext& context) override
+        {
+            const TensorBuffer& a = context.input(0);
+            const TensorBuffer& b = context.input(1);
+            TensorBuffer& out = context.output(0);
+
+            BroadcastPlan plan;
+            Status status = plan.Init(a.shape(), b.shape());
+            if (!status.ok()) return status;
+
+            const size_t n = plan.inner_size();
+            BinaryJob<T> job{plan, loop_,
+                a.Map<T>().data(), b.Map<T>().data(), out.Map<T>().data(),
+                ChunksPerRow(n)};
+
+            context.parallel_for(plan.outer_rows() * job.chunks_per_row, ChunkGrain(n),
+                [&job](size_t begin, size_t end) {
+                    const size_t n = job.plan.inner_size();
+                    const size_t a_step = job.plan.a_inner_step();
+                    const size_t b_step = job.plan.b_inner_step();
+                    for (size_t task = begin; task < end; ++task)
+                    {
+                        size_t row = task / job.chunks_per_row;
+                        size_t first = (task % job.chunks_per_row) * kChunkElements;
+                        size_t a_offset, b_offset;
+                        job.plan.RowOffsets(row, a_offset, b_offset);
+                        job.loop(job.a + a_offset + first * a_step, a_step,
+                            job.b + b_offset + first * b_step, b_step,
+                            job.out + row * n + first, std::min(kChunkElements, n - first));
+                    }
+                });
+            return Status::kOK;
+        }
+
+    private:
+        const BinaryLoopFn<T> loop_;
+    };
+
+    /**
+     * Unary kernel on contiguous tensors, using loops of
+     * at most instruction set isa
+    */
+    template<typename Op, typename T, CpuIsa isa>
+    class UnaryKernel : public OpKernel
+    {
+    public:
+        UnaryKernel(const OpKernelContext& context) :
+            OpKernel(context),
+            loop_(UnaryLoopFor<Op, T>(isa))
+        {
+
+        }
+
+        Status Compute(ComputeContext& context) override
+        {
+            const TensorBuffer& x = context.input(0);
+            TensorBuffer& out = context.output(0);
+
+            UnaryJob<T> job{loop_, x.Map<T>().data(), out.Map<T>().data(), x.size()};
+            context.parallel_for(ChunksPerRow(job.n), ChunkGrain(job.n),
+                [&job](size_t begin, size_t end) {
+                    size_t first = begin * kChunkElements;
+                    size_t last = std::min(end * kChunkElements, job.n);
+                    job.loop(job.x + first, job.out + first, last - first);
+                });
+            return Status::kOK;
+        }
+
+    private:
+        const UnaryLoopFn<T> loop_;
+    };
+
+    namespace
+    {
+        /**
+         * Registers the Float, Double and BFloat16 kernels 
+         * of an op at every instruction set level
+         *
+         * @param op_name Name of the op
+         * @param num_inputs Number of inputs of the op
+        */
+        template<template<typename, typename, CpuIsa> class Kernel, typename Op>
+        Initializer RegisterElementwiseKernels(const std::string& op_name, size_t num_inputs)
+        {
+            auto define = [&](auto builder, DataType dtype, CpuIsa isa) {
+                for (size_t i = 0; i < num_inputs; ++i)
+                {
+                    builder.Input(dtype);
+                }
+                builder.Output(dtype).Isa(isa).Build();
+            };
+
+            define(OpKernelDefBuilder<Kernel<Op, float, CpuIsa::Generic>>(op_name, "CPU"),
+                DataType::Float, CpuIsa::Generic);
+            define(OpKernelDefBuilder<Kernel<Op, float, CpuIsa::Avx2>>(op_name, "CPU"),
+                DataType::Float, CpuIsa::Avx2);
+            define(OpKernelDefBuilder<Kernel<Op, float, CpuIsa::Avx512>>(op_name, "CPU"),
+                DataType::Float, CpuIsa::Avx512);
+            define(OpKernelDefBuilder<Kernel<Op, double, CpuIsa::Generic>>(op_name, "CPU"),
+                DataType::Double, CpuIsa::Generic);
+            define(OpKernelDefBuilder<Kernel<Op, double, CpuIsa::Avx2>>(op_name, "CPU"),
+                DataType::Double, CpuIsa::Avx2);
+            define(OpKernelDefBuilder<Kernel<Op, double, CpuIsa::Avx512>>(op_name, "CPU"),
+                DataType::Double, CpuIsa::Avx512);
+            define(OpKernelDefBuilder<Kernel<Op, Bf16, CpuIsa::Generic>>(op_name, "CPU"),
+                DataType::BFloat16, CpuIsa::Generic);
+            define(OpKernelDefBuilder<Kernel<Op, Bf16, CpuIsa::Avx2>>(op_name, "CPU"),
+                DataType::BFloat16, CpuIsa::Avx2);
+            define(OpKernelDefBuilder<Kernel<Op, Bf16, CpuIsa::Avx512>>(op_name, "CPU"),
+                DataType::BFloat16, CpuIsa::Avx512);
+            return Initializer();
+        }
+    }
+
+    GL_REGISTER_OP("Add").Input().Input().Output(BroadcastShape).Build();
+    GL_REGISTER_OP("Sub").Input().Input().Output(BroadcastShape).Build();
+    GL_REGISTER_OP("Mul").Input().Input().Output(BroadcastShape).Build();
+    GL_REGISTER_OP("Div").Input().Input().Output(BroadcastShape).Build();
+    GL_REGISTER_OP("Max").Input().Input().Output(BroadcastShape).Build();
+    GL_REGISTER_OP("Min").Input().Input().Output(BroadcastShape).Build();
+
+    GL_REGISTER_OP("Relu").Input().Output(SameShape).Build();
+    GL_REGISTER_OP("Sigmoid").Input().Output(SameShape).Build();
+    GL_REGISTER_OP("Tanh").Input().Output(SameShape).Build();
+    GL_REGISTER_OP("Exp").Input().Output(SameShape).Build();
+    GL_REGISTER_OP("Log").Input().Output(SameShape).Build();
+
+    // registered after the ops above, ordered within this file
+    static Initializer register_elementwise_kernels[] = {
+        RegisterElementwiseKernels<BinaryKernel, AddOp>("Add", 2),
+        RegisterElementwiseKernels<BinaryKernel, SubOp>("Sub", 2),
+        RegisterElementwiseKernels<BinaryKernel, MulOp>("Mul", 2),
+        RegisterElementwiseKernels<BinaryKernel, DivOp>("Div", 2),
+        RegisterElementwiseKernels<BinaryKernel, MaxOp>("Max", 2),
+        RegisterElementwiseKernels<BinaryKernel, MinOp>("Min", 2),
+
+        RegisterElementwiseKernels<UnaryKernel, ReluOp>("Relu", 1),
+        RegisterElementwiseKernels<UnaryKernel, SigmoidOp>("Sigmoid", 1),
+        RegisterElementwiseKernels<UnaryKernel, TanhOp>("Tanh", 1),
+        RegisterElementwiseKernels<UnaryKernel, ExpOp>("Exp", 1),
+        RegisterElementwiseKernels<UnaryKernel, LogOp>("Log", 1),
+    };
+
+    GL_DEFINE_KERNEL_LIBRARY(elementwise);
+}
@@ -0,0 +1,394 @@
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+#include "kernels/gemm.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GL_GEMM_X86 1
+#include <immintrin.h>
+#define GL_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define GL_TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+
+namespace graphloom
+{
+    namespace
+    {
+        // Depth of a packed block. One A and one B strip of
+        // this depth fit in L1 while a micro-kernel runs
+        constexpr size_t kKc = 256;
+
+        // Columns of a packed B panel
+        constexpr size_t kNc = 4096;
+
+        // Micro-kernel strips of a parallel task along M and N.
+        // The task's A block stays in L2
+        constexpr size_t kTaskMStrips = 8;
+        constexpr size_t kTaskNStrips = 8;
+
+        // Products with less multiply-adds run on one thread
+        constexpr size_t kMinParallelWork = size_t(1) << 18;
+
+        // Largest register tile of any micro-kernel
+        constexpr size_t kMaxMr = 12;
+        constexpr size_t kMaxNr = 32;
+
+        template<typename T>
+        inline void StoreTile(const T* acc, size_t nr, T* c, size_t ldc,
+            size_t rows, size_t cols, bool accumulate)
+        {
+            for (size_t r = 0; r < rows; ++r)
+            {
+                for (size_t j = 0; j < cols; ++j)
+                {
+                    c[r * ldc + j] = accumulate ? c[r * ldc + j] + acc[r * nr + j] : acc[r * nr + j];
+                }
+            }
+        }
+
+        template<typename T>
+        void MicroKernelGeneric(size_t k, const T* a, const T* b, T* c, size_t ldc, bool accumulate)
+        {
+            constexpr size_t kMr = 4;
+            constexpr size_t kNr = 8;
+
+            T acc[kMr * kNr] = {};
+            for (size_t p = 0; p < k; ++p)
+            {
+                for (size_t r = 0; r < kMr; ++r)
+                {
+                    T av = a[p * kMr + r];
+                    for (size_t j = 0; j < kNr; ++j)
+                    {
+                        acc[r * kNr + j] += av * b[p * kNr + j];
+                    }
+                }
+            }
+            StoreTile(acc, kNr, c, ldc, kMr, kNr, accumulate);
+        }
+
+#ifdef GL_GEMM_X86
+        // Overloads select the intrinsic by element type
+        namespace avx2
+        {
+            GL_TARGET_AVX2 inline __m256 Zero(const float*) { return _mm256_setzero_ps(); }
+            GL_TARGET_AVX2 inline __m256d Zero(const double*) { return _mm256_setzero_pd(); }
+            GL_TARGET_AVX2 inline __m256 Load(const float* p) { return _mm256_loadu_ps(p); }
+            GL_TARGET_AVX2 inline __m256d Load(const double* p) { return _mm256_loadu_pd(p); }
+            GL_TARGET_AVX2 inline __m256 Broadcast(const float* p) { return _mm256_broadcast_ss(p); }
+            GL_TARGET_AVX2 inline __m256d Broadcast(const double* p) { return _mm256_broadcast_sd(p); }
+            GL_TARGET_AVX2 inline __m256 Fma(__m256 a, __m256 b, __m256 c) { return _mm256_fmadd_ps(a, b, c); }
+            GL_TARGET_AVX2 inline __m256d Fma(__m256d a, __m256d b, __m256d c) { return _mm256_fmadd_pd(a, b, c); }
+            GL_TARGET_AVX2 inline __m256 Add(__m256 a, __m256 b) { return _mm256_add_ps(a, b); }
+            GL_TARGET_AVX2 inline __m256d Add(__m256d a, __m256d b) { return _mm256_add_pd(a, b); }
+            GL_TARGET_AVX2 inline void Store(float* p, __m256 v) { _mm256_storeu_ps(p, v); }
+            GL_TARGET_AVX2 inline void Store(double* p, __m256d v) { _mm256_storeu_pd(p, v); }
+
+            // 6 x 2 vector tile, 12 accumulators of 16 registers
+            constexpr size_t kMr = 6;
+        }
+
+        template<typename T>
+        GL_TARGET_AVX2 void MicroKernelAvx2(size_t k, const T* a, const T* b, T* c, size_t ldc, bool accumulate)
+        {
+            using V = decltype(avx2::Load(b));
+            constexpr size_t kWidth = sizeof(V) / sizeof(T);
+            constexpr size_t kMr = avx2::kMr;
+            constexpr size_t kNr = 2 * kWidth;
+
+            V acc[kMr][2];
+            #pragma GCC unroll 16
+            for (size_t r = 0; r < kMr; ++r)
+            {
+                acc[r][0] = avx2::Zero(b);
+                acc[r][1] = avx2::Zero(b);
+            }
+
+            for (size_t p = 0; p < k; ++p)
+            {
+                V b0 = avx2::Load(b + p * kNr);
+                V b1 = avx2::Load(b + p * kNr + kWidth);
+                #pragma GCC unroll 16
+                for (size_t r = 0; r < kMr; ++r)
+                {
+                    V av = avx2::Broadcast(a + p * kMr + r);
+                    acc[r][0] = avx2::Fma(av, b0, acc[r][0]);
+                    acc[r][1] = avx2::Fma(av, b1, acc[r][1]);
+                }
+            }
+
+            #pragma GCC unroll 16
+            for (size_t r = 0; r < kMr; ++r)
+            {
+                T* row = c + r * ldc;
+                if (accumulate)
+                {
+                    acc[r][0] = avx2::Add(acc[r][0], avx2::Load(row));
+                    acc[r][1] = avx2::Add(acc[r][1], avx2::Load(row + kWidth));
+                }
+                avx2::Store(row, acc[r][0]);
+                avx2::Store(row + kWidth, acc[r][1]);
+            }
+        }
+
+        namespace avx512
+        {
+            GL_TARGET_AVX512 inline __m512 Zero(const float*) { return _mm512_setzero_ps(); }
+            GL_TARGET_AVX512 inline __m512d Zero(const double*) { return _mm512_setzero_pd(); }
+            GL_TARGET_AVX512 inline __m512 Load(const float* p) { return _mm512_loadu_ps(p); }
+            GL_TARGET_AVX512 inline __m512d Load(const double* p) { return _mm512_loadu_pd(p); }
+            GL_TARGET_AVX512 inline __m512 Broadcast(const float* p) { return _mm512_set1_ps(*p); }
+            GL_TARGET_AVX512 inline __m512d Broadcast(const double* p) { return _mm512_set1_pd(*p); }
+            GL_TARGET_AVX512 inline __m512 Fma(__m512 a, __m512 b, __m512 c) { return _mm512_fmadd_ps(a, b, c); }
+            GL_TARGET_AVX512 inline __m512d Fma(__m512d a, __m512d b, __m512d c) { return _mm512_fmadd_pd(a, b, c); }
+            GL_TARGET_AVX512 inline __m512 Add(__m512 a, __m512 b) { return _mm512_add_ps(a, b); }
+            GL_TARGET_AVX512 inline __m512d Add(__m512d a, __m512d b) { return _mm512_add_pd(a, b); }
+            GL_TARGET_AVX512 inline void Store(float* p, __m512 v) { _mm512_storeu_ps(p, v); }
+            GL_TARGET_AVX512 inline void Store(double* p, __m512d v) { _mm512_storeu_pd(p, v); }
+
+            // 12 x 2 vector tile, 24 accumulators of 32 registers
+            constexpr size_t kMr = 12;
+        }
+
+        template<typename T>
+        GL_TARGET_AVX512 void MicroKernelAvx512(size_t k, const T* a, const T* b, T* c, size_t ldc, bool accumulate)
+        {
+            using V = decltype(avx512::Load(b));
+            constexpr size_t kWidth = sizeof(V) / sizeof(T);
+            constexpr size_t kMr = avx512::kMr;
+            constexpr size_t kNr = 2 * kWidth;
+
+            V acc[kMr][2];
+            #pragma GCC unroll 16
+            for (size_t r = 0; r < kMr; ++r)
+            {
+                acc[r][0] = avx512::Zero(b);
+                acc[r][1] = avx512::Zero(b);
+            }
+
+            for (size_t p = 0; p < k; ++p)
+            {
+                V b0 = avx512::Load(b + p * kNr);
+                V b1 = avx512::Load(b + p * kNr + kWidth);
+                #pragma GCC unroll 16
+                for (size_t r = 0; r < kMr; ++r)
+                {
+                    V av = avx512::Broadcast(a + p * kMr + r);
+                    acc[r][0] = avx512::Fma(av, b0, acc[r][0]);
+                    acc[r][1] = avx512::Fma(av, b1, acc[r][1]);
+                }
+            }
+
+            #pragma GCC unroll 16
+            for (size_t r = 0; r < kMr; ++r)
+            {
+                T* row = c + r * ldc;
+                if (accumulate)
+                {
+                    acc[r][0] = avx512::Add(acc[r][0], avx512::Load(row));
+                    acc[r][1] = avx512::Add(acc[r][1], avx512::Load(row + kWidth));
+                }
+                avx512::Store(row, acc[r][0]);
+                avx512::Store(row + kWidth, acc[r][1]);
+            }
+        }
+#endif
+
+        /**
+         * Packs rows [i * mr, i * mr + mr) and columns [pc, pc + kc)
+         * of A into an mr tall strip, zero padded below m
+        */
+        template<typename T, typename S>
+        void PackA(const S* a, size_t lda, size_t m, size_t pc, size_t kc,
+            size_t mr, size_t i, T* dst)
+        {
+            for (size_t r = 0; r < mr; ++r)
+            {
+                size_t row = i * mr + r;
+                if (row < m)
+                {
+                    const S* src = a + row * lda + pc;
+                    for (size_t p = 0; p < kc; ++p)
+                    {
+                        dst[p * mr + r] = static_cast<T>(src[p]);
+                    }
+                }
+                else
+                {
+                    for (size_t p = 0; p < kc; ++p)
+                    {
+                        dst[p * mr + r] = T(0);
+                    }
+                }
+            }
+        }
+
+        /**
+         * Packs rows [pc, pc + kc) and columns [j * nr, j * nr + nr)
+         * of a B panel starting at column jc into an nr wide strip,
+         * zero padded right of n
+        */
+        template<typename T, typename S>
+        void PackB(const S* b, size_t ldb, size_t n, size_t jc, size_t pc, size_t kc,
+            size_t nr, size_t j, T* dst)
+        {
+            size_t col = jc + j * nr;
+            size_t cols = col < n ? std::min(nr, n - col) : 0;
+            for (size_t p = 0; p < kc; ++p)
+            {
+                const S* src = b + (pc + p) * ldb + col;
+                T* out = dst + p * nr;
+                if constexpr (std::is_same<S, T>::value)
+                {
+                    std::memcpy(out, src, cols * sizeof(T));
+                }
+                else
+                {
+                    for (size_t c = 0; c < cols; ++c)
+                    {
+                        out[c] = static_cast<T>(src[c]);
+                    }
+                }
+                for (size_t c = cols; c < nr; ++c)
+                {
+                    out[c] = T(0);
+                }
+            }
+        }
+
+        inline size_t DivUp(size_t x, size_t y)
+        {
+            return (x + y - 1) / y;
+        }
+    }
+
+    template<typename T>
+    GemmMicroKernel<T> GenericMicroKernel()
+    {
+        return GemmMicroKernel<T>{4, 8, MicroKernelGeneric<T>};
+    }
+
+    template<typename T>
+    GemmMicroKernel<T> MicroKernelFor(CpuIsa isa)
+    {
+#ifdef GL_GEMM_X86
+        if (isa >= CpuIsa::Avx512)
+        {
+            return GemmMicroKernel<T>{avx512::kMr, 128 / sizeof(T), MicroKernelAvx512<T>};
+        }
+        if (isa >= CpuIsa::Avx2)
+        {
+            return GemmMicroKernel<T>{avx2::kMr, 64 / sizeof(T), MicroKernelAvx2<T>};
+        }
+#endif
+        return GenericMicroKernel<T>();
+    }
+
+    template<typename T, typename S>
+    void Gemm(const GemmMicroKernel<T>& kernel, size_t m, size_t n, size_t k,
+        const S* a, size_t lda, const S* b, size_t ldb, T* c, size_t ldc,
+        const ComputeContext& context)
+    {
+        if (m == 0 || n == 0) return;
+        if (k == 0)
+        {
+            for (size_t i = 0; i < m; ++i)
+            {
+                std::fill(c + i * ldc, c + i * ldc + n, T(0));
+            }
+            return;
+        }
+
+        const size_t mr = kernel.mr;
+        const size_t nr = kernel.nr;
+        const size_t m_strips = DivUp(m, mr);
+        const size_t kc_max = std::min(k, kKc);
+        const size_t nc_max = std::min(n, kNc);
+
+        T* packed_a = static_cast<T*>(context.scratch(m_strips * mr * kc_max * sizeof(T)));
+        T* packed_b = static_cast<T*>(context.scratch(DivUp(nc_max, nr) * nr * kc_max * sizeof(T)));
+
+        // small products are not worth waking threads for
+        bool parallel = m * n >= kMinParallelWork / std::min(k, kMinParallelWork);
+        auto grain = [parallel](size_t count) { return parallel ? 1 : count; };
+
+        for (size_t jc = 0; jc < n; jc += kNc)
+        {
+            const size_t nc = std::min(kNc, n - jc);
+            const size_t n_strips = DivUp(nc, nr);
+            const size_t m_blocks = DivUp(m_strips, kTaskMStrips);
+            const size_t n_blocks = DivUp(n_strips, kTaskNStrips);
+
+            for (size_t pc = 0; pc < k; pc += kKc)
+            {
+                const size_t kc = std::min(kKc, k - pc);
+                const bool accumulate = pc > 0;
+
+                context.parallel_for(n_strips, grain(n_strips), [&](size_t begin, size_t end) {
+                    for (size_t j = begin; j < end; ++j)
+                    {
+                        PackB(b, ldb, n, jc, pc, kc, nr, j, packed_b + j * nr * kc);
+                    }
+                });
+
+                context.parallel_for(m_strips, grain(m_strips), [&](size_t begin, size_t end) {
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        PackA(a, lda, m, pc, kc, mr, i, packed_a + i * mr * kc);
+                    }
+                });
+
+                size_t num_tasks = m_blocks * n_blocks;
+                context.parallel_for(num_tasks, grain(num_tasks), [&](size_t begin, size_t end) {
+                    alignas(64) T edge[kMaxMr * kMaxNr];
+                    for (size_t task = begin; task < end; ++task)
+                    {
+                        size_t mb = task / n_blocks;
+                        size_t nb = task % n_blocks;
+                        size_t j_end = std::min(n_strips, (nb + 1) * kTaskNStrips);
+                        size_t i_end = std::min(m_strips, (mb + 1) * kTaskMStrips);
+
+                        // B strip stays in L1 while the A block streams from L2
+                        for (size_t j = nb * kTaskNStrips; j < j_end; ++j)
+                        {
+                            const T* b_strip = packed_b + j * nr * kc;
+                            size_t col = jc + j * nr;
+                            size_t cols = std::min(nr, n - col);
+
+                            for (size_t i = mb * kTaskMStrips; i < i_end; ++i)
+                            {
+                                const T* a_strip = packed_a + i * mr * kc;
+                                size_t row = i * mr;
+                                size_t rows = std::min(mr, m - row);
+                                T* c_tile = c + row * ldc + col;
+
+                                if (rows == mr && cols == nr)
+                                {
+                                    kernel.fn(kc, a_strip, b_strip, c_tile, ldc, accumulate);
+                                }
+                                else
+                                {
+                                    kernel.fn(kc, a_strip, b_strip, edge, nr, false);
+                                    StoreTile(edge, nr, c_tile, ldc, rows, cols, accumulate);
+                                }
+                            }
+                        }
+                    }
+                });
+            }
+        }
+    }
+
+    template GemmMicroKernel<float> GenericMicroKernel<float>();
+    template GemmMicroKernel<double> GenericMicroKernel<double>();
+    template GemmMicroKernel<float> MicroKernelFor<float>(CpuIsa);
+    template GemmMicroKernel<double> MicroKernelFor<double>(CpuIsa);
+
+    template void Gemm<float>(const GemmMicroKernel<float>&, size_t, size_t, size_t,
+        const float*, size_t, const float*, size_t, float*, size_t, const ComputeContext&);
+    template void Gemm<double>(const GemmMicroKernel<double>&, size_t, size_t, size_t,
+        const double*, size_t, const double*, size_t, double*, size_t, const ComputeContext&);
+    template void Gemm<float, Bf16>(const GemmMicroKernel<float>&, size_t, size_t, size_t,
+        const Bf16*, size_t, const Bf16*, size_t, float*, size_t, const ComputeContext&);
+}
@@ -0,0 +1,78 @@
+#ifndef GRAPHLOOM_KERNELS_GEMM_H_
+#define GRAPHLOOM_KERNELS_GEMM_H_
+
+#include <cstddef>
+
+#include "graphloom/common/half.h"
+#include "graphloom/device/cpu_isa.h"
+#include "graphloom/graph/graph_context.h"
+
+/**
+ * This module defines the blocked general matrix multiply
+ * used by MatMul. Operands are split into cache sized
+ * blocks: a KC x NC panel of B is packed into NR wide
+ * strips that stay in L3/L2, A is packed into MR tall
+ * strips, and a register blocked MR x NR micro-kernel
+ * computes every tile of C from the packed strips. Tiles
+ * of C are computed in parallel over M and N. Operands of
+ * a narrower type, ex. Bf16, are widened while packed so
+ * the micro-kernels only see T.
+*/
+
+namespace graphloom
+{
+    /**
+     * Register blocked inner kernel of Gemm.
+     *
+     * fn computes the mr x nr tile C = A * B, or C += A * B
+     * if accumulate is set, where A is a packed mr x k strip
+     * (mr values per k) and B a packed k x nr strip
+     * (nr values per k). C is row major with ldc.
+    */
+    template<typename T>
+    struct GemmMicroKernel
+    {
+        size_t mr;
+        size_t nr;
+        void (*fn)(size_t k, const T* a, const T* b, T* c, size_t ldc, bool accumulate);
+    };
+
+    /**
+     * @returns Portable micro-kernel, runs on any CPU
+    */
+    template<typename T>
+    GemmMicroKernel<T> GenericMicroKernel();
+
+    /**
+     * @param isa Highest instruction set level allowed
+     * @returns Fastest micro-kernel requiring at most isa
+    */
+    template<typename T>
+    GemmMicroKernel<T> MicroKernelFor(CpuIsa isa);
+
+    /**
+     * Computes C = A * B for row major A (m x k), B (k x n)
+     * and C (m x n). Packing buffers come from the context's
+     * scratch memory and tiles run on its parallel_for.
+     *
+     * @param T Type of C and of the micro-kernel math
+     * @param S Type of A and B, converted to T when packed
+     * @param kernel Micro-kernel computing the tiles
+     * @param m Rows of A and C
+     * @param n Columns of B and C
+     * @param k Columns of A and rows of B
+     * @param a A matrix
+     * @param lda Row stride of A in elements
+     * @param b B matrix
+     * @param ldb Row stride of B in elements
+     * @param c Returned C matrix
+     * @param ldc Row stride of C in elements
+     * @param context Context of the calling kernel
+    */
+    template<typename T, typename S = T>
+    void Gemm(const GemmMicroKernel<T>& kernel, size_t m, size_t n, size_t k,
+        const S* a, size_t lda, const S* b, size_t ldb, T* c, size_t ldc,
+        const ComputeContext& context);
+}
+
+#endif
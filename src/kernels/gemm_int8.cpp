@@ -0,0 +1,478 @@
+#include <algorithm>
+#include <cstring>
+
+#include "graphloom/tensor/quantization.h"
+#include "kernels/gemm_int8.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GL_GEMM_INT8_X86 1
+#include <immintrin.h>
+#define GL_TARGET_AVX2 __attribute__((target("avx2")))
+#define GL_TARGET_AVX512_VNNI __attribute__((target("avx512f,avx512vnni")))
+#endif
+
+namespace graphloom
+{
+    namespace
+    {
+        // Depth of a packed block, a multiple of kGemmInt8KGroup.
+        // Bytes are 4 times smaller than floats, so the strips
+        // of a block twice as deep as Gemm's still fit in L1
+        constexpr size_t kKc = 512;
+
+        // Columns of a packed B panel
+        constexpr size_t kNc = 4096;
+
+        // Micro-kernel strips of a parallel task along M and N
+        constexpr size_t kTaskMStrips = 8;
+        constexpr size_t kTaskNStrips = 8;
+
+        // Products with less multiply-adds run on one thread
+        constexpr size_t kMinParallelWork = size_t(1) << 18;
+
+        // Largest register tile of any micro-kernel
+        constexpr size_t kMaxMr = 12;
+        constexpr size_t kMaxNr = 32;
+
+        constexpr size_t kG = kGemmInt8KGroup;
+
+        inline void StoreTile(const int32_t* acc, size_t nr, int32_t* c, size_t ldc,
+            size_t rows, size_t cols, bool accumulate)
+        {
+            for (size_t r = 0; r < rows; ++r)
+            {
+                for (size_t j = 0; j < cols; ++j)
+                {
+                    c[r * ldc + j] = accumulate ? c[r * ldc + j] + acc[r * nr + j] : acc[r * nr + j];
+                }
+            }
+        }
+
+        void MicroKernelGeneric(size_t k_groups, const uint8_t* a, const int8_t* b,
+            int32_t* c, size_t ldc, bool accumulate)
+        {
+            constexpr size_t kMr = 4;
+            constexpr size_t kNr = 8;
+
+            int32_t acc[kMr * kNr] = {};
+            for (size_t g = 0; g < k_groups; ++g)
+            {
+                const uint8_t* a_group = a + g * kMr * kG;
+                const int8_t* b_group = b + g * kNr * kG;
+                for (size_t r = 0; r < kMr; ++r)
+                {
+                    for (size_t j = 0; j < kNr; ++j)
+                    {
+                        int32_t sum = 0;
+                        for (size_t q = 0; q < kG; ++q)
+                        {
+                            sum += static_cast<int32_t>(a_group[r * kG + q]) *
+                                static_cast<int32_t>(b_group[j * kG + q]);
+                        }
+                        acc[r * kNr + j] += sum;
+                    }
+                }
+            }
+            StoreTile(acc, kNr, c, ldc, kMr, kNr, accumulate);
+        }
+
+#ifdef GL_GEMM_INT8_X86
+        /**
+         * AVX2 has no byte dot product that cannot saturate,
+         * vpmaddubsw sums two u8 x s8 products into int16.
+         * Bytes are widened to int16 instead and vpmaddwd
+         * sums pairs of products into int32, leaving two
+         * partial sums per column that are added on store.
+        */
+        GL_TARGET_AVX2 void MicroKernelAvx2(size_t k_groups, const uint8_t* a, const int8_t* b,
+            int32_t* c, size_t ldc, bool accumulate)
+        {
+            // 6 x 2 vector tile, 12 accumulators of 16 registers
+            constexpr size_t kMr = 6;
+            constexpr size_t kNr = 8;
+
+            __m256i acc[kMr][2];
+            #pragma GCC unroll 16
+            for (size_t r = 0; r < kMr; ++r)
+            {
+                acc[r][0] = _mm256_setzero_si256();
+                acc[r][1] = _mm256_setzero_si256();
+            }
+
+            for (size_t g = 0; g < k_groups; ++g)
+            {
+                const int8_t* b_group = b + g * kNr * kG;
+                __m256i b0 = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b_group)));
+                __m256i b1 = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b_group + 16)));
+                #pragma GCC unroll 16
+                for (size_t r = 0; r < kMr; ++r)
+                {
+                    int32_t a_bytes;
+                    std::memcpy(&a_bytes, a + (g * kMr + r) * kG, sizeof(a_bytes));
+                    __m256i av = _mm256_cvtepu8_epi16(_mm_set1_epi32(a_bytes));
+                    acc[r][0] = _mm256_add_epi32(acc[r][0], _mm256_madd_epi16(av, b0));
+                    acc[r][1] = _mm256_add_epi32(acc[r][1], _mm256_madd_epi16(av, b1));
+                }
+            }
+
+            #pragma GCC unroll 16
+            for (size_t r = 0; r < kMr; ++r)
+            {
+                // columns 0 1 4 5 2 3 6 7 after the pairwise add
+                __m256i sums = _mm256_hadd_epi32(acc[r][0], acc[r][1]);
+                sums = _mm256_permute4x64_epi64(sums, 0xD8);
+
+                __m256i* row = reinterpret_cast<__m256i*>(c + r * ldc);
+                if (accumulate)
+                {
+                    sums = _mm256_add_epi32(sums, _mm256_loadu_si256(row));
+                }
+                _mm256_storeu_si256(row, sums);
+            }
+        }
+
+        /**
+         * vpdpbusd multiplies 4 unsigned bytes of A with 4
+         * signed bytes of B and adds the sum to each int32
+         * lane, a whole group of K per instruction
+        */
+        GL_TARGET_AVX512_VNNI void MicroKernelAvx512Vnni(size_t k_groups, const uint8_t* a,
+            const int8_t* b, int32_t* c, size_t ldc, bool accumulate)
+        {
+            // 12 x 2 vector tile, 24 accumulators of 32 registers
+            constexpr size_t kMr = 12;
+            constexpr size_t kNr = 32;
+
+            __m512i acc[kMr][2];
+            #pragma GCC unroll 16
+            for (size_t r = 0; r < kMr; ++r)
+            {
+                acc[r][0] = _mm512_setzero_si512();
+                acc[r][1] = _mm512_setzero_si512();
+            }
+
+            for (size_t g = 0; g < k_groups; ++g)
+            {
+                const int8_t* b_group = b + g * kNr * kG;
+                __m512i b0 = _mm512_loadu_si512(b_group);
+                __m512i b1 = _mm512_loadu_si512(b_group + 64);
+                #pragma GCC unroll 16
+                for (size_t r = 0; r < kMr; ++r)
+                {
+                    int32_t a_bytes;
+                    std::memcpy(&a_bytes, a + (g * kMr + r) * kG, sizeof(a_bytes));
+                    __m512i av = _mm512_set1_epi32(a_bytes);
+                    acc[r][0] = _mm512_dpbusd_epi32(acc[r][0], av, b0);
+                    acc[r][1] = _mm512_dpbusd_epi32(acc[r][1], av, b1);
+                }
+            }
+
+            #pragma GCC unroll 16
+            for (size_t r = 0; r < kMr; ++r)
+            {
+                int32_t* row = c + r * ldc;
+                if (accumulate)
+                {
+                    acc[r][0] = _mm512_add_epi32(acc[r][0], _mm512_loadu_si512(row));
+                    acc[r][1] = _mm512_add_epi32(acc[r][1], _mm512_loadu_si512(row + 16));
+                }
+                _mm512_storeu_si512(row, acc[r][0]);
+                _mm512_storeu_si512(row + 16, acc[r][1]);
+            }
+        }
+#endif
+
+        inline size_t DivUp(size_t x, size_t y)
+        {
+            return (x + y - 1) / y;
+        }
+
+        /**
+         * Packs rows [i * mr, i * mr + mr) and columns [pc, pc + kc)
+         * of A into an mr tall strip of groups, offset by 128 into
+         * unsigned bytes. Padding below m and right of kc is 0 + 128
+        */
+        void PackA(const int8_t* a, size_t lda, size_t m, size_t pc, size_t kc,
+            size_t mr, size_t i, uint8_t* dst)
+        {
+            size_t k_padded = DivUp(kc, kG) * kG;
+            for (size_t r = 0; r < mr; ++r)
+            {
+                size_t row = i * mr + r;
+                const int8_t* src = row < m ? a + row * lda + pc : nullptr;
+                for (size_t p = 0; p < k_padded; ++p)
+                {
+                    int8_t value = src != nullptr && p < kc ? src[p] : 0;
+                    dst[((p / kG) * mr + r) * kG + p % kG] = static_cast<uint8_t>(value) ^ 0x80;
+                }
+            }
+        }
+
+        /**
+         * Packs rows [pc, pc + kc) and columns [j * nr, j * nr + nr)
+         * of a B panel starting at column jc into an nr wide strip
+         * of groups, zero padded right of n and below kc
+        */
+        void PackB(const int8_t* b, size_t ldb, size_t n, size_t jc, size_t pc, size_t kc,
+            size_t nr, size_t j, int8_t* dst)
+        {
+            size_t col = jc + j * nr;
+            size_t cols = col < n ? std::min(nr, n - col) : 0;
+            size_t k_padded = DivUp(kc, kG) * kG;
+            for (size_t p = 0; p < k_padded; ++p)
+            {
+                const int8_t* src = b + (pc + std::min(p, kc - 1)) * ldb + col;
+                size_t valid = p < kc ? cols : 0;
+                int8_t* out = dst + (p / kG) * nr * kG + p % kG;
+                for (size_t c = 0; c < nr; ++c)
+                {
+                    out[c * kG] = c < valid ? src[c] : 0;
+                }
+            }
+        }
+
+        // Corrections and scales of the output stage, per column of C
+        struct OutputStage
+        {
+            const GemmInt8Output* out;
+            int32_t* acc;           // int32 C
+            size_t ld_acc;
+
+            // k * a_zero_point * b_zero_point - (128 + a_zero_point) * column sum of B
+            const int32_t* col_terms;
+
+            // row sums of A, nullptr if B has no zero points
+            const int32_t* row_sums;
+
+            // a_scale * b_scale, divided by the output scale for Int8
+            const float* multipliers;
+        };
+
+        /**
+         * Converts the tile at row, col of the int32 accumulators
+         * into the output once its accumulation is complete
+        */
+        void ApplyOutputStage(const OutputStage& stage, size_t row, size_t col,
+            size_t rows, size_t cols)
+        {
+            const GemmInt8Output& out = *stage.out;
+            for (size_t r = row; r < row + rows; ++r)
+            {
+                int32_t* acc = stage.acc + r * stage.ld_acc;
+                for (size_t j = col; j < col + cols; ++j)
+                {
+                    acc[j] += stage.col_terms[j];
+                }
+                if (stage.row_sums != nullptr)
+                {
+                    for (size_t j = col; j < col + cols; ++j)
+                    {
+                        acc[j] -= out.b_zero_points[out.b_per_channel ? j : 0] * stage.row_sums[r];
+                    }
+                }
+
+                if (out.dtype == DataType::Float)
+                {
+                    float* dst = static_cast<float*>(out.data) + r * out.ldc;
+                    for (size_t j = col; j < col + cols; ++j)
+                    {
+                        dst[j] = static_cast<float>(acc[j]) * stage.multipliers[j];
+                    }
+                }
+                else if (out.dtype == DataType::Int8)
+                {
+                    int8_t* dst = static_cast<int8_t*>(out.data) + r * out.ldc;
+                    for (size_t j = col; j < col + cols; ++j)
+                    {
+                        dst[j] = QuantizeValue(static_cast<float>(acc[j]),
+                            stage.multipliers[j], out.zero_point);
+                    }
+                }
+            }
+        }
+    }
+
+    GemmInt8MicroKernel GenericInt8MicroKernel()
+    {
+        return GemmInt8MicroKernel{4, 8, MicroKernelGeneric};
+    }
+
+    GemmInt8MicroKernel Int8MicroKernelFor(CpuIsa isa)
+    {
+#ifdef GL_GEMM_INT8_X86
+        if (isa >= CpuIsa::Avx512Vnni)
+        {
+            return GemmInt8MicroKernel{12, 32, MicroKernelAvx512Vnni};
+        }
+
+        // AVX-512 without VNNI has the same saturation
+        // problem as AVX2, the AVX2 kernel serves it
+        if (isa >= CpuIsa::Avx2)
+        {
+            return GemmInt8MicroKernel{6, 8, MicroKernelAvx2};
+        }
+#endif
+        return GenericInt8MicroKernel();
+    }
+
+    void GemmInt8(const GemmInt8MicroKernel& kernel, size_t m, size_t n, size_t k,
+        const int8_t* a, size_t lda, const int8_t* b, size_t ldb,
+        const GemmInt8Output& out, const ComputeContext& context)
+    {
+        if (m == 0 || n == 0) return;
+
+        // accumulate in the output if it is int32
+        OutputStage stage;
+        stage.out = &out;
+        if (out.dtype == DataType::Int32)
+        {
+            stage.acc = static_cast<int32_t*>(out.data);
+            stage.ld_acc = out.ldc;
+        }
+        else
+        {
+            stage.acc = static_cast<int32_t*>(context.scratch(m * n * sizeof(int32_t)));
+            stage.ld_acc = n;
+        }
+
+        bool b_zero_points = false;
+        for (size_t j = 0; j < (out.b_per_channel ? n : 1); ++j)
+        {
+            b_zero_points |= out.b_zero_points[j] != 0;
+        }
+
+        // sums of the operands remove the offset of A and the zero points
+        int32_t* col_terms = static_cast<int32_t*>(context.scratch(n * sizeof(int32_t)));
+        float* multipliers = static_cast<float*>(context.scratch(n * sizeof(float)));
+        std::fill(col_terms, col_terms + n, 0);
+        for (size_t p = 0; p < k; ++p)
+        {
+            const int8_t* row = b + p * ldb;
+            for (size_t j = 0; j < n; ++j)
+            {
+                col_terms[j] += row[j];
+            }
+        }
+        for (size_t j = 0; j < n; ++j)
+        {
+            size_t channel = out.b_per_channel ? j : 0;
+            int32_t b_zero_point = out.b_zero_points[channel];
+            col_terms[j] = static_cast<int32_t>(k) * out.a_zero_point * b_zero_point -
+                (128 + out.a_zero_point) * col_terms[j];
+
+            multipliers[j] = out.a_scale * out.b_scales[channel];
+            if (out.dtype == DataType::Int8) multipliers[j] /= out.scale;
+        }
+        stage.col_terms = col_terms;
+        stage.multipliers = multipliers;
+
+        stage.row_sums = nullptr;
+        if (b_zero_points)
+        {
+            int32_t* row_sums = static_cast<int32_t*>(context.scratch(m * sizeof(int32_t)));
+            for (size_t i = 0; i < m; ++i)
+            {
+                int32_t sum = 0;
+                for (size_t p = 0; p < k; ++p)
+                {
+                    sum += a[i * lda + p];
+                }
+                row_sums[i] = sum;
+            }
+            stage.row_sums = row_sums;
+        }
+
+        if (k == 0)
+        {
+            for (size_t i = 0; i < m; ++i)
+            {
+                std::fill(stage.acc + i * stage.ld_acc, stage.acc + i * stage.ld_acc + n, 0);
+            }
+            ApplyOutputStage(stage, 0, 0, m, n);
+            return;
+        }
+
+        const size_t mr = kernel.mr;
+        const size_t nr = kernel.nr;
+        const size_t m_strips = DivUp(m, mr);
+        const size_t kc_max = DivUp(std::min(k, kKc), kG) * kG;
+        const size_t nc_max = std::min(n, kNc);
+
+        uint8_t* packed_a = static_cast<uint8_t*>(context.scratch(m_strips * mr * kc_max));
+        int8_t* packed_b = static_cast<int8_t*>(context.scratch(DivUp(nc_max, nr) * nr * kc_max));
+
+        // small products are not worth waking threads for
+        bool parallel = m * n >= kMinParallelWork / std::min(k, kMinParallelWork);
+        auto grain = [parallel](size_t count) { return parallel ? 1 : count; };
+
+        for (size_t jc = 0; jc < n; jc += kNc)
+        {
+            const size_t nc = std::min(kNc, n - jc);
+            const size_t n_strips = DivUp(nc, nr);
+            const size_t m_blocks = DivUp(m_strips, kTaskMStrips);
+            const size_t n_blocks = DivUp(n_strips, kTaskNStrips);
+
+            for (size_t pc = 0; pc < k; pc += kKc)
+            {
+                const size_t kc = std::min(kKc, k - pc);
+                const size_t k_groups = DivUp(kc, kG);
+                const bool accumulate = pc > 0;
+                const bool last = pc + kc == k;
+
+                context.parallel_for(n_strips, grain(n_strips), [&](size_t begin, size_t end) {
+                    for (size_t j = begin; j < end; ++j)
+                    {
+                        PackB(b, ldb, n, jc, pc, kc, nr, j, packed_b + j * nr * k_groups * kG);
+                    }
+                });
+
+                context.parallel_for(m_strips, grain(m_strips), [&](size_t begin, size_t end) {
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        PackA(a, lda, m, pc, kc, mr, i, packed_a + i * mr * k_groups * kG);
+                    }
+                });
+
+                size_t num_tasks = m_blocks * n_blocks;
+                context.parallel_for(num_tasks, grain(num_tasks), [&](size_t begin, size_t end) {
+                    alignas(64) int32_t edge[kMaxMr * kMaxNr];
+                    for (size_t task = begin; task < end; ++task)
+                    {
+                        size_t mb = task / n_blocks;
+                        size_t nb = task % n_blocks;
+                        size_t j_end = std::min(n_strips, (nb + 1) * kTaskNStrips);
+                        size_t i_end = std::min(m_strips, (mb + 1) * kTaskMStrips);
+
+                        for (size_t j = nb * kTaskNStrips; j < j_end; ++j)
+                        {
+                            const int8_t* b_strip = packed_b + j * nr * k_groups * kG;
+                            size_t col = jc + j * nr;
+                            size_t cols = std::min(nr, n - col);
+
+                            for (size_t i = mb * kTaskMStrips; i < i_end; ++i)
+                            {
+                                const uint8_t* a_strip = packed_a + i * mr * k_groups * kG;
+                                size_t row = i * mr;
+                                size_t rows = std::min(mr, m - row);
+                                int32_t* c_tile = stage.acc + row * stage.ld_acc + col;
+
+                                if (rows == mr && cols == nr)
+                                {
+                                    kernel.fn(k_groups, a_strip, b_strip, c_tile, stage.ld_acc, accumulate);
+                                }
+                                else
+                                {
+                                    kernel.fn(k_groups, a_strip, b_strip, edge, nr, false);
+                                    StoreTile(edge, nr, c_tile, stage.ld_acc, rows, cols, accumulate);
+                                }
+
+                                // the tile is still in cache
+                                if (last) ApplyOutputStage(stage, row, col, rows, cols);
+                            }
+                        }
+                    }
+                });
+            }
+        }
+    }
+}
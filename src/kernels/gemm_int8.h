@@ -0,0 +1,106 @@
+#ifndef GRAPHLOOM_KERNELS_GEMM_INT8_H_
+#define GRAPHLOOM_KERNELS_GEMM_INT8_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "graphloom/common/data_type.h"
+#include "graphloom/device/cpu_isa.h"
+#include "graphloom/graph/graph_context.h"
+
+/**
+ * This module defines the blocked int8 matrix multiply
+ * used by the quantized MatMul kernels. It is blocked
+ * like Gemm, see kernels/gemm.h, with packed strips that
+ * hold 4 consecutive values of K per row or column, the
+ * operand of one vpdpbusd. A is offset by 128 into
+ * unsigned bytes while packed, the offset and the zero
+ * points are removed with row and column sums of the
+ * operands once the int32 accumulation of a tile is
+ * complete. The same output stage then converts the tile
+ * to the output type.
+*/
+
+namespace graphloom
+{
+    // Values of K a packed strip holds per row or column
+    constexpr size_t kGemmInt8KGroup = 4;
+
+    /**
+     * Register blocked inner kernel of GemmInt8.
+     *
+     * fn computes the mr x nr int32 tile C = A * B, or
+     * C += A * B if accumulate is set, from k_groups groups
+     * of kGemmInt8KGroup values of K. A is a packed strip
+     * of unsigned bytes, mr x kGemmInt8KGroup per group,
+     * B a packed strip of signed bytes, nr x kGemmInt8KGroup
+     * per group. C is row major with ldc.
+    */
+    struct GemmInt8MicroKernel
+    {
+        size_t mr;
+        size_t nr;
+        void (*fn)(size_t k_groups, const uint8_t* a, const int8_t* b,
+            int32_t* c, size_t ldc, bool accumulate);
+    };
+
+    /**
+     * @returns Portable micro-kernel, runs on any CPU
+    */
+    GemmInt8MicroKernel GenericInt8MicroKernel();
+
+    /**
+     * @param isa Highest instruction set level allowed
+     * @returns Fastest micro-kernel requiring at most isa
+    */
+    GemmInt8MicroKernel Int8MicroKernelFor(CpuIsa isa);
+
+    /**
+     * Quantization of the operands of GemmInt8 and the
+     * type its output stage writes
+    */
+    struct GemmInt8Output
+    {
+        // Int32 accumulators without zero points, Float
+        // real values or Int8 requantized values
+        DataType dtype;
+        void* data;
+        size_t ldc;
+
+        float a_scale;
+        int32_t a_zero_point;
+
+        // one per column of B if b_per_channel, else one
+        const float* b_scales;
+        const int32_t* b_zero_points;
+        bool b_per_channel;
+
+        // quantization of an Int8 output
+        float scale;
+        int32_t zero_point;
+    };
+
+    /**
+     * Computes C = (A - a_zero_point) * (B - b_zero_points)
+     * for row major int8 A (m x k) and B (k x n) and writes
+     * it as out.dtype. Packing buffers and the accumulators
+     * of a non Int32 output come from the context's scratch
+     * memory, tiles run on its parallel_for.
+     *
+     * @param kernel Micro-kernel computing the tiles
+     * @param m Rows of A and C
+     * @param n Columns of B and C
+     * @param k Columns of A and rows of B
+     * @param a A matrix
+     * @param lda Row stride of A in elements
+     * @param b B matrix
+     * @param ldb Row stride of B in elements
+     * @param out Returned C matrix and the quantization
+     * @param context Context of the calling kernel
+    */
+    void GemmInt8(const GemmInt8MicroKernel& kernel, size_t m, size_t n, size_t k,
+        const int8_t* a, size_t lda, const int8_t* b, size_t ldb,
+        const GemmInt8Output& out, const ComputeContext& context);
+}
+
+#endif
@@ -0,0 +1,258 @@
+#include <memory>
+
+#include "graphloom/kernels/matmul.h"
+#include "graphloom/op/op.h"
+#include "graphloom/tensor/quantization.h"
+
+#include "kernels/gemm.h"
+#include "kernels/gemm_int8.h"
+
+namespace graphloom
+{
+    namespace
+    {
+        Status MatMulShape(const ComputeContext& context, LayoutArray& shape)
+        {
+            const LayoutArray& a = context.input_shape(0);
+            const LayoutArray& b = context.input_shape(1);
+            if (a.rank() != 2 || b.rank() != 2)
+            {
+                return Status(1, "MatMul expects rank 2 inputs, got rank ", 
+                    a.rank(), " and ", b.rank());
+            }
+            if (a[1] != b[0])
+            {
+                return Status(2, "MatMul inner dimensions mismatched, ", a[1], " != ", b[0]);
+            }
+
+            shape = {a[0], b[1]};
+            return Status::kOK;
+        }
+    }
+
+    /**
+     * MatMul kernel on row major tensors, using the 
+     * fastest micro-kernel of at most instruction set isa.
+     * Inputs of type S are widened to T, the output type.
+    */
+    template<typename T, CpuIsa isa, typename S = T>
+    class MatMulKernel : public OpKernel
+    {
+    public:
+        MatMulKernel(const OpKernelContext& context) : 
+            OpKernel(context),
+            micro_kernel_(MicroKernelFor<T>(isa))
+        {
+
+        }
+
+        Status Compute(ComputeContext& context) override
+        {
+            const TensorBuffer& a = context.input(0);
+            const TensorBuffer& b = context.input(1);
+            TensorBuffer& c = context.output(0);
+
+            size_t m = a.shape()[0];
+            size_t k = a.shape()[1];
+            size_t n = b.shape()[1];
+            Gemm(micro_kernel_, m, n, k, 
+                a.Map<S>().data(), k, 
+                b.Map<S>().data(), n, 
+                c.Map<T>().data(), n, context);
+            return Status::kOK;
+        }
+
+    private:
+        const GemmMicroKernel<T> micro_kernel_;
+    };
+
+    /**
+     * MatMul kernel on row major quantized Int8 tensors, 
+     * using the fastest micro-kernel of at most instruction 
+     * set isa. T is int32_t for the accumulators without zero 
+     * points, float for real values or int8_t for values 
+     * requantized with the node's "out_scale" and 
+     * "out_zero_point" attributes. Inputs without parameters 
+     * are plain integers, scale 1 and zero point 0.
+    */
+    template<typename T, DataType dtype, CpuIsa isa>
+    class QuantizedMatMulKernel : public OpKernel
+    {
+    public:
+        QuantizedMatMulKernel(const OpKernelContext& context) : 
+            OpKernel(context),
+            micro_kernel_(Int8MicroKernelFor(isa))
+        {
+            if constexpr (dtype == DataType::Int8)
+            {
+                out_params_ = std::make_shared<const QuantParams>(QuantParams::PerTensor(
+                    context.GetFloatAttr("out_scale"), context.GetInt32Attr("out_zero_point")));
+            }
+        }
+
+        Status Compute(ComputeContext& context) override
+        {
+            static const float kScale = 1.0f;
+            static const int32_t kZeroPoint = 0;
+
+            const TensorBuffer& a = context.input(0);
+            const TensorBuffer& b = context.input(1);
+            TensorBuffer& c = context.output(0);
+
+            const QuantParams* a_params = a.quant_params();
+            const QuantParams* b_params = b.quant_params();
+            if (a_params != nullptr && a_params->per_channel())
+            {
+                return Status(1, "MatMul expects per tensor quantization of A");
+            }
+            if (b_params != nullptr && b_params->per_channel() && b_params->axis() != 1)
+            {
+                return Status(2, "MatMul expects per channel quantization of B along axis 1");
+            }
+            if (out_params_ != nullptr) c.set_quant_params(out_params_);
+
+            size_t m = a.shape()[0];
+            size_t k = a.shape()[1];
+            size_t n = b.shape()[1];
+
+            GemmInt8Output out;
+            out.dtype = dtype;
+            out.data = c.Map<T>().data();
+            out.ldc = n;
+            out.a_scale = a_params != nullptr ? a_params->scale() : kScale;
+            out.a_zero_point = a_params != nullptr ? a_params->zero_point() : kZeroPoint;
+            out.b_scales = b_params != nullptr ? b_params->scales() : &kScale;
+            out.b_zero_points = b_params != nullptr ? b_params->zero_points() : &kZeroPoint;
+            out.b_per_channel = b_params != nullptr && b_params->per_channel();
+            out.scale = out_params_ != nullptr ? out_params_->scale() : kScale;
+            out.zero_point = out_params_ != nullptr ? out_params_->zero_point() : kZeroPoint;
+
+            GemmInt8(micro_kernel_, m, n, k, 
+                a.Map<int8_t>().data(), k, 
+                b.Map<int8_t>().data(), n, 
+                out, context);
+            return Status::kOK;
+        }
+
+    private:
+        const GemmInt8MicroKernel micro_kernel_;
+        std::shared_ptr<const QuantParams> out_params_;
+    };
+
+    GL_REGISTER_OP("MatMul").
+        Input().
+        Input().
+        Output(MatMulShape).
+        Build();
+
+    // MatMul with a requantized Int8 output
+    GL_REGISTER_OP("QuantizedMatMul").
+        Input().
+        Input().
+        Output(MatMulShape).
+        Attribute("out_scale").
+        Attribute("out_zero_point").
+        Build();
+
+    using MatMulFloat         = MatMulKernel<float, CpuIsa::Generic>;
+    using MatMulFloatAvx2     = MatMulKernel<float, CpuIsa::Avx2>;
+    using MatMulFloatAvx512   = MatMulKernel<float, CpuIsa::Avx512>;
+    using MatMulDouble        = MatMulKernel<double, CpuIsa::Generic>;
+    using MatMulDoubleAvx2    = MatMulKernel<double, CpuIsa::Avx2>;
+    using MatMulDoubleAvx512  = MatMulKernel<double, CpuIsa::Avx512>;
+    using MatMulBf16          = MatMulKernel<float, CpuIsa::Generic, Bf16>;
+    using MatMulBf16Avx2      = MatMulKernel<float, CpuIsa::Avx2, Bf16>;
+    using MatMulBf16Avx512    = MatMulKernel<float, CpuIsa::Avx512, Bf16>;
+
+    GL_REGISTER_KERNEL("MatMul", MatMulFloat, "CPU").
+        Input(DataType::Float).
+        Input(DataType::Float).
+        Output(DataType::Float).
+        Isa(CpuIsa::Generic).
+        Build();
+
+    GL_REGISTER_KERNEL("MatMul", MatMulFloatAvx2, "CPU").
+        Input(DataType::Float).
+        Input(DataType::Float).
+        Output(DataType::Float).
+        Isa(CpuIsa::Avx2).
+        Build();
+
+    GL_REGISTER_KERNEL("MatMul", MatMulFloatAvx512, "CPU").
+        Input(DataType::Float).
+        Input(DataType::Float).
+        Output(DataType::Float).
+        Isa(CpuIsa::Avx512).
+        Build();
+
+    GL_REGISTER_KERNEL("MatMul", MatMulDouble, "CPU").
+        Input(DataType::Double).
+        Input(DataType::Double).
+        Output(DataType::Double).
+        Isa(CpuIsa::Generic).
+        Build();
+
+    GL_REGISTER_KERNEL("MatMul", MatMulDoubleAvx2, "CPU").
+        Input(DataType::Double).
+        Input(DataType::Double).
+        Output(DataType::Double).
+        Isa(CpuIsa::Avx2).
+        Build();
+
+    GL_REGISTER_KERNEL("MatMul", MatMulDoubleAvx512, "CPU").
+        Input(DataType::Double).
+        Input(DataType::Double).
+        Output(DataType::Double).
+        Isa(CpuIsa::Avx512).
+        Build();
+
+    // BFloat16 inputs accumulate in float
+    GL_REGISTER_KERNEL("MatMul", MatMulBf16, "CPU").
+        Input(DataType::BFloat16).
+        Input(DataType::BFloat16).
+        Output(DataType::Float).
+        Isa(CpuIsa::Generic).
+        Build();
+
+    GL_REGISTER_KERNEL("MatMul", MatMulBf16Avx2, "CPU").
+        Input(DataType::BFloat16).
+        Input(DataType::BFloat16).
+        Output(DataType::Float).
+        Isa(CpuIsa::Avx2).
+        Build();
+
+    GL_REGISTER_KERNEL("MatMul", MatMulBf16Avx512, "CPU").
+        Input(DataType::BFloat16).
+        Input(DataType::BFloat16).
+        Output(DataType::Float).
+        Isa(CpuIsa::Avx512).
+        Build();
+
+    namespace
+    {
+        /**
+         * Registers the Int8 kernels of op with output dtype 
+         * at every instruction set level with a micro-kernel
+        */
+        template<typename T, DataType dtype>
+        Initializer RegisterQuantizedMatMulKernels(const std::string& op)
+        {
+            OpKernelDefBuilder<QuantizedMatMulKernel<T, dtype, CpuIsa::Generic>>(op, "CPU").
+                Input(DataType::Int8).Input(DataType::Int8).Output(dtype).Isa(CpuIsa::Generic).Build();
+            OpKernelDefBuilder<QuantizedMatMulKernel<T, dtype, CpuIsa::Avx2>>(op, "CPU").
+                Input(DataType::Int8).Input(DataType::Int8).Output(dtype).Isa(CpuIsa::Avx2).Build();
+            OpKernelDefBuilder<QuantizedMatMulKernel<T, dtype, CpuIsa::Avx512Vnni>>(op, "CPU").
+                Input(DataType::Int8).Input(DataType::Int8).Output(dtype).Isa(CpuIsa::Avx512Vnni).Build();
+            return Initializer();
+        }
+    }
+
+    // registered after the ops above, ordered within this file
+    static Initializer register_quantized_matmul_kernels[] = {
+        RegisterQuantizedMatMulKernels<int32_t, DataType::Int32>("MatMul"),
+        RegisterQuantizedMatMulKernels<float, DataType::Float>("MatMul"),
+        RegisterQuantizedMatMulKernels<int8_t, DataType::Int8>("QuantizedMatMul"),
+    };
+
+    GL_DEFINE_KERNEL_LIBRARY(matmul);
+}
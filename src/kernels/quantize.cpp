@@ -0,0 +1,436 @@
+#include <algorithm>
+#include <limits>
+#include <memory>
+
+#include "graphloom/kernels/quantize.h"
+#include "graphloom/op/op.h"
+#include "graphloom/tensor/quantization.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GL_QUANTIZE_X86 1
+#include <immintrin.h>
+#define GL_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define GL_TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+#endif
+
+namespace graphloom
+{
+    namespace
+    {
+        // Elements of a loop call, a task of parallel_for
+        constexpr size_t kChunkElements = size_t(1) << 14;
+
+        // Min elements a thread of parallel_for is given
+        constexpr size_t kMinParallelElements = size_t(1) << 15;
+
+        using QuantizeLoopFn = void (*)(const float* x, int8_t* out, size_t n,
+            float inv_scale, int32_t zero_point);
+        using DequantizeLoopFn = void (*)(const int8_t* q, float* out, size_t n,
+            float scale, int32_t zero_point);
+        using MinMaxLoopFn = void (*)(const float* x, size_t n, float& min, float& max);
+
+        inline void QuantizeLoop(const float* x, int8_t* out, size_t n,
+            float inv_scale, int32_t zero_point)
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                out[i] = QuantizeValue(x[i], inv_scale, zero_point);
+            }
+        }
+
+        inline void DequantizeLoop(const int8_t* q, float* out, size_t n,
+            float scale, int32_t zero_point)
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                out[i] = DequantizeValue(q[i], scale, zero_point);
+            }
+        }
+
+        inline void MinMaxLoop(const float* x, size_t n, float& min, float& max)
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                min = std::min(min, x[i]);
+                max = std::max(max, x[i]);
+            }
+        }
+
+#ifdef GL_QUANTIZE_X86
+        /**
+         * Vector loops match QuantizeValue exactly: round to
+         * nearest even, add the zero point and clamp in float,
+         * so the conversion to int32 never overflows.
+        */
+
+        GL_TARGET_AVX2 void QuantizeLoopAvx2(const float* x, int8_t* out, size_t n,
+            float inv_scale, int32_t zero_point)
+        {
+            const __m256 scale = _mm256_set1_ps(inv_scale);
+            const __m256 zero = _mm256_set1_ps(static_cast<float>(zero_point));
+            const __m256 low = _mm256_set1_ps(-128.0f);
+            const __m256 high = _mm256_set1_ps(127.0f);
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                __m256 v = _mm256_round_ps(_mm256_mul_ps(_mm256_loadu_ps(x + i), scale),
+                    _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+                v = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(v, zero), low), high);
+                __m256i q = _mm256_cvtps_epi32(v);
+                __m128i q16 = _mm_packs_epi32(_mm256_castsi256_si128(q), _mm256_extracti128_si256(q, 1));
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi16(q16, q16));
+            }
+            QuantizeLoop(x + i, out + i, n - i, inv_scale, zero_point);
+        }
+
+        GL_TARGET_AVX2 void DequantizeLoopAvx2(const int8_t* q, float* out, size_t n,
+            float scale, int32_t zero_point)
+        {
+            const __m256 scales = _mm256_set1_ps(scale);
+            const __m256i zero = _mm256_set1_epi32(zero_point);
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                __m256i v = _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(q + i)));
+                _mm256_storeu_ps(out + i, _mm256_mul_ps(scales, _mm256_cvtepi32_ps(_mm256_sub_epi32(v, zero))));
+            }
+            DequantizeLoop(q + i, out + i, n - i, scale, zero_point);
+        }
+
+        GL_TARGET_AVX2 void MinMaxLoopAvx2(const float* x, size_t n, float& min, float& max)
+        {
+            __m256 low = _mm256_set1_ps(min);
+            __m256 high = _mm256_set1_ps(max);
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                __m256 v = _mm256_loadu_ps(x + i);
+                low = _mm256_min_ps(low, v);
+                high = _mm256_max_ps(high, v);
+            }
+
+            alignas(32) float lows[8], highs[8];
+            _mm256_store_ps(lows, low);
+            _mm256_store_ps(highs, high);
+            MinMaxLoop(lows, 8, min, max);
+            MinMaxLoop(highs, 8, min, max);
+            MinMaxLoop(x + i, n - i, min, max);
+        }
+
+        GL_TARGET_AVX512 void QuantizeLoopAvx512(const float* x, int8_t* out, size_t n,
+            float inv_scale, int32_t zero_point)
+        {
+            const __m512 scale = _mm512_set1_ps(inv_scale);
+            const __m512 zero = _mm512_set1_ps(static_cast<float>(zero_point));
+            const __m512 low = _mm512_set1_ps(-128.0f);
+            const __m512 high = _mm512_set1_ps(127.0f);
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16)
+            {
+                __m512 v = _mm512_roundscale_ps(_mm512_mul_ps(_mm512_loadu_ps(x + i), scale),
+                    _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+                v = _mm512_min_ps(_mm512_max_ps(_mm512_add_ps(v, zero), low), high);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                    _mm512_cvtsepi32_epi8(_mm512_cvtps_epi32(v)));
+            }
+            QuantizeLoop(x + i, out + i, n - i, inv_scale, zero_point);
+        }
+
+        GL_TARGET_AVX512 void DequantizeLoopAvx512(const int8_t* q, float* out, size_t n,
+            float scale, int32_t zero_point)
+        {
+            const __m512 scales = _mm512_set1_ps(scale);
+            const __m512i zero = _mm512_set1_epi32(zero_point);
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16)
+            {
+                __m512i v = _mm512_cvtepi8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(q + i)));
+                _mm512_storeu_ps(out + i, _mm512_mul_ps(scales, _mm512_cvtepi32_ps(_mm512_sub_epi32(v, zero))));
+            }
+            DequantizeLoop(q + i, out + i, n - i, scale, zero_point);
+        }
+
+        GL_TARGET_AVX512 void MinMaxLoopAvx512(const float* x, size_t n, float& min, float& max)
+        {
+            __m512 low = _mm512_set1_ps(min);
+            __m512 high = _mm512_set1_ps(max);
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16)
+            {
+                __m512 v = _mm512_loadu_ps(x + i);
+                low = _mm512_min_ps(low, v);
+                high = _mm512_max_ps(high, v);
+            }
+            min = std::min(min, _mm512_reduce_min_ps(low));
+            max = std::max(max, _mm512_reduce_max_ps(high));
+            MinMaxLoop(x + i, n - i, min, max);
+        }
+#endif
+
+        void QuantizeLoopGeneric(const float* x, int8_t* out, size_t n,
+            float inv_scale, int32_t zero_point)
+        {
+            QuantizeLoop(x, out, n, inv_scale, zero_point);
+        }
+
+        void DequantizeLoopGeneric(const int8_t* q, float* out, size_t n,
+            float scale, int32_t zero_point)
+        {
+            DequantizeLoop(q, out, n, scale, zero_point);
+        }
+
+        void MinMaxLoopGeneric(const float* x, size_t n, float& min, float& max)
+        {
+            MinMaxLoop(x, n, min, max);
+        }
+
+        /**
+         * @param isa Highest instruction set level allowed
+         * @returns Fastest loops requiring at most isa
+        */
+
+        QuantizeLoopFn QuantizeLoopFor(CpuIsa isa)
+        {
+#ifdef GL_QUANTIZE_X86
+            if (isa >= CpuIsa::Avx512) return QuantizeLoopAvx512;
+            if (isa >= CpuIsa::Avx2) return QuantizeLoopAvx2;
+#endif
+            return QuantizeLoopGeneric;
+        }
+
+        DequantizeLoopFn DequantizeLoopFor(CpuIsa isa)
+        {
+#ifdef GL_QUANTIZE_X86
+            if (isa >= CpuIsa::Avx512) return DequantizeLoopAvx512;
+            if (isa >= CpuIsa::Avx2) return DequantizeLoopAvx2;
+#endif
+            return DequantizeLoopGeneric;
+        }
+
+        MinMaxLoopFn MinMaxLoopFor(CpuIsa isa)
+        {
+#ifdef GL_QUANTIZE_X86
+            if (isa >= CpuIsa::Avx512) return MinMaxLoopAvx512;
+            if (isa >= CpuIsa::Avx2) return MinMaxLoopAvx2;
+#endif
+            return MinMaxLoopGeneric;
+        }
+
+        /**
+         * Calls fn(first, last, channel) over chunks of n elements,
+         * split where the channel changes. A channel is a run of
+         * inner elements, channels repeat every num_channels runs.
+        */
+        template<typename Fn>
+        void ForEachChannelRun(const ComputeContext& context, size_t n, size_t inner,
+            size_t num_channels, const Fn& fn)
+        {
+            size_t chunks = (n + kChunkElements - 1) / kChunkElements;
+            size_t grain = std::max<size_t>(1, kMinParallelElements / kChunkElements);
+            context.parallel_for(chunks, grain, [&](size_t begin, size_t end) {
+                size_t first = begin * kChunkElements;
+                size_t last = std::min(end * kChunkElements, n);
+                while (first < last)
+                {
+                    size_t run = first / inner;
+                    size_t run_end = std::min(last, (run + 1) * inner);
+                    fn(first, run_end, run % num_channels);
+                    first = run_end;
+                }
+            });
+        }
+
+        Status SameShape(const ComputeContext& context, LayoutArray& shape)
+        {
+            shape = context.input_shape(0);
+            return Status::kOK;
+        }
+    }
+
+    /**
+     * Quantize kernel, per tensor parameters of the
+     * node's attributes
+    */
+    template<CpuIsa isa>
+    class QuantizeKernel : public OpKernel
+    {
+    public:
+        QuantizeKernel(const OpKernelContext& context) :
+            OpKernel(context),
+            params_(std::make_shared<const QuantParams>(QuantParams::PerTensor(
+                context.GetFloatAttr("scale"), context.GetInt32Attr("zero_point")))),
+            loop_(QuantizeLoopFor(isa))
+        {
+
+        }
+
+        Status Compute(ComputeContext& context) override
+        {
+            const float* x = context.input(0).Map<float>().data();
+            TensorBuffer& out = context.output(0);
+            out.set_quant_params(params_);
+            int8_t* dst = out.Map<int8_t>().data();
+
+            float inv_scale = 1.0f / params_->scale();
+            int32_t zero_point = params_->zero_point();
+            ForEachChannelRun(context, out.size(), out.size(), 1,
+                [&](size_t first, size_t last, size_t) {
+                    loop_(x + first, dst + first, last - first, inv_scale, zero_point);
+                });
+            return Status::kOK;
+        }
+
+    private:
+        const std::shared_ptr<const QuantParams> params_;
+        const QuantizeLoopFn loop_;
+    };
+
+    /**
+     * QuantizeDynamic kernel, per tensor parameters
+     * covering the range of each input
+    */
+    template<CpuIsa isa>
+    class QuantizeDynamicKernel : public OpKernel
+    {
+    public:
+        QuantizeDynamicKernel(const OpKernelContext& context) :
+            OpKernel(context),
+            loop_(QuantizeLoopFor(isa)),
+            min_max_loop_(MinMaxLoopFor(isa))
+        {
+
+        }
+
+        Status Compute(ComputeContext& context) override
+        {
+            const TensorBuffer& input = context.input(0);
+            const float* x = input.Map<float>().data();
+            size_t n = input.size();
+
+            // min and max of each chunk, reduced after
+            size_t chunks = (n + kChunkElements - 1) / kChunkElements;
+            float* ranges = static_cast<float*>(context.scratch(2 * chunks * sizeof(float)));
+            size_t grain = std::max<size_t>(1, kMinParallelElements / kChunkElements);
+            context.parallel_for(chunks, grain, [&](size_t begin, size_t end) {
+                for (size_t chunk = begin; chunk < end; ++chunk)
+                {
+                    size_t first = chunk * kChunkElements;
+                    float min = 0.0f, max = 0.0f;
+                    min_max_loop_(x + first, std::min(kChunkElements, n - first), min, max);
+                    ranges[2 * chunk] = min;
+                    ranges[2 * chunk + 1] = max;
+                }
+            });
+
+            float min = 0.0f, max = 0.0f;
+            for (size_t chunk = 0; chunk < chunks; ++chunk)
+            {
+                min = std::min(min, ranges[2 * chunk]);
+                max = std::max(max, ranges[2 * chunk + 1]);
+            }
+
+            auto params = std::make_shared<const QuantParams>(ChooseQuantParams(min, max));
+            TensorBuffer& out = context.output(0);
+            out.set_quant_params(params);
+            int8_t* dst = out.Map<int8_t>().data();
+
+            float inv_scale = 1.0f / params->scale();
+            int32_t zero_point = params->zero_point();
+            ForEachChannelRun(context, n, n, 1, [&](size_t first, size_t last, size_t) {
+                loop_(x + first, dst + first, last - first, inv_scale, zero_point);
+            });
+            return Status::kOK;
+        }
+
+    private:
+        const QuantizeLoopFn loop_;
+        const MinMaxLoopFn min_max_loop_;
+    };
+
+    /**
+     * Dequantize kernel, per tensor or per channel
+     * parameters of the input
+    */
+    template<CpuIsa isa>
+    class DequantizeKernel : public OpKernel
+    {
+    public:
+        DequantizeKernel(const OpKernelContext& context) :
+            OpKernel(context),
+            loop_(DequantizeLoopFor(isa))
+        {
+
+        }
+
+        Status Compute(ComputeContext& context) override
+        {
+            const TensorBuffer& input = context.input(0);
+            const QuantParams* params = input.quant_params();
+            if (params == nullptr)
+            {
+                return Status(1, "Dequantize input has no quantization parameters");
+            }
+
+            const int8_t* q = input.Map<int8_t>().data();
+            float* dst = context.output(0).Map<float>().data();
+            size_t n = input.size();
+
+            size_t inner = n;
+            if (params->per_channel())
+            {
+                inner = 1;
+                for (size_t i = params->axis() + 1; i < input.shape().rank(); ++i)
+                {
+                    inner *= input.shape()[i];
+                }
+            }
+            ForEachChannelRun(context, n, std::max<size_t>(inner, 1), params->num_channels(),
+                [&](size_t first, size_t last, size_t channel) {
+                    loop_(q + first, dst + first, last - first,
+                        params->scale(channel), params->zero_point(channel));
+                });
+            return Status::kOK;
+        }
+
+    private:
+        const DequantizeLoopFn loop_;
+    };
+
+    GL_REGISTER_OP("Quantize").
+        Input().
+        Output(SameShape).
+        Attribute("scale").
+        Attribute("zero_point").
+        Build();
+
+    GL_REGISTER_OP("QuantizeDynamic").Input().Output(SameShape).Build();
+    GL_REGISTER_OP("Dequantize").Input().Output(SameShape).Build();
+
+    namespace
+    {
+        /**
+         * Registers a kernel of op at every instruction
+         * set level with a vector loop
+        */
+        template<template<CpuIsa> class Kernel>
+        Initializer RegisterQuantizeKernels(const std::string& op, DataType in, DataType out)
+        {
+            OpKernelDefBuilder<Kernel<CpuIsa::Generic>>(op, "CPU").
+                Input(in).Output(out).Isa(CpuIsa::Generic).Build();
+            OpKernelDefBuilder<Kernel<CpuIsa::Avx2>>(op, "CPU").
+                Input(in).Output(out).Isa(CpuIsa::Avx2).Build();
+            OpKernelDefBuilder<Kernel<CpuIsa::Avx512>>(op, "CPU").
+                Input(in).Output(out).Isa(CpuIsa::Avx512).Build();
+            return Initializer();
+        }
+    }
+
+    // registered after the ops above, ordered within this file
+    static Initializer register_quantize_kernels[] = {
+        RegisterQuantizeKernels<QuantizeKernel>("Quantize", DataType::Float, DataType::Int8),
+        RegisterQuantizeKernels<QuantizeDynamicKernel>("QuantizeDynamic", DataType::Float, DataType::Int8),
+        RegisterQuantizeKernels<DequantizeKernel>("Dequantize", DataType::Int8, DataType::Float),
+    };
+
+    GL_DEFINE_KERNEL_LIBRARY(quantize);
+}
@@ -0,0 +1,465 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+#include "graphloom/kernels/sparse_matmul.h"
+#include "graphloom/op/op.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GL_SPARSE_X86 1
+#define GL_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define GL_TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+
+namespace graphloom
+{
+    namespace
+    {
+        // Min multiply adds a thread of parallel_for is given
+        constexpr size_t kMinParallelWork = size_t(1) << 15;
+
+        // Max row ranges per thread, smaller ranges balance
+        // rows of uneven length
+        constexpr size_t kRangesPerThread = 16;
+
+        template<typename T>
+        using CsrRowFn = void (*)(const int32_t* cols, const T* values, size_t count,
+            const T* b, size_t n, T* c);
+
+        template<typename T>
+        using BsrRowFn = void (*)(const int32_t* cols, const T* blocks, size_t count,
+            size_t block_rows, size_t block_cols, const T* b, size_t n, T* c);
+
+        /**
+         * Computes the row c of n values as the sum of the
+         * rows cols[p] of b scaled by values[p]
+        */
+        template<typename T>
+        inline void CsrRow(const int32_t* cols, const T* values, size_t count,
+            const T* b, size_t n, T* c)
+        {
+            if (n == 1)
+            {
+                // matrix vector product, a gathered dot product
+                T sum = T(0);
+                #pragma omp simd reduction(+:sum)
+                for (size_t p = 0; p < count; ++p)
+                {
+                    sum += values[p] * b[cols[p]];
+                }
+                c[0] = sum;
+                return;
+            }
+
+            std::fill(c, c + n, T(0));
+            size_t p = 0;
+            for (; p + 4 <= count; p += 4)
+            {
+                // 4 rows of b per pass over c
+                const T* b0 = b + size_t(cols[p]) * n;
+                const T* b1 = b + size_t(cols[p + 1]) * n;
+                const T* b2 = b + size_t(cols[p + 2]) * n;
+                const T* b3 = b + size_t(cols[p + 3]) * n;
+                const T v0 = values[p], v1 = values[p + 1], v2 = values[p + 2], v3 = values[p + 3];
+                #pragma omp simd
+                for (size_t j = 0; j < n; ++j)
+                {
+                    c[j] += v0 * b0[j] + v1 * b1[j] + v2 * b2[j] + v3 * b3[j];
+                }
+            }
+            for (; p < count; ++p)
+            {
+                const T* row = b + size_t(cols[p]) * n;
+                const T v = values[p];
+                #pragma omp simd
+                for (size_t j = 0; j < n; ++j)
+                {
+                    c[j] += v * row[j];
+                }
+            }
+        }
+
+        /**
+         * Computes the block_rows rows c of n values from count
+         * blocks of block_rows x block_cols values, block k
+         * covers the rows [cols[k], cols[k] + 1) * block_cols of b
+        */
+        template<typename T>
+        inline void BsrRow(const int32_t* cols, const T* blocks, size_t count,
+            size_t block_rows, size_t block_cols, const T* b, size_t n, T* c)
+        {
+            std::fill(c, c + block_rows * n, T(0));
+            for (size_t k = 0; k < count; ++k)
+            {
+                const T* block = blocks + k * block_rows * block_cols;
+                const T* b_rows = b + size_t(cols[k]) * block_cols * n;
+                for (size_t r = 0; r < block_rows; ++r)
+                {
+                    T* c_row = c + r * n;
+                    for (size_t q = 0; q < block_cols; ++q)
+                    {
+                        const T v = block[r * block_cols + q];
+                        const T* row = b_rows + q * n;
+                        #pragma omp simd
+                        for (size_t j = 0; j < n; ++j)
+                        {
+                            c_row[j] += v * row[j];
+                        }
+                    }
+                }
+            }
+        }
+
+        template<typename T>
+        void CsrRowGeneric(const int32_t* cols, const T* values, size_t count,
+            const T* b, size_t n, T* c)
+        {
+            CsrRow(cols, values, count, b, n, c);
+        }
+
+        template<typename T>
+        void BsrRowGeneric(const int32_t* cols, const T* blocks, size_t count,
+            size_t block_rows, size_t block_cols, const T* b, size_t n, T* c)
+        {
+            BsrRow(cols, blocks, count, block_rows, block_cols, b, n, c);
+        }
+
+#ifdef GL_SPARSE_X86
+        template<typename T>
+        GL_TARGET_AVX2 void CsrRowAvx2(const int32_t* cols, const T* values, size_t count,
+            const T* b, size_t n, T* c)
+        {
+            CsrRow(cols, values, count, b, n, c);
+        }
+
+        template<typename T>
+        GL_TARGET_AVX2 void BsrRowAvx2(const int32_t* cols, const T* blocks, size_t count,
+            size_t block_rows, size_t block_cols, const T* b, size_t n, T* c)
+        {
+            BsrRow(cols, blocks, count, block_rows, block_cols, b, n, c);
+        }
+
+        template<typename T>
+        GL_TARGET_AVX512 void CsrRowAvx512(const int32_t* cols, const T* values, size_t count,
+            const T* b, size_t n, T* c)
+        {
+            CsrRow(cols, values, count, b, n, c);
+        }
+
+        template<typename T>
+        GL_TARGET_AVX512 void BsrRowAvx512(const int32_t* cols, const T* blocks, size_t count,
+            size_t block_rows, size_t block_cols, const T* b, size_t n, T* c)
+        {
+            BsrRow(cols, blocks, count, block_rows, block_cols, b, n, c);
+        }
+#endif
+
+        /**
+         * @param isa Highest instruction set level allowed
+         * @returns Fastest row function requiring at most isa
+        */
+        template<typename T>
+        CsrRowFn<T> CsrRowFor(CpuIsa isa)
+        {
+#ifdef GL_SPARSE_X86
+            if (isa >= CpuIsa::Avx512) return CsrRowAvx512<T>;
+            if (isa >= CpuIsa::Avx2) return CsrRowAvx2<T>;
+#endif
+            return CsrRowGeneric<T>;
+        }
+
+        template<typename T>
+        BsrRowFn<T> BsrRowFor(CpuIsa isa)
+        {
+#ifdef GL_SPARSE_X86
+            if (isa >= CpuIsa::Avx512) return BsrRowAvx512<T>;
+            if (isa >= CpuIsa::Avx2) return BsrRowAvx2<T>;
+#endif
+            return BsrRowGeneric<T>;
+        }
+
+        /**
+         * Checks the offsets of rows into count values
+         *
+         * @returns True if they go from 0 to count without decreasing
+        */
+        bool ValidOffsets(const int32_t* offsets, size_t rows, size_t count)
+        {
+            if (offsets[0] != 0 || size_t(offsets[rows]) != count) return false;
+            for (size_t i = 0; i < rows; ++i)
+            {
+                if (offsets[i] > offsets[i + 1]) return false;
+            }
+            return true;
+        }
+
+        /**
+         * Calls fn(first, last) over ranges of rows on the
+         * context's parallel_for. Ranges are split by work,
+         * a row costs its values plus one, so rows of uneven
+         * length spread evenly across threads.
+         *
+         * @param offsets rows + 1 offsets of the rows' values
+         * @param rows Number of rows
+         * @param n Multiply adds per value
+        */
+        template<typename Fn>
+        void ForEachRowRange(const ComputeContext& context, const int32_t* offsets,
+            size_t rows, size_t n, const Fn& fn)
+        {
+            // work before row r, non decreasing in r
+            auto work = [&](size_t r) { return (size_t(offsets[r]) + r) * n; };
+            size_t total = work(rows);
+            size_t ranges = std::min({rows, std::max<size_t>(1, total / kMinParallelWork),
+                kRangesPerThread * context.thread_budget()});
+            if (ranges <= 1)
+            {
+                if (rows > 0) fn(0, rows);
+                return;
+            }
+
+            // first row of range i, the first whose work before reaches its share
+            auto first_row = [&](size_t i) {
+                size_t target = total / ranges * i;
+                size_t low = 0, high = rows;
+                while (low < high)
+                {
+                    size_t mid = low + (high - low) / 2;
+                    if (work(mid) < target) low = mid + 1;
+                    else high = mid;
+                }
+                return low;
+            };
+
+            context.parallel_for(ranges, 1, [&](size_t begin, size_t end) {
+                size_t first = first_row(begin);
+                size_t last = end == ranges ? rows : first_row(end);
+                if (first < last) fn(first, last);
+            });
+        }
+
+        Status CsrMatMulShape(const ComputeContext& context, LayoutArray& shape)
+        {
+            const LayoutArray& offsets = context.input_shape(0);
+            const LayoutArray& cols = context.input_shape(1);
+            const LayoutArray& values = context.input_shape(2);
+            const LayoutArray& b = context.input_shape(3);
+            if (offsets.rank() != 1 || offsets[0] == 0 || cols.rank() != 1 || values.rank() != 1)
+            {
+                return Status(1, "CsrMatMul expects rank 1 row offsets, column indices and values");
+            }
+            if (cols[0] != values[0])
+            {
+                return Status(2, "CsrMatMul expects one column index per value, got ",
+                    cols[0], " and ", values[0]);
+            }
+            if (b.rank() != 2)
+            {
+                return Status(3, "CsrMatMul expects a rank 2 B, got rank ", b.rank());
+            }
+
+            shape = {offsets[0] - 1, b[1]};
+            return Status::kOK;
+        }
+
+        Status BsrMatMulShape(const ComputeContext& context, LayoutArray& shape)
+        {
+            const LayoutArray& offsets = context.input_shape(0);
+            const LayoutArray& cols = context.input_shape(1);
+            const LayoutArray& values = context.input_shape(2);
+            const LayoutArray& b = context.input_shape(3);
+            if (offsets.rank() != 1 || offsets[0] == 0 || cols.rank() != 1)
+            {
+                return Status(1, "BsrMatMul expects rank 1 row offsets and column indices");
+            }
+            if (values.rank() != 3 || values[1] == 0 || values[2] == 0 || cols[0] != values[0])
+            {
+                return Status(2, "BsrMatMul expects values of shape [blocks, block_rows, block_cols]"
+                    " with one column index per block");
+            }
+            if (b.rank() != 2 || b[0] % values[2] != 0)
+            {
+                return Status(3, "BsrMatMul expects a rank 2 B whose rows are a multiple of block_cols");
+            }
+
+            shape = {(offsets[0] - 1) * values[1], b[1]};
+            return Status::kOK;
+        }
+    }
+
+    /**
+     * CsrMatMul kernel on a row major B, using the
+     * fastest row function of at most instruction set isa
+    */
+    template<typename T, CpuIsa isa>
+    class CsrMatMulKernel : public OpKernel
+    {
+    public:
+        CsrMatMulKernel(const OpKernelContext& context) :
+            OpKernel(context),
+            row_(CsrRowFor<T>(isa))
+        {
+
+        }
+
+        Status Compute(ComputeContext& context) override
+        {
+            const int32_t* offsets = context.input(0).Map<int32_t>().data();
+            const int32_t* cols = context.input(1).Map<int32_t>().data();
+            const T* values = context.input(2).Map<T>().data();
+            const TensorBuffer& b = context.input(3);
+            TensorBuffer& c = context.output(0);
+
+            size_t m = c.shape()[0];
+            size_t n = c.shape()[1];
+            size_t k = b.shape()[0];
+            if (!ValidOffsets(offsets, m, context.input(2).size()))
+            {
+                return Status(1, "CsrMatMul row offsets must go from 0 to the number of values");
+            }
+
+            // columns are checked by the rows reading them
+            std::atomic<bool> invalid(false);
+            const T* b_data = b.Map<T>().data();
+            T* c_data = c.Map<T>().data();
+            ForEachRowRange(context, offsets, m, n, [&](size_t first, size_t last) {
+                for (int32_t p = offsets[first]; p < offsets[last]; ++p)
+                {
+                    if (cols[p] < 0 || size_t(cols[p]) >= k)
+                    {
+                        invalid.store(true, std::memory_order_relaxed);
+                        return;
+                    }
+                }
+                for (size_t i = first; i < last; ++i)
+                {
+                    row_(cols + offsets[i], values + offsets[i], size_t(offsets[i + 1] - offsets[i]),
+                        b_data, n, c_data + i * n);
+                }
+            });
+
+            if (invalid.load())
+            {
+                return Status(2, "CsrMatMul column index out of [0, ", k, ")");
+            }
+            return Status::kOK;
+        }
+
+    private:
+        const CsrRowFn<T> row_;
+    };
+
+    /**
+     * BsrMatMul kernel on a row major B, using the
+     * fastest row function of at most instruction set isa
+    */
+    template<typename T, CpuIsa isa>
+    class BsrMatMulKernel : public OpKernel
+    {
+    public:
+        BsrMatMulKernel(const OpKernelContext& context) :
+            OpKernel(context),
+            row_(BsrRowFor<T>(isa))
+        {
+
+        }
+
+        Status Compute(ComputeContext& context) override
+        {
+            const int32_t* offsets = context.input(0).Map<int32_t>().data();
+            const int32_t* cols = context.input(1).Map<int32_t>().data();
+            const TensorBuffer& blocks = context.input(2);
+            const TensorBuffer& b = context.input(3);
+            TensorBuffer& c = context.output(0);
+
+            size_t block_rows = blocks.shape()[1];
+            size_t block_cols = blocks.shape()[2];
+            size_t block_size = block_rows * block_cols;
+            size_t row_blocks = context.input(0).size() - 1;
+            size_t col_blocks = b.shape()[0] / block_cols;
+            size_t n = c.shape()[1];
+            if (!ValidOffsets(offsets, row_blocks, blocks.shape()[0]))
+            {
+                return Status(1, "BsrMatMul row offsets must go from 0 to the number of blocks");
+            }
+
+            std::atomic<bool> invalid(false);
+            const T* values = blocks.Map<T>().data();
+            const T* b_data = b.Map<T>().data();
+            T* c_data = c.Map<T>().data();
+            ForEachRowRange(context, offsets, row_blocks, block_size * n, [&](size_t first, size_t last) {
+                for (int32_t p = offsets[first]; p < offsets[last]; ++p)
+                {
+                    if (cols[p] < 0 || size_t(cols[p]) >= col_blocks)
+                    {
+                        invalid.store(true, std::memory_order_relaxed);
+                        return;
+                    }
+                }
+                for (size_t i = first; i < last; ++i)
+                {
+                    row_(cols + offsets[i], values + offsets[i] * block_size,
+                        size_t(offsets[i + 1] - offsets[i]), block_rows, block_cols,
+                        b_data, n, c_data + i * block_rows * n);
+                }
+            });
+
+            if (invalid.load())
+            {
+                return Status(2, "BsrMatMul block column index out of [0, ", col_blocks, ")");
+            }
+            return Status::kOK;
+        }
+
+    private:
+        const BsrRowFn<T> row_;
+    };
+
+    GL_REGISTER_OP("CsrMatMul").
+        Input().
+        Input().
+        Input().
+        Input().
+        Output(CsrMatMulShape).
+        Build();
+
+    GL_REGISTER_OP("BsrMatMul").
+        Input().
+        Input().
+        Input().
+        Input().
+        Output(BsrMatMulShape).
+        Build();
+
+    namespace
+    {
+        /**
+         * Registers the kernels of op with values of dtype
+         * at every instruction set level with a vector loop
+        */
+        template<template<typename, CpuIsa> class Kernel, typename T, DataType dtype>
+        Initializer RegisterSparseMatMulKernels(const std::string& op)
+        {
+            OpKernelDefBuilder<Kernel<T, CpuIsa::Generic>>(op, "CPU").
+                Input(DataType::Int32).Input(DataType::Int32).Input(dtype).Input(dtype).
+                Output(dtype).Isa(CpuIsa::Generic).Build();
+            OpKernelDefBuilder<Kernel<T, CpuIsa::Avx2>>(op, "CPU").
+                Input(DataType::Int32).Input(DataType::Int32).Input(dtype).Input(dtype).
+                Output(dtype).Isa(CpuIsa::Avx2).Build();
+            OpKernelDefBuilder<Kernel<T, CpuIsa::Avx512>>(op, "CPU").
+                Input(DataType::Int32).Input(DataType::Int32).Input(dtype).Input(dtype).
+                Output(dtype).Isa(CpuIsa::Avx512).Build();
+            return Initializer();
+        }
+    }
+
+    // registered after the ops above, ordered within this file
+    static Initializer register_sparse_matmul_kernels[] = {
+        RegisterSparseMatMulKernels<CsrMatMulKernel, float, DataType::Float>("CsrMatMul"),
+        RegisterSparseMatMulKernels<CsrMatMulKernel, double, DataType::Double>("CsrMatMul"),
+        RegisterSparseMatMulKernels<BsrMatMulKernel, float, DataType::Float>("BsrMatMul"),
+        RegisterSparseMatMulKernels<BsrMatMulKernel, double, DataType::Double>("BsrMatMul"),
+    };
+
+    GL_DEFINE_KERNEL_LIBRARY(sparse_matmul);
+}
@@ -1,7 +1,31 @@
+#include <algorithm>
+#include <functional>
+
 #include "graphloom/op/op.h"
 
 namespace graphloom
 {
+    namespace
+    {
+        /**
+         * Mixes value into seed
+        */
+        void HashCombine(size_t& seed, size_t value)
+        {
+            seed ^= value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+        }
+    }
+
+    /**
+     * OpKernel Impl
+    */
+
+    OpKernel::OpKernel(const OpKernelContext&)
+    {
+
+    }
+
+
     /**
      * Op Impl
     */
@@ -21,11 +45,88 @@ namespace graphloom
         return name_;
     }
 
-    const std::set<std::string>& Op::attributes() const
+    const std::vector<std::string>& Op::attributes() const
     {
         return attributes_;
     }
 
+    int Op::AttrIndex(const std::string& name) const
+    {
+        // ops have few attributes, a scan beats hashing
+        for (size_t i = 0; i < attributes_.size(); ++i)
+        {
+            if (attributes_[i] == name) return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    void Op::AddKernel(OpKernelDef&& kernel)
+    {
+        size_t index = kernels_.size();
+        kernels_.push_back(std::move(kernel));
+        const OpKernelDef& added = kernels_[index];
+
+        size_t hash = HashSignature(added.device_, added.in_dtypes_, added.out_dtypes_);
+        auto range = dispatch_.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            const OpKernelDef& other = kernels_[it->second.front()];
+            if (other.device_ != added.device_ || 
+                other.in_dtypes_ != added.in_dtypes_ ||
+                other.out_dtypes_ != added.out_dtypes_) continue;
+
+            // after the kernels of the same level, the first registered wins ties
+            std::vector<size_t>& candidates = it->second;
+            auto pos = std::find_if(candidates.begin(), candidates.end(), [&](size_t i) {
+                return kernels_[i].isa_ < added.isa_;
+            });
+            candidates.insert(pos, index);
+            return;
+        }
+        dispatch_.emplace(hash, std::vector<size_t>{index});
+    }
+
+    const OpKernelDef* Op::FindKernel(const std::string& device, 
+        const std::vector<DataType>& in_dtypes, 
+        const std::vector<DataType>& out_dtypes) const
+    {
+        auto range = dispatch_.equal_range(HashSignature(device, in_dtypes, out_dtypes));
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            const OpKernelDef& first = kernels_[it->second.front()];
+            if (first.device_ != device || 
+                first.in_dtypes_ != in_dtypes ||
+                first.out_dtypes_ != out_dtypes) continue;
+
+            // checked on every lookup, LimitCpuIsa() may lower the level
+            for (size_t index : it->second)
+            {
+                if (CpuIsaSupported(kernels_[index].isa_)) return &kernels_[index];
+            }
+            return nullptr;
+        }
+        return nullptr;
+    }
+
+    size_t Op::HashSignature(const std::string& device, 
+        const std::vector<DataType>& in_dtypes, 
+        const std::vector<DataType>& out_dtypes)
+    {
+        size_t seed = std::hash<std::string>()(device);
+        for (DataType dtype : in_dtypes)
+        {
+            HashCombine(seed, static_cast<size_t>(dtype));
+        }
+
+        // separates the inputs from the outputs
+        HashCombine(seed, in_dtypes.size());
+        for (DataType dtype : out_dtypes)
+        {
+            HashCombine(seed, static_cast<size_t>(dtype));
+        }
+        return seed;
+    }
+
 
     /**
      * OpKernelDef Impl
@@ -56,10 +157,17 @@ namespace graphloom
         return out_dtypes_.size();
     }
 
+    CpuIsa OpKernelDef::isa() const
+    {
+        return isa_;
+    }
+
     OpKernelDef::OpKernelDef(const std::string& device, const std::function<OpKernel*(const OpKernelContext&)>& create_fn, 
             const std::vector<DataType>& in_dtypes, 
-            const std::vector<DataType>& out_dtypes) :
+            const std::vector<DataType>& out_dtypes,
+            CpuIsa isa) :
             device_(device),
+            isa_(isa),
             create_fn_(create_fn),
             in_dtypes_(in_dtypes),
             out_dtypes_(out_dtypes)
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <utility>
 
 #include "graphloom/op/registration.h"
@@ -23,11 +24,11 @@ namespace graphloom
 
     OpBuilder& OpBuilder::Attribute(const std::string& name)
     {
-        auto pair = attributes_.insert(name);
-        if (!pair.second)
+        if (std::find(attributes_.begin(), attributes_.end(), name) != attributes_.end())
         {
             throw GlException("Failed to add attribute \"", name, "\" because it already exists.");
         }
+        attributes_.push_back(name);
         return *this;
     }
 
@@ -115,7 +116,7 @@ namespace graphloom
                 op.num_outputs(), " != ", kernel.num_outputs());
         }
 
-        op.kernels_.push_back(std::move(kernel));
+        op.AddKernel(std::move(kernel));
 
         return Status::kOK;
     }
@@ -0,0 +1,612 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <unordered_set>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "graphloom/tensor/checkpoint.h"
+#include "common/thread_pool.h"
+
+namespace graphloom
+{
+    namespace
+    {
+        const char kMagic[8] = {'G', 'L', 'C', 'K', 'P', 'T', '\0', '\0'};
+
+        // Max bytes of one pread of a parallel load
+        constexpr size_t kReadChunkBytes = size_t(16) << 20;
+
+        // Max bytes of a name, guards against corrupt headers
+        constexpr size_t kMaxNameBytes = size_t(1) << 16;
+
+        /**
+         * @param value Value to round up
+         * @returns value rounded up to kCheckpointAlignment
+        */
+        inline uint64_t AlignUp(uint64_t value)
+        {
+            return (value + kCheckpointAlignment - 1) / kCheckpointAlignment * kCheckpointAlignment;
+        }
+
+        /**
+         * Appends value to header as little endian
+         *
+         * @param header Header bytes
+         * @param value Integer to append
+        */
+        template<typename T>
+        void PutInt(std::vector<char>& header, T value)
+        {
+            for (size_t i = 0; i < sizeof(T); ++i)
+            {
+                header.push_back(static_cast<char>((static_cast<uint64_t>(value) >> (8 * i)) & 0xff));
+            }
+        }
+
+        /**
+         * @returns Bytes of the entry of a tensor in the header
+        */
+        inline uint64_t EntryBytes(const std::string& name, size_t rank)
+        {
+            return sizeof(uint32_t) + name.size() + 2 * sizeof(uint32_t) +
+                (rank + 2) * sizeof(uint64_t);
+        }
+
+        /**
+         * Closes a file descriptor when it goes out of scope
+        */
+        struct FileCloser
+        {
+            int fd;
+
+            ~FileCloser()
+            {
+                if (fd >= 0) ::close(fd);
+            }
+        };
+
+        /**
+         * Stages bytes and writes them to a file once the
+         * buffer is full. Large contiguous writes bypass it.
+        */
+        class FileWriter
+        {
+        public:
+            /**
+             * @param fd File written to
+             * @param buffer_bytes Capacity of the staging buffer
+            */
+            FileWriter(int fd, size_t buffer_bytes) :
+                fd_(fd), size_(0), buffer_(std::max<size_t>(buffer_bytes, 4096)), failed_(false), error_(0)
+            {
+
+            }
+
+            /**
+             * @param data Bytes to write
+             * @param bytes Number of bytes
+            */
+            void Append(const void* data, size_t bytes)
+            {
+                const char* src = static_cast<const char*>(data);
+                if (bytes >= buffer_.size())
+                {
+                    Flush();
+                    WriteAll(src, bytes);
+                    return;
+                }
+
+                while (bytes > 0)
+                {
+                    size_t n = std::min(bytes, buffer_.size() - size_);
+                    std::memcpy(buffer_.data() + size_, src, n);
+                    size_ += n;
+                    src += n;
+                    bytes -= n;
+                    if (size_ == buffer_.size()) Flush();
+                }
+            }
+
+            /**
+             * @param bytes Number of zero bytes to write
+            */
+            void Pad(size_t bytes)
+            {
+                static const char zeros[kCheckpointAlignment] = {};
+                while (bytes > 0)
+                {
+                    size_t n = std::min(bytes, sizeof(zeros));
+                    Append(zeros, n);
+                    bytes -= n;
+                }
+            }
+
+            /**
+             * Writes the staged bytes
+            */
+            void Flush()
+            {
+                WriteAll(buffer_.data(), size_);
+                size_ = 0;
+            }
+
+            /**
+             * @returns errno of the first failed write, 0 if none failed
+            */
+            int error() const
+            {
+                return failed_ ? error_ : 0;
+            }
+
+        private:
+            void WriteAll(const char* data, size_t bytes)
+            {
+                while (bytes > 0 && !failed_)
+                {
+                    ssize_t written = ::write(fd_, data, bytes);
+                    if (written < 0)
+                    {
+                        if (errno == EINTR) continue;
+                        failed_ = true;
+                        error_ = errno;
+                        return;
+                    }
+                    data += written;
+                    bytes -= static_cast<size_t>(written);
+                }
+            }
+
+            int fd_;
+            size_t size_;
+            std::vector<char> buffer_;
+            bool failed_;
+            int error_;
+        };
+
+        /**
+         * Reads the header of a file through a buffer
+        */
+        class HeaderReader
+        {
+        public:
+            /**
+             * @param fd File read from
+             * @param file_bytes Size of the file
+            */
+            HeaderReader(int fd, size_t file_bytes) :
+                fd_(fd), file_bytes_(file_bytes), pos_(0), begin_(0), buffer_()
+            {
+
+            }
+
+            /**
+             * @param data Returned bytes
+             * @param bytes Number of bytes
+             * @returns False if the file ends first or cannot be read
+            */
+            bool Read(void* data, size_t bytes)
+            {
+                char* dst = static_cast<char*>(data);
+                while (bytes > 0)
+                {
+                    if (pos_ < begin_ || pos_ >= begin_ + buffer_.size())
+                    {
+                        if (!Fill()) return false;
+                    }
+                    size_t available = begin_ + buffer_.size() - pos_;
+                    size_t n = std::min(bytes, available);
+                    std::memcpy(dst, buffer_.data() + (pos_ - begin_), n);
+                    pos_ += n;
+                    dst += n;
+                    bytes -= n;
+                }
+                return true;
+            }
+
+            /**
+             * @param value Returned little endian integer
+             * @returns False if the file ends first or cannot be read
+            */
+            template<typename T>
+            bool ReadInt(T& value)
+            {
+                unsigned char bytes[sizeof(T)];
+                if (!Read(bytes, sizeof(T))) return false;
+
+                uint64_t result = 0;
+                for (size_t i = 0; i < sizeof(T); ++i)
+                {
+                    result |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+                }
+                value = static_cast<T>(result);
+                return true;
+            }
+
+            /**
+             * @returns Offset of the next byte to read
+            */
+            size_t position() const
+            {
+                return pos_;
+            }
+
+        private:
+            bool Fill()
+            {
+                if (pos_ >= file_bytes_) return false;
+
+                buffer_.resize(std::min<size_t>(64 << 10, file_bytes_ - pos_));
+                begin_ = pos_;
+                size_t done = 0;
+                while (done < buffer_.size())
+                {
+                    ssize_t n = ::pread(fd_, buffer_.data() + done, buffer_.size() - done,
+                        static_cast<off_t>(begin_ + done));
+                    if (n < 0 && errno == EINTR) continue;
+                    if (n <= 0) return false;
+                    done += static_cast<size_t>(n);
+                }
+                return true;
+            }
+
+            int fd_;
+            size_t file_bytes_;
+            size_t pos_;
+            size_t begin_;
+            std::vector<char> buffer_;
+        };
+
+        // Entry of a tensor in the header
+        struct Entry
+        {
+            std::string name;
+            DataType dtype;
+            LayoutArray shape;
+            uint64_t offset;
+            uint64_t bytes;
+        };
+
+        /**
+         * Parses the header of a checkpoint
+         *
+         * @param fd File read from
+         * @param file_bytes Size of the file
+         * @param entries Returned entries
+         * @returns Non-ok status if the header is invalid
+        */
+        Status ReadHeader(int fd, size_t file_bytes, std::vector<Entry>& entries)
+        {
+            HeaderReader reader(fd, file_bytes);
+            char magic[sizeof(kMagic)];
+            uint32_t version = 0;
+            uint32_t count = 0;
+            if (!reader.Read(magic, sizeof(magic)) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0)
+            {
+                return Status(3, "Not a checkpoint file");
+            }
+            if (!reader.ReadInt(version) || !reader.ReadInt(count))
+            {
+                return Status(3, "Truncated checkpoint header");
+            }
+            if (version == 0 || version > kCheckpointVersion)
+            {
+                return Status(4, "Unsupported checkpoint version ", version);
+            }
+
+            constexpr size_t kNumDataTypes = sizeof(kDataTypeSize) / sizeof(kDataTypeSize[0]);
+            entries.clear();
+            entries.reserve(std::min<size_t>(count, file_bytes / kCheckpointAlignment + 1));
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                Entry entry;
+                uint32_t name_bytes = 0;
+                uint32_t dtype = 0;
+                uint32_t rank = 0;
+                if (!reader.ReadInt(name_bytes) || name_bytes > kMaxNameBytes)
+                {
+                    return Status(3, "Truncated or corrupt entry ", i);
+                }
+                entry.name.resize(name_bytes);
+                if (!reader.Read(&entry.name[0], name_bytes) ||
+                    !reader.ReadInt(dtype) || !reader.ReadInt(rank))
+                {
+                    return Status(3, "Truncated entry ", i);
+                }
+                if (dtype >= kNumDataTypes || rank > GRAPHLOOM_MAX_LAYOUT)
+                {
+                    return Status(3, "Invalid DataType or rank of tensor \"", entry.name, "\"");
+                }
+
+                entry.dtype = static_cast<DataType>(dtype);
+                entry.shape.Resize(rank);
+                for (size_t& dim : entry.shape)
+                {
+                    uint64_t value = 0;
+                    if (!reader.ReadInt(value)) return Status(3, "Truncated entry ", i);
+                    dim = static_cast<size_t>(value);
+                }
+                if (!reader.ReadInt(entry.offset) || !reader.ReadInt(entry.bytes))
+                {
+                    return Status(3, "Truncated entry ", i);
+                }
+                entries.push_back(std::move(entry));
+            }
+
+            // payloads follow the header, inside the file
+            for (const Entry& entry : entries)
+            {
+                size_t size = 1;
+                bool overflow = false;
+                for (size_t dim : entry.shape)
+                {
+                    overflow |= dim != 0 && size > SIZE_MAX / dim;
+                    size *= dim;
+                }
+                overflow |= size > SIZE_MAX / DataTypeSize(entry.dtype);
+
+                if (overflow || entry.bytes != size * DataTypeSize(entry.dtype) ||
+                    entry.offset % kCheckpointAlignment != 0 ||
+                    entry.offset < reader.position() || entry.offset > file_bytes ||
+                    entry.bytes > file_bytes - entry.offset)
+                {
+                    return Status(3, "Corrupt payload of tensor \"", entry.name, "\"");
+                }
+            }
+            return Status::kOK;
+        }
+
+        /**
+         * Reads bytes at offset of a file
+         *
+         * @returns errno of the failure, 0 on success
+        */
+        int ReadAll(int fd, char* data, size_t bytes, size_t offset)
+        {
+            while (bytes > 0)
+            {
+                ssize_t n = ::pread(fd, data, bytes, static_cast<off_t>(offset));
+                if (n < 0 && errno == EINTR) continue;
+                if (n < 0) return errno;
+                if (n == 0) return EIO;
+
+                data += n;
+                offset += static_cast<size_t>(n);
+                bytes -= static_cast<size_t>(n);
+            }
+            return 0;
+        }
+    }
+
+    /**
+     * Checkpoint Impl
+    */
+
+    Status Checkpoint::Save(const std::string& path,
+        const std::vector<std::pair<std::string, const TensorBuffer*>>& tensors,
+        const CheckpointSaveOptions& options)
+    {
+        std::unordered_set<std::string> names;
+        uint64_t header_bytes = sizeof(kMagic) + 2 * sizeof(uint32_t);
+        for (const std::pair<std::string, const TensorBuffer*>& tensor : tensors)
+        {
+            if (tensor.second == nullptr || tensor.second->device() == nullptr)
+            {
+                return Status(1, "Cannot save tensor \"", tensor.first, "\" without storage");
+            }
+            if (tensor.second->device()->type() != "CPU")
+            {
+                return Status(1, "Cannot save tensor \"", tensor.first, "\", only CPU tensors are supported");
+            }
+            if (tensor.first.size() > kMaxNameBytes || !names.insert(tensor.first).second)
+            {
+                return Status(2, "Tensor name \"", tensor.first, "\" is too long or repeated");
+            }
+            header_bytes += EntryBytes(tensor.first, tensor.second->shape().rank());
+        }
+        if (tensors.size() > UINT32_MAX)
+        {
+            return Status(2, "Cannot save more than ", UINT32_MAX, " tensors");
+        }
+
+        // the header is small, payloads are streamed
+        std::vector<char> header;
+        header.reserve(header_bytes);
+        header.insert(header.end(), kMagic, kMagic + sizeof(kMagic));
+        PutInt<uint32_t>(header, kCheckpointVersion);
+        PutInt<uint32_t>(header, static_cast<uint32_t>(tensors.size()));
+
+        uint64_t offset = AlignUp(header_bytes);
+        for (const std::pair<std::string, const TensorBuffer*>& tensor : tensors)
+        {
+            const TensorBuffer& buffer = *tensor.second;
+            PutInt<uint32_t>(header, static_cast<uint32_t>(tensor.first.size()));
+            header.insert(header.end(), tensor.first.begin(), tensor.first.end());
+            PutInt<uint32_t>(header, static_cast<uint32_t>(buffer.dtype()));
+            PutInt<uint32_t>(header, static_cast<uint32_t>(buffer.shape().rank()));
+            for (size_t dim : buffer.shape())
+            {
+                PutInt<uint64_t>(header, dim);
+            }
+            PutInt<uint64_t>(header, offset);
+            PutInt<uint64_t>(header, buffer.bytes());
+            offset = AlignUp(offset + buffer.bytes());
+        }
+
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0)
+        {
+            return Status(3, "Cannot open \"", path, "\": ", std::strerror(errno));
+        }
+        FileCloser closer{fd};
+
+        FileWriter writer(fd, options.buffer_bytes);
+        writer.Append(header.data(), header.size());
+        uint64_t written = header.size();
+        for (const std::pair<std::string, const TensorBuffer*>& tensor : tensors)
+        {
+            const TensorBuffer& buffer = *tensor.second;
+            writer.Pad(AlignUp(written) - written);
+            written = AlignUp(written);
+
+            const char* src = static_cast<const char*>(buffer.data());
+            if (buffer.IsContiguous())
+            {
+                writer.Append(src, buffer.bytes());
+                written += buffer.bytes();
+                continue;
+            }
+
+            // strided views are packed row by row through the buffer
+            size_t element = DataTypeSize(buffer.dtype());
+            const LayoutArray& shape = buffer.shape();
+            const LayoutArray& strides = buffer.strides();
+            size_t rank = shape.rank();
+            size_t inner = shape[rank - 1];
+            size_t inner_stride = strides[rank - 1];
+            size_t rows = buffer.size() / inner;
+            size_t index[GRAPHLOOM_MAX_LAYOUT] = {};
+            for (size_t row = 0; row < rows; ++row)
+            {
+                size_t row_offset = 0;
+                for (size_t i = 0; i + 1 < rank; ++i)
+                {
+                    row_offset += index[i] * strides[i];
+                }
+
+                if (inner_stride == 1)
+                {
+                    writer.Append(src + row_offset * element, inner * element);
+                }
+                else
+                {
+                    for (size_t j = 0; j < inner; ++j)
+                    {
+                        writer.Append(src + (row_offset + j * inner_stride) * element, element);
+                    }
+                }
+
+                for (size_t i = rank - 1; i-- > 0;)
+                {
+                    if (++index[i] < shape[i]) break;
+                    index[i] = 0;
+                }
+            }
+            written += buffer.bytes();
+        }
+        writer.Flush();
+
+        if (writer.error() != 0)
+        {
+            return Status(4, "Cannot write \"", path, "\": ", std::strerror(writer.error()));
+        }
+        return Status::kOK;
+    }
+
+    Status Checkpoint::Load(const std::string& path, Device* device,
+        std::unordered_map<std::string, TensorBuffer>& tensors,
+        const CheckpointLoadOptions& options)
+    {
+        if (device == nullptr || device->type() != "CPU")
+        {
+            return Status(1, "Checkpoints can only be loaded to CPU devices");
+        }
+
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return Status(2, "Cannot open \"", path, "\": ", std::strerror(errno));
+        }
+        FileCloser closer{fd};
+
+        struct stat info;
+        if (::fstat(fd, &info) != 0)
+        {
+            return Status(2, "Cannot stat \"", path, "\": ", std::strerror(errno));
+        }
+
+        std::vector<Entry> entries;
+        Status status = ReadHeader(fd, static_cast<size_t>(info.st_size), entries);
+        if (!status.ok()) return status;
+
+        std::unordered_map<std::string, TensorBuffer> loaded;
+        loaded.reserve(entries.size());
+        for (const Entry& entry : entries)
+        {
+            if (loaded.count(entry.name) != 0)
+            {
+                return Status(3, "Tensor name \"", entry.name, "\" is repeated");
+            }
+
+            TensorBuffer& tensor = loaded[entry.name];
+            if (options.mode == CheckpointLoadMode::Map)
+            {
+                status = TensorBuffer::MapFile(path, entry.offset, entry.dtype,
+                    entry.shape, device, options.map_options, tensor);
+                if (!status.ok()) return status;
+            }
+            else
+            {
+                tensor = TensorBuffer(entry.dtype, entry.shape, device);
+            }
+        }
+
+        if (options.mode == CheckpointLoadMode::Read)
+        {
+            // payloads split into chunks that threads pread at once
+            struct Chunk
+            {
+                char* data;
+                size_t bytes;
+                size_t offset;
+            };
+            std::vector<Chunk> chunks;
+            for (const Entry& entry : entries)
+            {
+                char* data = static_cast<char*>(loaded[entry.name].data());
+                for (size_t done = 0; done < entry.bytes; done += kReadChunkBytes)
+                {
+                    size_t bytes = std::min<size_t>(kReadChunkBytes, entry.bytes - done);
+                    chunks.push_back({data + done, bytes, entry.offset + done});
+                }
+            }
+
+            size_t threads = options.read_threads;
+            if (threads == 0) threads = std::max<unsigned>(1, std::thread::hardware_concurrency());
+            threads = std::min(threads, std::max<size_t>(1, chunks.size()));
+
+            std::atomic<int> error(0);
+            auto read = [&](size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end && error.load(std::memory_order_relaxed) == 0; ++i)
+                {
+                    int result = ReadAll(fd, chunks[i].data, chunks[i].bytes, chunks[i].offset);
+                    if (result != 0) error.store(result);
+                }
+            };
+
+            if (threads > 1)
+            {
+                // the caller reads too, the pool adds the other threads
+                ThreadPool pool(threads - 1, 0);
+                pool.ParallelFor(chunks.size(), threads, 1, read);
+            }
+            else
+            {
+                read(0, chunks.size());
+            }
+
+            if (error.load() != 0)
+            {
+                return Status(5, "Cannot read \"", path, "\": ", std::strerror(error.load()));
+            }
+        }
+
+        tensors = std::move(loaded);
+        return Status::kOK;
+    }
+}
@@ -0,0 +1,119 @@
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tensor/mapped_storage.h"
+
+namespace graphloom
+{
+    namespace
+    {
+        /**
+         * @param advice Access hint
+         * @returns madvise advice of the hint
+        */
+        int MadviseAdvice(MapAdvice advice)
+        {
+            switch (advice)
+            {
+            case MapAdvice::Sequential: return MADV_SEQUENTIAL;
+            case MapAdvice::Random:     return MADV_RANDOM;
+            case MapAdvice::WillNeed:   return MADV_WILLNEED;
+            default:                    return MADV_NORMAL;
+            }
+        }
+    }
+
+    /**
+     * MappedStorage Impl
+    */
+
+    Status MappedStorage::Map(Device* device, const std::string& path, size_t offset, 
+        size_t bytes, const MapFileOptions& options, std::shared_ptr<TensorStorage>& storage)
+    {
+        if (device == nullptr || device->type() != "CPU")
+        {
+            return Status(1, "Files can only be mapped to CPU devices");
+        }
+
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return Status(2, "Cannot open \"", path, "\": ", std::strerror(errno));
+        }
+
+        struct stat info;
+        if (::fstat(fd, &info) != 0)
+        {
+            int error = errno;
+            ::close(fd);
+            return Status(2, "Cannot stat \"", path, "\": ", std::strerror(error));
+        }
+
+        size_t file_bytes = static_cast<size_t>(info.st_size);
+        if (offset > file_bytes || bytes > file_bytes - offset)
+        {
+            ::close(fd);
+            return Status(3, "Region [", offset, ", ", offset + bytes, 
+                ") is past the end of \"", path, "\" of ", file_bytes, " bytes");
+        }
+
+        // mmap offsets must be page aligned, the region starts 
+        // inside the first page. An empty region still maps 
+        // a page so the tensor has a valid address.
+        size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        size_t aligned = offset - offset % page;
+        size_t mapping_bytes = offset - aligned + bytes;
+        if (mapping_bytes == 0) mapping_bytes = 1;
+
+        bool writable = options.mode == MapMode::CopyOnWrite;
+        int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+        int flags = writable ? MAP_PRIVATE : MAP_SHARED;
+        void* mapping = ::mmap(nullptr, mapping_bytes, prot, flags, fd, static_cast<off_t>(aligned));
+        int error = errno;
+
+        // the mapping keeps the file referenced
+        ::close(fd);
+        if (mapping == MAP_FAILED)
+        {
+            return Status(4, "Cannot map \"", path, "\": ", std::strerror(error));
+        }
+
+        // the hint is best effort, a refused one is not an error
+        if (options.advice != MapAdvice::Normal)
+        {
+            ::madvise(mapping, mapping_bytes, MadviseAdvice(options.advice));
+        }
+
+        storage.reset(new MappedStorage(device, mapping, mapping_bytes, 
+            offset - aligned, bytes, writable));
+        return Status::kOK;
+    }
+
+    MappedStorage::MappedStorage(Device* device, void* mapping, size_t mapping_bytes, 
+        size_t offset, size_t bytes, bool writable) :
+        TensorStorage(device, static_cast<char*>(mapping) + offset, bytes),
+        mapping_(mapping), mapping_bytes_(mapping_bytes), writable_(writable)
+    {
+
+    }
+
+    MappedStorage::~MappedStorage()
+    {
+        ::munmap(mapping_, mapping_bytes_);
+    }
+
+    bool MappedStorage::owns_data() const
+    {
+        return true;
+    }
+
+    bool MappedStorage::writable() const
+    {
+        return writable_;
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef GRAPHLOOM_TENSOR_MAPPED_STORAGE_H_
+#define GRAPHLOOM_TENSOR_MAPPED_STORAGE_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "graphloom/common/status.h"
+#include "graphloom/tensor/tensor.h"
+
+/**
+ * This module defines the MappedStorage, tensor memory
+ * backed by an mmap of a file region. Pages are read
+ * on first touch and a read only mapping is shared 
+ * through the page cache with every process mapping 
+ * the same file. Mappings start on a page boundary, 
+ * the storage's data points at the requested offset 
+ * inside the first page.
+*/
+
+namespace graphloom
+{
+    class MappedStorage : public TensorStorage
+    {
+    public:
+        /**
+         * Maps bytes of the file at path starting at offset
+         * 
+         * @param device CPU device the memory is accessed from
+         * @param path Path of the file
+         * @param offset Byte offset of the region in the file
+         * @param bytes Number of bytes of the region
+         * @param options Mapping mode and access hint
+         * @param storage Returned storage
+         * @returns Non-ok status if the region cannot be mapped
+        */
+        static Status Map(Device* device, const std::string& path, size_t offset, 
+            size_t bytes, const MapFileOptions& options, std::shared_ptr<TensorStorage>& storage);
+
+        ~MappedStorage() override;
+
+        /**
+         * @returns True, the mapping is released with the storage
+        */
+        bool owns_data() const override;
+
+        /**
+         * @returns False for read only mappings
+        */
+        bool writable() const override;
+
+    private:
+        /**
+         * @param device CPU device the memory is accessed from
+         * @param mapping Start of the page aligned mapping
+         * @param mapping_bytes Length of the mapping
+         * @param offset Byte offset of the region into the mapping
+         * @param bytes Number of bytes of the region
+         * @param writable False for read only mappings
+        */
+        MappedStorage(Device* device, void* mapping, size_t mapping_bytes, 
+            size_t offset, size_t bytes, bool writable);
+
+        void* mapping_;
+        size_t mapping_bytes_;
+        bool writable_;
+    };
+}
+
+#endif
@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <cmath>
+
+#include "graphloom/common/status.h"
+#include "graphloom/tensor/quantization.h"
+
+namespace graphloom
+{
+    namespace
+    {
+        void CheckQuantParam(float scale, int32_t zero_point)
+        {
+            if (!(scale > 0.0f) || !std::isfinite(scale))
+            {
+                throw GlException("Quantization scale must be positive and finite, got ", scale);
+            }
+            if (zero_point < -128 || zero_point > 127)
+            {
+                throw GlException("Quantization zero point ", zero_point, " is out of the Int8 range");
+            }
+        }
+
+        /**
+         * @returns Contiguous x, throws if x is not a Float tensor
+        */
+        TensorBuffer ContiguousFloat(const TensorBuffer& x)
+        {
+            if (x.dtype() != DataType::Float)
+            {
+                throw GlException("Expected a Float tensor to quantize");
+            }
+            return x.Contiguous();
+        }
+
+        /**
+         * Splits a contiguous shape around axis
+         *
+         * @param outer Returned product of the dimensions before axis
+         * @param inner Returned product of the dimensions after axis
+        */
+        void SplitAxis(const LayoutArray& shape, size_t axis, size_t& outer, size_t& inner)
+        {
+            outer = 1;
+            inner = 1;
+            for (size_t i = 0; i < shape.rank(); ++i)
+            {
+                if (i < axis) outer *= shape[i];
+                if (i > axis) inner *= shape[i];
+            }
+        }
+    }
+
+    /**
+     * QuantParams Impl
+    */
+
+    QuantParams QuantParams::PerTensor(float scale, int32_t zero_point)
+    {
+        CheckQuantParam(scale, zero_point);
+
+        QuantParams params;
+        params.scales_ = {scale};
+        params.zero_points_ = {zero_point};
+        return params;
+    }
+
+    QuantParams QuantParams::PerChannel(size_t axis, const std::vector<float>& scales,
+        const std::vector<int32_t>& zero_points)
+    {
+        if (scales.empty() || scales.size() != zero_points.size())
+        {
+            throw GlException("Per channel quantization needs one scale and zero point per channel, got ",
+                scales.size(), " scales and ", zero_points.size(), " zero points");
+        }
+        for (size_t i = 0; i < scales.size(); ++i)
+        {
+            CheckQuantParam(scales[i], zero_points[i]);
+        }
+
+        QuantParams params;
+        params.scales_ = scales;
+        params.zero_points_ = zero_points;
+        params.axis_ = axis;
+        params.per_channel_ = true;
+        return params;
+    }
+
+    bool QuantParams::per_channel() const
+    {
+        return per_channel_;
+    }
+
+    size_t QuantParams::axis() const
+    {
+        return axis_;
+    }
+
+    size_t QuantParams::num_channels() const
+    {
+        return scales_.size();
+    }
+
+    float QuantParams::scale(size_t channel) const
+    {
+        return scales_[channel];
+    }
+
+    int32_t QuantParams::zero_point(size_t channel) const
+    {
+        return zero_points_[channel];
+    }
+
+    const float* QuantParams::scales() const
+    {
+        return scales_.data();
+    }
+
+    const int32_t* QuantParams::zero_points() const
+    {
+        return zero_points_.data();
+    }
+
+    /**
+     * Quantization helpers Impl
+    */
+
+    QuantParams ChooseQuantParams(float min, float max)
+    {
+        min = std::min(min, 0.0f);
+        max = std::max(max, 0.0f);
+
+        float scale = (max - min) / 255.0f;
+        if (!(scale > 0.0f) || !std::isfinite(scale))
+        {
+            // all zeros, any scale represents them
+            return QuantParams::PerTensor(1.0f, 0);
+        }
+
+        float zero_point = std::nearbyint(-128.0f - min / scale);
+        zero_point = std::min(std::max(zero_point, -128.0f), 127.0f);
+        return QuantParams::PerTensor(scale, static_cast<int32_t>(zero_point));
+    }
+
+    QuantParams ChooseQuantParams(const TensorBuffer& x)
+    {
+        const TensorBuffer contiguous = ContiguousFloat(x);
+        const float* data = contiguous.Map<float>().data();
+
+        float min = 0.0f;
+        float max = 0.0f;
+        for (size_t i = 0; i < contiguous.size(); ++i)
+        {
+            min = std::min(min, data[i]);
+            max = std::max(max, data[i]);
+        }
+        return ChooseQuantParams(min, max);
+    }
+
+    QuantParams ChooseChannelQuantParams(const TensorBuffer& x, size_t axis)
+    {
+        if (axis >= x.shape().rank())
+        {
+            throw GlException("Channel axis ", axis, " of rank ", x.shape().rank(), " tensor");
+        }
+
+        const TensorBuffer contiguous = ContiguousFloat(x);
+        const float* data = contiguous.Map<float>().data();
+        size_t channels = x.shape()[axis];
+        size_t outer, inner;
+        SplitAxis(x.shape(), axis, outer, inner);
+
+        std::vector<float> max_abs(channels, 0.0f);
+        for (size_t o = 0; o < outer; ++o)
+        {
+            for (size_t c = 0; c < channels; ++c)
+            {
+                const float* run = data + (o * channels + c) * inner;
+                for (size_t i = 0; i < inner; ++i)
+                {
+                    max_abs[c] = std::max(max_abs[c], std::fabs(run[i]));
+                }
+            }
+        }
+
+        std::vector<float> scales(channels);
+        for (size_t c = 0; c < channels; ++c)
+        {
+            scales[c] = max_abs[c] > 0.0f ? max_abs[c] / 127.0f : 1.0f;
+        }
+        return QuantParams::PerChannel(axis, scales, std::vector<int32_t>(channels, 0));
+    }
+
+    TensorBuffer QuantizeTensor(const TensorBuffer& x, const QuantParams& params)
+    {
+        const TensorBuffer contiguous = ContiguousFloat(x);
+        TensorBuffer result(DataType::Int8, x.shape(), x.device());
+        result.set_quant_params(params);
+
+        size_t axis = params.per_channel() ? params.axis() : 0;
+        size_t channels = params.per_channel() ? params.num_channels() : 1;
+        size_t outer = 1, inner = x.size();
+        if (params.per_channel()) SplitAxis(x.shape(), axis, outer, inner);
+
+        const float* src = contiguous.Map<float>().data();
+        int8_t* dst = result.Map<int8_t>().data();
+        for (size_t o = 0; o < outer; ++o)
+        {
+            for (size_t c = 0; c < channels; ++c)
+            {
+                float inv_scale = 1.0f / params.scale(c);
+                int32_t zero_point = params.zero_point(c);
+                size_t first = (o * channels + c) * inner;
+                for (size_t i = first; i < first + inner; ++i)
+                {
+                    dst[i] = QuantizeValue(src[i], inv_scale, zero_point);
+                }
+            }
+        }
+        return result;
+    }
+
+    TensorBuffer DequantizeTensor(const TensorBuffer& q)
+    {
+        const QuantParams* params = q.quant_params();
+        if (q.dtype() != DataType::Int8 || params == nullptr)
+        {
+            throw GlException("Expected a quantized Int8 tensor to dequantize");
+        }
+
+        const TensorBuffer contiguous = q.Contiguous();
+        TensorBuffer result(DataType::Float, q.shape(), q.device());
+
+        size_t channels = params->num_channels();
+        size_t outer = 1, inner = q.size();
+        if (params->per_channel()) SplitAxis(q.shape(), params->axis(), outer, inner);
+
+        const int8_t* src = contiguous.Map<int8_t>().data();
+        float* dst = result.Map<float>().data();
+        for (size_t o = 0; o < outer; ++o)
+        {
+            for (size_t c = 0; c < channels; ++c)
+            {
+                size_t first = (o * channels + c) * inner;
+                for (size_t i = first; i < first + inner; ++i)
+                {
+                    dst[i] = DequantizeValue(src[i], params->scale(c), params->zero_point(c));
+                }
+            }
+        }
+        return result;
+    }
+}
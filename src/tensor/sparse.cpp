@@ -0,0 +1,448 @@
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "graphloom/common/status.h"
+#include "graphloom/tensor/sparse.h"
+
+namespace graphloom
+{
+    namespace
+    {
+        /**
+         * @returns Contiguous x, throws unless x is a rank 1 Int32 tensor
+        */
+        TensorBuffer CheckIndices(const TensorBuffer& x, const char* name)
+        {
+            if (x.dtype() != DataType::Int32 || x.shape().rank() != 1)
+            {
+                throw GlException("Sparse ", name, " must be a rank 1 Int32 tensor");
+            }
+            return x.Contiguous();
+        }
+
+        void CheckValueType(DataType dtype)
+        {
+            if (dtype != DataType::Float && dtype != DataType::Double)
+            {
+                throw GlException("Sparse values must be Float or Double, got dtype ", dtype);
+            }
+        }
+
+        void CheckShape(const LayoutArray& shape)
+        {
+            if (shape.rank() != 2)
+            {
+                throw GlException("Sparse tensors are matrices, got rank ", shape.rank());
+            }
+            if (shape[0] > size_t(std::numeric_limits<int32_t>::max()) ||
+                shape[1] > size_t(std::numeric_limits<int32_t>::max()))
+            {
+                throw GlException("Sparse dimensions must fit Int32 indices");
+            }
+        }
+
+        /**
+         * Throws unless offsets are count + 1 non decreasing
+         * offsets from 0 to nnz
+        */
+        void CheckOffsets(const TensorBuffer& offsets, size_t count, size_t nnz)
+        {
+            if (offsets.size() != count + 1)
+            {
+                throw GlException("Expected ", count + 1, " sparse row offsets, got ", offsets.size());
+            }
+
+            const int32_t* data = offsets.Map<int32_t>().data();
+            if (data[0] != 0 || size_t(data[count]) != nnz)
+            {
+                throw GlException("Sparse row offsets must span [0, ", nnz, "]");
+            }
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (data[i] > data[i + 1])
+                {
+                    throw GlException("Sparse row offsets decrease at row ", i);
+                }
+            }
+        }
+
+        /**
+         * Throws unless every index is in [0, bound)
+        */
+        void CheckBounds(const TensorBuffer& indices, size_t bound)
+        {
+            const int32_t* data = indices.Map<int32_t>().data();
+            for (size_t i = 0; i < indices.size(); ++i)
+            {
+                if (data[i] < 0 || size_t(data[i]) >= bound)
+                {
+                    throw GlException("Sparse index ", data[i], " out of [0, ", bound, ")");
+                }
+            }
+        }
+
+        TensorBuffer MakeIndices(const std::vector<int32_t>& indices, Device* device)
+        {
+            TensorBuffer result(DataType::Int32, {indices.size()}, device);
+            std::copy(indices.begin(), indices.end(), result.Map<int32_t>().data());
+            return result;
+        }
+
+        /**
+         * Collects the nonzero blocks of a contiguous dense
+         * matrix in Bsr order, a block of 1 x 1 is a value
+        */
+        template<typename T>
+        void CollectBlocks(const TensorBuffer& dense, size_t block_rows, size_t block_cols,
+            std::vector<int32_t>& rows, std::vector<int32_t>& offsets,
+            std::vector<int32_t>& cols, std::vector<T>& values)
+        {
+            const T* data = dense.Map<T>().data();
+            size_t n = dense.shape()[1];
+            size_t row_blocks = dense.shape()[0] / block_rows;
+            size_t col_blocks = n / block_cols;
+
+            offsets.push_back(0);
+            for (size_t rb = 0; rb < row_blocks; ++rb)
+            {
+                for (size_t cb = 0; cb < col_blocks; ++cb)
+                {
+                    const T* block = data + rb * block_rows * n + cb * block_cols;
+                    bool nonzero = false;
+                    for (size_t r = 0; r < block_rows && !nonzero; ++r)
+                    {
+                        for (size_t c = 0; c < block_cols && !nonzero; ++c)
+                        {
+                            nonzero = block[r * n + c] != T(0);
+                        }
+                    }
+                    if (!nonzero) continue;
+
+                    rows.push_back(static_cast<int32_t>(rb));
+                    cols.push_back(static_cast<int32_t>(cb));
+                    for (size_t r = 0; r < block_rows; ++r)
+                    {
+                        values.insert(values.end(), block + r * n, block + r * n + block_cols);
+                    }
+                }
+                offsets.push_back(static_cast<int32_t>(cols.size()));
+            }
+
+            if (cols.empty())
+            {
+                // tensors have no 0 dims, a matrix of zeros
+                // stores a zero block in its last block row
+                rows.push_back(static_cast<int32_t>(row_blocks - 1));
+                cols.push_back(0);
+                values.resize(block_rows * block_cols, T(0));
+                offsets.back() = 1;
+            }
+        }
+
+        template<typename T>
+        SparseTensor FromDenseTyped(const TensorBuffer& dense, SparseFormat format,
+            size_t block_rows, size_t block_cols)
+        {
+            const TensorBuffer contiguous = dense.Contiguous();
+            std::vector<int32_t> rows, offsets, cols;
+            std::vector<T> values;
+            CollectBlocks<T>(contiguous, block_rows, block_cols, rows, offsets, cols, values);
+            if (values.size() > size_t(std::numeric_limits<int32_t>::max()))
+            {
+                throw GlException("Sparse tensors hold at most 2^31 - 1 values, got ", values.size());
+            }
+
+            Device* device = dense.device();
+            TensorBuffer value_tensor(dense.dtype(), {values.size()}, device);
+            if (format == SparseFormat::Bsr)
+            {
+                value_tensor = TensorBuffer(dense.dtype(), {cols.size(), block_rows, block_cols}, device);
+            }
+            std::copy(values.begin(), values.end(), value_tensor.Map<T>().data());
+
+            if (format == SparseFormat::Coo)
+            {
+                return SparseTensor::Coo(dense.shape(), MakeIndices(rows, device),
+                    MakeIndices(cols, device), value_tensor);
+            }
+            if (format == SparseFormat::Csr)
+            {
+                return SparseTensor::Csr(dense.shape(), MakeIndices(offsets, device),
+                    MakeIndices(cols, device), value_tensor);
+            }
+            return SparseTensor::Bsr(dense.shape(), MakeIndices(offsets, device),
+                MakeIndices(cols, device), value_tensor);
+        }
+
+        template<typename T>
+        SparseTensor ToCsrTyped(const SparseTensor& sparse)
+        {
+            Device* device = sparse.values().device();
+            size_t m = sparse.shape()[0];
+            std::vector<int32_t> offsets(m + 1, 0);
+            TensorBuffer cols(DataType::Int32, {sparse.nnz()}, device);
+            TensorBuffer values(sparse.dtype(), {sparse.nnz()}, device);
+            int32_t* out_cols = cols.Map<int32_t>().data();
+            T* out_values = values.Map<T>().data();
+            const int32_t* in_cols = sparse.col_indices().Map<int32_t>().data();
+            const T* in_values = sparse.values().Map<T>().data();
+
+            if (sparse.format() == SparseFormat::Coo)
+            {
+                // sorted by row, only the offsets are new
+                const int32_t* rows = sparse.row_indices().Map<int32_t>().data();
+                for (size_t i = 0; i < sparse.nnz(); ++i) ++offsets[rows[i] + 1];
+                for (size_t i = 0; i < m; ++i) offsets[i + 1] += offsets[i];
+                std::copy(in_cols, in_cols + sparse.nnz(), out_cols);
+                std::copy(in_values, in_values + sparse.nnz(), out_values);
+                return SparseTensor::Csr(sparse.shape(), MakeIndices(offsets, device), cols, values);
+            }
+
+            // Bsr, each block row expands into block_rows rows
+            size_t br = sparse.block_rows();
+            size_t bc = sparse.block_cols();
+            const int32_t* block_offsets = sparse.row_offsets().Map<int32_t>().data();
+            size_t next = 0;
+            for (size_t rb = 0; rb < m / br; ++rb)
+            {
+                for (size_t r = 0; r < br; ++r)
+                {
+                    for (int32_t b = block_offsets[rb]; b < block_offsets[rb + 1]; ++b)
+                    {
+                        const T* block_row = in_values + (b * br + r) * bc;
+                        for (size_t c = 0; c < bc; ++c)
+                        {
+                            out_cols[next] = static_cast<int32_t>(in_cols[b] * bc + c);
+                            out_values[next] = block_row[c];
+                            ++next;
+                        }
+                    }
+                    offsets[rb * br + r + 1] = static_cast<int32_t>(next);
+                }
+            }
+            return SparseTensor::Csr(sparse.shape(), MakeIndices(offsets, device), cols, values);
+        }
+
+        template<typename T>
+        TensorBuffer ToDenseTyped(const SparseTensor& sparse)
+        {
+            const SparseTensor csr = sparse.ToCsr();
+            TensorBuffer dense(sparse.dtype(), sparse.shape(), sparse.values().device());
+            T* out = dense.Map<T>().data();
+            std::fill(out, out + dense.size(), T(0));
+
+            const int32_t* offsets = csr.row_offsets().Map<int32_t>().data();
+            const int32_t* cols = csr.col_indices().Map<int32_t>().data();
+            const T* values = csr.values().Map<T>().data();
+            size_t n = sparse.shape()[1];
+            for (size_t i = 0; i < sparse.shape()[0]; ++i)
+            {
+                for (int32_t p = offsets[i]; p < offsets[i + 1]; ++p)
+                {
+                    out[i * n + cols[p]] = values[p];
+                }
+            }
+            return dense;
+        }
+    }
+
+    /**
+     * SparseTensor Impl
+    */
+
+    SparseTensor SparseTensor::FromDense(const TensorBuffer& dense, SparseFormat format,
+        size_t block_rows, size_t block_cols)
+    {
+        CheckShape(dense.shape());
+        CheckValueType(dense.dtype());
+        if (format != SparseFormat::Bsr)
+        {
+            block_rows = 1;
+            block_cols = 1;
+        }
+        if (block_rows == 0 || block_cols == 0 ||
+            dense.shape()[0] % block_rows != 0 || dense.shape()[1] % block_cols != 0)
+        {
+            throw GlException("Dense shape (", dense.shape()[0], ", ", dense.shape()[1],
+                ") is not a multiple of the ", block_rows, "x", block_cols, " blocks");
+        }
+
+        if (dense.dtype() == DataType::Float)
+        {
+            return FromDenseTyped<float>(dense, format, block_rows, block_cols);
+        }
+        return FromDenseTyped<double>(dense, format, block_rows, block_cols);
+    }
+
+    SparseTensor SparseTensor::Coo(const LayoutArray& shape, const TensorBuffer& row_indices,
+        const TensorBuffer& col_indices, const TensorBuffer& values)
+    {
+        CheckShape(shape);
+        CheckValueType(values.dtype());
+
+        SparseTensor result;
+        result.format_ = SparseFormat::Coo;
+        result.shape_ = shape;
+        result.rows_ = CheckIndices(row_indices, "row indices");
+        result.cols_ = CheckIndices(col_indices, "column indices");
+        result.values_ = values.Contiguous();
+        if (result.rows_.size() != values.size() || result.cols_.size() != values.size())
+        {
+            throw GlException("Coo expects one row and column index per value");
+        }
+        CheckBounds(result.rows_, shape[0]);
+        CheckBounds(result.cols_, shape[1]);
+
+        const int32_t* rows = result.rows_.Map<int32_t>().data();
+        const int32_t* cols = result.cols_.Map<int32_t>().data();
+        for (size_t i = 1; i < values.size(); ++i)
+        {
+            if (rows[i - 1] > rows[i] || (rows[i - 1] == rows[i] && cols[i - 1] >= cols[i]))
+            {
+                throw GlException("Coo indices must be unique and sorted by row then column, see value ", i);
+            }
+        }
+        return result;
+    }
+
+    SparseTensor SparseTensor::Csr(const LayoutArray& shape, const TensorBuffer& row_offsets,
+        const TensorBuffer& col_indices, const TensorBuffer& values)
+    {
+        CheckShape(shape);
+        CheckValueType(values.dtype());
+
+        SparseTensor result;
+        result.format_ = SparseFormat::Csr;
+        result.shape_ = shape;
+        result.rows_ = CheckIndices(row_offsets, "row offsets");
+        result.cols_ = CheckIndices(col_indices, "column indices");
+        result.values_ = values.Contiguous();
+        if (result.cols_.size() != values.size())
+        {
+            throw GlException("Csr expects one column index per value");
+        }
+        CheckOffsets(result.rows_, shape[0], values.size());
+        CheckBounds(result.cols_, shape[1]);
+        return result;
+    }
+
+    SparseTensor SparseTensor::Bsr(const LayoutArray& shape, const TensorBuffer& row_offsets,
+        const TensorBuffer& col_indices, const TensorBuffer& values)
+    {
+        CheckShape(shape);
+        CheckValueType(values.dtype());
+        if (values.shape().rank() != 3 || values.shape()[1] == 0 || values.shape()[2] == 0)
+        {
+            throw GlException("Bsr values must have shape [blocks, block_rows, block_cols]");
+        }
+
+        size_t block_rows = values.shape()[1];
+        size_t block_cols = values.shape()[2];
+        if (shape[0] % block_rows != 0 || shape[1] % block_cols != 0)
+        {
+            throw GlException("Bsr shape (", shape[0], ", ", shape[1], ") is not a multiple of the ",
+                block_rows, "x", block_cols, " blocks");
+        }
+
+        SparseTensor result;
+        result.format_ = SparseFormat::Bsr;
+        result.shape_ = shape;
+        result.rows_ = CheckIndices(row_offsets, "row offsets");
+        result.cols_ = CheckIndices(col_indices, "column indices");
+        result.values_ = values.Contiguous();
+        if (result.cols_.size() != values.shape()[0])
+        {
+            throw GlException("Bsr expects one block column index per block");
+        }
+        CheckOffsets(result.rows_, shape[0] / block_rows, values.shape()[0]);
+        CheckBounds(result.cols_, shape[1] / block_cols);
+        return result;
+    }
+
+    SparseTensor SparseTensor::ToCsr() const
+    {
+        if (format_ == SparseFormat::Csr)
+        {
+            return *this;
+        }
+        if (dtype() == DataType::Float)
+        {
+            return ToCsrTyped<float>(*this);
+        }
+        return ToCsrTyped<double>(*this);
+    }
+
+    TensorBuffer SparseTensor::ToDense() const
+    {
+        if (dtype() == DataType::Float)
+        {
+            return ToDenseTyped<float>(*this);
+        }
+        return ToDenseTyped<double>(*this);
+    }
+
+    SparseFormat SparseTensor::format() const
+    {
+        return format_;
+    }
+
+    DataType SparseTensor::dtype() const
+    {
+        return values_.dtype();
+    }
+
+    const LayoutArray& SparseTensor::shape() const
+    {
+        return shape_;
+    }
+
+    size_t SparseTensor::nnz() const
+    {
+        return values_.size();
+    }
+
+    size_t SparseTensor::block_rows() const
+    {
+        return format_ == SparseFormat::Bsr ? values_.shape()[1] : 1;
+    }
+
+    size_t SparseTensor::block_cols() const
+    {
+        return format_ == SparseFormat::Bsr ? values_.shape()[2] : 1;
+    }
+
+    size_t SparseTensor::bytes() const
+    {
+        return rows_.bytes() + cols_.bytes() + values_.bytes();
+    }
+
+    const TensorBuffer& SparseTensor::row_indices() const
+    {
+        if (format_ != SparseFormat::Coo)
+        {
+            throw GlException("Only Coo sparse tensors have row indices");
+        }
+        return rows_;
+    }
+
+    const TensorBuffer& SparseTensor::row_offsets() const
+    {
+        if (format_ == SparseFormat::Coo)
+        {
+            throw GlException("Coo sparse tensors have no row offsets");
+        }
+        return rows_;
+    }
+
+    const TensorBuffer& SparseTensor::col_indices() const
+    {
+        return cols_;
+    }
+
+    const TensorBuffer& SparseTensor::values() const
+    {
+        return values_;
+    }
+}
@@ -1,6 +1,10 @@
+#include <cstdint>
+
 #include "graphloom/common/status.h"
 #include "graphloom/tensor/tensor.h"
+#include "graphloom/tensor/quantization.h"
 #include "graphloom/device/device.h"
+#include "tensor/mapped_storage.h"
 
 
 namespace graphloom
@@ -9,6 +13,12 @@ namespace graphloom
      * LayoutArray Impl
     */
 
+    LayoutArray::LayoutArray() : 
+        rank_(0)
+    {
+
+    }
+
     LayoutArray::LayoutArray(const std::initializer_list<size_t>& list)
     {
         Set(list);
@@ -51,30 +61,349 @@ namespace graphloom
         }
     }
 
+    void LayoutArray::Resize(size_t rank)
+    {
+        if (rank > GRAPHLOOM_MAX_LAYOUT)
+        {
+            throw GlException("Only layout size ", GRAPHLOOM_MAX_LAYOUT, " is supported");
+        }
+
+        for (size_t i = rank_; i < rank; ++i)
+        {
+            array_[i] = 1;
+        }
+        rank_ = rank;
+    }
+
+    size_t& LayoutArray::operator[](size_t index)
+    {
+        return array_[index];
+    }
+
+    size_t LayoutArray::NumElements() const
+    {
+        size_t count = 1;
+        for (size_t i = 0; i < rank_; ++i)
+        {
+            count *= array_[i];
+        }
+        return count;
+    }
+
+    namespace
+    {
+        /**
+         * @param shape Tensor shape
+         * @returns Row major packed element strides of shape
+        */
+        LayoutArray ContiguousStrides(const LayoutArray& shape)
+        {
+            LayoutArray strides(shape);
+            size_t stride = 1;
+            for (size_t i = shape.rank(); i-- > 0;)
+            {
+                strides[i] = stride;
+                stride *= shape[i];
+            }
+            return strides;
+        }
+
+        /**
+         * Computes the strides of a reshape that keeps the 
+         * memory in place, splitting or merging dimensions
+         * 
+         * @param shape Current shape
+         * @param strides Current strides
+         * @param new_shape Shape of equal size
+         * @param new_strides Returned strides of new_shape
+         * @returns False if new_shape needs a copy
+        */
+        bool ReshapeStrides(const LayoutArray& shape, const LayoutArray& strides, 
+            const LayoutArray& new_shape, LayoutArray& new_strides)
+        {
+            // size 1 dimensions do not constrain the layout
+            size_t old_dims[GRAPHLOOM_MAX_LAYOUT];
+            size_t old_strides[GRAPHLOOM_MAX_LAYOUT];
+            size_t old_rank = 0;
+            for (size_t i = 0; i < shape.rank(); ++i)
+            {
+                if (shape[i] == 1) continue;
+                old_dims[old_rank] = shape[i];
+                old_strides[old_rank] = strides[i];
+                ++old_rank;
+            }
+
+            new_strides = new_shape;
+            for (size_t& stride : new_strides)
+            {
+                stride = 1;
+            }
+
+            // match groups of old and new dimensions of equal size
+            size_t oi = 0, oj = 1, ni = 0, nj = 1;
+            while (ni < new_shape.rank() && oi < old_rank)
+            {
+                size_t np = new_shape[ni];
+                size_t op = old_dims[oi];
+                while (np != op)
+                {
+                    if (np < op)
+                    {
+                        np *= new_shape[nj++];
+                    }
+                    else
+                    {
+                        op *= old_dims[oj++];
+                    }
+                }
+
+                // the old group must be one contiguous run
+                for (size_t k = oi; k + 1 < oj; ++k)
+                {
+                    if (old_strides[k] != old_dims[k + 1] * old_strides[k + 1])
+                    {
+                        return false;
+                    }
+                }
+
+                new_strides[nj - 1] = old_strides[oj - 1];
+                for (size_t k = nj - 1; k > ni; --k)
+                {
+                    new_strides[k - 1] = new_strides[k] * new_shape[k];
+                }
+                ni = nj++;
+                oi = oj++;
+            }
+            return true;
+        }
+
+        /**
+         * Finds the channel axis of a per channel quantized 
+         * tensor after a reshape
+         * 
+         * @param shape Shape before the reshape
+         * @param axis Channel axis of shape
+         * @param new_shape Shape after the reshape
+         * @param new_axis Returned channel axis of new_shape
+         * @returns False if the reshape splits or merges the channel axis
+        */
+        bool ReshapeChannelAxis(const LayoutArray& shape, size_t axis, 
+            const LayoutArray& new_shape, size_t& new_axis)
+        {
+            size_t outer = 1;
+            for (size_t i = 0; i < axis; ++i)
+            {
+                outer *= shape[i];
+            }
+
+            size_t new_outer = 1;
+            for (size_t i = 0; i < new_shape.rank(); ++i)
+            {
+                if (new_outer == outer && new_shape[i] == shape[axis])
+                {
+                    new_axis = i;
+                    return true;
+                }
+                new_outer *= new_shape[i];
+            }
+            return false;
+        }
+
+        /**
+         * @returns Per channel params moved to axis
+        */
+        std::shared_ptr<const QuantParams> MoveChannelAxis(const QuantParams& params, size_t axis)
+        {
+            return std::make_shared<const QuantParams>(QuantParams::PerChannel(axis,
+                std::vector<float>(params.scales(), params.scales() + params.num_channels()),
+                std::vector<int32_t>(params.zero_points(), params.zero_points() + params.num_channels())));
+        }
+    }
+
+    /**
+     * TensorStorage Impl
+    */
+
+    TensorStorage::TensorStorage(Device* device, size_t bytes) :
+        device_(device), data_(nullptr), bytes_(bytes), owns_data_(true), copies_(0)
+    {
+        GL_CHECK_OK(device->malloc(DataType::Int8, bytes, data_));
+    }
+
+    TensorStorage::TensorStorage(Device* device, void* data, size_t bytes) :
+        device_(device), data_(data), bytes_(bytes), owns_data_(false), copies_(0)
+    {
+
+    }
+
+    TensorStorage::~TensorStorage()
+    {
+        // no status checking because exceptions 
+        // should be avoided in destructor
+        if (owns_data_ && data_ != nullptr)
+        {
+            device_->free(DataType::Int8, data_);
+        }
+        data_ = nullptr;
+    }
+
+    void* TensorStorage::data() const
+    {
+        return data_;
+    }
+
+    size_t TensorStorage::bytes() const
+    {
+        return bytes_;
+    }
+
+    Device* TensorStorage::device() const
+    {
+        return device_;
+    }
+
+    bool TensorStorage::owns_data() const
+    {
+        return owns_data_;
+    }
+
+    bool TensorStorage::writable() const
+    {
+        return true;
+    }
+
+    bool TensorStorage::shared() const
+    {
+        return copies_.load(std::memory_order_acquire) > 0;
+    }
+
+    void TensorStorage::AddCopy()
+    {
+        copies_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void TensorStorage::RemoveCopy()
+    {
+        copies_.fetch_sub(1, std::memory_order_release);
+    }
+
     /**
      * TensorBuffer Impl
     */
 
+    TensorBuffer::TensorBuffer() :
+        offset_(0), size_(0), dtype_(DataType::Float), copy_(false)
+    {
+
+    }
+
     TensorBuffer::TensorBuffer(DataType dtype, const LayoutArray& shape, Device* device) :
-        dtype_(dtype), shape_(shape), device_(device), data_(nullptr)
+        shape_(shape), strides_(ContiguousStrides(shape)), offset_(0), 
+        size_(shape.NumElements()), dtype_(dtype), copy_(false)
     {
-        // compute size in bytes to allocate
-        size_ = DataTypeSize(dtype);
-        for (size_t i = 0; i < shape_.rank(); ++i)
+        if (size_ > SIZE_MAX / DataTypeSize(dtype))
         {
-            size_ *= shape_[i];
+            throw GlException("Tensor of ", size_, " elements overflows size_t bytes");
         }
-        
-        GL_CHECK_OK(device->malloc(this->dtype(), this->size(), data_));
+        storage_ = std::make_shared<TensorStorage>(device, bytes());
+    }
+
+    TensorBuffer::TensorBuffer(DataType dtype, const LayoutArray& shape, Device* device, void* data) :
+        shape_(shape), strides_(ContiguousStrides(shape)), offset_(0), 
+        size_(shape.NumElements()), dtype_(dtype), copy_(false)
+    {
+        storage_ = std::make_shared<TensorStorage>(device, data, bytes());
+    }
+
+    Status TensorBuffer::MapFile(const std::string& path, size_t offset, DataType dtype, 
+        const LayoutArray& shape, Device* device, const MapFileOptions& options, 
+        TensorBuffer& tensor)
+    {
+        size_t size = shape.NumElements();
+        if (size > SIZE_MAX / DataTypeSize(dtype))
+        {
+            return Status(1, "Tensor of ", size, " elements overflows size_t bytes");
+        }
+
+        std::shared_ptr<TensorStorage> storage;
+        Status status = MappedStorage::Map(device, path, offset, 
+            size * DataTypeSize(dtype), options, storage);
+        if (!status.ok()) return status;
+
+        tensor = TensorBuffer(storage, dtype, shape, ContiguousStrides(shape), 0);
+        return Status::kOK;
+    }
+
+    TensorBuffer::TensorBuffer(const std::shared_ptr<TensorStorage>& storage, DataType dtype, 
+        const LayoutArray& shape, const LayoutArray& strides, size_t offset) :
+        storage_(storage), shape_(shape), strides_(strides), offset_(offset), 
+        size_(shape.NumElements()), dtype_(dtype), copy_(false)
+    {
+
     }
 
     TensorBuffer::~TensorBuffer()
     {
-        // no status checking because exceptions 
-        // should be avoided in destructor
-        device_->free(dtype_, data_);
-        data_ = nullptr;
-        size_ = 0;
+        // the storage frees the memory with its last tensor
+        ReleaseCopy();
+    }
+
+    TensorBuffer::TensorBuffer(const TensorBuffer& other) :
+        storage_(other.storage_), shape_(other.shape_), strides_(other.strides_),
+        offset_(other.offset_), size_(other.size_), dtype_(other.dtype_), quant_(other.quant_),
+        copy_(storage_ != nullptr)
+    {
+        if (copy_) storage_->AddCopy();
+    }
+
+    TensorBuffer& TensorBuffer::operator=(const TensorBuffer& other)
+    {
+        if (this != &other)
+        {
+            ReleaseCopy();
+            storage_    = other.storage_;
+            shape_      = other.shape_;
+            strides_    = other.strides_;
+            offset_     = other.offset_;
+            size_       = other.size_;
+            dtype_      = other.dtype_;
+            quant_      = other.quant_;
+            copy_       = storage_ != nullptr;
+
+            if (copy_) storage_->AddCopy();
+        }
+        return *this;
+    }
+
+    TensorBuffer::TensorBuffer(TensorBuffer&& other) noexcept :
+        storage_(std::move(other.storage_)), shape_(other.shape_), strides_(other.strides_),
+        offset_(other.offset_), size_(other.size_), dtype_(other.dtype_), 
+        quant_(std::move(other.quant_)), copy_(other.copy_)
+    {
+        other.offset_ = 0;
+        other.size_ = 0;
+        other.copy_ = false;
+    }
+
+    TensorBuffer& TensorBuffer::operator=(TensorBuffer&& other) noexcept
+    {
+        if (this != &other)
+        {
+            ReleaseCopy();
+            storage_    = std::move(other.storage_);
+            shape_      = other.shape_;
+            strides_    = other.strides_;
+            offset_     = other.offset_;
+            size_       = other.size_;
+            dtype_      = other.dtype_;
+            quant_      = std::move(other.quant_);
+            copy_       = other.copy_;
+
+            other.offset_ = 0;
+            other.size_ = 0;
+            other.copy_ = false;
+        }
+        return *this;
     }
     
     const LayoutArray& TensorBuffer::shape() const
@@ -82,35 +411,375 @@ namespace graphloom
         return shape_;
     }
 
+    const LayoutArray& TensorBuffer::strides() const
+    {
+        return strides_;
+    }
+
+    size_t TensorBuffer::offset() const
+    {
+        return offset_;
+    }
+
     size_t TensorBuffer::size() const
     {
         return size_;
     }
 
+    size_t TensorBuffer::bytes() const
+    {
+        return size_ * DataTypeSize(dtype_);
+    }
+
     DataType TensorBuffer::dtype() const
     {
         return dtype_;
     }
 
+    Device* TensorBuffer::device() const
+    {
+        return storage_ == nullptr ? nullptr : storage_->device();
+    }
+
+    bool TensorBuffer::IsContiguous() const
+    {
+        size_t expected = 1;
+        for (size_t i = shape_.rank(); i-- > 0;)
+        {
+            if (shape_[i] != 1 && strides_[i] != expected) return false;
+            expected *= shape_[i];
+        }
+        return true;
+    }
+
     Status TensorBuffer::Reshape(const std::initializer_list<size_t>& list)
     {
-        size_t size = DataTypeSize(dtype());
+        size_t size = 1;
         for (size_t d : list)
         {
             size *= d;
         }
-        if (size == this->size())
+        if (size != this->size())
+        {
+            return Status(1, "Cannot reshape size=", this->size(), 
+                " into size=", size);
+        }
+        if (!IsContiguous())
+        {
+            return Status(2, "Cannot reshape a non contiguous tensor in place");
+        }
+
+        LayoutArray shape(list);
+        if (quant_ != nullptr && quant_->per_channel())
+        {
+            size_t axis;
+            if (!ReshapeChannelAxis(shape_, quant_->axis(), shape, axis))
+            {
+                return Status(3, "Cannot reshape the channel axis of a per channel quantized tensor");
+            }
+            if (axis != quant_->axis()) quant_ = MoveChannelAxis(*quant_, axis);
+        }
+
+        shape_ = shape;
+        strides_ = ContiguousStrides(shape_);
+        return Status::kOK;
+    }
+
+    TensorBuffer TensorBuffer::Slice(size_t dim, size_t begin, size_t end) const
+    {
+        if (dim >= shape_.rank())
+        {
+            throw GlException("Cannot slice dimension ", dim, " of rank ", shape_.rank(), " tensor");
+        }
+        if (begin >= end || end > shape_[dim])
+        {
+            throw GlException("Invalid slice [", begin, ", ", end, ") of dimension ", 
+                dim, " with size ", shape_[dim]);
+        }
+
+        LayoutArray shape(shape_);
+        shape[dim] = end - begin;
+        TensorBuffer view = MakeView(shape, strides_, offset_ + begin * strides_[dim]);
+        view.quant_ = quant_;
+
+        // the view keeps the channels it covers
+        if (quant_ != nullptr && quant_->per_channel() && quant_->axis() == dim)
         {
-            shape_ = list;
-            return Status::kOK;
+            view.quant_ = std::make_shared<const QuantParams>(QuantParams::PerChannel(dim,
+                std::vector<float>(quant_->scales() + begin, quant_->scales() + end),
+                std::vector<int32_t>(quant_->zero_points() + begin, quant_->zero_points() + end)));
         }
-        return Status(1, "Cannot reshape size=", this->size(), 
-            " into size=", size);
+        return view;
+    }
+
+    TensorBuffer TensorBuffer::Transpose(const LayoutArray& perm) const
+    {
+        if (perm.rank() != shape_.rank())
+        {
+            throw GlException("Permutation of rank ", perm.rank(), 
+                " for rank ", shape_.rank(), " tensor");
+        }
+
+        bool seen[GRAPHLOOM_MAX_LAYOUT] = {};
+        LayoutArray shape(shape_);
+        LayoutArray strides(strides_);
+        for (size_t i = 0; i < perm.rank(); ++i)
+        {
+            if (perm[i] >= perm.rank() || seen[perm[i]])
+            {
+                throw GlException("Invalid permutation, dimension ", perm[i], 
+                    " is out of range or repeated");
+            }
+            seen[perm[i]] = true;
+            shape[i] = shape_[perm[i]];
+            strides[i] = strides_[perm[i]];
+        }
+
+        TensorBuffer view = MakeView(shape, strides, offset_);
+        view.quant_ = quant_;
+        if (quant_ != nullptr && quant_->per_channel())
+        {
+            size_t axis = 0;
+            while (perm[axis] != quant_->axis()) ++axis;
+            if (axis != quant_->axis()) view.quant_ = MoveChannelAxis(*quant_, axis);
+        }
+        return view;
+    }
+
+    TensorBuffer TensorBuffer::Transpose() const
+    {
+        LayoutArray perm(shape_);
+        for (size_t i = 0; i < perm.rank(); ++i)
+        {
+            perm[i] = perm.rank() - 1 - i;
+        }
+        return Transpose(perm);
+    }
+
+    TensorBuffer TensorBuffer::Broadcast(const LayoutArray& shape) const
+    {
+        if (shape.rank() < shape_.rank())
+        {
+            throw GlException("Cannot broadcast rank ", shape_.rank(), 
+                " tensor to rank ", shape.rank());
+        }
+
+        // dimensions align on the last, new leading ones repeat
+        size_t lead = shape.rank() - shape_.rank();
+        LayoutArray strides(shape);
+        for (size_t i = 0; i < shape.rank(); ++i)
+        {
+            if (i < lead)
+            {
+                strides[i] = 0;
+                continue;
+            }
+
+            size_t dim = shape_[i - lead];
+            if (dim == shape[i])
+            {
+                strides[i] = strides_[i - lead];
+            }
+            else if (dim == 1)
+            {
+                strides[i] = 0;
+            }
+            else
+            {
+                throw GlException("Cannot broadcast dimension ", i - lead, 
+                    " of size ", dim, " to size ", shape[i]);
+            }
+        }
+
+        TensorBuffer view = MakeView(shape, strides, offset_);
+        view.quant_ = quant_;
+        if (quant_ != nullptr && quant_->per_channel())
+        {
+            size_t axis = quant_->axis() + lead;
+            if (shape[axis] != shape_[quant_->axis()])
+            {
+                // a single repeated channel
+                view.quant_ = std::make_shared<const QuantParams>(
+                    QuantParams::PerTensor(quant_->scale(), quant_->zero_point()));
+            }
+            else if (lead != 0)
+            {
+                view.quant_ = MoveChannelAxis(*quant_, axis);
+            }
+        }
+        return view;
+    }
+
+    TensorBuffer TensorBuffer::View(const LayoutArray& shape) const
+    {
+        if (shape.NumElements() != size_)
+        {
+            throw GlException("Cannot view size=", size_, 
+                " as size=", shape.NumElements());
+        }
+
+        LayoutArray strides;
+        if (!ReshapeStrides(shape_, strides_, shape, strides))
+        {
+            throw GlException("Cannot view the tensor in this shape without a copy, "
+                "use Contiguous() first");
+        }
+
+        TensorBuffer view = MakeView(shape, strides, offset_);
+        view.quant_ = quant_;
+        if (quant_ != nullptr && quant_->per_channel())
+        {
+            size_t axis;
+            if (!ReshapeChannelAxis(shape_, quant_->axis(), shape, axis))
+            {
+                throw GlException("Cannot view the channel axis of a per channel "
+                    "quantized tensor in another shape");
+            }
+            if (axis != quant_->axis()) view.quant_ = MoveChannelAxis(*quant_, axis);
+        }
+        return view;
+    }
+
+    TensorBuffer TensorBuffer::Contiguous() const
+    {
+        if (IsContiguous())
+        {
+            TensorBuffer view = MakeView(shape_, strides_, offset_);
+            view.quant_ = quant_;
+            return view;
+        }
+        return Clone();
+    }
+
+    TensorBuffer TensorBuffer::Clone() const
+    {
+        if (storage_ == nullptr)
+        {
+            return TensorBuffer();
+        }
+
+        TensorBuffer result(dtype_, shape_, device());
+        result.quant_ = quant_;
+        Device* device = this->device();
+        if (IsContiguous())
+        {
+            void* dst = result.data();
+            GL_CHECK_OK(device->memcpy(dst, data(), bytes()));
+            return result;
+        }
+
+        size_t element = DataTypeSize(dtype_);
+        size_t rank = shape_.rank();
+        size_t inner = shape_[rank - 1];
+        size_t inner_stride = strides_[rank - 1];
+        size_t rows = size_ / inner;
+
+        // copy row by row, one call per row if it is packed
+        const char* src = static_cast<const char*>(data());
+        char* dst = static_cast<char*>(result.data());
+        size_t index[GRAPHLOOM_MAX_LAYOUT] = {};
+        for (size_t row = 0; row < rows; ++row)
+        {
+            size_t offset = 0;
+            for (size_t i = 0; i + 1 < rank; ++i)
+            {
+                offset += index[i] * strides_[i];
+            }
+
+            if (inner_stride == 1)
+            {
+                GL_CHECK_OK(device->memcpy(dst, src + offset * element, inner * element));
+            }
+            else
+            {
+                for (size_t j = 0; j < inner; ++j)
+                {
+                    GL_CHECK_OK(device->memcpy(dst + j * element, 
+                        src + (offset + j * inner_stride) * element, element));
+                }
+            }
+            dst += inner * element;
+
+            // advance the index of the outer dimensions
+            for (size_t i = rank - 1; i-- > 0;)
+            {
+                if (++index[i] < shape_[i]) break;
+                index[i] = 0;
+            }
+        }
+        return result;
+    }
+
+    const QuantParams* TensorBuffer::quant_params() const
+    {
+        return quant_.get();
+    }
+
+    void TensorBuffer::set_quant_params(const std::shared_ptr<const QuantParams>& params)
+    {
+        if (params != nullptr)
+        {
+            if (dtype_ != DataType::Int8)
+            {
+                throw GlException("Only Int8 tensors can be quantized");
+            }
+            if (params->per_channel() && (params->axis() >= shape_.rank() || 
+                shape_[params->axis()] != params->num_channels()))
+            {
+                throw GlException("Quantization of ", params->num_channels(), 
+                    " channels does not match the channel axis ", params->axis());
+            }
+        }
+        quant_ = params;
+    }
+
+    void TensorBuffer::set_quant_params(const QuantParams& params)
+    {
+        set_quant_params(std::make_shared<const QuantParams>(params));
     }
 
     void* TensorBuffer::data()
     {
-        return data_;
+        if (storage_ == nullptr) return nullptr;
+        return static_cast<char*>(storage_->data()) + offset_ * DataTypeSize(dtype_);
+    }
+
+    const void* TensorBuffer::data() const
+    {
+        if (storage_ == nullptr) return nullptr;
+        return static_cast<const char*>(storage_->data()) + offset_ * DataTypeSize(dtype_);
+    }
+
+    bool TensorBuffer::owns_data() const
+    {
+        return storage_ != nullptr && storage_->owns_data();
     }
 
-}
\ No newline at end of file
+    void TensorBuffer::MakeUnique()
+    {
+        if (storage_ == nullptr) return;
+        if (!storage_->writable())
+        {
+            *this = Clone();
+            return;
+        }
+        // views of this tensor share its writes, 
+        // only live copies need a private storage
+        if (!storage_->shared()) return;
+        *this = Clone();
+    }
+
+    TensorBuffer TensorBuffer::MakeView(const LayoutArray& shape, const LayoutArray& strides, size_t offset) const
+    {
+        TensorBuffer view(storage_, dtype_, shape, strides, offset);
+        view.copy_ = copy_;
+        if (copy_) storage_->AddCopy();
+        return view;
+    }
+
+    void TensorBuffer::ReleaseCopy()
+    {
+        if (copy_) storage_->RemoveCopy();
+        copy_ = false;
+    }
+}
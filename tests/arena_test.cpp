@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "common/arena.h"
+
+using namespace graphloom;
+
+TEST(ArenaSuite, AlignedAndDisjoint)
+{
+    Arena arena;
+    EXPECT_EQ(arena.capacity(), 0);
+
+    std::vector<std::pair<char*, size_t>> allocations;
+    for (size_t i = 1; i < 2000; ++i)
+    {
+        size_t bytes = i % 97 + 1;
+        size_t alignment = size_t(1) << (i % 4);
+        char* ptr = static_cast<char*>(arena.Allocate(bytes, alignment));
+        ASSERT_NE(ptr, nullptr);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % alignment, 0);
+        std::memset(ptr, static_cast<int>(i & 0xFF), bytes);
+        allocations.push_back({ptr, bytes});
+    }
+
+    // later writes did not overwrite earlier allocations
+    for (size_t i = 0; i < allocations.size(); ++i)
+    {
+        const std::pair<char*, size_t>& allocation = allocations[i];
+        for (size_t b = 0; b < allocation.second; ++b)
+        {
+            ASSERT_EQ(static_cast<unsigned char>(allocation.first[b]), (i + 1) & 0xFF);
+        }
+    }
+
+    // small objects are packed into few blocks
+    EXPECT_LE(arena.capacity(), 2 * Arena::kBlockBytes);
+}
+
+TEST(ArenaSuite, OversizedRequests)
+{
+    Arena arena;
+    char* small = static_cast<char*>(arena.Allocate(16, 8));
+    char* large = static_cast<char*>(arena.Allocate(Arena::kBlockBytes * 2, 8));
+    char* next = static_cast<char*>(arena.Allocate(16, 8));
+    std::memset(large, 1, Arena::kBlockBytes * 2);
+
+    // the current block keeps serving small requests
+    EXPECT_EQ(next, small + 16);
+    EXPECT_EQ(arena.capacity(), Arena::kBlockBytes * 3);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,190 @@
+#include <gtest/gtest.h>
+#include <graphloom/graphloom.h>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "feed_placeholder.h"
+
+using namespace graphloom;
+
+static Initializer register_cast_input = 
+    RegisterFeedPlaceholder<DataType::Float, DataType::Double, DataType::Float16, DataType::BFloat16>("cast_input");
+
+Device* Cpu0()
+{
+    return DeviceRegistry::instance().GetDevice("CPU:0");
+}
+
+/**
+ * Runs Cast on x
+ * 
+ * @returns Output of the cast
+*/
+TensorBuffer RunCast(const TensorBuffer& x, DataType to)
+{
+    GraphDef graph;
+    NodeDef* input = NodeDefBuilder(graph, "cast_input", "CPU:0").Name("x").Build({x.dtype()});
+    NodeDef* cast = NodeDefBuilder(graph, "Cast", "CPU:0").Input(input, 0).Name("cast").Build({to});
+
+    Session session;
+    Status status = session.UpdateGraph(graph);
+    EXPECT_TRUE(status.ok()) << status.msg();
+
+    TensorBuffer value = x;
+    std::vector<TensorBuffer> outputs;
+    status = session.Run({{input, &value}}, {cast}, outputs);
+    EXPECT_TRUE(status.ok()) << status.msg();
+    return outputs.empty() ? TensorBuffer() : outputs[0];
+}
+
+// normal floats of every magnitude, 16 bit ties and specials
+std::vector<float> CastInputs()
+{
+    std::vector<float> values = {
+        0.0f, -0.0f, 1.0f, -1.0f, 65504.0f, 65520.0f, 1e10f, -1e10f,
+        6.1e-5f, 5.96e-8f, 3e-8f, 1e-6f, -2.5e-7f,
+        1.0f + 1.0f / 2048, 1.0f + 3.0f / 2048, 1.0f + 1.0f / 256, 1.0f + 3.0f / 256,
+        std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+        std::numeric_limits<float>::max(), std::numeric_limits<float>::min(),
+    };
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> mantissa(-2.0f, 2.0f);
+    std::uniform_int_distribution<int> exponent(-30, 30);
+    while (values.size() < 1013)
+    {
+        values.push_back(std::ldexp(mantissa(rng), exponent(rng)));
+    }
+    return values;
+}
+
+TensorBuffer FloatTensor(const std::vector<float>& values)
+{
+    TensorBuffer tensor(DataType::Float, {values.size()}, Cpu0());
+    std::memcpy(tensor.Map<float>().data(), values.data(), values.size() * sizeof(float));
+    return tensor;
+}
+
+TEST(CastSuite, Registered)
+{
+    ASSERT_TRUE(OpRegistry::instance().HasOp("Cast"));
+    const Op& op = OpRegistry::instance().GetOp("Cast");
+    EXPECT_EQ(op.num_inputs(), 1);
+    EXPECT_EQ(op.num_outputs(), 1);
+}
+
+TEST(CastSuite, EveryIsa)
+{
+    const std::vector<float> values = CastInputs();
+    TensorBuffer x = FloatTensor(values);
+
+    for (CpuIsa isa : {CpuIsa::Generic, CpuIsa::Avx2, CpuIsa::Avx512, CpuIsa::Avx512Bf16})
+    {
+        if (!CpuIsaSupported(isa)) continue;
+        LimitCpuIsa(isa);
+
+        TensorBuffer half = RunCast(x, DataType::Float16);
+        TensorBuffer bf16 = RunCast(x, DataType::BFloat16);
+        TensorBuffer half_back = RunCast(half, DataType::Float);
+        TensorBuffer bf16_back = RunCast(bf16, DataType::Float);
+        ASSERT_EQ(half.size(), values.size());
+        ASSERT_EQ(bf16_back.size(), values.size());
+
+        const Fp16* half_data = half.Map<Fp16>().data();
+        const Bf16* bf16_data = bf16.Map<Bf16>().data();
+        const float* half_back_data = half_back.Map<float>().data();
+        const float* bf16_back_data = bf16_back.Map<float>().data();
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            Fp16 expected_half(values[i]);
+            Bf16 expected_bf16(values[i]);
+            ASSERT_EQ(half_data[i].bits, expected_half.bits) << values[i] << " at " << CpuIsaName(isa);
+            ASSERT_EQ(bf16_data[i].bits, expected_bf16.bits) << values[i] << " at " << CpuIsaName(isa);
+            ASSERT_EQ(half_back_data[i], static_cast<float>(expected_half)) << CpuIsaName(isa);
+            ASSERT_EQ(bf16_back_data[i], static_cast<float>(expected_bf16)) << CpuIsaName(isa);
+        }
+    }
+    LimitCpuIsa(CpuIsa::Avx512Bf16);
+}
+
+TEST(CastSuite, NaN)
+{
+    TensorBuffer x = FloatTensor(std::vector<float>(19, std::numeric_limits<float>::quiet_NaN()));
+    TensorBuffer half_back = RunCast(RunCast(x, DataType::Float16), DataType::Float);
+    TensorBuffer bf16_back = RunCast(RunCast(x, DataType::BFloat16), DataType::Double);
+    for (size_t i = 0; i < x.size(); ++i)
+    {
+        EXPECT_TRUE(std::isnan(half_back.Map<float>()(i)));
+        EXPECT_TRUE(std::isnan(bf16_back.Map<double>()(i)));
+    }
+}
+
+TEST(CastSuite, Double)
+{
+    TensorBuffer x(DataType::Double, {3, 7}, Cpu0());
+    for (size_t i = 0; i < x.size(); ++i)
+    {
+        x.Map<double>().data()[i] = 0.1 * static_cast<double>(i) - 1.0;
+    }
+
+    TensorBuffer f = RunCast(x, DataType::Float);
+    TensorBuffer b = RunCast(x, DataType::BFloat16);
+    TensorBuffer h = RunCast(b, DataType::Float16);
+    ASSERT_EQ(f.shape().rank(), 2);
+    EXPECT_EQ(f.shape()[1], 7);
+    for (size_t i = 0; i < x.size(); ++i)
+    {
+        double value = x.Map<double>().data()[i];
+        Bf16 rounded(static_cast<float>(value));
+        EXPECT_EQ(f.Map<float>().data()[i], static_cast<float>(value));
+        EXPECT_EQ(b.Map<Bf16>().data()[i].bits, rounded.bits);
+        EXPECT_EQ(h.Map<Fp16>().data()[i].bits, 
+            Fp16(static_cast<float>(rounded)).bits);
+    }
+}
+
+TEST(CastSuite, Parallel)
+{
+    TensorBuffer x(DataType::Float, {100003}, Cpu0());
+    for (size_t i = 0; i < x.size(); ++i)
+    {
+        x.Map<float>().data()[i] = static_cast<float>(i);
+    }
+
+    GraphDef graph;
+    NodeDef* input = NodeDefBuilder(graph, "cast_input", "CPU:0").Name("x").Build({DataType::Float});
+    NodeDef* cast = NodeDefBuilder(graph, "Cast", "CPU:0").Input(input, 0).Name("cast").Build({DataType::BFloat16});
+
+    SessionOptions options;
+    options.inter_op_threads = 4;
+    Session session(options);
+    ASSERT_TRUE(session.UpdateGraph(graph).ok());
+
+    std::vector<TensorBuffer> outputs;
+    ASSERT_TRUE(session.Run({{input, &x}}, {cast}, outputs).ok());
+    const Bf16* data = outputs[0].Map<Bf16>().data();
+    for (size_t i = 0; i < x.size(); i += 97)
+    {
+        ASSERT_EQ(data[i].bits, Bf16(static_cast<float>(i)).bits) << i;
+    }
+}
+
+TEST(CastSuite, UnregisteredPair)
+{
+    GraphDef graph;
+    NodeDef* input = NodeDefBuilder(graph, "cast_input", "CPU:0").Name("x").Build({DataType::Float});
+    NodeDefBuilder(graph, "Cast", "CPU:0").Input(input, 0).Name("cast").Build({DataType::Int32});
+
+    Session session;
+    EXPECT_FALSE(session.UpdateGraph(graph).ok());
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
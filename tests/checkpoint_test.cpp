@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+#include <graphloom/graphloom.h>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace graphloom;
+
+Device* Cpu0()
+{
+    return DeviceRegistry::instance().GetDevice("CPU:0");
+}
+
+std::string TempPath(const std::string& name)
+{
+    return testing::TempDir() + name;
+}
+
+TensorBuffer Iota(DataType dtype, const LayoutArray& shape)
+{
+    TensorBuffer tensor(dtype, shape, Cpu0());
+    if (dtype == DataType::Double)
+    {
+        TensorMap<double> map = tensor.Map<double>();
+        for (size_t i = 0; i < tensor.size(); ++i) map.data()[i] = static_cast<double>(i);
+    }
+    else
+    {
+        TensorMap<int8_t> map = tensor.Map<int8_t>();
+        for (size_t i = 0; i < tensor.size(); ++i) map.data()[i] = static_cast<int8_t>(i);
+    }
+    return tensor;
+}
+
+void ExpectRoundTrip(const CheckpointLoadOptions& load_options, size_t buffer_bytes)
+{
+    std::string path = TempPath("graphloom_checkpoint.bin");
+    TensorBuffer weights = Iota(DataType::Double, {3, 5});
+    TensorBuffer bias = Iota(DataType::Int8, {7});
+    TensorBuffer transposed = weights.Transpose();
+
+    CheckpointSaveOptions save_options;
+    save_options.buffer_bytes = buffer_bytes;
+    ASSERT_TRUE(Checkpoint::Save(path, {
+        {"weights", &weights}, {"bias", &bias}, {"weights_t", &transposed}
+    }, save_options).ok());
+
+    std::unordered_map<std::string, TensorBuffer> tensors;
+    Status status = Checkpoint::Load(path, Cpu0(), tensors, load_options);
+    ASSERT_TRUE(status.ok()) << status.msg();
+    ASSERT_EQ(tensors.size(), 3);
+
+    const TensorBuffer& w = tensors.at("weights");
+    ASSERT_EQ(w.dtype(), DataType::Double);
+    ASSERT_EQ(w.shape().rank(), 2);
+    EXPECT_EQ(w.shape()[1], 5);
+    EXPECT_EQ(w.Map<double>()(2, 4), 14.0);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(w.Map<double>().data()) % kCheckpointAlignment, 0);
+
+    const TensorBuffer& b = tensors.at("bias");
+    EXPECT_EQ(b.dtype(), DataType::Int8);
+    EXPECT_EQ(b.Map<int8_t>()(6), 6);
+
+    // strided tensors are saved packed
+    const TensorBuffer& t = tensors.at("weights_t");
+    ASSERT_TRUE(t.IsContiguous());
+    EXPECT_EQ(t.shape()[0], 5);
+    EXPECT_EQ(t.Map<double>()(4, 2), 14.0);
+    EXPECT_EQ(t.Map<double>()(1, 2), 11.0);
+    std::remove(path.c_str());
+}
+
+TEST(CheckpointSuite, MapRoundTrip)
+{
+    ExpectRoundTrip(CheckpointLoadOptions(), CheckpointSaveOptions().buffer_bytes);
+}
+
+TEST(CheckpointSuite, ReadRoundTrip)
+{
+    CheckpointLoadOptions options;
+    options.mode = CheckpointLoadMode::Read;
+    options.read_threads = 4;
+
+    // a buffer smaller than the tensors streams them in pieces
+    ExpectRoundTrip(options, 1);
+}
+
+TEST(CheckpointSuite, LargeParallelRead)
+{
+    std::string path = TempPath("graphloom_checkpoint_large.bin");
+    TensorBuffer large = Iota(DataType::Double, {5 << 20});
+    TensorBuffer small = Iota(DataType::Int8, {3});
+    ASSERT_TRUE(Checkpoint::Save(path, {{"large", &large}, {"small", &small}}).ok());
+
+    CheckpointLoadOptions options;
+    options.mode = CheckpointLoadMode::Read;
+    options.read_threads = 3;
+    std::unordered_map<std::string, TensorBuffer> tensors;
+    ASSERT_TRUE(Checkpoint::Load(path, Cpu0(), tensors, options).ok());
+
+    const double* data = static_cast<const TensorBuffer&>(tensors.at("large")).Map<double>().data();
+    for (size_t i = 0; i < large.size(); i += 4099)
+    {
+        ASSERT_EQ(data[i], static_cast<double>(i));
+    }
+    EXPECT_EQ(data[large.size() - 1], static_cast<double>(large.size() - 1));
+    EXPECT_EQ(static_cast<const TensorBuffer&>(tensors.at("small")).Map<int8_t>()(2), 2);
+    std::remove(path.c_str());
+}
+
+TEST(CheckpointSuite, SaveErrors)
+{
+    std::string path = TempPath("graphloom_checkpoint_errors.bin");
+    TensorBuffer tensor = Iota(DataType::Int8, {4});
+    TensorBuffer empty;
+    EXPECT_FALSE(Checkpoint::Save(path, {{"a", &tensor}, {"a", &tensor}}).ok());
+    EXPECT_FALSE(Checkpoint::Save(path, {{"a", &empty}}).ok());
+    EXPECT_FALSE(Checkpoint::Save(path, {{"a", nullptr}}).ok());
+    std::remove(path.c_str());
+}
+
+TEST(CheckpointSuite, LoadErrors)
+{
+    std::string path = TempPath("graphloom_checkpoint_corrupt.bin");
+    std::unordered_map<std::string, TensorBuffer> tensors;
+    EXPECT_FALSE(Checkpoint::Load(path + ".missing", Cpu0(), tensors).ok());
+
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << "not a checkpoint";
+    }
+    EXPECT_FALSE(Checkpoint::Load(path, Cpu0(), tensors).ok());
+
+    // cut off inside the payload
+    TensorBuffer tensor = Iota(DataType::Double, {64});
+    ASSERT_TRUE(Checkpoint::Save(path, {{"a", &tensor}}).ok());
+    std::string bytes;
+    {
+        std::ifstream file(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(bytes.data(), bytes.size() - 8);
+    }
+    EXPECT_FALSE(Checkpoint::Load(path, Cpu0(), tensors).ok());
+
+    // newer versions are rejected
+    bytes[8] = static_cast<char>(kCheckpointVersion + 1);
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(bytes.data(), bytes.size());
+    }
+    EXPECT_FALSE(Checkpoint::Load(path, Cpu0(), tensors).ok());
+    EXPECT_TRUE(tensors.empty());
+    std::remove(path.c_str());
+}
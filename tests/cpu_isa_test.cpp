@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+#include <graphloom/graphloom.h>
+#include <string>
+#include <vector>
+
+using namespace graphloom;
+
+// writes the isa level it was registered with
+template<CpuIsa isa>
+class IsaKernel : public OpKernel
+{
+public:
+    IsaKernel(const OpKernelContext& context) : OpKernel(context) {}
+
+    Status Compute(ComputeContext& context) override
+    {
+        context.output(0).Map<int32_t>().data()[0] = isa;
+        return Status::kOK;
+    }
+};
+
+using IsaGenericKernel = IsaKernel<CpuIsa::Generic>;
+using IsaAvx2Kernel = IsaKernel<CpuIsa::Avx2>;
+using IsaBf16Kernel = IsaKernel<CpuIsa::Avx512Bf16>;
+
+GL_REGISTER_OP("isa_probe").
+    Output([](const ComputeContext& c, LayoutArray& shape){
+        shape = {1};
+        return Status::kOK;
+    }).
+    Build();
+
+// registered out of order, the resolver must not pick the first match
+GL_REGISTER_KERNEL("isa_probe", IsaAvx2Kernel, "CPU").
+    Output(DataType::Int32).
+    Isa(CpuIsa::Avx2).
+    Build();
+
+GL_REGISTER_KERNEL("isa_probe", IsaGenericKernel, "CPU").
+    Output(DataType::Int32).
+    Build();
+
+GL_REGISTER_KERNEL("isa_probe", IsaBf16Kernel, "CPU").
+    Output(DataType::Int32).
+    Isa(CpuIsa::Avx512Bf16).
+    Build();
+
+int32_t ResolvedIsa()
+{
+    GraphDef graph;
+    NodeDef* probe = NodeDefBuilder(graph, "isa_probe", "CPU:0").
+        Name("probe").
+        Build({DataType::Int32});
+
+    Session session;
+    Status status = session.UpdateGraph(graph);
+    EXPECT_TRUE(status.ok()) << status.msg();
+
+    std::vector<TensorBuffer> outputs;
+    status = session.Run({}, {probe}, outputs);
+    EXPECT_TRUE(status.ok()) << status.msg();
+    return outputs.empty() ? -1 : outputs[0].Map<int32_t>().data()[0];
+}
+
+TEST(CpuIsaSuite, HostLevel)
+{
+    CpuIsa host = HostCpuIsa();
+    EXPECT_TRUE(CpuIsaSupported(CpuIsa::Generic));
+    EXPECT_TRUE(CpuIsaSupported(host));
+    if (host < CpuIsa::Avx512Bf16)
+    {
+        EXPECT_FALSE(CpuIsaSupported(static_cast<CpuIsa>(host + 1)));
+    }
+    EXPECT_NE(std::string(CpuIsaName(host)), "Unknown");
+}
+
+TEST(CpuIsaSuite, ResolvesBestSupportedKernel)
+{
+    CpuIsa expected = CpuIsa::Generic;
+    if (CpuIsaSupported(CpuIsa::Avx2)) expected = CpuIsa::Avx2;
+    if (CpuIsaSupported(CpuIsa::Avx512Bf16)) expected = CpuIsa::Avx512Bf16;
+    EXPECT_EQ(ResolvedIsa(), expected);
+}
+
+TEST(CpuIsaSuite, LimitedIsa)
+{
+    CpuIsa host = HostCpuIsa();
+
+    LimitCpuIsa(CpuIsa::Generic);
+    EXPECT_EQ(HostCpuIsa(), CpuIsa::Generic);
+    EXPECT_EQ(ResolvedIsa(), CpuIsa::Generic);
+
+    LimitCpuIsa(CpuIsa::Avx2);
+    EXPECT_EQ(ResolvedIsa(), host >= CpuIsa::Avx2 ? CpuIsa::Avx2 : CpuIsa::Generic);
+
+    LimitCpuIsa(CpuIsa::Avx512Bf16);
+    EXPECT_EQ(HostCpuIsa(), host);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
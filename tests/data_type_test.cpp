@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 #include <graphloom/graphloom.h>
+#include <cmath>
+#include <cstdint>
+#include <limits>
 
 using namespace graphloom;
 
@@ -17,6 +20,56 @@ TEST(DataTypeSuite, DataSizeTest)
         << "Expected size of Int64 mismatched";
     EXPECT_EQ(DataTypeSize(DataType::Int8), sizeof(int8_t))
         << "Expected size of Int8 mismatched";
+    EXPECT_EQ(DataTypeSize(DataType::Float16), 2)
+        << "Expected size of Float16 mismatched";
+    EXPECT_EQ(DataTypeSize(DataType::BFloat16), 2)
+        << "Expected size of BFloat16 mismatched";
+}
+
+TEST(DataTypeSuite, Float16Conversions)
+{
+    EXPECT_EQ(Fp16(1.0f).bits, 0x3c00);
+    EXPECT_EQ(Fp16(-2.0f).bits, 0xc000);
+    EXPECT_EQ(Fp16(65504.0f).bits, 0x7bff);
+    EXPECT_EQ(Fp16(1e6f).bits, 0x7c00);
+    EXPECT_EQ(Fp16(std::numeric_limits<float>::infinity()).bits, 0x7c00);
+    EXPECT_EQ(Fp16(5.9604645e-8f).bits, 0x0001);
+    EXPECT_EQ(Fp16(1e-9f).bits, 0x0000);
+
+    // ties round to even
+    EXPECT_EQ(Fp16(1.0f + 1.0f / 2048).bits, 0x3c00);
+    EXPECT_EQ(Fp16(1.0f + 3.0f / 2048).bits, 0x3c02);
+
+    // every binary16 value converts to float and back unchanged
+    for (uint32_t bits = 0; bits < 0x10000; ++bits)
+    {
+        Fp16 value = Fp16::FromBits(static_cast<uint16_t>(bits));
+        float f = static_cast<float>(value);
+        if (std::isnan(f))
+        {
+            EXPECT_EQ(bits & 0x7c00, 0x7c00u);
+            continue;
+        }
+        ASSERT_EQ(Fp16(f).bits, bits) << f;
+    }
+    EXPECT_EQ(static_cast<float>(Fp16::FromBits(0x0001)), std::ldexp(1.0f, -24));
+    EXPECT_TRUE(std::isnan(static_cast<float>(Fp16(std::nanf("")))));
+}
+
+TEST(DataTypeSuite, BFloat16Conversions)
+{
+    EXPECT_EQ(Bf16(1.0f).bits, 0x3f80);
+    EXPECT_EQ(Bf16(-2.0f).bits, 0xc000);
+    EXPECT_EQ(static_cast<float>(Bf16::FromBits(0x4049)), 3.140625f);
+
+    // ties round to even, above the tie rounds up
+    EXPECT_EQ(Bf16(1.0f + 1.0f / 256).bits, 0x3f80);
+    EXPECT_EQ(Bf16(1.0f + 3.0f / 256).bits, 0x3f82);
+    EXPECT_EQ(Bf16(1.0f + 1.5f / 256).bits, 0x3f81);
+
+    EXPECT_EQ(Bf16(std::numeric_limits<float>::infinity()).bits, 0x7f80);
+    EXPECT_EQ(Bf16(std::numeric_limits<float>::max()).bits, 0x7f80);
+    EXPECT_TRUE(std::isnan(static_cast<float>(Bf16(std::nanf("")))));
 }
 
 int main(int argc, char **argv) 
@@ -1,10 +1,28 @@
 #include <gtest/gtest.h>
 #include <graphloom/graphloom.h>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <vector>
 #include <string>
+#include <thread>
+
+#include "common/thread_pool.h"
+#include "device/caching_allocator.h"
+#include "device/numa.h"
+#include "device/scratch_allocator.h"
+#include "device/system_memory.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 using namespace graphloom;
 
+// a device of its own so the statistics are not shared with other tests
+GL_REGISTER_DEVICE(STATS_CPU, CpuFactory);
+
 TEST(DeviceCPUSuite, ValidDevice) 
 {
     const std::string cpu_name("CPU:0");
@@ -66,8 +84,484 @@ TEST(DeviceCPUSuite, ValidAllocatorFloat)
         << status.code() << " \"" << status.msg() << "\"";
 }
 
+TEST(DeviceCPUSuite, CachedBlockReuse)
+{
+    Device* cpu = DeviceRegistry::instance().GetDevice("CPU:0");
+
+    void* first = nullptr;
+    ASSERT_TRUE(cpu->malloc(DataType::Float, 1000, first).ok());
+    EXPECT_TRUE(reinterpret_cast<intptr_t>(first) % CachingAllocator::kAlignment == 0)
+        << "Allocated buffer is not cache line aligned";
+    ASSERT_TRUE(cpu->free(DataType::Float, first).ok());
+
+    // same size class on the same thread should be served from the cache
+    void* second = nullptr;
+    ASSERT_TRUE(cpu->malloc(DataType::Int32, 1000, second).ok());
+    EXPECT_EQ(first, second)
+        << "Expected freed block to be reused for an allocation of the same size";
+    ASSERT_TRUE(cpu->free(DataType::Int32, second).ok());
+}
+
+TEST(DeviceCPUSuite, ShortLivedAllocators)
+{
+    // each allocator leaves a cache on the thread, caches of
+    // destroyed allocators must be dropped without touching their slabs
+    std::thread worker([]()
+    {
+        for (int i = 0; i < 64; ++i)
+        {
+            CachingAllocator allocator;
+            void* buffer = allocator.Allocate(1000);
+            ASSERT_TRUE(buffer);
+            allocator.Deallocate(buffer);
+        }
+
+        CachingAllocator allocator;
+        void* first = allocator.Allocate(1000);
+        ASSERT_TRUE(first);
+        allocator.Deallocate(first);
+        void* second = allocator.Allocate(1000);
+        EXPECT_EQ(first, second);
+        allocator.Deallocate(second);
+    });
+    worker.join();
+}
+
+TEST(DeviceCPUSuite, LargeAllocation)
+{
+    Device* cpu = DeviceRegistry::instance().GetDevice("CPU:0");
+    const size_t size = (size_t(1) << CachingAllocator::kMaxBinShift) + 1;
+
+    void* buffer = nullptr;
+    ASSERT_TRUE(cpu->malloc(DataType::Int8, size, buffer).ok());
+    ASSERT_TRUE(buffer);
+    EXPECT_TRUE(reinterpret_cast<intptr_t>(buffer) % CachingAllocator::kAlignment == 0);
+
+    int8_t* bytes = static_cast<int8_t*>(buffer);
+    bytes[0] = 1;
+    bytes[size - 1] = 1;
+    EXPECT_TRUE(cpu->free(DataType::Int8, buffer).ok());
+}
+
+TEST(DeviceCPUSuite, ConcurrentAllocations)
+{
+    Device* cpu = DeviceRegistry::instance().GetDevice("CPU:0");
+    const int num_threads = 8;
+    const int num_iters = 2000;
+    std::vector<int> failures(num_threads, 0);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t)
+    {
+        threads.emplace_back([cpu, t, &failures]() {
+            std::vector<int64_t*> live;
+            for (int i = 0; i < num_iters; ++i)
+            {
+                size_t size = 1 + (i * 37 + t) % 4096;
+                void* buffer = nullptr;
+                if (!cpu->malloc(DataType::Int64, size, buffer).ok())
+                {
+                    ++failures[t];
+                    continue;
+                }
+
+                int64_t* data = static_cast<int64_t*>(buffer);
+                data[0] = t;
+                data[size - 1] = t;
+                live.push_back(data);
+
+                // free in a different order than allocated
+                if (live.size() > 16)
+                {
+                    int64_t* victim = live[i % live.size()];
+                    if (victim[0] != t) ++failures[t];
+                    live.erase(live.begin() + i % live.size());
+                    cpu->free(DataType::Int64, victim);
+                }
+            }
+            for (int64_t* data : live)
+            {
+                if (data[0] != t) ++failures[t];
+                cpu->free(DataType::Int64, data);
+            }
+        });
+    }
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    for (int t = 0; t < num_threads; ++t)
+    {
+        EXPECT_EQ(failures[t], 0)
+            << "Thread " << t << " observed a failed allocation or a corrupted buffer";
+    }
+}
+
+TEST(DeviceCPUSuite, SizeClasses)
+{
+    EXPECT_EQ(CachingAllocator::BinIndex(0), 0);
+    EXPECT_EQ(CachingAllocator::BinIndex(64), 0);
+    EXPECT_EQ(CachingAllocator::BinIndex(size_t(1) << CachingAllocator::kMaxBinShift), 
+        CachingAllocator::kNumBins - 1);
+    EXPECT_EQ(CachingAllocator::BinIndex((size_t(1) << CachingAllocator::kMaxBinShift) + 1), 
+        CachingAllocator::kLargeBin);
+
+    for (size_t bytes = 1; bytes < 100000; bytes += 7)
+    {
+        size_t bin = CachingAllocator::BinIndex(bytes);
+        ASSERT_GE(CachingAllocator::BinSize(bin), bytes)
+            << "Size class of " << bytes << " bytes is too small";
+        if (bin > 0)
+        {
+            ASSERT_LT(CachingAllocator::BinSize(bin - 1), bytes)
+                << "Size class of " << bytes << " bytes is not the tightest fit";
+        }
+    }
+}
+
+TEST(DeviceCPUSuite, ScratchCoalesces)
+{
+    Device* cpu = DeviceRegistry::instance().GetDevice("CPU:0");
+    ScratchAllocator scratch(cpu);
+
+    // first run chains blocks
+    std::vector<char*> ptrs;
+    for (int i = 0; i < 8; ++i)
+    {
+        char* ptr = static_cast<char*>(scratch.Allocate(100000));
+        ASSERT_NE(ptr, nullptr);
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(ptr) % ScratchAllocator::kAlignment, 0);
+        for (char* other : ptrs)
+        {
+            ASSERT_TRUE(ptr >= other + 100000 || ptr + 100000 <= other) 
+                << "Scratch allocations overlap";
+        }
+        ptrs.push_back(ptr);
+    }
+
+    // after reset one block holds the whole peak
+    scratch.Reset();
+    size_t capacity = scratch.capacity();
+    EXPECT_GE(capacity, 8 * 100000);
+
+    for (int run = 0; run < 3; ++run)
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            ASSERT_NE(scratch.Allocate(100000), nullptr);
+        }
+        scratch.Reset();
+        EXPECT_EQ(scratch.capacity(), capacity) << "Steady state must not grow";
+    }
+}
+
+TEST(DeviceCPUSuite, MemoryStats)
+{
+    Device* cpu = DeviceRegistry::instance().GetDevice("STATS_CPU:0");
+    MemoryStats before = cpu->memory_stats();
+
+    void* small = nullptr;
+    void* medium = nullptr;
+    void* large = nullptr;
+    ASSERT_TRUE(cpu->malloc(DataType::Float, 100, small).ok());
+    ASSERT_TRUE(cpu->malloc(DataType::Int8, 1000, medium).ok());
+    ASSERT_TRUE(cpu->malloc(DataType::Int8, (size_t(1) << 27) + 1, large).ok());
+
+    MemoryStats stats = cpu->memory_stats();
+    size_t total = 400 + 1000 + (size_t(1) << 27) + 1;
+    EXPECT_EQ(stats.live_bytes, before.live_bytes + total);
+    EXPECT_GE(stats.peak_bytes, stats.live_bytes);
+    EXPECT_EQ(stats.num_allocs, before.num_allocs + 3);
+
+    // (256, 512], (512, 1024] and just over 2^27
+    EXPECT_EQ(stats.histogram[9], before.histogram[9] + 1);
+    EXPECT_EQ(stats.histogram[10], before.histogram[10] + 1);
+    EXPECT_EQ(stats.histogram[28], before.histogram[28] + 1);
+
+    EXPECT_TRUE(cpu->free(DataType::Float, small).ok());
+    EXPECT_TRUE(cpu->free(DataType::Int8, medium).ok());
+    EXPECT_TRUE(cpu->free(DataType::Int8, large).ok());
+
+    MemoryStats after = cpu->memory_stats();
+    EXPECT_EQ(after.live_bytes, before.live_bytes);
+    EXPECT_EQ(after.num_frees, before.num_frees + 3);
+    EXPECT_EQ(after.peak_bytes, stats.peak_bytes);
+
+    cpu->ResetPeakMemory();
+    EXPECT_EQ(cpu->memory_stats().peak_bytes, after.live_bytes);
+    EXPECT_EQ(DeviceRegistry::instance().GetMemoryStats("STATS_CPU:0").num_allocs, after.num_allocs);
+}
+
+TEST(DeviceCPUSuite, MemoryStatsAcrossThreads)
+{
+    Device* cpu = DeviceRegistry::instance().GetDevice("STATS_CPU:0");
+    MemoryStats before = cpu->memory_stats();
+
+    // threads count into their own shards, frees may land on another
+    std::vector<void*> buffers(64, nullptr);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&, t]() {
+            for (size_t i = t; i < buffers.size(); i += 4)
+            {
+                ASSERT_TRUE(cpu->malloc(DataType::Int8, 4096, buffers[i]).ok());
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+
+    MemoryStats stats = cpu->memory_stats();
+    EXPECT_EQ(stats.num_allocs, before.num_allocs + 64);
+    EXPECT_EQ(stats.live_bytes, before.live_bytes + 64 * 4096);
+    EXPECT_GE(stats.peak_bytes, stats.live_bytes);
+
+    for (void* buffer : buffers)
+    {
+        EXPECT_TRUE(cpu->free(DataType::Int8, buffer).ok());
+    }
+    MemoryStats after = cpu->memory_stats();
+    EXPECT_EQ(after.num_frees, before.num_frees + 64);
+    EXPECT_EQ(after.live_bytes, before.live_bytes);
+}
+
+TEST(DeviceCPUSuite, MemoryProfiling)
+{
+    Device* cpu = DeviceRegistry::instance().GetDevice("STATS_CPU:0");
+    cpu->set_memory_profiling(MemoryProfiling::Nodes);
+    EXPECT_EQ(cpu->memory_profiling(), MemoryProfiling::Nodes);
+
+    const std::string outer("outer");
+    const std::string inner("inner");
+    void* a = nullptr;
+    void* b = nullptr;
+    void* c = nullptr;
+    void* d = nullptr;
+    {
+        MemoryScope outer_scope(outer);
+        ASSERT_TRUE(cpu->malloc(DataType::Int8, 100, a).ok());
+        ASSERT_TRUE(cpu->malloc(DataType::Int8, 200, b).ok());
+        {
+            MemoryScope inner_scope(inner);
+            EXPECT_EQ(MemoryScope::current(), &inner);
+            ASSERT_TRUE(cpu->malloc(DataType::Int8, 300, c).ok());
+        }
+        EXPECT_EQ(MemoryScope::current(), &outer);
+    }
+    EXPECT_EQ(MemoryScope::current(), nullptr);
+    ASSERT_TRUE(cpu->malloc(DataType::Int8, 50, d).ok());
+    EXPECT_TRUE(cpu->free(DataType::Int8, b).ok());
+
+    std::unordered_map<std::string, MemoryStats> nodes = cpu->node_memory_stats();
+    EXPECT_EQ(nodes["outer"].num_allocs, 2);
+    EXPECT_EQ(nodes["outer"].num_frees, 1);
+    EXPECT_EQ(nodes["outer"].live_bytes, 100);
+    EXPECT_EQ(nodes["outer"].peak_bytes, 300);
+    EXPECT_EQ(nodes["inner"].live_bytes, 300);
+    EXPECT_EQ(nodes[""].live_bytes, 50);
+
+    std::vector<AllocationRecord> live = cpu->live_allocations();
+    ASSERT_EQ(live.size(), 3);
+    EXPECT_EQ(live[0].ptr, c);
+    EXPECT_EQ(live[0].node, "inner");
+    EXPECT_EQ(live[1].bytes, 100);
+    EXPECT_EQ(live[2].node, "");
+    EXPECT_TRUE(live[0].call_site.empty());
+
+    cpu->set_memory_profiling(MemoryProfiling::CallSites);
+    void* e = nullptr;
+    ASSERT_TRUE(cpu->malloc(DataType::Int8, 1000, e).ok());
+    live = cpu->live_allocations();
+    ASSERT_EQ(live.size(), 4);
+    EXPECT_EQ(live[0].ptr, e);
+#ifdef __GLIBC__
+    EXPECT_FALSE(live[0].call_site.empty());
+#endif
+
+    cpu->ResetPeakMemory();
+    EXPECT_EQ(cpu->node_memory_stats()["outer"].peak_bytes, 100);
+
+    // records are dropped, the node statistics stay 
+    // without the dropped allocations
+    MemoryStats on = cpu->memory_stats();
+    cpu->set_memory_profiling(MemoryProfiling::Off);
+    EXPECT_TRUE(cpu->live_allocations().empty());
+    EXPECT_EQ(cpu->node_memory_stats()["inner"].num_allocs, 1);
+    EXPECT_EQ(cpu->node_memory_stats()["inner"].live_bytes, 0);
+    for (void* ptr : {a, c, d, e})
+    {
+        EXPECT_TRUE(cpu->free(DataType::Int8, ptr).ok());
+    }
+
+    // the device totals count every free
+    cpu->set_memory_profiling(MemoryProfiling::Nodes);
+    EXPECT_EQ(cpu->memory_stats().live_bytes, on.live_bytes - 1450);
+    EXPECT_EQ(cpu->memory_stats().num_frees, on.num_frees + 4);
+    EXPECT_EQ(cpu->node_memory_stats()["outer"].live_bytes, 0);
+    cpu->set_memory_profiling(MemoryProfiling::Off);
+}
+
+TEST(DeviceCPUSuite, ParseCpuList)
+{
+    std::vector<int> ids;
+    ASSERT_TRUE(ParseCpuList("0-3,8,10-11\n", ids));
+    EXPECT_EQ(ids, std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+
+    ASSERT_TRUE(ParseCpuList("5", ids));
+    EXPECT_EQ(ids, std::vector<int>({5}));
+
+    ASSERT_TRUE(ParseCpuList("\n", ids));
+    EXPECT_TRUE(ids.empty());
+
+    EXPECT_FALSE(ParseCpuList("3-1", ids));
+    EXPECT_FALSE(ParseCpuList("0,,1", ids));
+    EXPECT_FALSE(ParseCpuList("0-", ids));
+    EXPECT_FALSE(ParseCpuList("4,2", ids));
+    EXPECT_FALSE(ParseCpuList("a", ids));
+}
+
+TEST(DeviceCPUSuite, DiscoverNumaNodes)
+{
+    namespace fs = std::filesystem;
+    fs::path root = fs::temp_directory_path() / "graphloom_numa_test";
+    fs::remove_all(root);
+    fs::create_directories(root / "node0");
+    fs::create_directories(root / "node1");
+    fs::create_directories(root / "node2");
+
+    auto write = [](const fs::path& path, const char* contents) {
+        std::ofstream file(path);
+        file << contents;
+    };
+    write(root / "online", "0-2\n");
+    write(root / "node0" / "cpulist", "0-1,4\n");
+    write(root / "node1" / "cpulist", "\n"); // memory only
+    write(root / "node2" / "cpulist", "2-3\n");
+
+    std::vector<NumaNode> nodes = DiscoverNumaNodes(root.string());
+    ASSERT_EQ(nodes.size(), 2);
+    EXPECT_EQ(nodes[0].id, 0);
+    EXPECT_EQ(nodes[0].cpus, std::vector<int>({0, 1, 4}));
+    EXPECT_EQ(nodes[1].id, 2);
+    EXPECT_EQ(nodes[1].cpus, std::vector<int>({2, 3}));
+
+    // an unreadable node gives no topology
+    fs::remove(root / "node2" / "cpulist");
+    EXPECT_TRUE(DiscoverNumaNodes(root.string()).empty());
+    EXPECT_TRUE(DiscoverNumaNodes((root / "missing").string()).empty());
+
+    fs::remove_all(root);
+}
+
+TEST(DeviceCPUSuite, NumaBoundCpu)
+{
+    Cpu unbound;
+    EXPECT_EQ(unbound.numa_node(), -1);
+    EXPECT_EQ(unbound.workers(), nullptr);
+
+    Cpu cpu(0, {0});
+    EXPECT_EQ(cpu.numa_node(), 0);
+    EXPECT_EQ(cpu.cpus(), std::vector<int>({0}));
+
+    ThreadPool* workers = cpu.workers();
+    ASSERT_NE(workers, nullptr);
+    EXPECT_EQ(workers->num_threads(), 1);
+    EXPECT_EQ(cpu.workers(), workers) << "Workers must be started once";
+
+    // memory bound to the node is usable like any other
+    const size_t sizes[] = {100, size_t(1) << 27};
+    for (size_t size : sizes)
+    {
+        void* buffer = nullptr;
+        ASSERT_TRUE(cpu.malloc(DataType::Int8, size, buffer).ok());
+        std::memset(buffer, 1, size);
+        EXPECT_EQ(static_cast<char*>(buffer)[size - 1], 1);
+        EXPECT_TRUE(cpu.free(DataType::Int8, buffer).ok());
+    }
+}
+
+TEST(DeviceCPUSuite, CacheLineAlignment)
+{
+    Device* cpu = DeviceRegistry::instance().GetDevice("CPU:0");
+    std::vector<void*> buffers;
+    for (size_t size : {1, 3, 65, 1000, 100000})
+    {
+        void* buffer = nullptr;
+        ASSERT_TRUE(cpu->malloc(DataType::Int8, size, buffer).ok());
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(buffer) % 64, 0) << "Int8 buffer of " << size;
+        buffers.push_back(buffer);
+    }
+    for (void* buffer : buffers)
+    {
+        EXPECT_TRUE(cpu->free(DataType::Int8, buffer).ok());
+    }
+}
+
+TEST(DeviceCPUSuite, AllocOptions)
+{
+    Cpu cpu;
+    CpuAllocOptions defaults = cpu.alloc_options();
+    EXPECT_EQ(defaults.huge_pages, HugePages::Transparent);
+    EXPECT_FALSE(defaults.prefault);
+
+    const size_t size = size_t(3) << 21;
+    for (HugePages mode : {HugePages::Off, HugePages::Transparent, HugePages::Explicit})
+    {
+        CpuAllocOptions options;
+        options.huge_pages = mode;
+        options.prefault = true;
+        options.lock = mode == HugePages::Off;
+        cpu.set_alloc_options(options);
+        EXPECT_EQ(cpu.alloc_options().huge_pages, mode);
+
+        // binned and large blocks, both over the threshold
+        for (size_t bytes : {size, size_t(100) << 20})
+        {
+            void* buffer = nullptr;
+            ASSERT_TRUE(cpu.malloc(DataType::Int8, bytes, buffer).ok());
+            EXPECT_EQ(reinterpret_cast<uintptr_t>(buffer) % 64, 0);
+#if defined(__linux__)
+            // pre-faulted, every page is resident before first use
+            size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            uintptr_t begin = reinterpret_cast<uintptr_t>(buffer) / page * page;
+            uintptr_t end = reinterpret_cast<uintptr_t>(buffer) + bytes;
+            std::vector<unsigned char> resident((end - begin + page - 1) / page);
+            ASSERT_EQ(mincore(reinterpret_cast<void*>(begin), end - begin, resident.data()), 0);
+            size_t faulted = 0;
+            for (unsigned char r : resident) faulted += r & 1;
+            EXPECT_EQ(faulted, resident.size());
+#endif
+            std::memset(buffer, 1, bytes);
+            EXPECT_TRUE(cpu.free(DataType::Int8, buffer).ok());
+        }
+    }
+}
+
+TEST(DeviceCPUSuite, SystemMemory)
+{
+    CpuAllocOptions options;
+    size_t mapped = 0;
+
+    // below the threshold nothing is mapped
+    void* small = SystemAllocate(1000, 64, options, -1, mapped);
+    ASSERT_NE(small, nullptr);
+    EXPECT_EQ(mapped, 0);
+    SystemFree(small, 64, mapped);
+
+    void* large = SystemAllocate(kHugePageBytes + 1, 64, options, -1, mapped);
+    ASSERT_NE(large, nullptr);
+#if defined(__linux__)
+    // transparent huge pages need huge page aligned ranges
+    EXPECT_GE(mapped, kHugePageBytes + 1);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(large) % kHugePageBytes, 0);
+#endif
+    SystemFree(large, 64, mapped);
+}
+
 int main(int argc, char **argv) 
 {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
-}
\ No newline at end of file
+}
@@ -6,11 +6,28 @@
 
 using namespace graphloom;
 
-
 GL_REGISTER_DEVICE(TEST_CPU, CpuFactory);
 GL_REGISTER_DEVICE(TEST_CPU2, CpuFactory);
 GL_REGISTER_DEVICE(TEST_CPU3, CpuFactory);
 
+// discovers one device per NUMA node, as on a 3 node host
+class MultiNodeFactory : public DeviceFactory
+{
+public:
+    explicit MultiNodeFactory(const std::string& device_type) : DeviceFactory(device_type) {}
+
+    Status DiscoverDevices(std::vector<Device*>& devices_found) override
+    {
+        for (int node = 0; node < 3; ++node)
+        {
+            devices_found.push_back(new Cpu(node, {0}));
+        }
+        return Status::kOK;
+    }
+};
+
+GL_REGISTER_DEVICE(TEST_NUMA, MultiNodeFactory);
+
 TEST(DeviceRegistrySuite, TEST_CPU)
 {
     EXPECT_TRUE(DeviceRegistry::instance().HasDevice("TEST_CPU:0"))
@@ -55,14 +72,51 @@ TEST(DeviceRegistrySuite, Devices)
     }
 }
 
+TEST(DeviceRegistrySuite, NumberedInDiscoveryOrder)
+{
+    for (int node = 0; node < 3; ++node)
+    {
+        std::string name = "TEST_NUMA:" + std::to_string(node);
+        ASSERT_TRUE(DeviceRegistry::instance().HasDevice(name)) << name << " not found";
+
+        Cpu* cpu = static_cast<Cpu*>(DeviceRegistry::instance().GetDevice(name));
+        EXPECT_EQ(cpu->name(), name);
+        EXPECT_EQ(cpu->numa_node(), node);
+    }
+    EXPECT_FALSE(DeviceRegistry::instance().HasDevice("TEST_NUMA"));
+}
+
 TEST(DeviceRegistrySuite, DuplicateName)
 {
     // Should fail and throw exception due to duplicate device type name
     EXPECT_THROW(RegisterDevice<CpuFactory>().Register("TEST_CPU"), GlException);
 }
 
+TEST(DeviceRegistrySuite, MemoryReport)
+{
+    Device* device = DeviceRegistry::instance().GetDevice("TEST_CPU2:0");
+    DeviceRegistry::instance().SetMemoryProfiling(MemoryProfiling::Nodes);
+    EXPECT_EQ(device->memory_profiling(), MemoryProfiling::Nodes);
+
+    const std::string node("report_node");
+    void* buffer = nullptr;
+    {
+        MemoryScope scope(node);
+        ASSERT_TRUE(device->malloc(DataType::Float, 256, buffer).ok());
+    }
+
+    std::string report = DeviceRegistry::instance().GenMemoryReport();
+    EXPECT_NE(report.find("TEST_CPU2:0: live 1024 B"), std::string::npos) << report;
+    EXPECT_NE(report.find("  report_node: live 1024 B"), std::string::npos) << report;
+    EXPECT_EQ(DeviceRegistry::instance().GenMemoryReport(0).find("report_node"), std::string::npos);
+
+    EXPECT_TRUE(device->free(DataType::Float, buffer).ok());
+    DeviceRegistry::instance().SetMemoryProfiling(MemoryProfiling::Off);
+    EXPECT_THROW(DeviceRegistry::instance().GetMemoryStats("NOT_A_DEVICE:0"), std::out_of_range);
+}
+
 int main(int argc, char **argv) 
 {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
-}
\ No newline at end of file
+}
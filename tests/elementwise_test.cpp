@@ -0,0 +1,378 @@
+#include <gtest/gtest.h>
+#include <graphloom/graphloom.h>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "kernels/broadcast.h"
+#include "feed_placeholder.h"
+
+using namespace graphloom;
+
+static Initializer register_elementwise_input = 
+    RegisterFeedPlaceholder<DataType::Float, DataType::Double, DataType::BFloat16>("elementwise_input");
+
+template<typename T>
+void FillRandom(TensorBuffer& tensor, std::mt19937& rng, double low, double high)
+{
+    std::uniform_real_distribution<double> dist(low, high);
+    T* data = tensor.Map<T>().data();
+    for (size_t i = 0; i < tensor.size(); ++i)
+    {
+        data[i] = static_cast<T>(dist(rng));
+    }
+}
+
+/**
+ * @returns Index into a tensor of shape for the broadcast
+ * output element at index of out_shape
+*/
+size_t BroadcastIndex(const LayoutArray& shape, const LayoutArray& out_shape, size_t index)
+{
+    size_t offset = out_shape.rank() - shape.rank();
+    size_t result = 0;
+    size_t stride = 1;
+    for (size_t d = out_shape.rank(); d-- > 0;)
+    {
+        size_t i = index % out_shape[d];
+        index /= out_shape[d];
+        if (d < offset) continue;
+
+        size_t size = shape[d - offset];
+        result += (size == 1 ? 0 : i) * stride;
+        stride *= size;
+    }
+    return result;
+}
+
+template<typename T>
+void CheckBinary(const std::string& op, const std::function<T(T, T)>& reference,
+    DataType dtype, const LayoutArray& a_shape, const LayoutArray& b_shape,
+    const LayoutArray& out_shape, size_t threads = 1)
+{
+    GraphDef graph;
+    NodeDef* a = NodeDefBuilder(graph, "elementwise_input", "CPU:0").Name("a").Build({dtype});
+    NodeDef* b = NodeDefBuilder(graph, "elementwise_input", "CPU:0").Name("b").Build({dtype});
+    NodeDef* c = NodeDefBuilder(graph, op, "CPU:0").
+        Input(a, 0).
+        Input(b, 0).
+        Name("c").
+        Build({dtype});
+
+    SessionOptions options;
+    options.inter_op_threads = threads;
+    Session session(options);
+    ASSERT_TRUE(session.UpdateGraph(graph).ok());
+
+    Device* cpu = DeviceRegistry::instance().GetDevice("CPU:0");
+    TensorBuffer a_value(dtype, a_shape, cpu);
+    TensorBuffer b_value(dtype, b_shape, cpu);
+    std::mt19937 rng(static_cast<unsigned>(a_shape.NumElements() * 31 + b_shape.NumElements()));
+    FillRandom<T>(a_value, rng, 0.5, 2.0);
+    FillRandom<T>(b_value, rng, 0.5, 2.0);
+
+    std::vector<TensorBuffer> outputs;
+    Status status = session.Run({{a, &a_value}, {b, &b_value}}, {c}, outputs);
+    ASSERT_TRUE(status.ok()) << status.msg();
+    ASSERT_EQ(outputs.size(), 1);
+    ASSERT_EQ(outputs[0].shape().rank(), out_shape.rank());
+    for (size_t d = 0; d < out_shape.rank(); ++d)
+    {
+        ASSERT_EQ(outputs[0].shape()[d], out_shape[d]);
+    }
+
+    const T* a_data = a_value.Map<T>().data();
+    const T* b_data = b_value.Map<T>().data();
+    const T* result = outputs[0].Map<T>().data();
+    for (size_t i = 0; i < out_shape.NumElements(); ++i)
+    {
+        T expected = reference(a_data[BroadcastIndex(a_shape, out_shape, i)],
+            b_data[BroadcastIndex(b_shape, out_shape, i)]);
+        ASSERT_EQ(result[i], expected) << op << " mismatch at " << i;
+    }
+}
+
+template<typename T>
+void CheckUnary(const std::string& op, const std::function<double(double)>& reference,
+    DataType dtype, double low, double high, double tolerance)
+{
+    GraphDef graph;
+    NodeDef* x = NodeDefBuilder(graph, "elementwise_input", "CPU:0").Name("x").Build({dtype});
+    NodeDef* y = NodeDefBuilder(graph, op, "CPU:0").Input(x, 0).Name("y").Build({dtype});
+
+    Session session;
+    ASSERT_TRUE(session.UpdateGraph(graph).ok());
+
+    Device* cpu = DeviceRegistry::instance().GetDevice("CPU:0");
+    TensorBuffer x_value(dtype, {7, 1001}, cpu);
+    std::mt19937 rng(7);
+    FillRandom<T>(x_value, rng, low, high);
+
+    std::vector<TensorBuffer> outputs;
+    Status status = session.Run({{x, &x_value}}, {y}, outputs);
+    ASSERT_TRUE(status.ok()) << status.msg();
+    ASSERT_EQ(outputs[0].size(), x_value.size());
+
+    const T* data = x_value.Map<T>().data();
+    const T* result = outputs[0].Map<T>().data();
+    for (size_t i = 0; i < x_value.size(); ++i)
+    {
+        double expected = reference(static_cast<double>(data[i]));
+        ASSERT_NEAR(result[i], expected, tolerance * std::max(1.0, std::fabs(expected)))
+            << op << "(" << data[i] << ")";
+    }
+}
+
+TEST(ElementwiseSuite, Registered)
+{
+    for (const char* name : {"Add", "Sub", "Mul", "Div", "Max", "Min"})
+    {
+        ASSERT_TRUE(OpRegistry::instance().HasOp(name)) << name;
+        EXPECT_EQ(OpRegistry::instance().GetOp(name).num_inputs(), 2);
+    }
+    for (const char* name : {"Relu", "Sigmoid", "Tanh", "Exp", "Log"})
+    {
+        ASSERT_TRUE(OpRegistry::instance().HasOp(name)) << name;
+        EXPECT_EQ(OpRegistry::instance().GetOp(name).num_inputs(), 1);
+    }
+}
+
+TEST(ElementwiseSuite, PlanCollapses)
+{
+    BroadcastPlan plan;
+
+    // same shapes are one contiguous loop
+    ASSERT_TRUE(plan.Init({2, 3, 4}, {2, 3, 4}).ok());
+    EXPECT_EQ(plan.rank(), 1);
+    EXPECT_EQ(plan.inner_size(), 24);
+    EXPECT_EQ(plan.outer_rows(), 1);
+
+    // a broadcast row vector adds an outer loop
+    ASSERT_TRUE(plan.Init({2, 3, 4}, {4}).ok());
+    EXPECT_EQ(plan.rank(), 2);
+    EXPECT_EQ(plan.inner_size(), 4);
+    EXPECT_EQ(plan.outer_rows(), 6);
+    EXPECT_EQ(plan.b_inner_step(), 1);
+
+    // size 1 dimensions vanish
+    ASSERT_TRUE(plan.Init({1, 5, 1}, {5, 1}).ok());
+    EXPECT_EQ(plan.rank(), 1);
+    EXPECT_EQ(plan.inner_size(), 5);
+
+    // a column against a row
+    ASSERT_TRUE(plan.Init({3, 1}, {1, 4}).ok());
+    EXPECT_EQ(plan.rank(), 2);
+    EXPECT_EQ(plan.inner_size(), 4);
+    EXPECT_EQ(plan.a_inner_step(), 0);
+    EXPECT_EQ(plan.b_inner_step(), 1);
+    size_t a_offset, b_offset;
+    plan.RowOffsets(2, a_offset, b_offset);
+    EXPECT_EQ(a_offset, 2);
+    EXPECT_EQ(b_offset, 0);
+
+    // a scalar
+    ASSERT_TRUE(plan.Init(LayoutArray(), {6}).ok());
+    EXPECT_EQ(plan.rank(), 1);
+    EXPECT_EQ(plan.a_inner_step(), 0);
+
+    EXPECT_FALSE(plan.Init({3}, {4}).ok());
+}
+
+TEST(ElementwiseSuite, OutputShape)
+{
+    LayoutArray shape;
+    ASSERT_TRUE(BroadcastPlan::OutputShape({8, 1, 6, 1}, {7, 1, 5}, shape).ok());
+    ASSERT_EQ(shape.rank(), 4);
+    EXPECT_EQ(shape[0], 8);
+    EXPECT_EQ(shape[1], 7);
+    EXPECT_EQ(shape[2], 6);
+    EXPECT_EQ(shape[3], 5);
+
+    EXPECT_FALSE(BroadcastPlan::OutputShape({2, 3}, {2}, shape).ok());
+}
+
+TEST(ElementwiseSuite, BinaryOps)
+{
+    CheckBinary<float>("Add", [](float a, float b) { return a + b; },
+        DataType::Float, {3, 37}, {3, 37}, {3, 37});
+    CheckBinary<float>("Sub", [](float a, float b) { return a - b; },
+        DataType::Float, {4, 5, 6}, {6}, {4, 5, 6});
+    CheckBinary<float>("Mul", [](float a, float b) { return a * b; },
+        DataType::Float, {3, 1}, {1, 70}, {3, 70});
+    CheckBinary<float>("Div", [](float a, float b) { return a / b; },
+        DataType::Float, {5, 1, 9}, {5, 4, 1}, {5, 4, 9});
+    CheckBinary<float>("Max", [](float a, float b) { return std::max(a, b); },
+        DataType::Float, {1}, {33}, {33});
+    CheckBinary<float>("Min", [](float a, float b) { return std::min(a, b); },
+        DataType::Float, {2, 3}, {1}, {2, 3});
+
+    CheckBinary<double>("Add", [](double a, double b) { return a + b; },
+        DataType::Double, {2, 1, 3}, {4, 1}, {2, 4, 3});
+    CheckBinary<double>("Div", [](double a, double b) { return a / b; },
+        DataType::Double, {17}, {17}, {17});
+}
+
+TEST(ElementwiseSuite, BroadcastShapesMismatch)
+{
+    GraphDef graph;
+    NodeDef* a = NodeDefBuilder(graph, "elementwise_input", "CPU:0").Name("a").Build({DataType::Float});
+    NodeDef* b = NodeDefBuilder(graph, "elementwise_input", "CPU:0").Name("b").Build({DataType::Float});
+    NodeDef* c = NodeDefBuilder(graph, "Add", "CPU:0").Input(a, 0).Input(b, 0).Name("c").Build({DataType::Float});
+
+    Session session;
+    ASSERT_TRUE(session.UpdateGraph(graph).ok());
+
+    Device* cpu = DeviceRegistry::instance().GetDevice("CPU:0");
+    TensorBuffer a_value(DataType::Float, {3}, cpu);
+    TensorBuffer b_value(DataType::Float, {4}, cpu);
+    std::vector<TensorBuffer> outputs;
+    EXPECT_FALSE(session.Run({{a, &a_value}, {b, &b_value}}, {c}, outputs).ok());
+}
+
+TEST(ElementwiseSuite, UnaryOps)
+{
+    auto relu = [](double x) { return x > 0.0 ? x : 0.0; };
+    auto sigmoid = [](double x) { return 1.0 / (1.0 + std::exp(-x)); };
+    auto tanh = [](double x) { return std::tanh(x); };
+    auto exp = [](double x) { return std::exp(x); };
+    auto log = [](double x) { return std::log(x); };
+
+    CheckUnary<float>("Relu", relu, DataType::Float, -5.0, 5.0, 0.0);
+    CheckUnary<float>("Sigmoid", sigmoid, DataType::Float, -20.0, 20.0, 1e-6);
+    CheckUnary<float>("Tanh", tanh, DataType::Float, -10.0, 10.0, 1e-6);
+    CheckUnary<float>("Tanh", tanh, DataType::Float, -0.1, 0.1, 1e-6);
+    CheckUnary<float>("Exp", exp, DataType::Float, -80.0, 80.0, 1e-6);
+    CheckUnary<float>("Log", log, DataType::Float, 1e-30, 1e30, 1e-6);
+    CheckUnary<float>("Log", log, DataType::Float, 0.5, 2.0, 1e-6);
+
+    CheckUnary<double>("Relu", relu, DataType::Double, -5.0, 5.0, 0.0);
+    CheckUnary<double>("Sigmoid", sigmoid, DataType::Double, -20.0, 20.0, 1e-14);
+    CheckUnary<double>("Exp", exp, DataType::Double, -50.0, 50.0, 1e-14);
+    CheckUnary<double>("Log", log, DataType::Double, 1e-10, 1e10, 1e-14);
+}
+
+TEST(ElementwiseSuite, SpecialValues)
+{
+    const float inf = std::numeric_limits<float>::infinity();
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const std::vector<float> inputs = {0.0f, -1.0f, inf, -inf, nan, 100.0f, -100.0f, 1e-40f};
+
+    GraphDef graph;
+    NodeDef* x = NodeDefBuilder(graph, "elementwise_input", "CPU:0").Name("x").Build({DataType::Float});
+    NodeDef* exp = NodeDefBuilder(graph, "Exp", "CPU:0").Input(x, 0).Name("exp").Build({DataType::Float});
+    NodeDef* log = NodeDefBuilder(graph, "Log", "CPU:0").Input(x, 0).Name("log").Build({DataType::Float});
+
+    Session session;
+    ASSERT_TRUE(session.UpdateGraph(graph).ok());
+
+    Device* cpu = DeviceRegistry::instance().GetDevice("CPU:0");
+    TensorBuffer x_value(DataType::Float, {inputs.size()}, cpu);
+    std::copy(inputs.begin(), inputs.end(), x_value.Map<float>().data());
+
+    std::vector<TensorBuffer> outputs;
+    Status status = session.Run({{x, &x_value}}, {exp, log}, outputs);
+    ASSERT_TRUE(status.ok()) << status.msg();
+
+    const float* exp_data = outputs[0].Map<float>().data();
+    const float* log_data = outputs[1].Map<float>().data();
+    for (size_t i = 0; i < inputs.size(); ++i)
+    {
+        float expected_exp = std::exp(inputs[i]);
+        float expected_log = std::log(inputs[i]);
+        // results below the normal range flush to 0
+        if (std::isnan(expected_exp)) EXPECT_TRUE(std::isnan(exp_data[i])) << inputs[i];
+        else if (std::isinf(expected_exp)) EXPECT_EQ(exp_data[i], expected_exp) << inputs[i];
+        else EXPECT_NEAR(exp_data[i], expected_exp, 
+            std::max(1e-6f * expected_exp, std::numeric_limits<float>::min())) << inputs[i];
+        if (std::isnan(expected_log)) EXPECT_TRUE(std::isnan(log_data[i])) << inputs[i];
+        else if (std::isinf(expected_log)) EXPECT_EQ(log_data[i], expected_log) << inputs[i];
+        else EXPECT_NEAR(log_data[i], expected_log, 1e-5f * std::fabs(expected_log)) << inputs[i];
+    }
+}
+
+TEST(ElementwiseSuite, BFloat16)
+{
+    GraphDef graph;
+    NodeDef* a = NodeDefBuilder(graph, "elementwise_input", "CPU:0").Name("a").Build({DataType::BFloat16});
+    NodeDef* b = NodeDefBuilder(graph, "elementwise_input", "CPU:0").Name("b").Build({DataType::BFloat16});
+    NodeDef* mul = NodeDefBuilder(graph, "Mul", "CPU:0").Input(a, 0).Input(b, 0).Name("mul").Build({DataType::BFloat16});
+    NodeDef* exp = NodeDefBuilder(graph, "Exp", "CPU:0").Input(a, 0).Name("exp").Build({DataType::BFloat16});
+
+    Session session;
+    ASSERT_TRUE(session.UpdateGraph(graph).ok());
+
+    Device* cpu = DeviceRegistry::instance().GetDevice("CPU:0");
+    TensorBuffer a_value(DataType::BFloat16, {5, 67}, cpu);
+    TensorBuffer b_value(DataType::BFloat16, {67}, cpu);
+    std::mt19937 rng(11);
+    FillRandom<Bf16>(a_value, rng, -4.0, 4.0);
+    FillRandom<Bf16>(b_value, rng, -4.0, 4.0);
+
+    std::vector<TensorBuffer> outputs;
+    Status status = session.Run({{a, &a_value}, {b, &b_value}}, {mul, exp}, outputs);
+    ASSERT_TRUE(status.ok()) << status.msg();
+    ASSERT_EQ(outputs[0].dtype(), DataType::BFloat16);
+
+    const Bf16* a_data = a_value.Map<Bf16>().data();
+    const Bf16* b_data = b_value.Map<Bf16>().data();
+    const Bf16* mul_data = outputs[0].Map<Bf16>().data();
+    const Bf16* exp_data = outputs[1].Map<Bf16>().data();
+    for (size_t i = 0; i < a_value.size(); ++i)
+    {
+        // computed in float, rounded once to bfloat16
+        float x = static_cast<float>(a_data[i]);
+        Bf16 expected_mul(x * static_cast<float>(b_data[i % 67]));
+        ASSERT_EQ(mul_data[i].bits, expected_mul.bits) << "Mul mismatch at " << i;
+
+        float expected_exp = std::exp(x);
+        ASSERT_NEAR(static_cast<float>(exp_data[i]), expected_exp, expected_exp / 128) << "Exp(" << x << ")";
+    }
+}
+
+TEST(ElementwiseSuite, Parallel)
+{
+    // rows of a broadcast and a row longer than a chunk
+    CheckBinary<float>("Add", [](float a, float b) { return a + b; },
+        DataType::Float, {300, 1000}, {1000}, {300, 1000}, 4);
+    CheckBinary<float>("Mul", [](float a, float b) { return a * b; },
+        DataType::Float, {100000}, {1}, {100000}, 4);
+    CheckBinary<double>("Max", [](double a, double b) { return std::max(a, b); },
+        DataType::Double, {40000, 1}, {1, 3}, {40000, 3}, 4);
+}
+
+TEST(ElementwiseSuite, StridedFeed)
+{
+    GraphDef graph;
+    NodeDef* a = NodeDefBuilder(graph, "elementwise_input", "CPU:0").Name("a").Build({DataType::Float});
+    NodeDef* b = NodeDefBuilder(graph, "elementwise_input", "CPU:0").Name("b").Build({DataType::Float});
+    NodeDef* c = NodeDefBuilder(graph, "Sub", "CPU:0").Input(a, 0).Input(b, 0).Name("c").Build({DataType::Float});
+
+    Session session;
+    ASSERT_TRUE(session.UpdateGraph(graph).ok());
+
+    Device* cpu = DeviceRegistry::instance().GetDevice("CPU:0");
+    TensorBuffer a_value(DataType::Float, {3, 5}, cpu);
+    TensorBuffer b_value(DataType::Float, {5, 3}, cpu);
+    std::mt19937 rng(3);
+    FillRandom<float>(a_value, rng, -1.0, 1.0);
+    FillRandom<float>(b_value, rng, -1.0, 1.0);
+
+    // a transposed view is packed before the kernel reads it
+    TensorBuffer b_view = b_value.Transpose();
+    std::vector<TensorBuffer> outputs;
+    Status status = session.Run({{a, &a_value}, {b, &b_view}}, {c}, outputs);
+    ASSERT_TRUE(status.ok()) << status.msg();
+
+    TensorMap<float> result = outputs[0].Map<float>();
+    for (size_t i = 0; i < 3; ++i)
+    {
+        for (size_t j = 0; j < 5; ++j)
+        {
+            EXPECT_EQ(result(i, j), a_value.Map<float>()(i, j) - b_value.Map<float>()(j, i));
+        }
+    }
+}
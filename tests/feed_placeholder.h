@@ -0,0 +1,51 @@
+#ifndef GRAPHLOOM_TESTS_FEED_PLACEHOLDER_H_
+#define GRAPHLOOM_TESTS_FEED_PLACEHOLDER_H_
+
+#include <string>
+
+#include <graphloom/graphloom.h>
+
+/**
+ * Input placeholders shared by the kernel tests. A placeholder
+ * op has one output of unknown shape and a CPU kernel for each
+ * of its data types, graphs must feed it.
+*/
+
+namespace graphloom
+{
+    /**
+     * Kernel of a placeholder output of dtype, only ever fed
+    */
+    template<DataType dtype>
+    class FeedOnlyKernel : public OpKernel
+    {
+    public:
+        FeedOnlyKernel(const OpKernelContext& context) : OpKernel(context) {}
+
+        Status Compute(ComputeContext&) override
+        {
+            return Status(1, "Input placeholder must be fed");
+        }
+    };
+
+    inline Status UnknownShape(const ComputeContext&, LayoutArray&)
+    {
+        return Status(1, "Shape is only known when fed");
+    }
+
+    /**
+     * Registers a placeholder op with a kernel for each of dtypes
+     *
+     * @param op_name Name of the placeholder op
+     * @returns Initializer object to allow out-of-main initalization
+    */
+    template<DataType... dtypes>
+    Initializer RegisterFeedPlaceholder(const std::string& op_name)
+    {
+        OpBuilder(op_name).Output(UnknownShape).Build();
+        ((void)OpKernelDefBuilder<FeedOnlyKernel<dtypes>>(op_name, "CPU").Output(dtypes).Build(), ...);
+        return Initializer();
+    }
+}
+
+#endif
@@ -0,0 +1,409 @@
+#include <gtest/gtest.h>
+#include <graphloom/graphloom.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "kernels/gemm.h"
+#include "kernels/gemm_int8.h"
+#include "feed_placeholder.h"
+
+using namespace graphloom;
+
+static Initializer register_matmul_input = 
+    RegisterFeedPlaceholder<DataType::Float, DataType::Double, DataType::BFloat16, DataType::Int8>("matmul_input");
+
+template<typename T>
+std::vector<T> Reference(size_t m, size_t n, size_t k, const T* a, const T* b)
+{
+    std::vector<T> c(m * n, T(0));
+    for (size_t i = 0; i < m; ++i)
+    {
+        for (size_t p = 0; p < k; ++p)
+        {
+            for (size_t j = 0; j < n; ++j)
+            {
+                c[i * n + j] += a[i * k + p] * b[p * n + j];
+            }
+        }
+    }
+    return c;
+}
+
+template<typename T>
+void FillRandom(TensorBuffer& tensor, std::mt19937& rng)
+{
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    T* data = tensor.Map<T>().data();
+    for (size_t i = 0; i < tensor.size(); ++i)
+    {
+        data[i] = static_cast<T>(dist(rng));
+    }
+}
+
+template<typename T>
+void CheckMatMul(DataType dtype, size_t m, size_t n, size_t k, size_t threads)
+{
+    GraphDef graph;
+    NodeDef* a = NodeDefBuilder(graph, "matmul_input", "CPU:0").Name("a").Build({dtype});
+    NodeDef* b = NodeDefBuilder(graph, "matmul_input", "CPU:0").Name("b").Build({dtype});
+    NodeDef* c = NodeDefBuilder(graph, "MatMul", "CPU:0").
+        Input(a, 0).
+        Input(b, 0).
+        Name("c").
+        Build({dtype});
+
+    SessionOptions options;
+    options.inter_op_threads = threads;
+    Session session(options);
+    ASSERT_TRUE(session.UpdateGraph(graph).ok());
+
+    Device* cpu = DeviceRegistry::instance().GetDevice("CPU:0");
+    TensorBuffer a_value(dtype, {m, k}, cpu);
+    TensorBuffer b_value(dtype, {k, n}, cpu);
+    std::mt19937 rng(static_cast<unsigned>(m * 7919 + n * 31 + k));
+    FillRandom<T>(a_value, rng);
+    FillRandom<T>(b_value, rng);
+
+    std::vector<TensorBuffer> outputs;
+    Status status = session.Run({{a, &a_value}, {b, &b_value}}, {c}, outputs);
+    ASSERT_TRUE(status.ok()) << status.msg();
+    ASSERT_EQ(outputs.size(), 1);
+    ASSERT_EQ(outputs[0].shape().rank(), 2);
+    ASSERT_EQ(outputs[0].shape()[0], m);
+    ASSERT_EQ(outputs[0].shape()[1], n);
+
+    std::vector<T> expected = Reference(m, n, k, 
+        a_value.Map<T>().data(), b_value.Map<T>().data());
+    const T* result = outputs[0].Map<T>().data();
+    double tolerance = (sizeof(T) == 4 ? 1e-5 : 1e-12) * k;
+    for (size_t i = 0; i < m * n; ++i)
+    {
+        ASSERT_NEAR(result[i], expected[i], tolerance) 
+            << "Mismatch at (" << i / n << ", " << i % n << ") of " 
+            << m << "x" << n << "x" << k;
+    }
+}
+
+TEST(MatMulSuite, Registered)
+{
+    ASSERT_TRUE(OpRegistry::instance().HasOp("MatMul"));
+    const Op& op = OpRegistry::instance().GetOp("MatMul");
+    EXPECT_EQ(op.num_inputs(), 2);
+    EXPECT_EQ(op.num_outputs(), 1);
+}
+
+TEST(MatMulSuite, FloatShapes)
+{
+    // edge tiles, single tiles and more than one packed block of K
+    CheckMatMul<float>(DataType::Float, 1, 1, 1, 1);
+    CheckMatMul<float>(DataType::Float, 13, 17, 19, 1);
+    CheckMatMul<float>(DataType::Float, 24, 64, 256, 1);
+    CheckMatMul<float>(DataType::Float, 100, 70, 300, 1);
+}
+
+TEST(MatMulSuite, DoubleShapes)
+{
+    CheckMatMul<double>(DataType::Double, 1, 1, 1, 1);
+    CheckMatMul<double>(DataType::Double, 13, 17, 19, 1);
+    CheckMatMul<double>(DataType::Double, 100, 70, 300, 1);
+}
+
+TEST(MatMulSuite, Parallel)
+{
+    CheckMatMul<float>(DataType::Float, 200, 300, 150, 4);
+    CheckMatMul<double>(DataType::Double, 130, 257, 129, 4);
+}
+
+TEST(MatMulSuite, BFloat16)
+{
+    for (size_t threads : {1, 4})
+    {
+        const size_t m = 37, n = 70, k = 300;
+        GraphDef graph;
+        NodeDef* a = NodeDefBuilder(graph, "matmul_input", "CPU:0").Name("a").Build({DataType::BFloat16});
+        NodeDef* b = NodeDefBuilder(graph, "matmul_input", "CPU:0").Name("b").Build({DataType::BFloat16});
+        NodeDef* c = NodeDefBuilder(graph, "MatMul", "CPU:0").
+            Input(a, 0).
+            Input(b, 0).
+            Name("c").
+            Build({DataType::Float});
+
+        SessionOptions options;
+        options.inter_op_threads = threads;
+        Session session(options);
+        ASSERT_TRUE(session.UpdateGraph(graph).ok());
+
+        Device* cpu = DeviceRegistry::instance().GetDevice("CPU:0");
+        TensorBuffer a_value(DataType::BFloat16, {m, k}, cpu);
+        TensorBuffer b_value(DataType::BFloat16, {k, n}, cpu);
+        std::mt19937 rng(5);
+        FillRandom<Bf16>(a_value, rng);
+        FillRandom<Bf16>(b_value, rng);
+
+        std::vector<TensorBuffer> outputs;
+        Status status = session.Run({{a, &a_value}, {b, &b_value}}, {c}, outputs);
+        ASSERT_TRUE(status.ok()) << status.msg();
+        ASSERT_EQ(outputs[0].dtype(), DataType::Float);
+
+        // inputs are exact in float, only the accumulation rounds
+        std::vector<float> a_float(m * k);
+        std::vector<float> b_float(k * n);
+        for (size_t i = 0; i < a_float.size(); ++i) a_float[i] = static_cast<float>(a_value.Map<Bf16>().data()[i]);
+        for (size_t i = 0; i < b_float.size(); ++i) b_float[i] = static_cast<float>(b_value.Map<Bf16>().data()[i]);
+        std::vector<float> expected = Reference(m, n, k, a_float.data(), b_float.data());
+
+        const float* result = outputs[0].Map<float>().data();
+        for (size_t i = 0; i < m * n; ++i)
+        {
+            ASSERT_NEAR(result[i], expected[i], 1e-5 * k) << "Mismatch at " << i;
+        }
+    }
+}
+
+TensorBuffer RandomInt8(size_t rows, size_t cols, std::mt19937& rng)
+{
+    TensorBuffer tensor(DataType::Int8, {rows, cols}, DeviceRegistry::instance().GetDevice("CPU:0"));
+    std::uniform_int_distribution<int> dist(-128, 127);
+    int8_t* data = tensor.Map<int8_t>().data();
+    for (size_t i = 0; i < tensor.size(); ++i)
+    {
+        data[i] = static_cast<int8_t>(dist(rng));
+    }
+    return tensor;
+}
+
+/**
+ * Checks the Int32, Float and requantized Int8 outputs 
+ * of an int8 product against the same math in int64
+*/
+void CheckQuantizedMatMul(size_t m, size_t n, size_t k, bool b_per_channel, size_t threads)
+{
+    const float out_scale = 40.0f;
+    const int32_t out_zero_point = -2;
+
+    GraphDef graph;
+    NodeDef* a = NodeDefBuilder(graph, "matmul_input", "CPU:0").Name("a").Build({DataType::Int8});
+    NodeDef* b = NodeDefBuilder(graph, "matmul_input", "CPU:0").Name("b").Build({DataType::Int8});
+    NodeDef* acc = NodeDefBuilder(graph, "MatMul", "CPU:0").Input(a, 0).Input(b, 0).Name("acc").Build({DataType::Int32});
+    NodeDef* real = NodeDefBuilder(graph, "MatMul", "CPU:0").Input(a, 0).Input(b, 0).Name("real").Build({DataType::Float});
+    NodeDef* requantized = NodeDefBuilder(graph, "QuantizedMatMul", "CPU:0").
+        Input(a, 0).
+        Input(b, 0).
+        SetAttr("out_scale", out_scale).
+        SetAttr("out_zero_point", out_zero_point).
+        Name("requantized").
+        Build({DataType::Int8});
+
+    SessionOptions options;
+    options.inter_op_threads = threads;
+    Session session(options);
+    ASSERT_TRUE(session.UpdateGraph(graph).ok());
+
+    std::mt19937 rng(static_cast<unsigned>(m * 7919 + n * 31 + k));
+    TensorBuffer a_value = RandomInt8(m, k, rng);
+    TensorBuffer b_value = RandomInt8(k, n, rng);
+    a_value.set_quant_params(QuantParams::PerTensor(0.05f, 3));
+    if (b_per_channel)
+    {
+        std::vector<float> scales(n);
+        for (size_t j = 0; j < n; ++j) scales[j] = 0.01f * static_cast<float>(j % 7 + 1);
+        b_value.set_quant_params(QuantParams::PerChannel(1, scales, std::vector<int32_t>(n, 0)));
+    }
+    else
+    {
+        b_value.set_quant_params(QuantParams::PerTensor(0.02f, -5));
+    }
+
+    std::vector<TensorBuffer> outputs;
+    Status status = session.Run({{a, &a_value}, {b, &b_value}}, {acc, real, requantized}, outputs);
+    ASSERT_TRUE(status.ok()) << status.msg();
+    ASSERT_EQ(outputs[2].quant_params()->scale(), out_scale);
+
+    const QuantParams& a_params = *a_value.quant_params();
+    const QuantParams& b_params = *b_value.quant_params();
+    const int8_t* a_data = a_value.Map<int8_t>().data();
+    const int8_t* b_data = b_value.Map<int8_t>().data();
+    for (size_t i = 0; i < m; ++i)
+    {
+        for (size_t j = 0; j < n; ++j)
+        {
+            size_t channel = b_per_channel ? j : 0;
+            int64_t expected = 0;
+            for (size_t p = 0; p < k; ++p)
+            {
+                expected += (int64_t(a_data[i * k + p]) - a_params.zero_point()) * 
+                    (int64_t(b_data[p * n + j]) - b_params.zero_point(channel));
+            }
+
+            float multiplier = a_params.scale() * b_params.scale(channel);
+            ASSERT_EQ(outputs[0].Map<int32_t>().data()[i * n + j], expected) 
+                << "Mismatch at (" << i << ", " << j << ") of " << m << "x" << n << "x" << k;
+            ASSERT_EQ(outputs[1].Map<float>().data()[i * n + j], static_cast<float>(expected) * multiplier);
+            ASSERT_EQ(outputs[2].Map<int8_t>().data()[i * n + j], 
+                QuantizeValue(static_cast<float>(expected), multiplier / out_scale, out_zero_point));
+        }
+    }
+}
+
+TEST(MatMulSuite, Int8)
+{
+    for (CpuIsa isa : {CpuIsa::Generic, CpuIsa::Avx2, CpuIsa::Avx512Vnni})
+    {
+        if (!CpuIsaSupported(isa)) continue;
+        LimitCpuIsa(isa);
+
+        // edge tiles, K not a multiple of 4 and more than one packed block of K
+        CheckQuantizedMatMul(1, 1, 1, false, 1);
+        CheckQuantizedMatMul(13, 37, 19, true, 1);
+        CheckQuantizedMatMul(30, 70, 1031, false, 1);
+        CheckQuantizedMatMul(100, 130, 301, true, 4);
+    }
+    LimitCpuIsa(CpuIsa::Avx512Bf16);
+}
+
+TEST(MatMulSuite, Int8Unquantized)
+{
+    GraphDef graph;
+    NodeDef* a = NodeDefBuilder(graph, "matmul_input", "CPU:0").Name("a").Build({DataType::Int8});
+    NodeDef* b = NodeDefBuilder(graph, "matmul_input", "CPU:0").Name("b").Build({DataType::Int8});
+    NodeDef* c = NodeDefBuilder(graph, "MatMul", "CPU:0").Input(a, 0).Input(b, 0).Name("c").Build({DataType::Int32});
+
+    Session session;
+    ASSERT_TRUE(session.UpdateGraph(graph).ok());
+
+    // plain integers, the extremes of int8
+    Device* cpu = DeviceRegistry::instance().GetDevice("CPU:0");
+    TensorBuffer a_value(DataType::Int8, {2, 64}, cpu);
+    TensorBuffer b_value(DataType::Int8, {64, 3}, cpu);
+    std::fill(a_value.Map<int8_t>().begin(), a_value.Map<int8_t>().end(), int8_t(-128));
+    std::fill(b_value.Map<int8_t>().begin(), b_value.Map<int8_t>().end(), int8_t(-128));
+
+    std::vector<TensorBuffer> outputs;
+    ASSERT_TRUE(session.Run({{a, &a_value}, {b, &b_value}}, {c}, outputs).ok());
+    for (size_t i = 0; i < 6; ++i)
+    {
+        EXPECT_EQ(outputs[0].Map<int32_t>().data()[i], 64 * 128 * 128);
+    }
+
+    // A must be quantized per tensor
+    a_value.set_quant_params(QuantParams::PerChannel(0, {1.0f, 1.0f}, {0, 0}));
+    EXPECT_FALSE(session.Run({{a, &a_value}, {b, &b_value}}, {c}, outputs).ok());
+}
+
+TEST(MatMulSuite, MismatchedShapes)
+{
+    GraphDef graph;
+    NodeDef* a = NodeDefBuilder(graph, "matmul_input", "CPU:0").Name("a").Build({DataType::Float});
+    NodeDef* b = NodeDefBuilder(graph, "matmul_input", "CPU:0").Name("b").Build({DataType::Float});
+    NodeDef* c = NodeDefBuilder(graph, "MatMul", "CPU:0").
+        Input(a, 0).
+        Input(b, 0).
+        Name("c").
+        Build({DataType::Float});
+
+    Session session;
+    ASSERT_TRUE(session.UpdateGraph(graph).ok());
+
+    Device* cpu = DeviceRegistry::instance().GetDevice("CPU:0");
+    TensorBuffer a_value(DataType::Float, {4, 5}, cpu);
+    TensorBuffer b_value(DataType::Float, {6, 7}, cpu);
+    std::vector<TensorBuffer> outputs;
+    EXPECT_FALSE(session.Run({{a, &a_value}, {b, &b_value}}, {c}, outputs).ok());
+}
+
+template<typename T>
+void CheckMicroKernel(const GemmMicroKernel<T>& kernel)
+{
+    const size_t k = 37;
+    std::vector<T> a(kernel.mr * k);
+    std::vector<T> b(k * kernel.nr);
+    for (size_t i = 0; i < a.size(); ++i) a[i] = static_cast<T>((i % 7) - 3);
+    for (size_t i = 0; i < b.size(); ++i) b[i] = static_cast<T>((i % 5) - 2);
+
+    // padded ldc checks the kernel only writes its tile
+    const size_t ldc = kernel.nr + 3;
+    std::vector<T> c(kernel.mr * ldc, T(1));
+    kernel.fn(k, a.data(), b.data(), c.data(), ldc, true);
+
+    for (size_t r = 0; r < kernel.mr; ++r)
+    {
+        for (size_t j = 0; j < ldc; ++j)
+        {
+            T expected = T(1);
+            if (j < kernel.nr)
+            {
+                for (size_t p = 0; p < k; ++p)
+                {
+                    expected += a[p * kernel.mr + r] * b[p * kernel.nr + j];
+                }
+            }
+            ASSERT_EQ(c[r * ldc + j], expected) << "Mismatch at (" << r << ", " << j << ")";
+        }
+    }
+}
+
+void CheckInt8MicroKernel(const GemmInt8MicroKernel& kernel)
+{
+    const size_t groups = 9;
+    std::vector<uint8_t> a(kernel.mr * groups * kGemmInt8KGroup);
+    std::vector<int8_t> b(kernel.nr * groups * kGemmInt8KGroup);
+    for (size_t i = 0; i < a.size(); ++i) a[i] = static_cast<uint8_t>(i * 37 % 256);
+    for (size_t i = 0; i < b.size(); ++i) b[i] = static_cast<int8_t>(i * 91 % 256 - 128);
+
+    // padded ldc checks the kernel only writes its tile
+    const size_t ldc = kernel.nr + 3;
+    std::vector<int32_t> c(kernel.mr * ldc, 1);
+    kernel.fn(groups, a.data(), b.data(), c.data(), ldc, true);
+
+    for (size_t r = 0; r < kernel.mr; ++r)
+    {
+        for (size_t j = 0; j < ldc; ++j)
+        {
+            int32_t expected = 1;
+            if (j < kernel.nr)
+            {
+                for (size_t g = 0; g < groups; ++g)
+                {
+                    for (size_t q = 0; q < kGemmInt8KGroup; ++q)
+                    {
+                        expected += int32_t(a[(g * kernel.mr + r) * kGemmInt8KGroup + q]) *
+                            int32_t(b[(g * kernel.nr + j) * kGemmInt8KGroup + q]);
+                    }
+                }
+            }
+            ASSERT_EQ(c[r * ldc + j], expected) << "Mismatch at (" << r << ", " << j << ")";
+        }
+    }
+}
+
+TEST(MatMulSuite, Int8MicroKernels)
+{
+    CheckInt8MicroKernel(GenericInt8MicroKernel());
+    CheckInt8MicroKernel(Int8MicroKernelFor(HostCpuIsa()));
+    if (CpuIsaSupported(CpuIsa::Avx2))
+    {
+        CheckInt8MicroKernel(Int8MicroKernelFor(CpuIsa::Avx2));
+    }
+}
+
+TEST(MatMulSuite, MicroKernels)
+{
+    CheckMicroKernel(GenericMicroKernel<float>());
+    CheckMicroKernel(GenericMicroKernel<double>());
+    CheckMicroKernel(MicroKernelFor<float>(HostCpuIsa()));
+    CheckMicroKernel(MicroKernelFor<double>(HostCpuIsa()));
+    if (CpuIsaSupported(CpuIsa::Avx2))
+    {
+        CheckMicroKernel(MicroKernelFor<float>(CpuIsa::Avx2));
+        CheckMicroKernel(MicroKernelFor<double>(CpuIsa::Avx2));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,281 @@
+#include <gtest/gtest.h>
+#include <graphloom/graphloom.h>
+#include <vector>
+
+#include "graph/graph_factory.h"
+
+using namespace graphloom;
+
+class NopKernel : public OpKernel
+{
+public:
+    NopKernel(const OpKernelContext& context) : OpKernel(context) {}
+
+    Status Compute(ComputeContext& context) override
+    {
+        return Status::kOK;
+    }
+};
+
+GL_REGISTER_OP("planner_source").
+    Output([](const ComputeContext& c, LayoutArray& shape){
+        shape = {16, 16};
+        return Status::kOK;
+    }).
+    Build();
+
+GL_REGISTER_OP("planner_unary").
+    Input().
+    Output([](const ComputeContext& c, LayoutArray& shape){
+        shape = {16, 16};
+        return Status::kOK;
+    }).
+    Build();
+
+GL_REGISTER_OP("planner_binary").
+    Input().
+    Input().
+    Output([](const ComputeContext& c, LayoutArray& shape){
+        shape = {16, 16};
+        return Status::kOK;
+    }).
+    Build();
+
+GL_REGISTER_OP("planner_dynamic").
+    Input().
+    Output([](const ComputeContext& c, LayoutArray& shape){
+        return Status(1, "Shape depends on input values");
+    }).
+    Build();
+
+GL_REGISTER_OP("planner_like").
+    Input().
+    Output([](const ComputeContext& c, LayoutArray& shape){
+        shape = c.input_shape(0);
+        return Status::kOK;
+    }).
+    Build();
+
+GL_REGISTER_KERNEL("planner_source", NopKernel, "CPU").
+    Output(DataType::Float).
+    Build();
+
+GL_REGISTER_KERNEL("planner_unary", NopKernel, "CPU").
+    Input(DataType::Float).
+    Output(DataType::Float).
+    Build();
+
+GL_REGISTER_KERNEL("planner_binary", NopKernel, "CPU").
+    Input(DataType::Float).
+    Input(DataType::Float).
+    Output(DataType::Float).
+    Build();
+
+GL_REGISTER_KERNEL("planner_like", NopKernel, "CPU").
+    Input(DataType::Float).
+    Output(DataType::Float).
+    Build();
+
+GL_REGISTER_KERNEL("planner_dynamic", NopKernel, "CPU").
+    Input(DataType::Float).
+    Output(DataType::Float).
+    Build();
+
+const size_t kTensorBytes = 16 * 16 * sizeof(float);
+
+NodeDef* Source(GraphDef& graph)
+{
+    return NodeDefBuilder(graph, "planner_source", "CPU:0").
+        Name("source").
+        Build({DataType::Float});
+}
+
+NodeDef* Unary(GraphDef& graph, NodeDef* input, const char* op = "planner_unary")
+{
+    return NodeDefBuilder(graph, op, "CPU:0").
+        Input(input, 0).
+        Name("unary").
+        Build({DataType::Float});
+}
+
+NodeDef* Binary(GraphDef& graph, NodeDef* a, NodeDef* b)
+{
+    return NodeDefBuilder(graph, "planner_binary", "CPU:0").
+        Input(a, 0).
+        Input(b, 0).
+        Name("binary").
+        Build({DataType::Float});
+}
+
+TEST(MemoryPlannerSuite, ChainReusesMemory)
+{
+    GraphDef graph_def;
+    NodeDef* node = Source(graph_def);
+    for (int i = 0; i < 4; ++i)
+    {
+        node = Unary(graph_def, node);
+    }
+
+    Graph graph;
+    ASSERT_TRUE(GraphFactory::UpdateGraph(graph_def, graph).ok());
+    const MemoryPlan& plan = graph.memory_plan();
+
+    // last node is a graph output and is not planned
+    EXPECT_EQ(plan.offset(4, 0), MemoryPlan::kUnplanned);
+    for (int i = 0; i < 4; ++i)
+    {
+        EXPECT_NE(plan.offset(i, 0), MemoryPlan::kUnplanned)
+            << "Expected intermediate output of node " << i << " to be planned";
+        EXPECT_NE(plan.address(i, 0), nullptr);
+    }
+
+    // a chain never needs more than an input and an output live
+    EXPECT_EQ(plan.num_arenas(), 1);
+    EXPECT_EQ(plan.naive_bytes(), 4 * kTensorBytes);
+    EXPECT_EQ(plan.peak_bytes(), 2 * kTensorBytes);
+    EXPECT_EQ(plan.live_peak_bytes(), 2 * kTensorBytes);
+    EXPECT_DOUBLE_EQ(plan.fragmentation(), 0.0);
+
+    // a node never writes over its own input
+    for (int i = 1; i < 4; ++i)
+    {
+        EXPECT_NE(plan.offset(i, 0), plan.offset(i - 1, 0));
+    }
+}
+
+TEST(MemoryPlannerSuite, MoveAssignFreesArenas)
+{
+    GraphDef graph_def;
+    Unary(graph_def, Unary(graph_def, Source(graph_def)));
+
+    Graph graph;
+    ASSERT_TRUE(GraphFactory::UpdateGraph(graph_def, graph).ok());
+    MemoryPlan first, second;
+    ASSERT_TRUE(MemoryPlanner::Plan(graph, first).ok());
+    ASSERT_TRUE(MemoryPlanner::Plan(graph, second).ok());
+    ASSERT_EQ(second.num_arenas(), 1);
+
+    // the arena of the replaced plan goes back to the device
+    Device* cpu = DeviceRegistry::instance().GetDevice("CPU:0");
+    size_t num_frees = cpu->memory_stats().num_frees;
+    void* address = first.address(0, 0);
+    second = std::move(first);
+    EXPECT_EQ(cpu->memory_stats().num_frees, num_frees + 1);
+
+    EXPECT_EQ(second.num_arenas(), 1);
+    EXPECT_EQ(second.address(0, 0), address);
+    EXPECT_EQ(first.num_arenas(), 0);
+    EXPECT_EQ(first.address(0, 0), nullptr);
+}
+
+TEST(MemoryPlannerSuite, ParallelBranchesDoNotShare)
+{
+    // two independent chains interleaved in build order
+    GraphDef graph_def;
+    NodeDef* a0 = Source(graph_def);        // 0
+    NodeDef* a1 = Unary(graph_def, a0);     // 1
+    NodeDef* b0 = Source(graph_def);        // 2
+    NodeDef* b1 = Unary(graph_def, b0);     // 3
+    NodeDef* a2 = Unary(graph_def, a1);     // 4
+    NodeDef* b2 = Unary(graph_def, b1);     // 5
+    Binary(graph_def, a2, b2);              // 6
+
+    Graph graph;
+    ASSERT_TRUE(GraphFactory::UpdateGraph(graph_def, graph).ok());
+    const MemoryPlan& plan = graph.memory_plan();
+
+    // a0 is released by a1, which is not an ancestor of b0, b1 or b2.
+    // Their tensors may be live at the same time as a0.
+    EXPECT_NE(plan.offset(a0->id(), 0), plan.offset(b0->id(), 0));
+    EXPECT_NE(plan.offset(a0->id(), 0), plan.offset(b1->id(), 0));
+    EXPECT_NE(plan.offset(a0->id(), 0), plan.offset(b2->id(), 0));
+    EXPECT_NE(plan.offset(b0->id(), 0), plan.offset(a2->id(), 0));
+
+    // a2 runs after a1 finished, so it may take a0's memory
+    EXPECT_EQ(plan.offset(a0->id(), 0), plan.offset(a2->id(), 0));
+
+    EXPECT_GE(plan.peak_bytes(), plan.live_peak_bytes());
+    EXPECT_LE(plan.peak_bytes(), plan.naive_bytes());
+    EXPECT_GE(plan.fragmentation(), 0.0);
+    EXPECT_LT(plan.fragmentation(), 1.0);
+}
+
+TEST(MemoryPlannerSuite, DynamicShapeNotPlanned)
+{
+    GraphDef graph_def;
+    NodeDef* source = Source(graph_def);
+    NodeDef* dynamic = Unary(graph_def, source, "planner_dynamic");
+    Unary(graph_def, dynamic);
+
+    Graph graph;
+    ASSERT_TRUE(GraphFactory::UpdateGraph(graph_def, graph).ok());
+    const MemoryPlan& plan = graph.memory_plan();
+
+    EXPECT_NE(plan.offset(source->id(), 0), MemoryPlan::kUnplanned);
+    EXPECT_EQ(plan.offset(dynamic->id(), 0), MemoryPlan::kUnplanned);
+    EXPECT_EQ(plan.address(dynamic->id(), 0), nullptr);
+    EXPECT_EQ(plan.peak_bytes(), kTensorBytes);
+}
+
+TEST(MemoryPlannerSuite, ShapesPropagate)
+{
+    GraphDef graph_def;
+    NodeDef* source = Source(graph_def);
+    NodeDef* like = Unary(graph_def, source, "planner_like");
+    NodeDef* dynamic = Unary(graph_def, like, "planner_dynamic");
+    NodeDef* after = Unary(graph_def, dynamic, "planner_like");
+    Unary(graph_def, after);
+
+    Graph graph;
+    ASSERT_TRUE(GraphFactory::UpdateGraph(graph_def, graph).ok());
+    const MemoryPlan& plan = graph.memory_plan();
+
+    // shape of like is inferred from source's shape
+    EXPECT_NE(plan.offset(like->id(), 0), MemoryPlan::kUnplanned);
+
+    // unknown input shapes stay unknown downstream
+    EXPECT_EQ(plan.offset(dynamic->id(), 0), MemoryPlan::kUnplanned);
+    EXPECT_EQ(plan.offset(after->id(), 0), MemoryPlan::kUnplanned);
+}
+
+TEST(GraphSuite, FlattenedLayout)
+{
+    // a -> b, a -> c, (b, c) -> d
+    GraphDef graph_def;
+    NodeDef* a = Source(graph_def);
+    NodeDef* b = Unary(graph_def, a);
+    NodeDef* c = Unary(graph_def, a);
+    NodeDef* d = Binary(graph_def, b, c);
+
+    Graph graph;
+    ASSERT_TRUE(GraphFactory::UpdateGraph(graph_def, graph).ok());
+    const FlatGraph& flat = graph.flat();
+
+    ASSERT_EQ(flat.num_nodes(), 4);
+    EXPECT_EQ(flat.num_values(), 4);
+    EXPECT_EQ(flat.pending, std::vector<int>({0, 1, 1, 2}));
+    EXPECT_EQ(flat.names, std::vector<std::string>({a->name(), b->name(), c->name(), d->name()}));
+    EXPECT_EQ(flat.output_offsets, std::vector<uint32_t>({0, 1, 2, 3, 4}));
+
+    // inputs read the value slot of their source's output
+    EXPECT_EQ(flat.input_offsets, std::vector<uint32_t>({0, 0, 1, 2, 4}));
+    EXPECT_EQ(flat.input_slots, std::vector<uint32_t>({0, 0, 1, 2}));
+    EXPECT_EQ(flat.input_nodes, std::vector<uint32_t>({0, 0, uint32_t(b->id()), uint32_t(c->id())}));
+
+    EXPECT_EQ(flat.consumer_offsets, std::vector<uint32_t>({0, 2, 3, 4, 4}));
+    EXPECT_EQ(flat.consumers, std::vector<uint32_t>({
+        uint32_t(b->id()), uint32_t(c->id()), uint32_t(d->id()), uint32_t(d->id())}));
+
+    Device* cpu = DeviceRegistry::instance().GetDevice("CPU:0");
+    for (size_t i = 0; i < 4; ++i)
+    {
+        EXPECT_NE(flat.kernels[i], nullptr);
+        EXPECT_EQ(flat.devices[i], cpu);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -21,6 +21,54 @@ GL_REGISTER_OP("test_input_op").
     }).
     Build();
 
+GL_REGISTER_OP("test_attr_op").
+    Attribute("C1").
+    Attribute("C2").
+    Attribute("C3").
+    Output([](const ComputeContext& c, LayoutArray& shape){
+        shape = {3, 1};
+        return Status::kOK;
+    }).
+    Build();
+
+GL_REGISTER_OP("test_slot_op").
+    Attribute("D1").
+    Attribute("D2").
+    Attribute("D3").
+    Output([](const ComputeContext& c, LayoutArray& shape){
+        shape = {3, 1};
+        return Status::kOK;
+    }).
+    Build();
+
+// reads its attributes by slot, in the order test_slot_op declares them
+class SlotKernel : public OpKernel
+{
+public:
+    SlotKernel(const OpKernelContext& context) : 
+        OpKernel(context), 
+        scale_(context.GetFloatAttr(0)), 
+        counts_(context.GetInt64ListAttr(1)), 
+        bias_(context.GetDoubleAttr(2)) {}
+
+    Status Compute(ComputeContext& context) override
+    {
+        float* out = context.output(0).Map<float>().data();
+        out[0] = scale_;
+        out[1] = static_cast<float>(counts_.back());
+        out[2] = static_cast<float>(bias_);
+        return Status::kOK;
+    }
+
+private:
+    float scale_;
+    std::vector<int64_t> counts_;
+    double bias_;
+};
+
+GL_REGISTER_KERNEL("test_slot_op", SlotKernel, "CPU").
+    Output(DataType::Float).Build();
+
 TEST(NodeDefBuilderSuite, ValidBuildTest)
 {
     GraphDef graph;
@@ -45,6 +93,10 @@ TEST(NodeDefBuilderSuite, ValidBuildTest)
     const std::vector<graphloom::DataType>& out_dtypes = node->out_dtypes();
     EXPECT_EQ(out_dtypes.size(), 1);
     EXPECT_EQ(out_dtypes[0], DataType::Float);
+    EXPECT_EQ(node->num_outputs(), 1);
+    EXPECT_EQ(node->output_dtype(0), DataType::Float);
+    EXPECT_ANY_THROW(node->output_dtype(1));
+    EXPECT_EQ(graph.FindNode("myNode"), node);
 
     EXPECT_ANY_THROW(graph.GetDoubleAttr("myNode/A1"));
 }
@@ -238,6 +290,156 @@ TEST(NodeDefBuilderSuite, InvalidInputNodeIdTest)
 
 
 
+TEST(NodeDefBuilderSuite, UniqueNames)
+{
+    GraphDef graph;
+    auto build = [&graph](const std::string& name) {
+        return NodeDefBuilder(graph, "test_op", "CPU:0").
+            SetAttr("A1", 1).
+            SetAttr("A2", false).
+            Name(name).
+            Build({DataType::Float});
+    };
+
+    // a taken suffix is skipped
+    NodeDef* explicit_node = build("node_2");
+    std::vector<NodeDef*> nodes;
+    for (int i = 0; i < 4; ++i)
+    {
+        nodes.push_back(build("node"));
+    }
+    EXPECT_EQ(explicit_node->name(), "node_2");
+    EXPECT_EQ(nodes[0]->name(), "node");
+    EXPECT_EQ(nodes[1]->name(), "node_1");
+    EXPECT_EQ(nodes[2]->name(), "node_3");
+    EXPECT_EQ(nodes[3]->name(), "node_4");
+
+    // suffixed names are bases of their own
+    EXPECT_EQ(build("node_1")->name(), "node_1_1");
+
+    EXPECT_EQ(graph.FindNode("node_2"), explicit_node);
+    for (NodeDef* node : nodes)
+    {
+        EXPECT_EQ(graph.FindNode(node->name()), node);
+    }
+    EXPECT_EQ(graph.FindNode("node_5"), nullptr);
+    EXPECT_EQ(graph.num_nodes(), 6);
+}
+
+TEST(NodeDefBuilderSuite, Adjacency)
+{
+    GraphDef graph;
+    auto source = [&graph]() {
+        return NodeDefBuilder(graph, "test_op", "CPU:0").
+            SetAttr("A1", 1).
+            SetAttr("A2", false).
+            Name("source").
+            Build({DataType::Float});
+    };
+    auto unary = [&graph](NodeDef* input) {
+        return NodeDefBuilder(graph, "test_input_op", "CPU:0").
+            Input(input, 0).
+            SetAttr("B1", 1).
+            Name("unary").
+            Build({DataType::Float});
+    };
+
+    // a -> b, a -> c, c -> d
+    NodeDef* a = source();
+    NodeDef* b = unary(a);
+    NodeDef* c = unary(a);
+    NodeDef* d = unary(c);
+    EXPECT_EQ(graph.num_edges(), 3);
+
+    GraphDefAdjacency adjacency = graph.Adjacency();
+    EXPECT_EQ(adjacency.in_offsets, std::vector<size_t>({0, 0, 1, 2, 3}));
+    EXPECT_EQ(adjacency.in_nodes, std::vector<int>({a->id(), a->id(), c->id()}));
+    EXPECT_EQ(adjacency.in_ports, std::vector<size_t>({0, 0, 0}));
+    EXPECT_EQ(adjacency.out_offsets, std::vector<size_t>({0, 2, 2, 3, 3}));
+    EXPECT_EQ(adjacency.out_nodes, std::vector<int>({b->id(), c->id(), d->id()}));
+    EXPECT_EQ(adjacency.out_ports, std::vector<size_t>({0, 0, 0}));
+}
+
+TEST(NodeDefBuilderSuite, TypedAttributes)
+{
+    GraphDef graph;
+    TensorBuffer tensor(DataType::Float, {2}, DeviceRegistry::instance().GetDevice("CPU:0"));
+    tensor.Map<float>().data()[0] = 1.5f;
+    tensor.Map<float>().data()[1] = -2.0f;
+
+    NodeDefBuilder builder(graph, "test_attr_op", "CPU:0");
+    EXPECT_THROW(builder.SetAttr("C4", 1), GlException);
+
+    // a slot set twice keeps the last value
+    builder.
+        SetAttr("C1", tensor).
+        SetAttr("C2", std::vector<int64_t>({1, 2})).
+        SetAttr("C2", std::vector<int64_t>({3, -4, 5})).
+        SetAttr("C3", std::vector<float>({0.5f}));
+    NodeDef* first = builder.Name("attrs").Build({DataType::Float});
+
+    // scalars and lists share the slot
+    builder.SetAttr("C3", 7.0);
+    NodeDef* second = builder.Name("attrs").Build({DataType::Float});
+    ASSERT_TRUE(first);
+    ASSERT_TRUE(second);
+
+    const TensorBuffer& stored = graph.GetTensorAttr("attrs/C1");
+    EXPECT_EQ(stored.size(), 2);
+    const TensorBuffer& original = tensor;
+    EXPECT_EQ(stored.Map<float>().data(), original.Map<float>().data());
+    EXPECT_EQ(graph.GetInt64ListAttr("attrs/C2"), std::vector<int64_t>({3, -4, 5}));
+    EXPECT_EQ(graph.GetFloatListAttr("attrs/C3"), std::vector<float>({0.5f}));
+
+    EXPECT_EQ(graph.GetInt64ListAttr("attrs_1/C2"), std::vector<int64_t>({3, -4, 5}));
+    EXPECT_EQ(graph.GetDoubleAttr("attrs_1/C3"), 7.0);
+    EXPECT_THROW(graph.GetFloatListAttr("attrs_1/C3"), GlException);
+
+    // a slot may change type back and forth
+    builder.
+        SetAttr("C1", 3).
+        SetAttr("C3", std::vector<float>({1.0f, 2.0f}));
+    ASSERT_TRUE(builder.Name("attrs").Build({DataType::Float}));
+    EXPECT_EQ(graph.GetInt32Attr("attrs_2/C1"), 3);
+    EXPECT_EQ(graph.GetFloatListAttr("attrs_2/C3"), std::vector<float>({1.0f, 2.0f}));
+    EXPECT_EQ(graph.GetInt64ListAttr("attrs_2/C2"), std::vector<int64_t>({3, -4, 5}));
+    EXPECT_THROW(graph.GetTensorAttr("attrs_2/C1"), GlException);
+
+    EXPECT_FALSE(graph.HasAttr("attrs/C4"));
+    EXPECT_FALSE(graph.HasAttr("C1"));
+    EXPECT_THROW(graph.GetInt64ListAttr("attrs/C1"), GlException);
+    EXPECT_THROW(graph.GetTensorAttr("missing/C1"), GlException);
+}
+
+TEST(NodeDefBuilderSuite, AttributeSlots)
+{
+    const Op& op = OpRegistry::instance().GetOp("test_slot_op");
+    EXPECT_EQ(op.AttrIndex("D1"), 0);
+    EXPECT_EQ(op.AttrIndex("D3"), 2);
+    EXPECT_EQ(op.AttrIndex("D4"), -1);
+
+    // slots follow the op's declaration, not the order attributes are set
+    GraphDef graph;
+    NodeDef* node = NodeDefBuilder(graph, "test_slot_op", "CPU:0").
+        SetAttr("D3", -0.5).
+        SetAttr("D2", std::vector<int64_t>({4, 9})).
+        SetAttr("D1", 2.5f).
+        Build({DataType::Float});
+    ASSERT_TRUE(node);
+
+    Session session;
+    ASSERT_TRUE(session.UpdateGraph(graph).ok());
+    std::vector<TensorBuffer> outputs;
+    Status status = session.Run({}, {node}, outputs);
+    ASSERT_TRUE(status.ok()) << status.msg();
+    ASSERT_EQ(outputs.size(), 1);
+
+    const TensorBuffer& out = outputs[0];
+    EXPECT_EQ(out.Map<float>().data()[0], 2.5f);
+    EXPECT_EQ(out.Map<float>().data()[1], 9.0f);
+    EXPECT_EQ(out.Map<float>().data()[2], -0.5f);
+}
+
 int main(int argc, char **argv) 
 {
     ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,283 @@
+#include <gtest/gtest.h>
+#include <graphloom/graphloom.h>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "feed_placeholder.h"
+
+using namespace graphloom;
+
+static Initializer register_quantize_input = 
+    RegisterFeedPlaceholder<DataType::Float, DataType::Int8>("quantize_input");
+
+Device* Cpu0()
+{
+    return DeviceRegistry::instance().GetDevice("CPU:0");
+}
+
+TensorBuffer RandomFloat(const LayoutArray& shape, float low, float high, unsigned seed)
+{
+    TensorBuffer tensor(DataType::Float, shape, Cpu0());
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> dist(low, high);
+    float* data = tensor.Map<float>().data();
+    for (size_t i = 0; i < tensor.size(); ++i)
+    {
+        data[i] = dist(rng);
+    }
+    return tensor;
+}
+
+TEST(QuantizeSuite, Registered)
+{
+    for (const char* name : {"Quantize", "QuantizeDynamic", "Dequantize"})
+    {
+        ASSERT_TRUE(OpRegistry::instance().HasOp(name)) << name;
+        EXPECT_EQ(OpRegistry::instance().GetOp(name).num_inputs(), 1);
+    }
+    EXPECT_EQ(OpRegistry::instance().GetOp("Quantize").attributes().size(), 2);
+}
+
+TEST(QuantizeSuite, Params)
+{
+    QuantParams tensor = QuantParams::PerTensor(0.5f, -3);
+    EXPECT_FALSE(tensor.per_channel());
+    EXPECT_EQ(tensor.num_channels(), 1);
+    EXPECT_EQ(tensor.scale(), 0.5f);
+    EXPECT_EQ(tensor.zero_point(), -3);
+
+    QuantParams channel = QuantParams::PerChannel(1, {0.1f, 0.2f}, {0, 1});
+    EXPECT_TRUE(channel.per_channel());
+    EXPECT_EQ(channel.axis(), 1);
+    EXPECT_EQ(channel.scale(1), 0.2f);
+    EXPECT_EQ(channel.zero_point(1), 1);
+
+    EXPECT_THROW(QuantParams::PerTensor(0.0f, 0), GlException);
+    EXPECT_THROW(QuantParams::PerTensor(1.0f, 128), GlException);
+    EXPECT_THROW(QuantParams::PerChannel(0, {1.0f}, {0, 0}), GlException);
+
+    // 0 is exact and the range is covered
+    QuantParams chosen = ChooseQuantParams(-1.0f, 3.0f);
+    EXPECT_FLOAT_EQ(chosen.scale(), 4.0f / 255.0f);
+    EXPECT_EQ(chosen.zero_point(), -64);
+    EXPECT_EQ(QuantizeValue(0.0f, 1.0f / chosen.scale(), chosen.zero_point()), -64);
+    EXPECT_EQ(QuantizeValue(3.0f, 1.0f / chosen.scale(), chosen.zero_point()), 127);
+    EXPECT_EQ(QuantizeValue(-1.0f, 1.0f / chosen.scale(), chosen.zero_point()), -128);
+    EXPECT_EQ(ChooseQuantParams(0.0f, 0.0f).scale(), 1.0f);
+
+    // ties round to even, out of range saturates
+    EXPECT_EQ(QuantizeValue(2.5f, 1.0f, 0), 2);
+    EXPECT_EQ(QuantizeValue(-3.5f, 1.0f, 0), -4);
+    EXPECT_EQ(QuantizeValue(1e9f, 1.0f, 0), 127);
+    EXPECT_EQ(QuantizeValue(-1e9f, 1.0f, 5), -128);
+    EXPECT_EQ(DequantizeValue(-128, 0.5f, -3), -62.5f);
+}
+
+TEST(QuantizeSuite, TensorParams)
+{
+    TensorBuffer f(DataType::Float, {2, 3}, Cpu0());
+    EXPECT_THROW(f.set_quant_params(QuantParams::PerTensor(1.0f, 0)), GlException);
+
+    TensorBuffer q(DataType::Int8, {2, 3}, Cpu0());
+    EXPECT_EQ(q.quant_params(), nullptr);
+    EXPECT_THROW(q.set_quant_params(QuantParams::PerChannel(1, {1.0f, 2.0f}, {0, 0})), GlException);
+    EXPECT_THROW(q.set_quant_params(QuantParams::PerChannel(2, {1.0f}, {0})), GlException);
+    q.set_quant_params(QuantParams::PerChannel(1, {1.0f, 2.0f, 3.0f}, {0, 1, 2}));
+
+    // copies and views carry the parameters along their channel axis
+    TensorBuffer copy = q;
+    EXPECT_EQ(copy.quant_params(), q.quant_params());
+    EXPECT_EQ(q.Clone().quant_params()->scale(2), 3.0f);
+
+    TensorBuffer slice = q.Slice(1, 1, 3);
+    ASSERT_EQ(slice.quant_params()->num_channels(), 2);
+    EXPECT_EQ(slice.quant_params()->scale(0), 2.0f);
+    EXPECT_EQ(slice.quant_params()->zero_point(1), 2);
+    EXPECT_EQ(q.Slice(0, 1, 2).quant_params()->num_channels(), 3);
+
+    TensorBuffer transposed = q.Transpose();
+    EXPECT_EQ(transposed.quant_params()->axis(), 0);
+    EXPECT_EQ(transposed.Contiguous().quant_params()->axis(), 0);
+
+    EXPECT_EQ(q.Broadcast({4, 2, 3}).quant_params()->axis(), 2);
+    EXPECT_EQ(q.View({2, 1, 3}).quant_params()->axis(), 2);
+    EXPECT_THROW(q.View({6}), GlException);
+    EXPECT_FALSE(copy.Reshape({3, 2}).ok());
+    EXPECT_TRUE(copy.Reshape({1, 2, 3}).ok());
+    EXPECT_EQ(copy.quant_params()->axis(), 2);
+
+    // a broadcast single channel is per tensor
+    TensorBuffer column(DataType::Int8, {3, 1}, Cpu0());
+    column.set_quant_params(QuantParams::PerChannel(1, {0.5f}, {1}));
+    TensorBuffer broadcast = column.Broadcast({3, 4});
+    const QuantParams* repeated = broadcast.quant_params();
+    EXPECT_FALSE(repeated->per_channel());
+    EXPECT_EQ(repeated->scale(), 0.5f);
+
+    q.set_quant_params(nullptr);
+    EXPECT_EQ(q.quant_params(), nullptr);
+}
+
+TEST(QuantizeSuite, QuantizeTensor)
+{
+    TensorBuffer x = RandomFloat({4, 5, 6}, -2.0f, 2.0f, 3);
+    x.Map<float>()(1, 2, 3) = 8.0f;
+
+    QuantParams tensor_params = ChooseQuantParams(x);
+    TensorBuffer q = QuantizeTensor(x, tensor_params);
+    ASSERT_EQ(q.dtype(), DataType::Int8);
+    ASSERT_NE(q.quant_params(), nullptr);
+    TensorBuffer back = DequantizeTensor(q);
+    for (size_t i = 0; i < x.size(); ++i)
+    {
+        ASSERT_NEAR(back.Map<float>().data()[i], x.Map<float>().data()[i], tensor_params.scale() / 2 * 1.001f);
+    }
+
+    // each channel of axis 1 has its own range
+    QuantParams channel_params = ChooseChannelQuantParams(x, 1);
+    ASSERT_EQ(channel_params.num_channels(), 5);
+    EXPECT_FLOAT_EQ(channel_params.scale(2), 8.0f / 127);
+    q = QuantizeTensor(x, channel_params);
+    back = DequantizeTensor(q);
+    TensorMap<const float, 3> x_map = static_cast<const TensorBuffer&>(x).Map<float, 3>();
+    TensorMap<const float, 3> back_map = static_cast<const TensorBuffer&>(back).Map<float, 3>();
+    for (size_t i = 0; i < 4; ++i)
+    {
+        for (size_t c = 0; c < 5; ++c)
+        {
+            for (size_t j = 0; j < 6; ++j)
+            {
+                ASSERT_NEAR(back_map(i, c, j), x_map(i, c, j), channel_params.scale(c) / 2 * 1.001f);
+            }
+        }
+    }
+    EXPECT_EQ(q.Map<int8_t>()(1, 2, 3), 127);
+}
+
+TEST(QuantizeSuite, EveryIsa)
+{
+    TensorBuffer x = RandomFloat({1013}, -3.0f, 3.0f, 5);
+    float* data = x.Map<float>().data();
+    data[0] = 1e9f;
+    data[1] = -1e9f;
+    // ties of 2.5 and 7.5 steps
+    data[2] = 0.25f;
+    data[3] = 0.75f;
+
+    GraphDef graph;
+    NodeDef* input = NodeDefBuilder(graph, "quantize_input", "CPU:0").Name("x").Build({DataType::Float});
+    NodeDef* quantize = NodeDefBuilder(graph, "Quantize", "CPU:0").
+        Input(input, 0).
+        SetAttr("scale", 0.1f).
+        SetAttr("zero_point", int32_t(-7)).
+        Name("quantize").
+        Build({DataType::Int8});
+    NodeDef* dequantize = NodeDefBuilder(graph, "Dequantize", "CPU:0").
+        Input(quantize, 0).
+        Name("dequantize").
+        Build({DataType::Float});
+
+    for (CpuIsa isa : {CpuIsa::Generic, CpuIsa::Avx2, CpuIsa::Avx512})
+    {
+        if (!CpuIsaSupported(isa)) continue;
+        LimitCpuIsa(isa);
+
+        Session session;
+        ASSERT_TRUE(session.UpdateGraph(graph).ok());
+        std::vector<TensorBuffer> outputs;
+        Status status = session.Run({{input, &x}}, {quantize, dequantize}, outputs);
+        ASSERT_TRUE(status.ok()) << status.msg();
+
+        const QuantParams* params = outputs[0].quant_params();
+        ASSERT_NE(params, nullptr);
+        EXPECT_EQ(params->scale(), 0.1f);
+        EXPECT_EQ(params->zero_point(), -7);
+
+        const int8_t* q = outputs[0].Map<int8_t>().data();
+        const float* back = outputs[1].Map<float>().data();
+        for (size_t i = 0; i < x.size(); ++i)
+        {
+            int8_t expected = QuantizeValue(data[i], 1.0f / 0.1f, -7);
+            ASSERT_EQ(q[i], expected) << data[i] << " at " << CpuIsaName(isa);
+            ASSERT_EQ(back[i], DequantizeValue(expected, 0.1f, -7)) << CpuIsaName(isa);
+        }
+    }
+    LimitCpuIsa(CpuIsa::Avx512Bf16);
+}
+
+TEST(QuantizeSuite, Dynamic)
+{
+    TensorBuffer x = RandomFloat({70001}, -1.0f, 5.0f, 9);
+    x.Map<float>().data()[5000] = -2.0f;
+
+    GraphDef graph;
+    NodeDef* input = NodeDefBuilder(graph, "quantize_input", "CPU:0").Name("x").Build({DataType::Float});
+    NodeDef* quantize = NodeDefBuilder(graph, "QuantizeDynamic", "CPU:0").Input(input, 0).Name("q").Build({DataType::Int8});
+    NodeDef* dequantize = NodeDefBuilder(graph, "Dequantize", "CPU:0").Input(quantize, 0).Name("dq").Build({DataType::Float});
+
+    SessionOptions options;
+    options.inter_op_threads = 4;
+    Session session(options);
+    ASSERT_TRUE(session.UpdateGraph(graph).ok());
+
+    std::vector<TensorBuffer> outputs;
+    Status status = session.Run({{input, &x}}, {quantize, dequantize}, outputs);
+    ASSERT_TRUE(status.ok()) << status.msg();
+
+    // same parameters as the library helper
+    QuantParams expected = ChooseQuantParams(x);
+    const QuantParams* params = outputs[0].quant_params();
+    ASSERT_NE(params, nullptr);
+    EXPECT_EQ(params->scale(), expected.scale());
+    EXPECT_EQ(params->zero_point(), expected.zero_point());
+
+    const float* data = x.Map<float>().data();
+    const float* back = outputs[1].Map<float>().data();
+    for (size_t i = 0; i < x.size(); ++i)
+    {
+        ASSERT_NEAR(back[i], data[i], params->scale() / 2 * 1.001f) << i;
+    }
+}
+
+TEST(QuantizeSuite, DequantizePerChannel)
+{
+    TensorBuffer x = RandomFloat({3, 5, 7}, -4.0f, 4.0f, 13);
+    TensorBuffer q = QuantizeTensor(x, ChooseChannelQuantParams(x, 1));
+
+    GraphDef graph;
+    NodeDef* input = NodeDefBuilder(graph, "quantize_input", "CPU:0").Name("q").Build({DataType::Int8});
+    NodeDef* dequantize = NodeDefBuilder(graph, "Dequantize", "CPU:0").Input(input, 0).Name("dq").Build({DataType::Float});
+
+    Session session;
+    ASSERT_TRUE(session.UpdateGraph(graph).ok());
+
+    std::vector<TensorBuffer> outputs;
+    ASSERT_TRUE(session.Run({{input, &q}}, {dequantize}, outputs).ok());
+
+    TensorBuffer expected = DequantizeTensor(q);
+    for (size_t i = 0; i < q.size(); ++i)
+    {
+        ASSERT_EQ(outputs[0].Map<float>().data()[i], expected.Map<float>().data()[i]) << i;
+    }
+
+    // a strided feed is packed with its parameters
+    TensorBuffer transposed = q.Transpose({1, 0, 2});
+    ASSERT_TRUE(session.Run({{input, &transposed}}, {dequantize}, outputs).ok());
+    TensorBuffer expected_transposed = DequantizeTensor(transposed);
+    for (size_t i = 0; i < q.size(); ++i)
+    {
+        ASSERT_EQ(outputs[0].Map<float>().data()[i], expected_transposed.Map<float>().data()[i]) << i;
+    }
+
+    // plain integers have no real values
+    TensorBuffer plain(DataType::Int8, {4}, Cpu0());
+    EXPECT_FALSE(session.Run({{input, &plain}}, {dequantize}, outputs).ok());
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
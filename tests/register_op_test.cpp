@@ -31,10 +31,11 @@ TEST(RegisterOpSuite, ValidTestOp)
 
     auto attributes  = op.attributes();
     EXPECT_EQ(attributes.size(), 2);
-    EXPECT_NE(attributes.find("A1"), attributes.end())
-        << "Expcted the attibute \"A1\" to exist, but is not found";
-    EXPECT_NE(attributes.find("A2"), attributes.end())
-        << "Expcted the attibute \"A2\" to exist, but is not found";
+    EXPECT_EQ(op.AttrIndex("A1"), 0)
+        << "Expcted the attibute \"A1\" in the first slot";
+    EXPECT_EQ(op.AttrIndex("A2"), 1)
+        << "Expcted the attibute \"A2\" in the second slot";
+    EXPECT_EQ(op.AttrIndex("A3"), -1);
 
     EXPECT_EQ(op.num_inputs(), 2);
     EXPECT_EQ(op.num_outputs(), 1);
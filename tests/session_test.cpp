@@ -0,0 +1,672 @@
+#include <gtest/gtest.h>
+#include <graphloom/graphloom.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <new>
+#include <set>
+#include <thread>
+#include <vector>
+#include <utility>
+
+using namespace graphloom;
+
+// number of kernels computing right now and the max observed
+std::atomic<int> running{0};
+std::atomic<int> max_running{0};
+
+class FillKernel : public OpKernel
+{
+public:
+    FillKernel(const OpKernelContext& context) : 
+        OpKernel(context), value_(context.GetFloatAttr("value")) {}
+
+    Status Compute(ComputeContext& context) override
+    {
+        TensorMap<float> out = context.output(0).Map<float>();
+        for (size_t i = 0; i < context.output(0).size(); ++i)
+        {
+            out.data()[i] = value_;
+        }
+        return Status::kOK;
+    }
+
+private:
+    float value_;
+};
+
+class AddKernel : public OpKernel
+{
+public:
+    AddKernel(const OpKernelContext& context) : OpKernel(context) {}
+
+    Status Compute(ComputeContext& context) override
+    {
+        TensorMap<const float> a = context.input(0).Map<float>();
+        TensorMap<const float> b = context.input(1).Map<float>();
+        TensorMap<float> out = context.output(0).Map<float>();
+        for (size_t i = 0; i < context.output(0).size(); ++i)
+        {
+            out.data()[i] = a.data()[i] + b.data()[i];
+        }
+        return Status::kOK;
+    }
+};
+
+class SlowCopyKernel : public OpKernel
+{
+public:
+    SlowCopyKernel(const OpKernelContext& context) : OpKernel(context) {}
+
+    Status Compute(ComputeContext& context) override
+    {
+        int now = ++running;
+        int prev = max_running.load();
+        while (now > prev && !max_running.compare_exchange_weak(prev, now)) {}
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+        TensorMap<const float> in = context.input(0).Map<float>();
+        TensorMap<float> out = context.output(0).Map<float>();
+        for (size_t i = 0; i < context.output(0).size(); ++i)
+        {
+            out.data()[i] = in.data()[i];
+        }
+        --running;
+        return Status::kOK;
+    }
+};
+
+// thread budget seen by the last ParallelSum kernel
+std::atomic<size_t> last_budget{0};
+
+class ParallelSumKernel : public OpKernel
+{
+public:
+    ParallelSumKernel(const OpKernelContext& context) : OpKernel(context) {}
+
+    Status Compute(ComputeContext& context) override
+    {
+        last_budget = context.thread_budget();
+
+        TensorMap<const float> in = context.input(0).Map<float>();
+        TensorMap<float> out = context.output(0).Map<float>();
+        context.parallel_for(context.output(0).size(), 1, [&](size_t begin, size_t end){
+            for (size_t i = begin; i < end; ++i)
+            {
+                out.data()[i] = in.data()[i] + 1.0f;
+            }
+        });
+        return Status::kOK;
+    }
+};
+
+// scratch buffer seen by the last Reverse kernel
+std::atomic<void*> last_scratch{nullptr};
+
+class ReverseKernel : public OpKernel
+{
+public:
+    ReverseKernel(const OpKernelContext& context) : OpKernel(context) {}
+
+    Status Compute(ComputeContext& context) override
+    {
+        size_t size = context.output(0).size();
+        float* temp = static_cast<float*>(context.scratch(size * sizeof(float)));
+        last_scratch = temp;
+
+        TensorMap<const float> in = context.input(0).Map<float>();
+        TensorMap<float> out = context.output(0).Map<float>();
+        for (size_t i = 0; i < size; ++i)
+        {
+            temp[size - 1 - i] = in.data()[i];
+        }
+        for (size_t i = 0; i < size; ++i)
+        {
+            out.data()[i] = temp[i];
+        }
+        return Status::kOK;
+    }
+};
+
+class FailKernel : public OpKernel
+{
+public:
+    FailKernel(const OpKernelContext& context) : OpKernel(context) {}
+
+    Status Compute(ComputeContext& context) override
+    {
+        return Status(7, "intentional failure");
+    }
+};
+
+// threads that constructed a SlowInitKernel
+std::mutex init_mutex;
+std::set<std::thread::id> init_threads;
+
+class SlowInitKernel : public OpKernel
+{
+public:
+    SlowInitKernel(const OpKernelContext& context) : OpKernel(context)
+    {
+        if (context.GetBoolAttr("fail"))
+        {
+            throw GlException("intentional init failure");
+        }
+
+        // stands in for prepacking weights
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        std::lock_guard<std::mutex> lock(init_mutex);
+        init_threads.insert(std::this_thread::get_id());
+    }
+
+    Status Compute(ComputeContext& context) override
+    {
+        return Status::kOK;
+    }
+};
+
+Status Shape4x4(const ComputeContext& c, LayoutArray& shape)
+{
+    shape = {4, 4};
+    return Status::kOK;
+}
+
+GL_REGISTER_OP("session_fill").Attribute("value").Output(Shape4x4).Build();
+GL_REGISTER_OP("session_add").Input().Input().Output(Shape4x4).Build();
+GL_REGISTER_OP("session_slow").Input().Output(Shape4x4).Build();
+GL_REGISTER_OP("session_parallel").Input().Output(Shape4x4).Build();
+GL_REGISTER_OP("session_reverse").Input().Output(
+    [](const ComputeContext& c, LayoutArray& shape){
+        shape = c.input_shape(0);
+        return Status::kOK;
+    }).Build();
+GL_REGISTER_OP("session_fail").Input().Output(Shape4x4).Build();
+GL_REGISTER_OP("session_slow_init").Attribute("fail").Output(Shape4x4).Build();
+GL_REGISTER_OP("session_bad_alloc").Output(
+    [](const ComputeContext& c, LayoutArray& shape) -> Status {
+        throw std::bad_alloc();
+    }).Build();
+
+GL_REGISTER_KERNEL("session_fill", FillKernel, "CPU").
+    Output(DataType::Float).Build();
+GL_REGISTER_KERNEL("session_add", AddKernel, "CPU").
+    Input(DataType::Float).Input(DataType::Float).Output(DataType::Float).Build();
+GL_REGISTER_KERNEL("session_slow", SlowCopyKernel, "CPU").
+    Input(DataType::Float).Output(DataType::Float).Build();
+GL_REGISTER_KERNEL("session_parallel", ParallelSumKernel, "CPU").
+    Input(DataType::Float).Output(DataType::Float).Build();
+GL_REGISTER_KERNEL("session_reverse", ReverseKernel, "CPU").
+    Input(DataType::Float).Output(DataType::Float).Build();
+GL_REGISTER_KERNEL("session_fail", FailKernel, "CPU").
+    Input(DataType::Float).Output(DataType::Float).Build();
+GL_REGISTER_KERNEL("session_slow_init", SlowInitKernel, "CPU").
+    Output(DataType::Float).Build();
+GL_REGISTER_KERNEL("session_bad_alloc", FailKernel, "CPU").
+    Output(DataType::Float).Build();
+
+// two devices bound to NUMA nodes, each with its own worker
+class NumaCpuFactory : public DeviceFactory
+{
+public:
+    explicit NumaCpuFactory(const std::string& device_type) : DeviceFactory(device_type) {}
+
+    Status DiscoverDevices(std::vector<Device*>& devices_found) override
+    {
+        devices_found.push_back(new Cpu(0, {0}));
+        devices_found.push_back(new Cpu(1, {0}));
+        return Status::kOK;
+    }
+};
+
+GL_REGISTER_DEVICE(NUMA_CPU, NumaCpuFactory);
+
+GL_REGISTER_KERNEL("session_fill", FillKernel, "NUMA_CPU").
+    Output(DataType::Float).Build();
+GL_REGISTER_KERNEL("session_parallel", ParallelSumKernel, "NUMA_CPU").
+    Input(DataType::Float).Output(DataType::Float).Build();
+
+NodeDef* Fill(GraphDef& graph, float value)
+{
+    return NodeDefBuilder(graph, "session_fill", "CPU:0").
+        SetAttr("value", value).
+        Name("fill").
+        Build({DataType::Float});
+}
+
+NodeDef* Add(GraphDef& graph, NodeDef* a, NodeDef* b)
+{
+    return NodeDefBuilder(graph, "session_add", "CPU:0").
+        Input(a, 0).
+        Input(b, 0).
+        Name("add").
+        Build({DataType::Float});
+}
+
+NodeDef* Unary(GraphDef& graph, const char* op, NodeDef* a)
+{
+    return NodeDefBuilder(graph, op, "CPU:0").
+        Input(a, 0).
+        Name(op).
+        Build({DataType::Float});
+}
+
+void ExpectFilled(const TensorBuffer& tensor, float value)
+{
+    ASSERT_EQ(tensor.size(), 16);
+    TensorMap<const float> map = tensor.Map<float>();
+    for (size_t i = 0; i < 4; ++i)
+    {
+        for (size_t j = 0; j < 4; ++j)
+        {
+            EXPECT_FLOAT_EQ(map(i, j), value);
+        }
+    }
+}
+
+TEST(SessionSuite, RunWithoutGraph)
+{
+    Session session;
+    std::vector<TensorBuffer> outputs;
+    EXPECT_FALSE(session.Run({}, {}, outputs).ok());
+}
+
+TEST(SessionSuite, ComputesTargets)
+{
+    GraphDef graph;
+    NodeDef* a = Fill(graph, 1.0f);
+    NodeDef* b = Fill(graph, 2.0f);
+    NodeDef* sum = Add(graph, a, b);
+    NodeDef* total = Add(graph, sum, a);
+
+    Session session;
+    ASSERT_TRUE(session.UpdateGraph(graph).ok());
+
+    std::vector<TensorBuffer> outputs;
+    Status status = session.Run({}, {total, sum}, outputs);
+    ASSERT_TRUE(status.ok()) << status.msg();
+    ASSERT_EQ(outputs.size(), 2);
+    ExpectFilled(outputs[0], 4.0f);
+
+    // sum is an intermediate that lives in the arena, it must be copied out
+    ExpectFilled(outputs[1], 3.0f);
+    EXPECT_GT(session.planned_peak_bytes(), 0);
+
+    // runs are repeatable
+    ASSERT_TRUE(session.Run({}, {total}, outputs).ok());
+    ASSERT_EQ(outputs.size(), 1);
+    ExpectFilled(outputs[0], 4.0f);
+}
+
+TEST(SessionSuite, TargetsConsumedByLaterNodes)
+{
+    GraphDef graph;
+    NodeDef* a = Fill(graph, 1.0f);
+    NodeDef* b = Fill(graph, 2.0f);
+    std::vector<NodeDef*> sums{Add(graph, a, b)};
+    for (int i = 1; i < 5; ++i)
+    {
+        sums.push_back(Add(graph, sums.back(), b));
+    }
+
+    Session session;
+    ASSERT_TRUE(session.UpdateGraph(graph).ok());
+
+    // the arena ranges of s1, s2 and a are reused by the later sums
+    std::vector<TensorBuffer> outputs;
+    Status status = session.Run({}, {sums[4], sums[0], sums[1], a}, outputs);
+    ASSERT_TRUE(status.ok()) << status.msg();
+    ASSERT_EQ(outputs.size(), 4);
+    ExpectFilled(outputs[0], 11.0f);
+    ExpectFilled(outputs[1], 3.0f);
+    ExpectFilled(outputs[2], 5.0f);
+    ExpectFilled(outputs[3], 1.0f);
+}
+
+TEST(SessionSuite, FeedReplacesNode)
+{
+    GraphDef graph;
+    NodeDef* a = Fill(graph, 1.0f);
+    NodeDef* b = Fill(graph, 2.0f);
+    NodeDef* sum = Add(graph, a, b);
+
+    Session session;
+    ASSERT_TRUE(session.UpdateGraph(graph).ok());
+
+    Device* cpu = DeviceRegistry::instance().GetDevice("CPU:0");
+    TensorBuffer feed(DataType::Float, {4, 4}, cpu);
+    TensorMap<float> map = feed.Map<float>();
+    for (size_t i = 0; i < feed.size(); ++i)
+    {
+        map.data()[i] = 10.0f;
+    }
+
+    std::vector<TensorBuffer> outputs;
+    ASSERT_TRUE(session.Run({{a, &feed}}, {sum, a}, outputs).ok());
+    ASSERT_EQ(outputs.size(), 2);
+    ExpectFilled(outputs[0], 12.0f);
+    ExpectFilled(outputs[1], 10.0f);
+
+    // the fed tensor is left untouched
+    ExpectFilled(feed, 10.0f);
+
+    // feeding the wrong dtype is rejected
+    TensorBuffer bad_feed(DataType::Int32, {4, 4}, cpu);
+    EXPECT_FALSE(session.Run({{a, &bad_feed}}, {sum}, outputs).ok());
+}
+
+TEST(SessionSuite, FeedOfMismatchedShape)
+{
+    GraphDef graph;
+    NodeDef* a = Fill(graph, 1.0f);
+    NodeDef* b = Unary(graph, "session_parallel", a);
+    NodeDef* c = Unary(graph, "session_parallel", b);
+    NodeDef* d = Unary(graph, "session_parallel", c);
+
+    Session session;
+    ASSERT_TRUE(session.UpdateGraph(graph).ok());
+
+    // outputs below the feed are sized for the static shape of a
+    TensorBuffer feed(DataType::Float, {64, 64}, DeviceRegistry::instance().GetDevice("CPU:0"));
+    std::vector<TensorBuffer> outputs;
+    EXPECT_FALSE(session.Run({{a, &feed}}, {d}, outputs).ok());
+
+    ASSERT_TRUE(session.Run({}, {d}, outputs).ok());
+    ASSERT_EQ(outputs.size(), 1);
+    ExpectFilled(outputs[0], 4.0f);
+}
+
+TEST(SessionSuite, FeedCutsDependencies)
+{
+    GraphDef graph;
+    NodeDef* source = Fill(graph, 1.0f);
+    NodeDef* slow = Unary(graph, "session_slow", source);
+    NodeDef* fed = Unary(graph, "session_reverse", slow);
+    NodeDef* p = Unary(graph, "session_reverse", fed);
+    NodeDef* q = Unary(graph, "session_reverse", p);
+    NodeDef* r = Unary(graph, "session_reverse", q);
+    NodeDef* other = Unary(graph, "session_slow", slow);
+
+    SessionOptions options;
+    options.inter_op_threads = 4;
+    Session session(options);
+    ASSERT_TRUE(session.UpdateGraph(graph).ok());
+
+    Device* cpu = DeviceRegistry::instance().GetDevice("CPU:0");
+    TensorBuffer feed(DataType::Float, {4, 4}, cpu);
+    TensorMap<float> map = feed.Map<float>();
+    for (size_t i = 0; i < feed.size(); ++i)
+    {
+        map.data()[i] = 5.0f;
+    }
+
+    // the nodes below the feed start while slow is still read,
+    // they must not write over its arena range
+    std::vector<TensorBuffer> outputs;
+    Status status = session.Run({{fed, &feed}}, {r, other}, outputs);
+    ASSERT_TRUE(status.ok()) << status.msg();
+    ASSERT_EQ(outputs.size(), 2);
+    ExpectFilled(outputs[0], 5.0f);
+    ExpectFilled(outputs[1], 1.0f);
+}
+
+TEST(SessionSuite, IndependentBranchesRunConcurrently)
+{
+    const int width = 4;
+    GraphDef graph;
+    NodeDef* source = Fill(graph, 1.0f);
+
+    std::vector<NodeDef*> branches;
+    for (int i = 0; i < width; ++i)
+    {
+        branches.push_back(Unary(graph, "session_slow", source));
+    }
+
+    NodeDef* total = branches[0];
+    for (int i = 1; i < width; ++i)
+    {
+        total = Add(graph, total, branches[i]);
+    }
+
+    SessionOptions options;
+    options.inter_op_threads = width;
+    Session session(options);
+    ASSERT_TRUE(session.UpdateGraph(graph).ok());
+
+    running = 0;
+    max_running = 0;
+
+    std::vector<TensorBuffer> outputs;
+    ASSERT_TRUE(session.Run({}, {total}, outputs).ok());
+    ASSERT_EQ(outputs.size(), 1);
+    ExpectFilled(outputs[0], static_cast<float>(width));
+
+    EXPECT_GT(max_running.load(), 1)
+        << "Expected independent branches to overlap";
+}
+
+TEST(SessionSuite, KernelGetsThreadBudget)
+{
+    GraphDef graph;
+    NodeDef* a = Fill(graph, 1.0f);
+    NodeDef* b = Unary(graph, "session_parallel", a);
+
+    SessionOptions options;
+    options.inter_op_threads = 4;
+    options.intra_op_threads = 3;
+    Session session(options);
+    ASSERT_TRUE(session.UpdateGraph(graph).ok());
+
+    // b computes alone, it gets the whole intra-op budget
+    std::vector<TensorBuffer> outputs;
+    ASSERT_TRUE(session.Run({}, {b}, outputs).ok());
+    ASSERT_EQ(outputs.size(), 1);
+    ExpectFilled(outputs[0], 2.0f);
+    EXPECT_EQ(last_budget.load(), 3);
+}
+
+TEST(SessionSuite, KernelUsesScratch)
+{
+    GraphDef graph;
+    NodeDef* a = Fill(graph, 1.0f);
+    NodeDef* b = Unary(graph, "session_parallel", a);
+    NodeDef* c = Unary(graph, "session_reverse", b);
+    NodeDef* d = Unary(graph, "session_reverse", c);
+
+    SessionOptions options;
+    options.inter_op_threads = 1;
+    Session session(options);
+    ASSERT_TRUE(session.UpdateGraph(graph).ok());
+
+    std::vector<TensorBuffer> outputs;
+    ASSERT_TRUE(session.Run({}, {d}, outputs).ok());
+    ASSERT_EQ(outputs.size(), 1);
+    ExpectFilled(outputs[0], 2.0f);
+    EXPECT_EQ(outputs[0].shape().rank(), 2);
+
+    // scratch is recycled between kernels and runs
+    void* scratch = last_scratch.load();
+    ASSERT_NE(scratch, nullptr);
+    ASSERT_TRUE(session.Run({}, {d}, outputs).ok());
+    EXPECT_EQ(last_scratch.load(), scratch);
+}
+
+TEST(SessionSuite, KernelFailure)
+{
+    GraphDef graph;
+    NodeDef* a = Fill(graph, 1.0f);
+    NodeDef* fail = Unary(graph, "session_fail", a);
+    NodeDef* after = Unary(graph, "session_slow", fail);
+
+    Session session;
+    ASSERT_TRUE(session.UpdateGraph(graph).ok());
+
+    std::vector<TensorBuffer> outputs;
+    Status status = session.Run({}, {after}, outputs);
+    EXPECT_FALSE(status.ok());
+    EXPECT_EQ(status.code(), 7);
+
+    // nodes the target does not depend on are not computed
+    ASSERT_TRUE(session.Run({}, {a}, outputs).ok());
+    ASSERT_EQ(outputs.size(), 1);
+    ExpectFilled(outputs[0], 1.0f);
+}
+
+TEST(SessionSuite, KernelResolvedBySignature)
+{
+    Session session;
+
+    // session_add has no NUMA_CPU kernel
+    GraphDef numa;
+    NodeDef* a = NodeDefBuilder(numa, "session_fill", "NUMA_CPU:0").
+        SetAttr("value", 1.0f).
+        Build({DataType::Float});
+    NodeDefBuilder(numa, "session_add", "NUMA_CPU:0").
+        Input(a, 0).
+        Input(a, 0).
+        Build({DataType::Float});
+    EXPECT_FALSE(session.UpdateGraph(numa).ok());
+
+    // no session_fill kernel outputs Double
+    GraphDef dtypes;
+    NodeDefBuilder(dtypes, "session_fill", "CPU:0").
+        SetAttr("value", 1.0f).
+        Build({DataType::Double});
+    EXPECT_FALSE(session.UpdateGraph(dtypes).ok());
+}
+
+TEST(SessionSuite, KernelsConstructedInParallel)
+{
+    GraphDef graph;
+    std::vector<NodeDef*> nodes;
+    for (int i = 0; i < 64; ++i)
+    {
+        nodes.push_back(NodeDefBuilder(graph, "session_slow_init", "CPU:0").
+            SetAttr("fail", false).
+            Name("init").
+            Build({DataType::Float}));
+    }
+
+    SessionOptions options;
+    options.inter_op_threads = 4;
+    Session session(options);
+    init_threads.clear();
+    Status status = session.UpdateGraph(graph);
+    ASSERT_TRUE(status.ok()) << status.msg();
+    EXPECT_GT(init_threads.size(), 1);
+
+    // every node got its own kernel
+    std::vector<TensorBuffer> outputs;
+    ASSERT_TRUE(session.Run({}, nodes, outputs).ok());
+    EXPECT_EQ(outputs.size(), nodes.size());
+}
+
+TEST(SessionSuite, KernelConstructionErrors)
+{
+    GraphDef graph;
+    for (int i = 0; i < 32; ++i)
+    {
+        NodeDefBuilder(graph, "session_slow_init", "CPU:0").
+            SetAttr("fail", i == 5 || i == 20).
+            Name(i == 5 || i == 20 ? "bad" : "good").
+            Build({DataType::Float});
+    }
+
+    SessionOptions options;
+    options.inter_op_threads = 4;
+    Session session(options);
+    Status status = session.UpdateGraph(graph);
+    ASSERT_FALSE(status.ok());
+
+    // every failure is reported, in node order
+    std::string msg = status.msg();
+    EXPECT_NE(msg.find("Failed to create 2 of 32 nodes"), std::string::npos) << msg;
+    size_t first = msg.find("node \"bad\": intentional init failure");
+    size_t second = msg.find("node \"bad_1\": intentional init failure");
+    ASSERT_NE(first, std::string::npos) << msg;
+    ASSERT_NE(second, std::string::npos) << msg;
+    EXPECT_LT(first, second);
+
+    std::vector<TensorBuffer> outputs;
+    EXPECT_FALSE(session.Run({}, {}, outputs).ok());
+}
+
+TEST(SessionSuite, UpdateGraphReleasesLockOnException)
+{
+    GraphDef bad_graph;
+    NodeDefBuilder(bad_graph, "session_bad_alloc", "CPU:0").Build({DataType::Float});
+
+    Session session;
+    EXPECT_FALSE(session.UpdateGraph(bad_graph).ok());
+
+    // the session is still usable
+    GraphDef graph;
+    NodeDef* a = Fill(graph, 3.0f);
+    ASSERT_TRUE(session.UpdateGraph(graph).ok());
+    std::vector<TensorBuffer> outputs;
+    ASSERT_TRUE(session.Run({}, {a}, outputs).ok());
+    ExpectFilled(outputs[0], 3.0f);
+}
+
+TEST(SessionSuite, NodesRunOnDeviceWorkers)
+{
+    GraphDef graph;
+    NodeDef* a = NodeDefBuilder(graph, "session_fill", "NUMA_CPU:0").
+        SetAttr("value", 1.0f).
+        Name("fill").
+        Build({DataType::Float});
+    NodeDef* b = NodeDefBuilder(graph, "session_fill", "NUMA_CPU:1").
+        SetAttr("value", 2.0f).
+        Name("fill").
+        Build({DataType::Float});
+    NodeDef* parallel = NodeDefBuilder(graph, "session_parallel", "NUMA_CPU:1").
+        Input(b, 0).
+        Name("parallel").
+        Build({DataType::Float});
+    NodeDef* sum = Add(graph, a, parallel);
+
+    SessionOptions options;
+    options.inter_op_threads = 4;
+    options.intra_op_threads = 3;
+    Session session(options);
+    ASSERT_TRUE(session.UpdateGraph(graph).ok());
+
+    for (int run = 0; run < 3; ++run)
+    {
+        std::vector<TensorBuffer> outputs;
+        ASSERT_TRUE(session.Run({}, {sum, parallel}, outputs).ok());
+        ASSERT_EQ(outputs.size(), 2);
+        ExpectFilled(outputs[0], 4.0f);
+        ExpectFilled(outputs[1], 3.0f);
+
+        // the device's single worker bounds the budget, not the session pool
+        EXPECT_EQ(last_budget.load(), 1);
+    }
+}
+
+TEST(SessionSuite, AttributesMemoryToNodes)
+{
+    Device* cpu = DeviceRegistry::instance().GetDevice("CPU:0");
+    cpu->set_memory_profiling(MemoryProfiling::Nodes);
+
+    GraphDef graph;
+    NodeDef* reverse = Unary(graph, "session_reverse", Fill(graph, 1.0f));
+
+    Session session;
+    ASSERT_TRUE(session.UpdateGraph(graph).ok());
+    std::vector<TensorBuffer> outputs;
+    ASSERT_TRUE(session.Run({}, {reverse}, outputs).ok());
+
+    // the kernel's scratch memory is the node's
+    std::unordered_map<std::string, MemoryStats> nodes = cpu->node_memory_stats();
+    ASSERT_TRUE(nodes.count("session_reverse"));
+    EXPECT_GE(nodes["session_reverse"].num_allocs, 1);
+
+    cpu->set_memory_profiling(MemoryProfiling::Off);
+}
+
+int main(int argc, char **argv) 
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,280 @@
+#include <gtest/gtest.h>
+#include <graphloom/graphloom.h>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "feed_placeholder.h"
+
+using namespace graphloom;
+
+static Initializer register_sparse_input = 
+    RegisterFeedPlaceholder<DataType::Float, DataType::Int32, DataType::Double>("sparse_input");
+
+Device* Cpu0()
+{
+    return DeviceRegistry::instance().GetDevice("CPU:0");
+}
+
+/**
+ * @returns Matrix whose values are zero with probability
+ * 1 - density, row 1 is dense if it exists
+*/
+template<typename T>
+TensorBuffer RandomSparse(DataType dtype, size_t rows, size_t cols, double density, unsigned seed)
+{
+    TensorBuffer tensor(dtype, {rows, cols}, Cpu0());
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> value(-1.0, 1.0);
+    std::uniform_real_distribution<double> keep(0.0, 1.0);
+    T* data = tensor.Map<T>().data();
+    for (size_t i = 0; i < tensor.size(); ++i)
+    {
+        bool dense_row = i / cols == 1;
+        data[i] = dense_row || keep(rng) < density ? T(value(rng)) : T(0);
+    }
+    return tensor;
+}
+
+TensorBuffer Indices(const std::vector<int32_t>& indices)
+{
+    TensorBuffer tensor(DataType::Int32, {indices.size()}, Cpu0());
+    std::copy(indices.begin(), indices.end(), tensor.Map<int32_t>().data());
+    return tensor;
+}
+
+TensorBuffer Values(const std::vector<float>& values)
+{
+    TensorBuffer tensor(DataType::Float, {values.size()}, Cpu0());
+    std::copy(values.begin(), values.end(), tensor.Map<float>().data());
+    return tensor;
+}
+
+template<typename T>
+void ExpectEqual(const TensorBuffer& a, const TensorBuffer& b)
+{
+    ASSERT_EQ(a.size(), b.size());
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        ASSERT_EQ(a.Map<T>().data()[i], b.Map<T>().data()[i]) << "Mismatch at " << i;
+    }
+}
+
+TEST(SparseSuite, Registered)
+{
+    for (const char* name : {"CsrMatMul", "BsrMatMul"})
+    {
+        ASSERT_TRUE(OpRegistry::instance().HasOp(name)) << name;
+        EXPECT_EQ(OpRegistry::instance().GetOp(name).num_inputs(), 4);
+    }
+}
+
+TEST(SparseSuite, FromDense)
+{
+    TensorBuffer dense = RandomSparse<float>(DataType::Float, 12, 20, 0.1, 1);
+    size_t nonzeros = 0;
+    for (size_t i = 0; i < dense.size(); ++i)
+    {
+        nonzeros += dense.Map<float>().data()[i] != 0.0f;
+    }
+
+    for (SparseFormat format : {SparseFormat::Coo, SparseFormat::Csr})
+    {
+        SparseTensor sparse = SparseTensor::FromDense(dense, format);
+        EXPECT_EQ(sparse.format(), format);
+        EXPECT_EQ(sparse.dtype(), DataType::Float);
+        EXPECT_EQ(sparse.shape()[0], 12);
+        EXPECT_EQ(sparse.shape()[1], 20);
+        EXPECT_EQ(sparse.nnz(), nonzeros);
+        EXPECT_LT(sparse.bytes(), dense.bytes());
+        ExpectEqual<float>(sparse.ToDense(), dense);
+        ExpectEqual<float>(sparse.ToCsr().ToDense(), dense);
+    }
+
+    SparseTensor bsr = SparseTensor::FromDense(dense, SparseFormat::Bsr, 4, 5);
+    EXPECT_EQ(bsr.block_rows(), 4);
+    EXPECT_EQ(bsr.block_cols(), 5);
+    EXPECT_EQ(bsr.values().shape()[0], bsr.col_indices().size());
+    EXPECT_EQ(bsr.row_offsets().size(), 4);
+    ExpectEqual<float>(bsr.ToDense(), dense);
+    ExpectEqual<float>(bsr.ToCsr().ToDense(), dense);
+    EXPECT_EQ(bsr.ToCsr().nnz(), bsr.nnz());
+
+    TensorBuffer double_dense = RandomSparse<double>(DataType::Double, 6, 6, 0.3, 2);
+    ExpectEqual<double>(SparseTensor::FromDense(double_dense, SparseFormat::Bsr, 2, 3).ToDense(), double_dense);
+
+    // a transposed view is read in its logical order
+    ExpectEqual<float>(SparseTensor::FromDense(dense.Transpose(), SparseFormat::Csr).ToDense(),
+        dense.Transpose().Contiguous());
+
+    EXPECT_THROW(SparseTensor::FromDense(dense, SparseFormat::Bsr, 5, 5), GlException);
+    EXPECT_THROW(SparseTensor::FromDense(TensorBuffer(DataType::Int32, {2, 2}, Cpu0()), SparseFormat::Csr), GlException);
+    EXPECT_THROW(SparseTensor::FromDense(TensorBuffer(DataType::Float, {8}, Cpu0()), SparseFormat::Csr), GlException);
+}
+
+TEST(SparseSuite, Components)
+{
+    // [[0, 1, 0], [0, 0, 0], [2, 0, 3]]
+    SparseTensor coo = SparseTensor::Coo({3, 3}, Indices({0, 2, 2}), Indices({1, 0, 2}), Values({1, 2, 3}));
+    SparseTensor csr = SparseTensor::Csr({3, 3}, Indices({0, 1, 1, 3}), Indices({1, 0, 2}), Values({1, 2, 3}));
+    ExpectEqual<float>(coo.ToDense(), csr.ToDense());
+    ExpectEqual<int32_t>(coo.ToCsr().row_offsets(), csr.row_offsets());
+    EXPECT_EQ(csr.ToDense().Map<float>()(2, 2), 3.0f);
+    EXPECT_THROW(coo.row_offsets(), GlException);
+    EXPECT_THROW(csr.row_indices(), GlException);
+
+    // unsorted, duplicated and out of range coordinates
+    EXPECT_THROW(SparseTensor::Coo({3, 3}, Indices({2, 0}), Indices({0, 1}), Values({1, 2})), GlException);
+    EXPECT_THROW(SparseTensor::Coo({3, 3}, Indices({0, 0}), Indices({1, 1}), Values({1, 2})), GlException);
+    EXPECT_THROW(SparseTensor::Coo({3, 3}, Indices({0}), Indices({3}), Values({1})), GlException);
+
+    // offsets not ending at nnz, decreasing or of the wrong count
+    EXPECT_THROW(SparseTensor::Csr({3, 3}, Indices({0, 1, 1, 2}), Indices({1, 0, 2}), Values({1, 2, 3})), GlException);
+    EXPECT_THROW(SparseTensor::Csr({3, 3}, Indices({0, 2, 1, 3}), Indices({1, 0, 2}), Values({1, 2, 3})), GlException);
+    EXPECT_THROW(SparseTensor::Csr({3, 3}, Indices({0, 3}), Indices({1, 0, 2}), Values({1, 2, 3})), GlException);
+
+    // blocks of 1 x 2 in a 2 x 4 matrix
+    TensorBuffer blocks(DataType::Float, {1, 1, 2}, Cpu0());
+    blocks.Map<float>().data()[0] = 4.0f;
+    blocks.Map<float>().data()[1] = 5.0f;
+    SparseTensor bsr = SparseTensor::Bsr({2, 4}, Indices({0, 0, 1}), Indices({1}), blocks);
+    EXPECT_EQ(bsr.ToDense().Map<float>()(1, 3), 5.0f);
+    EXPECT_THROW(SparseTensor::Bsr({2, 4}, Indices({0, 0, 1}), Indices({2}), blocks), GlException);
+    EXPECT_THROW(SparseTensor::Bsr({2, 3}, Indices({0, 0, 1}), Indices({1}), blocks), GlException);
+}
+
+/**
+ * Runs op on the components of sparse times b and
+ * checks it against the dense product
+*/
+template<typename T>
+void CheckSparseMatMul(const char* op, const SparseTensor& sparse, const TensorBuffer& b, size_t threads)
+{
+    DataType dtype = sparse.dtype();
+    GraphDef graph;
+    NodeDef* offsets = NodeDefBuilder(graph, "sparse_input", "CPU:0").Name("offsets").Build({DataType::Int32});
+    NodeDef* cols = NodeDefBuilder(graph, "sparse_input", "CPU:0").Name("cols").Build({DataType::Int32});
+    NodeDef* values = NodeDefBuilder(graph, "sparse_input", "CPU:0").Name("values").Build({dtype});
+    NodeDef* dense = NodeDefBuilder(graph, "sparse_input", "CPU:0").Name("b").Build({dtype});
+    NodeDef* c = NodeDefBuilder(graph, op, "CPU:0").
+        Input(offsets, 0).
+        Input(cols, 0).
+        Input(values, 0).
+        Input(dense, 0).
+        Name("c").
+        Build({dtype});
+
+    SessionOptions options;
+    options.inter_op_threads = threads;
+    Session session(options);
+    ASSERT_TRUE(session.UpdateGraph(graph).ok());
+
+    TensorBuffer offsets_value = sparse.row_offsets();
+    TensorBuffer cols_value = sparse.col_indices();
+    TensorBuffer values_value = sparse.values();
+    TensorBuffer b_value = b;
+
+    std::vector<TensorBuffer> outputs;
+    Status status = session.Run({{offsets, &offsets_value}, {cols, &cols_value},
+        {values, &values_value}, {dense, &b_value}}, {c}, outputs);
+    ASSERT_TRUE(status.ok()) << status.msg();
+
+    const TensorBuffer a = sparse.ToDense();
+    size_t m = a.shape()[0], k = a.shape()[1], n = b.shape()[1];
+    ASSERT_EQ(outputs[0].shape()[0], m);
+    ASSERT_EQ(outputs[0].shape()[1], n);
+    for (size_t i = 0; i < m; ++i)
+    {
+        for (size_t j = 0; j < n; ++j)
+        {
+            double expected = 0.0;
+            double magnitude = 0.0;
+            for (size_t p = 0; p < k; ++p)
+            {
+                double product = double(a.Map<T>()(i, p)) * double(b.Map<T>()(p, j));
+                expected += product;
+                magnitude += std::fabs(product);
+            }
+            double tolerance = 1e-5 * magnitude + 1e-30;
+            ASSERT_NEAR(outputs[0].Map<T>()(i, j), expected, tolerance)
+                << op << " mismatch at (" << i << ", " << j << ")";
+        }
+    }
+}
+
+TEST(SparseSuite, CsrMatMul)
+{
+    for (CpuIsa isa : {CpuIsa::Generic, CpuIsa::Avx2, CpuIsa::Avx512})
+    {
+        if (!CpuIsaSupported(isa)) continue;
+        LimitCpuIsa(isa);
+
+        TensorBuffer a = RandomSparse<float>(DataType::Float, 150, 90, 0.05, 3);
+        SparseTensor csr = SparseTensor::FromDense(a, SparseFormat::Csr);
+        CheckSparseMatMul<float>("CsrMatMul", csr, RandomSparse<float>(DataType::Float, 90, 37, 1.0, 4), 1);
+        CheckSparseMatMul<float>("CsrMatMul", csr, RandomSparse<float>(DataType::Float, 90, 37, 1.0, 4), 4);
+        CheckSparseMatMul<float>("CsrMatMul", csr, RandomSparse<float>(DataType::Float, 90, 1, 1.0, 5), 4);
+
+        // empty rows, and large enough to split across threads
+        TensorBuffer large = RandomSparse<double>(DataType::Double, 400, 300, 0.02, 6);
+        SparseTensor large_csr = SparseTensor::FromDense(large, SparseFormat::Csr);
+        CheckSparseMatMul<double>("CsrMatMul", large_csr, RandomSparse<double>(DataType::Double, 300, 64, 1.0, 7), 4);
+        CheckSparseMatMul<double>("CsrMatMul", large_csr, RandomSparse<double>(DataType::Double, 300, 1, 1.0, 8), 4);
+
+        TensorBuffer zeros = RandomSparse<float>(DataType::Float, 7, 5, 0.0, 9);
+        EXPECT_EQ(SparseTensor::FromDense(zeros.Slice(0, 2, 7), SparseFormat::Csr).nnz(), 1);
+        CheckSparseMatMul<float>("CsrMatMul", SparseTensor::FromDense(zeros.Slice(0, 2, 7), SparseFormat::Csr),
+            RandomSparse<float>(DataType::Float, 5, 3, 1.0, 10), 1);
+    }
+    LimitCpuIsa(CpuIsa::Avx512Bf16);
+}
+
+TEST(SparseSuite, BsrMatMul)
+{
+    for (CpuIsa isa : {CpuIsa::Generic, CpuIsa::Avx2, CpuIsa::Avx512})
+    {
+        if (!CpuIsaSupported(isa)) continue;
+        LimitCpuIsa(isa);
+
+        TensorBuffer a = RandomSparse<float>(DataType::Float, 64, 96, 0.01, 11);
+        SparseTensor bsr = SparseTensor::FromDense(a, SparseFormat::Bsr, 4, 8);
+        CheckSparseMatMul<float>("BsrMatMul", bsr, RandomSparse<float>(DataType::Float, 96, 33, 1.0, 12), 1);
+        CheckSparseMatMul<float>("BsrMatMul", bsr, RandomSparse<float>(DataType::Float, 96, 1, 1.0, 13), 4);
+
+        TensorBuffer large = RandomSparse<double>(DataType::Double, 300, 200, 0.005, 14);
+        SparseTensor large_bsr = SparseTensor::FromDense(large, SparseFormat::Bsr, 3, 2);
+        CheckSparseMatMul<double>("BsrMatMul", large_bsr, RandomSparse<double>(DataType::Double, 200, 70, 1.0, 15), 4);
+    }
+    LimitCpuIsa(CpuIsa::Avx512Bf16);
+}
+
+TEST(SparseSuite, InvalidIndices)
+{
+    GraphDef graph;
+    NodeDef* offsets = NodeDefBuilder(graph, "sparse_input", "CPU:0").Name("offsets").Build({DataType::Int32});
+    NodeDef* cols = NodeDefBuilder(graph, "sparse_input", "CPU:0").Name("cols").Build({DataType::Int32});
+    NodeDef* values = NodeDefBuilder(graph, "sparse_input", "CPU:0").Name("values").Build({DataType::Float});
+    NodeDef* b = NodeDefBuilder(graph, "sparse_input", "CPU:0").Name("b").Build({DataType::Float});
+    NodeDef* c = NodeDefBuilder(graph, "CsrMatMul", "CPU:0").
+        Input(offsets, 0).Input(cols, 0).Input(values, 0).Input(b, 0).Name("c").Build({DataType::Float});
+
+    Session session;
+    ASSERT_TRUE(session.UpdateGraph(graph).ok());
+
+    // components fed directly are not checked by SparseTensor
+    TensorBuffer b_value = RandomSparse<float>(DataType::Float, 3, 2, 1.0, 16);
+    TensorBuffer values_value = Values({1, 2});
+    TensorBuffer good_offsets = Indices({0, 1, 2});
+    TensorBuffer bad_offsets = Indices({0, 2, 1});
+    TensorBuffer good_cols = Indices({0, 2});
+    TensorBuffer bad_cols = Indices({0, 3});
+
+    std::vector<TensorBuffer> outputs;
+    EXPECT_TRUE(session.Run({{offsets, &good_offsets}, {cols, &good_cols},
+        {values, &values_value}, {b, &b_value}}, {c}, outputs).ok());
+    EXPECT_FALSE(session.Run({{offsets, &bad_offsets}, {cols, &good_cols},
+        {values, &values_value}, {b, &b_value}}, {c}, outputs).ok());
+    EXPECT_FALSE(session.Run({{offsets, &good_offsets}, {cols, &bad_cols},
+        {values, &values_value}, {b, &b_value}}, {c}, outputs).ok());
+}
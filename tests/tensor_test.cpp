@@ -0,0 +1,348 @@
+#include <gtest/gtest.h>
+#include <graphloom/graphloom.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace graphloom;
+
+Device* Cpu0()
+{
+    return DeviceRegistry::instance().GetDevice("CPU:0");
+}
+
+// rank 3 tensor holding 0, 1, 2, ... in row major order
+TensorBuffer Iota(const LayoutArray& shape)
+{
+    TensorBuffer tensor(DataType::Float, shape, Cpu0());
+    float* data = tensor.Map<float>().data();
+    for (size_t i = 0; i < tensor.size(); ++i)
+    {
+        data[i] = static_cast<float>(i);
+    }
+    return tensor;
+}
+
+TEST(TensorSuite, ContiguousByDefault)
+{
+    TensorBuffer tensor(DataType::Float, {2, 3, 4}, Cpu0());
+    EXPECT_TRUE(tensor.IsContiguous());
+    EXPECT_EQ(tensor.offset(), 0);
+    EXPECT_EQ(tensor.strides()[0], 12);
+    EXPECT_EQ(tensor.strides()[1], 4);
+    EXPECT_EQ(tensor.strides()[2], 1);
+
+    TensorBuffer empty;
+    EXPECT_EQ(empty.size(), 0);
+    EXPECT_EQ(empty.device(), nullptr);
+}
+
+TEST(TensorSuite, SliceSharesStorage)
+{
+    TensorBuffer tensor = Iota({4, 5});
+    TensorBuffer rows = tensor.Slice(0, 1, 3);
+    ASSERT_EQ(rows.shape()[0], 2);
+    EXPECT_EQ(rows.offset(), 5);
+    EXPECT_TRUE(rows.IsContiguous());
+    EXPECT_EQ(rows.Map<float>()(0, 0), 5.0f);
+
+    // column slices skip elements of each row
+    TensorBuffer cols = tensor.Slice(1, 2, 4);
+    EXPECT_FALSE(cols.IsContiguous());
+    EXPECT_EQ(cols.Map<float>()(3, 1), 18.0f);
+
+    // writes through a view reach the tensor
+    cols.Map<float>()(0, 0) = -1.0f;
+    EXPECT_EQ(tensor.Map<float>()(0, 2), -1.0f);
+
+    EXPECT_THROW(tensor.Slice(0, 3, 3), GlException);
+    EXPECT_THROW(tensor.Slice(1, 0, 6), GlException);
+    EXPECT_THROW(tensor.Slice(2, 0, 1), GlException);
+}
+
+TEST(TensorSuite, Transpose)
+{
+    TensorBuffer tensor = Iota({2, 3, 4});
+    TensorBuffer t = tensor.Transpose({2, 0, 1});
+    ASSERT_EQ(t.shape()[0], 4);
+    ASSERT_EQ(t.shape()[1], 2);
+    ASSERT_EQ(t.shape()[2], 3);
+    EXPECT_FALSE(t.IsContiguous());
+    EXPECT_EQ(t.Map<float>()(3, 1, 2), tensor.Map<float>()(1, 2, 3));
+
+    TensorBuffer matrix = Iota({3, 5});
+    TensorBuffer reversed = matrix.Transpose();
+    EXPECT_EQ(reversed.shape()[0], 5);
+    EXPECT_EQ(reversed.Map<float>()(4, 1), 9.0f);
+
+    EXPECT_THROW(tensor.Transpose({0, 0, 1}), GlException);
+    EXPECT_THROW(tensor.Transpose({0, 1}), GlException);
+}
+
+TEST(TensorSuite, Broadcast)
+{
+    TensorBuffer row = Iota({1, 3});
+    TensorBuffer b = row.Broadcast({2, 4, 3});
+    ASSERT_EQ(b.shape().rank(), 3);
+    EXPECT_EQ(b.strides()[0], 0);
+    EXPECT_EQ(b.strides()[1], 0);
+    EXPECT_EQ(b.strides()[2], 1);
+    EXPECT_EQ(b.Map<float>()(1, 3, 2), 2.0f);
+
+    EXPECT_THROW(row.Broadcast({2, 2}), GlException);
+    EXPECT_THROW(row.Broadcast({3}), GlException);
+}
+
+TEST(TensorSuite, View)
+{
+    TensorBuffer tensor = Iota({2, 3, 4});
+    TensorBuffer flat = tensor.View({24});
+    EXPECT_TRUE(flat.IsContiguous());
+    EXPECT_EQ(flat.Map<float>()(17), 17.0f);
+
+    // splitting a dimension of a strided view keeps its stride
+    TensorBuffer cols = Iota({4, 6}).Slice(1, 0, 4);
+    TensorBuffer split = cols.View({4, 2, 2});
+    EXPECT_EQ(split.Map<float>()(2, 1, 0), 14.0f);
+
+    // merging the dimensions of a transpose needs a copy
+    TensorBuffer t = tensor.Transpose();
+    EXPECT_THROW(t.View({24}), GlException);
+    EXPECT_THROW(tensor.View({5, 5}), GlException);
+
+    EXPECT_TRUE(tensor.Reshape({6, 4}).ok());
+    EXPECT_EQ(tensor.strides()[0], 4);
+    EXPECT_FALSE(t.Reshape({24}).ok());
+}
+
+TEST(TensorSuite, Contiguous)
+{
+    TensorBuffer tensor = Iota({3, 4});
+    TensorBuffer same = tensor.Contiguous();
+    EXPECT_EQ(same.Map<float>().data(), tensor.Map<float>().data());
+
+    TensorBuffer packed = tensor.Transpose().Contiguous();
+    ASSERT_TRUE(packed.IsContiguous());
+    ASSERT_EQ(packed.shape()[0], 4);
+    const float* data = packed.Map<float>().data();
+    for (size_t i = 0; i < 4; ++i)
+    {
+        for (size_t j = 0; j < 3; ++j)
+        {
+            EXPECT_EQ(data[i * 3 + j], static_cast<float>(j * 4 + i));
+        }
+    }
+
+    TensorBuffer rows = Iota({4, 6}).Slice(1, 1, 5).Contiguous();
+    EXPECT_EQ(rows.Map<float>().data()[4], 7.0f);
+}
+
+TEST(TensorSuite, ViewOutlivesTensor)
+{
+    TensorBuffer view;
+    {
+        TensorBuffer tensor = Iota({8});
+        view = tensor.Slice(0, 4, 8);
+    }
+    EXPECT_EQ(view.Map<float>()(0), 4.0f);
+    EXPECT_EQ(view.Map<float>()(3), 7.0f);
+}
+
+TEST(TensorSuite, RankedMap)
+{
+    TensorBuffer tensor = Iota({2, 3, 4});
+    TensorMap<float, 3> map = tensor.Map<float, 3>();
+    EXPECT_EQ(map.dim(1), 3);
+    EXPECT_EQ(map.stride(0), 12);
+    EXPECT_EQ(map.size(), 24);
+    EXPECT_EQ(map(1, 2, 3), 23.0f);
+
+    // ranked maps follow the strides of views
+    TensorMap<float, 3> t = tensor.Transpose({2, 0, 1}).Map<float, 3>();
+    EXPECT_EQ(t(3, 1, 2), 23.0f);
+    EXPECT_FALSE(t.IsContiguous());
+    EXPECT_THROW(t.begin(), GlException);
+
+    EXPECT_THROW((tensor.Map<float, 2>()), GlException);
+    EXPECT_THROW((tensor.Map<double, 3>()), GlException);
+}
+
+TEST(TensorSuite, MapIterators)
+{
+    TensorBuffer tensor = Iota({3, 4});
+    float expected = 0.0f;
+    for (float value : tensor.Map<float, 2>())
+    {
+        EXPECT_EQ(value, expected++);
+    }
+    EXPECT_EQ(expected, 12.0f);
+
+    float sum = 0.0f;
+    for (float value : tensor.Slice(0, 1, 3).Map<float>())
+    {
+        sum += value;
+    }
+    EXPECT_EQ(sum, 4.0f + 5 + 6 + 7 + 8 + 9 + 10 + 11);
+
+    EXPECT_THROW(tensor.Slice(1, 0, 2).Map<float>().begin(), GlException);
+}
+
+TEST(TensorSuite, StaticMap)
+{
+    TensorBuffer tensor = Iota({2, 3, 4});
+    auto map = tensor.StaticMap<float, 2, 3, 4>();
+    static_assert(decltype(map)::kSize == 24, "size is a compile time constant");
+    EXPECT_EQ(map(1, 2, 3), 23.0f);
+    EXPECT_EQ(map(0, 1, 0), 4.0f);
+    EXPECT_EQ(map.end() - map.begin(), 24);
+
+    const TensorBuffer& ref = tensor;
+    EXPECT_EQ((ref.StaticMap<float, 2, 3, 4>()(1, 0, 0)), 12.0f);
+
+    EXPECT_THROW((tensor.StaticMap<float, 4, 3, 2>()), GlException);
+    EXPECT_THROW((tensor.StaticMap<float, 24>()), GlException);
+    EXPECT_THROW((tensor.Slice(2, 0, 2).StaticMap<float, 2, 3, 2>()), GlException);
+}
+
+TEST(TensorSuite, CopyOnWrite)
+{
+    TensorBuffer tensor = Iota({2, 3});
+    TensorBuffer copy(tensor);
+    const TensorBuffer& view = copy;
+    EXPECT_EQ(view.Map<float>().data(), static_cast<const TensorBuffer&>(tensor).Map<float>().data());
+
+    // the first write copies the storage, the other tensor keeps it
+    copy.Map<float>()(1, 2) = -1.0f;
+    EXPECT_EQ(copy.Map<float>()(1, 2), -1.0f);
+    EXPECT_EQ(tensor.Map<float>()(1, 2), 5.0f);
+    EXPECT_NE(copy.Map<float>().data(), tensor.Map<float>().data());
+
+    // once the copies are gone writes stay in place
+    const float* data = nullptr;
+    {
+        TensorBuffer assigned;
+        assigned = tensor;
+        data = static_cast<const TensorBuffer&>(assigned).Map<float>().data();
+    }
+    EXPECT_EQ(tensor.Map<float>().data(), data);
+
+    TensorBuffer strided = Iota({4, 6}).Slice(1, 2, 4);
+    TensorBuffer strided_copy = strided;
+    strided_copy.Map<float>()(3, 1) = 0.0f;
+    EXPECT_TRUE(strided_copy.IsContiguous());
+    EXPECT_EQ(strided.Map<float>()(3, 1), 21.0f);
+}
+
+TEST(TensorSuite, CopyOnWriteKeepsViews)
+{
+    TensorBuffer tensor = Iota({2, 3});
+    TensorBuffer row = tensor.Slice(0, 1, 2);
+    {
+        TensorBuffer copy(tensor);
+    }
+
+    // views are not copies, the write reaches the view
+    tensor.Map<float>()(1, 0) = -1.0f;
+    EXPECT_EQ(row.Map<float>()(0, 0), -1.0f);
+
+    // a live copy and its views keep the old values
+    TensorBuffer copy(tensor);
+    TensorBuffer copy_row = copy.Slice(0, 1, 2);
+    tensor.Map<float>()(1, 1) = -2.0f;
+    EXPECT_EQ(row.Map<float>()(0, 1), 4.0f);
+    EXPECT_EQ(copy_row.Map<float>()(0, 1), 4.0f);
+    EXPECT_EQ(tensor.Map<float>()(1, 1), -2.0f);
+}
+
+TEST(TensorSuite, Clone)
+{
+    TensorBuffer tensor = Iota({3, 4});
+    TensorBuffer clone = tensor.Clone();
+    EXPECT_NE(clone.Map<float>().data(), tensor.Map<float>().data());
+    EXPECT_EQ(clone.Map<float>()(2, 3), 11.0f);
+
+    TensorBuffer packed = tensor.Transpose().Clone();
+    EXPECT_TRUE(packed.IsContiguous());
+    EXPECT_EQ(packed.Map<float>()(3, 2), 11.0f);
+
+    EXPECT_EQ(TensorBuffer().Clone().size(), 0);
+}
+
+// writes count floats 0, 1, 2, ... after header_bytes zero bytes
+std::string WriteFloats(const std::string& name, size_t header_bytes, size_t count)
+{
+    std::string path = testing::TempDir() + name;
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    std::vector<char> header(header_bytes, 0);
+    file.write(header.data(), header.size());
+    for (size_t i = 0; i < count; ++i)
+    {
+        float value = static_cast<float>(i);
+        file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+    return path;
+}
+
+TEST(TensorSuite, MapFileReadOnly)
+{
+    // the data starts inside the first page
+    std::string path = WriteFloats("graphloom_map_read_only.bin", 12, 24);
+    TensorBuffer tensor;
+    MapFileOptions options;
+    options.advice = MapAdvice::Sequential;
+    ASSERT_TRUE(TensorBuffer::MapFile(path, 12, DataType::Float, {2, 3, 4}, 
+        Cpu0(), options, tensor).ok());
+
+    const TensorBuffer& ref = tensor;
+    EXPECT_EQ(ref.Map<float>()(1, 2, 3), 23.0f);
+    TensorBuffer rows = tensor.Slice(0, 1, 2);
+    EXPECT_EQ(static_cast<const TensorBuffer&>(rows).Map<float>()(0, 0, 1), 13.0f);
+
+    // writes go to a private copy, the file is untouched
+    tensor.Map<float>()(0, 0, 0) = -1.0f;
+    EXPECT_EQ(tensor.Map<float>()(0, 0, 0), -1.0f);
+
+    TensorBuffer again;
+    ASSERT_TRUE(TensorBuffer::MapFile(path, 12, DataType::Float, {24}, 
+        Cpu0(), MapFileOptions(), again).ok());
+    EXPECT_EQ(static_cast<const TensorBuffer&>(again).Map<float>()(0), 0.0f);
+    std::remove(path.c_str());
+}
+
+TEST(TensorSuite, MapFileCopyOnWrite)
+{
+    std::string path = WriteFloats("graphloom_map_cow.bin", 0, 8);
+    TensorBuffer tensor;
+    MapFileOptions options;
+    options.mode = MapMode::CopyOnWrite;
+    ASSERT_TRUE(TensorBuffer::MapFile(path, 4, DataType::Float, {7}, 
+        Cpu0(), options, tensor).ok());
+
+    // written in place, the mapping is private
+    float* data = tensor.Map<float>().data();
+    data[0] = 100.0f;
+    EXPECT_EQ(tensor.Map<float>().data(), data);
+    EXPECT_EQ(tensor.Map<float>()(0), 100.0f);
+    EXPECT_EQ(tensor.Map<float>()(6), 7.0f);
+
+    std::ifstream file(path, std::ios::binary);
+    float first[2];
+    file.read(reinterpret_cast<char*>(first), sizeof(first));
+    EXPECT_EQ(first[1], 1.0f);
+    std::remove(path.c_str());
+}
+
+TEST(TensorSuite, MapFileErrors)
+{
+    std::string path = WriteFloats("graphloom_map_errors.bin", 0, 4);
+    TensorBuffer tensor;
+    EXPECT_FALSE(TensorBuffer::MapFile(path + ".missing", 0, DataType::Float, {4}, 
+        Cpu0(), MapFileOptions(), tensor).ok());
+    EXPECT_FALSE(TensorBuffer::MapFile(path, 4, DataType::Float, {4}, 
+        Cpu0(), MapFileOptions(), tensor).ok());
+    EXPECT_FALSE(TensorBuffer::MapFile(path, 0, DataType::Float, {4}, 
+        nullptr, MapFileOptions(), tensor).ok());
+    EXPECT_EQ(tensor.size(), 0);
+    std::remove(path.c_str());
+}
@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "common/thread_pool.h"
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+using namespace graphloom;
+
+TEST(ThreadPoolSuite, RunsEveryTask)
+{
+    std::atomic<int> count{0};
+    {
+        ThreadPool pool(4, 0);
+        EXPECT_EQ(pool.num_threads(), 4);
+        EXPECT_EQ(pool.CurrentThreadId(), -1);
+
+        for (int i = 0; i < 1000; ++i)
+        {
+            pool.Schedule([&count]() { ++count; });
+        }
+    }
+
+    // destruction runs the queued tasks
+    EXPECT_EQ(count.load(), 1000);
+}
+
+TEST(ThreadPoolSuite, NestedTasksRunOnWorkers)
+{
+    std::atomic<int> count{0};
+    std::atomic<int> outside{0};
+    {
+        ThreadPool pool(3);
+        for (int i = 0; i < 10; ++i)
+        {
+            pool.Schedule([&]() {
+                if (pool.CurrentThreadId() < 0) ++outside;
+                for (int j = 0; j < 10; ++j)
+                {
+                    pool.Schedule([&]() {
+                        if (pool.CurrentThreadId() < 0) ++outside;
+                        ++count;
+                    });
+                }
+            });
+        }
+    }
+    EXPECT_EQ(count.load(), 100);
+    EXPECT_EQ(outside.load(), 0);
+}
+
+TEST(ThreadPoolSuite, ParallelForCoversRange)
+{
+    ThreadPool pool(4);
+    for (size_t n : {0, 1, 7, 100, 12345})
+    {
+        std::vector<std::atomic<int>> hits(n);
+        pool.ParallelFor(n, 4, 3, [&](size_t begin, size_t end) {
+            ASSERT_LT(begin, end);
+            for (size_t i = begin; i < end; ++i)
+            {
+                ++hits[i];
+            }
+        });
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            ASSERT_EQ(hits[i].load(), 1) << "Iteration " << i << " of " << n;
+        }
+    }
+}
+
+TEST(ThreadPoolSuite, ParallelForRespectsBudget)
+{
+    ThreadPool pool(4);
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+
+    pool.ParallelFor(64, 2, 1, [&](size_t begin, size_t end) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        std::lock_guard<std::mutex> lock(mutex);
+        threads.insert(std::this_thread::get_id());
+    });
+    EXPECT_LE(threads.size(), 2);
+
+    // a budget of 1 runs on the caller
+    threads.clear();
+    pool.ParallelFor(64, 1, 1, [&](size_t begin, size_t end) {
+        std::lock_guard<std::mutex> lock(mutex);
+        threads.insert(std::this_thread::get_id());
+    });
+    ASSERT_EQ(threads.size(), 1);
+    EXPECT_EQ(*threads.begin(), std::this_thread::get_id());
+}
+
+TEST(ThreadPoolSuite, ParallelForInsideTasks)
+{
+    // every worker blocks in a ParallelFor, callers
+    // must finish the chunks themselves
+    ThreadPool pool(2);
+    std::atomic<size_t> total{0};
+    std::atomic<int> done{0};
+    for (int i = 0; i < 8; ++i)
+    {
+        pool.Schedule([&]() {
+            pool.ParallelFor(100, 2, 1, [&](size_t begin, size_t end) {
+                total += end - begin;
+            });
+            ++done;
+        });
+    }
+
+    while (done.load() < 8)
+    {
+        std::this_thread::yield();
+    }
+    EXPECT_EQ(total.load(), 800);
+}
+
+TEST(ThreadPoolSuite, ParallelForRethrows)
+{
+    ThreadPool pool(2);
+    EXPECT_THROW(pool.ParallelFor(100, 2, 1, [](size_t begin, size_t end) {
+        if (begin == 0) throw std::runtime_error("chunk failed");
+    }), std::runtime_error);
+}
+
+#if defined(__linux__)
+TEST(ThreadPoolSuite, WorkersPinnedToCpus)
+{
+    cpu_set_t allowed;
+    ASSERT_EQ(sched_getaffinity(0, sizeof(allowed), &allowed), 0);
+    int cpu = 0;
+    while (!CPU_ISSET(cpu, &allowed)) ++cpu;
+
+    std::atomic<int> pinned{0};
+    {
+        ThreadPool pool(2, 0, {cpu});
+        for (int i = 0; i < 8; ++i)
+        {
+            pool.Schedule([&pinned, cpu]() {
+                cpu_set_t set;
+                if (sched_getaffinity(0, sizeof(set), &set) != 0) return;
+                if (CPU_COUNT(&set) == 1 && CPU_ISSET(cpu, &set)) ++pinned;
+            });
+        }
+    }
+    EXPECT_EQ(pinned.load(), 8);
+}
+#endif
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}